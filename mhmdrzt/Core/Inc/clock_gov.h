@@ -0,0 +1,40 @@
+/* clock_gov.h */
+#ifndef __CLOCK_GOV_H
+#define __CLOCK_GOV_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "main.h"
+
+/* Idle clock governor. After `idle_frames` SOFs without activity (key edge,
+   SETUP or OUT traffic, IN completions, bulk or stripe writes, a running
+   bench) HCLK is divided down with the AHB prescaler; the first activity
+   restores full speed. The PLL, and with it the 48 MHz USB clock,
+   keeps running throughout. */
+#define CLOCK_GOV_IDLE_FRAMES       1000U    /* 0 disables throttling */
+
+typedef struct
+{
+  uint16_t idle_frames;   /* SOFs without activity before throttling */
+  uint32_t throttles;
+  uint32_t boosts;
+  uint32_t wake_last;     /* activity to full HCLK, DWT cycles */
+  uint32_t wake_max;
+} ClockGov_StatsTypeDef;
+
+extern ClockGov_StatsTypeDef ClockGov_Stats;
+
+void    ClockGov_Init(void);
+void    ClockGov_SOF(void);
+void    ClockGov_Activity(void);
+uint8_t ClockGov_IsIdle(void);
+/* OTG turnaround time (GUSBCFG.TRDT) for `hclk` */
+uint32_t ClockGov_Trdt(uint32_t hclk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_GOV_H */
@@ -0,0 +1,145 @@
+/* clock_profile.h */
+#ifndef __CLOCK_PROFILE_H
+#define __CLOCK_PROFILE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+
+/* Build-time PLL solver for SystemClock_Config.
+
+   Given HSE_VALUE and the SYSCLK of the selected profile, picks PLL M/N/P/Q
+   so that the 48 MHz domain (OTG_FS) is exact, plus the matching regulator
+   scale, flash wait states and APB dividers. Anything that cannot be met
+   stops the build with #error instead of running USB off-frequency.
+
+     VCO input  = HSE / M          2 MHz when HSE allows it, else 1 MHz
+     VCO        = SYSCLK * P       100..432 MHz, P in {2, 4, 6, 8}
+     PLL48CK    = VCO / Q          exactly 48 MHz, Q in 2..15
+   The smallest P that satisfies all of the above wins.
+
+   Select a profile with -DCLOCK_PROFILE=CLOCK_PROFILE_EFFICIENCY. */
+#define CLOCK_PROFILE_PERFORMANCE   0U       /* 168 MHz, scale 1 */
+#define CLOCK_PROFILE_EFFICIENCY    1U       /* 48 MHz, scale 3 */
+
+#ifndef CLOCK_PROFILE
+#define CLOCK_PROFILE               CLOCK_PROFILE_PERFORMANCE
+#endif
+
+#if (CLOCK_PROFILE == CLOCK_PROFILE_PERFORMANCE)
+#define CLOCK_SYSCLK_HZ             168000000U
+#elif (CLOCK_PROFILE == CLOCK_PROFILE_EFFICIENCY)
+#define CLOCK_SYSCLK_HZ             48000000U
+#else
+#error "clock_profile.h: unknown CLOCK_PROFILE"
+#endif
+
+#define CLOCK_USB_HZ                48000000U
+
+/* ---- PLLM: VCO input frequency ---- */
+#if ((HSE_VALUE % 2000000U) == 0U) && ((HSE_VALUE / 2000000U) >= 2U) && ((HSE_VALUE / 2000000U) <= 63U)
+#define CLOCK_VCO_IN_HZ             2000000U
+#elif ((HSE_VALUE % 1000000U) == 0U) && ((HSE_VALUE / 1000000U) >= 2U) && ((HSE_VALUE / 1000000U) <= 63U)
+#define CLOCK_VCO_IN_HZ             1000000U
+#else
+#error "clock_profile.h: HSE_VALUE must be a whole number of MHz"
+#endif
+#define CLOCK_PLLM                  (HSE_VALUE / CLOCK_VCO_IN_HZ)
+
+/* ---- PLLP: first divider whose VCO also gives an exact 48 MHz ---- */
+#define CLOCK_VCO_FOR(p)            (CLOCK_SYSCLK_HZ * (p))
+#define CLOCK_VCO_OK(p)                                                    \
+  ((CLOCK_VCO_FOR(p) >= 100000000U) && (CLOCK_VCO_FOR(p) <= 432000000U) && \
+   ((CLOCK_VCO_FOR(p) % CLOCK_USB_HZ) == 0U) &&                            \
+   ((CLOCK_VCO_FOR(p) / CLOCK_USB_HZ) >= 2U) &&                            \
+   ((CLOCK_VCO_FOR(p) / CLOCK_USB_HZ) <= 15U) &&                           \
+   ((CLOCK_VCO_FOR(p) % CLOCK_VCO_IN_HZ) == 0U))
+
+#if CLOCK_VCO_OK(2U)
+#define CLOCK_PLLP_DIV              2U
+#define CLOCK_PLLP                  RCC_PLLP_DIV2
+#elif CLOCK_VCO_OK(4U)
+#define CLOCK_PLLP_DIV              4U
+#define CLOCK_PLLP                  RCC_PLLP_DIV4
+#elif CLOCK_VCO_OK(6U)
+#define CLOCK_PLLP_DIV              6U
+#define CLOCK_PLLP                  RCC_PLLP_DIV6
+#elif CLOCK_VCO_OK(8U)
+#define CLOCK_PLLP_DIV              8U
+#define CLOCK_PLLP                  RCC_PLLP_DIV8
+#else
+#error "clock_profile.h: no PLL setting gives this SYSCLK with an exact 48 MHz USB clock"
+#endif
+
+#define CLOCK_VCO_HZ                CLOCK_VCO_FOR(CLOCK_PLLP_DIV)
+#define CLOCK_PLLN                  (CLOCK_VCO_HZ / CLOCK_VCO_IN_HZ)
+#define CLOCK_PLLQ                  (CLOCK_VCO_HZ / CLOCK_USB_HZ)
+
+/* ---- Regulator scale (no over-drive) ---- */
+#if (CLOCK_SYSCLK_HZ <= 120000000U)
+#define CLOCK_VOLTAGE_SCALE         PWR_REGULATOR_VOLTAGE_SCALE3
+#elif (CLOCK_SYSCLK_HZ <= 144000000U)
+#define CLOCK_VOLTAGE_SCALE         PWR_REGULATOR_VOLTAGE_SCALE2
+#elif (CLOCK_SYSCLK_HZ <= 168000000U)
+#define CLOCK_VOLTAGE_SCALE         PWR_REGULATOR_VOLTAGE_SCALE1
+#else
+#error "clock_profile.h: SYSCLK above 168 MHz needs over-drive"
+#endif
+
+/* ---- Flash wait states, VDD 2.7..3.6 V: one per started 30 MHz ----
+   FLASH_LATENCY_n is defined as n by the HAL. */
+#define CLOCK_FLASH_WS              ((CLOCK_SYSCLK_HZ - 1U) / 30000000U)
+#define CLOCK_FLASH_LATENCY         ((uint32_t)CLOCK_FLASH_WS)
+
+/* ---- APB dividers: APB1 <= 45 MHz, APB2 <= 90 MHz ---- */
+#if (CLOCK_SYSCLK_HZ <= 45000000U)
+#define CLOCK_APB1_DIV              RCC_HCLK_DIV1
+#elif (CLOCK_SYSCLK_HZ <= 90000000U)
+#define CLOCK_APB1_DIV              RCC_HCLK_DIV2
+#else
+#define CLOCK_APB1_DIV              RCC_HCLK_DIV4
+#endif
+
+#if (CLOCK_SYSCLK_HZ <= 90000000U)
+#define CLOCK_APB2_DIV              RCC_HCLK_DIV1
+#else
+#define CLOCK_APB2_DIV              RCC_HCLK_DIV2
+#endif
+
+/* ---- Idle AHB divider for the clock governor ----
+   OTG_FS needs HCLK >= 14.2 MHz; PLL and the 48 MHz clock are untouched. */
+#if ((CLOCK_SYSCLK_HZ / 8U) >= 14200000U)
+#define CLOCK_IDLE_AHB_DIV          RCC_SYSCLK_DIV8
+#define CLOCK_IDLE_HCLK_HZ          (CLOCK_SYSCLK_HZ / 8U)
+#elif ((CLOCK_SYSCLK_HZ / 4U) >= 14200000U)
+#define CLOCK_IDLE_AHB_DIV          RCC_SYSCLK_DIV4
+#define CLOCK_IDLE_HCLK_HZ          (CLOCK_SYSCLK_HZ / 4U)
+#elif ((CLOCK_SYSCLK_HZ / 2U) >= 14200000U)
+#define CLOCK_IDLE_AHB_DIV          RCC_SYSCLK_DIV2
+#define CLOCK_IDLE_HCLK_HZ          (CLOCK_SYSCLK_HZ / 2U)
+#else
+#define CLOCK_IDLE_AHB_DIV          RCC_SYSCLK_DIV1
+#define CLOCK_IDLE_HCLK_HZ          CLOCK_SYSCLK_HZ
+#endif
+
+/* ---- Build-time checks on the solution ---- */
+#if (CLOCK_PLLN < 50U) || (CLOCK_PLLN > 432U)
+#error "clock_profile.h: PLLN out of range"
+#endif
+#if ((CLOCK_VCO_HZ / CLOCK_PLLQ) != CLOCK_USB_HZ) || ((CLOCK_VCO_HZ % CLOCK_PLLQ) != 0U)
+#error "clock_profile.h: USB clock is not exactly 48 MHz"
+#endif
+#if ((CLOCK_VCO_HZ / CLOCK_PLLP_DIV) != CLOCK_SYSCLK_HZ)
+#error "clock_profile.h: SYSCLK not reached"
+#endif
+#if (CLOCK_FLASH_WS > 7U)
+#error "clock_profile.h: flash wait states out of range"
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_PROFILE_H */
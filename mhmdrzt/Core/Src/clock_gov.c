@@ -0,0 +1,123 @@
+/* Src/clock_gov.c */
+#include "clock_gov.h"
+#include "clock_profile.h"
+#include "usbd_trace.h"
+
+ClockGov_StatsTypeDef ClockGov_Stats;
+
+static __IO uint16_t ClockGovIdle;
+static __IO uint8_t  ClockGovSlow;
+
+/* OTG turnaround time for a given HCLK (RM0090, TRDT table); the same
+   table holds for OTG_HS on its embedded full-speed PHY */
+uint32_t ClockGov_Trdt(uint32_t hclk)
+{
+    if (hclk < 15000000U) { return 0xFU; }
+    if (hclk < 16000000U) { return 0xEU; }
+    if (hclk < 17200000U) { return 0xDU; }
+    if (hclk < 18500000U) { return 0xCU; }
+    if (hclk < 20000000U) { return 0xBU; }
+    if (hclk < 21800000U) { return 0xAU; }
+    if (hclk < 24000000U) { return 0x9U; }
+    if (hclk < 27700000U) { return 0x8U; }
+    if (hclk < 32000000U) { return 0x7U; }
+    return 0x6U;
+}
+
+static void ClockGov_SetTrdt(uint32_t hclk)
+{
+    MODIFY_REG(USB_OTG_FS->GUSBCFG, USB_OTG_GUSBCFG_TRDT, ClockGov_Trdt(hclk) << USB_OTG_GUSBCFG_TRDT_Pos);
+#if (USBD_USE_OTG_HS != 0U)
+    MODIFY_REG(USB_OTG_HS->GUSBCFG, USB_OTG_GUSBCFG_TRDT, ClockGov_Trdt(hclk) << USB_OTG_GUSBCFG_TRDT_Pos);
+#endif
+}
+
+/* Switch the AHB prescaler and keep SystemCoreClock and the 1 ms tick in step */
+static void ClockGov_SetAHB(uint32_t div)
+{
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE, div);
+    SystemCoreClockUpdate();
+    (void)HAL_InitTick(TICK_INT_PRIORITY);
+}
+
+void ClockGov_Init(void)
+{
+    ClockGov_Stats.idle_frames = CLOCK_GOV_IDLE_FRAMES;
+    ClockGov_Stats.throttles = 0U;
+    ClockGov_Stats.boosts = 0U;
+    ClockGov_Stats.wake_last = 0U;
+    ClockGov_Stats.wake_max = 0U;
+
+    ClockGovIdle = 0U;
+    ClockGovSlow = 0U;
+}
+
+/**
+  * @brief  Count an idle frame; throttle HCLK once the idle limit is reached.
+  *         Called from the SOF interrupt.
+  */
+void ClockGov_SOF(void)
+{
+    uint32_t primask;
+
+    if ((ClockGovSlow != 0U) || (ClockGov_Stats.idle_frames == 0U))
+    {
+        return;
+    }
+    if (++ClockGovIdle < ClockGov_Stats.idle_frames)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (ClockGovIdle >= ClockGov_Stats.idle_frames)
+    {
+        /* Longer turnaround first: it is still valid at the higher clock */
+        ClockGov_SetTrdt(CLOCK_IDLE_HCLK_HZ);
+        ClockGov_SetAHB(CLOCK_IDLE_AHB_DIV);
+        USBD_LOG(USBD_LOG_USR, USBD_LOG_HCLK_FMT, SystemCoreClock);
+        ClockGovSlow = 1U;
+        ClockGov_Stats.throttles++;
+    }
+    __set_PRIMASK(primask);
+
+    USBD_Trace_Board(USBD_TRACE_EV_CLOCK, 0U);
+}
+
+/**
+  * @brief  Input or USB traffic: back to full HCLK. Safe from any interrupt.
+  */
+void ClockGov_Activity(void)
+{
+    uint32_t t0 = DWT->CYCCNT;
+    uint32_t primask;
+
+    ClockGovIdle = 0U;
+    if (ClockGovSlow == 0U)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (ClockGovSlow != 0U)
+    {
+        ClockGov_SetAHB(RCC_SYSCLK_DIV1);
+        ClockGov_SetTrdt(SystemCoreClock);
+        USBD_LOG(USBD_LOG_USR, USBD_LOG_HCLK_FMT, SystemCoreClock);
+        ClockGovSlow = 0U;
+
+        ClockGov_Stats.boosts++;
+        ClockGov_Stats.wake_last = DWT->CYCCNT - t0;
+        ClockGov_Stats.wake_max = MAX(ClockGov_Stats.wake_max, ClockGov_Stats.wake_last);
+    }
+    __set_PRIMASK(primask);
+
+    USBD_Trace_Board(USBD_TRACE_EV_CLOCK, 1U);
+}
+
+uint8_t ClockGov_IsIdle(void)
+{
+    return ClockGovSlow;
+}
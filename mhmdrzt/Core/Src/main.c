@@ -21,11 +21,15 @@
 #include "main.h"
 #include "usb_device.h"
 #include "gpio.h"
+#include "clock_profile.h"
+#include "clock_gov.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "usbd_def.h"
 #include "usbd_hid_mouse.h"
+#include "usbd_report_sched.h"
+#include "usbd_trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -45,18 +49,22 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-
+/* Keys pressed while the bus was suspended, delivered in the first report */
+static __IO uint8_t WakeKeys;
+/* The part of WakeKeys in the report being armed */
+static uint8_t WakeSampled;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
-
+static uint8_t Keys_Read(void);
+static void WakeKeys_Consume(void);
+static void LowPower_Idle(void);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-extern USBD_HandleTypeDef hUsbDeviceFS;
 /* USER CODE END 0 */
 
 /**
@@ -82,17 +90,16 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  USBD_Trace_Init();
+  ClockGov_Init();
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_USB_DEVICE_Init();
   /* USER CODE BEGIN 2 */
-	while(hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED) 
-    {
-        HAL_Delay(10);
-    }
+	/* No wait for enumeration: reports are only armed once configured, and
+	   the device may be unplugged and re-enumerated at any time */
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -102,16 +109,10 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-		if (!HAL_GPIO_ReadPin(KEY1_GPIO_Port, KEY1_Pin)) {
-			uint8_t mouseReport[3] = {0x00, -10, 0}; // Move -10 pixels
-			USBD_HID_MOUSE_SendReport(&hUsbDeviceFS, mouseReport, sizeof(mouseReport));
-			HAL_Delay(10);
-		}
-    if (!HAL_GPIO_ReadPin(KEY2_GPIO_Port, KEY2_Pin)) {
-			uint8_t mouseReport[3] = {0x00, 10, 0}; // Move 10 pixels right
-			USBD_HID_MOUSE_SendReport(&hUsbDeviceFS, mouseReport, sizeof(mouseReport));
-			HAL_Delay(10);
-		}
+		/* Keys are sampled from SOF, see USBD_Sched_SampleCallback */
+		USBD_LP_Process();
+		MX_USB_DEVICE_Process();
+		LowPower_Idle();
   }
   /* USER CODE END 3 */
 }
@@ -128,7 +129,7 @@ void SystemClock_Config(void)
   /** Configure the main internal regulator output voltage
   */
   __HAL_RCC_PWR_CLK_ENABLE();
-  __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE3);
+  __HAL_PWR_VOLTAGESCALING_CONFIG(CLOCK_VOLTAGE_SCALE);
   /** Initializes the RCC Oscillators according to the specified parameters
   * in the RCC_OscInitTypeDef structure.
   */
@@ -136,10 +137,11 @@ void SystemClock_Config(void)
   RCC_OscInitStruct.HSEState = RCC_HSE_ON;
   RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
   RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-  RCC_OscInitStruct.PLL.PLLM = 15;
-  RCC_OscInitStruct.PLL.PLLN = 144;
-  RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-  RCC_OscInitStruct.PLL.PLLQ = 5;
+  /* M/N/P/Q solved at build time for an exact 48 MHz USB clock, see clock_profile.h */
+  RCC_OscInitStruct.PLL.PLLM = CLOCK_PLLM;
+  RCC_OscInitStruct.PLL.PLLN = CLOCK_PLLN;
+  RCC_OscInitStruct.PLL.PLLP = CLOCK_PLLP;
+  RCC_OscInitStruct.PLL.PLLQ = CLOCK_PLLQ;
   if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
   {
     Error_Handler();
@@ -150,16 +152,149 @@ void SystemClock_Config(void)
                               |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
   RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
   RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV4;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2;
+  RCC_ClkInitStruct.APB1CLKDivider = CLOCK_APB1_DIV;
+  RCC_ClkInitStruct.APB2CLKDivider = CLOCK_APB2_DIV;
 
-  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_3) != HAL_OK)
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, CLOCK_FLASH_LATENCY) != HAL_OK)
   {
     Error_Handler();
   }
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief  Bring SYSCLK back to the PLL after STOP. PLL configuration, bus
+  *         prescalers and flash latency survive STOP, so only HSE and the
+  *         PLL need restarting; SystemCoreClock stays valid.
+  */
+void SystemClock_Restore(void)
+{
+  if (__HAL_RCC_GET_SYSCLK_SOURCE() == RCC_SYSCLKSOURCE_STATUS_PLLCLK)
+  {
+    return;
+  }
+
+  __HAL_RCC_HSE_CONFIG(RCC_HSE_ON);
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_HSERDY) == RESET)
+  {
+  }
+  __HAL_RCC_PLL_ENABLE();
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY) == RESET)
+  {
+  }
+  __HAL_RCC_SYSCLK_CONFIG(RCC_SYSCLKSOURCE_PLLCLK);
+  while (__HAL_RCC_GET_SYSCLK_SOURCE() != RCC_SYSCLKSOURCE_STATUS_PLLCLK)
+  {
+  }
+}
+
+/**
+  * @brief  Sleep in STOP mode while the bus is suspended (every port that
+  *         is plugged in). Interrupts stay
+  *         masked from the state check until the clocks are back, so a
+  *         resume that races the check still ends the WFI and its handler
+  *         runs at full speed.
+  */
+static void LowPower_Idle(void)
+{
+	__disable_irq();
+	if ((USBD_LP_Suspended() != 0U) && (USBD_LP_WakeupPending() == 0U)) {
+		HAL_SuspendTick();
+		HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+		SystemClock_Restore();
+		HAL_ResumeTick();
+	}
+	__enable_irq();
+}
+
+/* Pressed keys as a bitmap: bit 0 = KEY1, bit 1 = KEY2 (both active low) */
+static uint8_t Keys_Read(void)
+{
+	uint8_t keys = 0U;
+
+	if (!HAL_GPIO_ReadPin(KEY1_GPIO_Port, KEY1_Pin)) {
+		keys |= 0x01U;
+	}
+	if (!HAL_GPIO_ReadPin(KEY2_GPIO_Port, KEY2_Pin)) {
+		keys |= 0x02U;
+	}
+	return keys;
+}
+
+/**
+  * @brief  Key edge: stamp it into the trace so the host can line it up
+  *         with the IN completion that carried it.
+  */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	uint8_t keys = Keys_Read();
+
+	UNUSED(GPIO_Pin);
+	ClockGov_Activity();
+	USBD_Trace_Board(USBD_TRACE_EV_KEY, keys);
+
+	/* Hold the press for the first report and ask the host to resume */
+	if ((USBD_LP_Suspended() != 0U) && (keys != 0U)) {
+		__disable_irq();
+		WakeKeys |= keys;
+		__enable_irq();
+		(void)USBD_LP_RequestWakeup();
+	}
+}
+
+/**
+  * @brief  Sample the keys for the next mouse report. Runs from SOF, just
+  *         ahead of the host's poll on 0x81.
+  * @retval 1 if a report should be sent
+  */
+uint8_t USBD_Sched_SampleCallback(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+	int8_t dx = 0;
+	uint8_t keys;
+
+	/* Held until the report is armed (USBD_Sched_SentCallback), so a send
+	   that fails keeps the press for the next sample */
+	WakeSampled = WakeKeys;
+	keys = Keys_Read() | WakeSampled;
+
+	if (keys & 0x01U) {
+		dx -= 10; // Move -10 pixels
+	}
+	if (keys & 0x02U) {
+		dx += 10; // Move 10 pixels right
+	}
+	if (dx == 0) {
+		/* Nothing to send, e.g. both keys queued while suspended: the
+		   queued press is spent, or it would cancel every later one */
+		WakeKeys_Consume();
+		return 0;
+	}
+
+	report[0] = 0x00;
+	report[1] = (uint8_t)dx;
+	report[2] = 0;
+	return 1;
+}
+
+/**
+  * @brief  The sampled report is armed: the wake keys it carries are delivered.
+  */
+void USBD_Sched_SentCallback(USBD_HandleTypeDef *pdev)
+{
+	UNUSED(pdev);
+	WakeKeys_Consume();
+}
+
+/* Drop the wake keys of the last sample from the queue */
+static void WakeKeys_Consume(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	WakeKeys &= (uint8_t)~WakeSampled;
+	__set_PRIMASK(primask);
+	WakeSampled = 0U;
+}
 
 /* USER CODE END 4 */
 
@@ -23,6 +23,7 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "usbd_conf.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -57,6 +58,7 @@
 
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
+extern PCD_HandleTypeDef hpcd_USB_OTG_HS;
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -199,13 +201,65 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line0 interrupt.
+  */
+void EXTI0_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI0_IRQn 0 */
+
+  /* USER CODE END EXTI0_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(KEY2_Pin);
+  /* USER CODE BEGIN EXTI0_IRQn 1 */
+
+  /* USER CODE END EXTI0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles EXTI line3 interrupt.
+  */
+void EXTI3_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI3_IRQn 0 */
+
+  /* USER CODE END EXTI3_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(KEY1_Pin);
+  /* USER CODE BEGIN EXTI3_IRQn 1 */
+
+  /* USER CODE END EXTI3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USB On The Go FS Wakeup through EXTI line interrupt.
+  */
+void OTG_FS_WKUP_IRQHandler(void)
+{
+  /* USER CODE BEGIN OTG_FS_WKUP_IRQn 0 */
+
+  /* USER CODE END OTG_FS_WKUP_IRQn 0 */
+  if ((&hpcd_USB_OTG_FS)->Init.low_power_enable) {
+    /* Reset SLEEPDEEP bit of Cortex System Control Register */
+    SCB->SCR &= (uint32_t)~((uint32_t)(SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk));
+    SystemClock_Restore();
+  }
+  __HAL_PCD_UNGATE_PHYCLOCK(&hpcd_USB_OTG_FS);
+  /* Clear EXTI pending Bit*/
+  __HAL_USB_OTG_FS_WAKEUP_EXTI_CLEAR_FLAG();
+  /* USER CODE BEGIN OTG_FS_WKUP_IRQn 1 */
+
+  /* USER CODE END OTG_FS_WKUP_IRQn 1 */
+}
+
 /**
   * @brief This function handles USB On The Go FS global interrupt.
   */
 void OTG_FS_IRQHandler(void)
 {
   /* USER CODE BEGIN OTG_FS_IRQn 0 */
-
+  /* Drains every pending event itself; the generated call below is kept
+     for CubeMX but never reached */
+  USBD_LL_IRQService(&hpcd_USB_OTG_FS, OTG_FS_IRQn);
+  return;
   /* USER CODE END OTG_FS_IRQn 0 */
   HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
   /* USER CODE BEGIN OTG_FS_IRQn 1 */
@@ -213,6 +267,44 @@ void OTG_FS_IRQHandler(void)
   /* USER CODE END OTG_FS_IRQn 1 */
 }
 
+/**
+  * @brief This function handles USB On The Go HS Wakeup through EXTI interrupt.
+  */
+void OTG_HS_WKUP_IRQHandler(void)
+{
+  /* USER CODE BEGIN OTG_HS_WKUP_IRQn 0 */
+
+  /* USER CODE END OTG_HS_WKUP_IRQn 0 */
+  if ((&hpcd_USB_OTG_HS)->Init.low_power_enable) {
+    /* Reset SLEEPDEEP bit of Cortex System Control Register */
+    SCB->SCR &= (uint32_t)~((uint32_t)(SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk));
+    SystemClock_Restore();
+  }
+  __HAL_PCD_UNGATE_PHYCLOCK(&hpcd_USB_OTG_HS);
+  /* Clear EXTI pending Bit*/
+  __HAL_USB_OTG_HS_WAKEUP_EXTI_CLEAR_FLAG();
+  /* USER CODE BEGIN OTG_HS_WKUP_IRQn 1 */
+
+  /* USER CODE END OTG_HS_WKUP_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USB On The Go HS global interrupt.
+  */
+void OTG_HS_IRQHandler(void)
+{
+  /* USER CODE BEGIN OTG_HS_IRQn 0 */
+  /* Drains every pending event itself; the generated call below is kept
+     for CubeMX but never reached */
+  USBD_LL_IRQService(&hpcd_USB_OTG_HS, OTG_HS_IRQn);
+  return;
+  /* USER CODE END OTG_HS_IRQn 0 */
+  HAL_PCD_IRQHandler(&hpcd_USB_OTG_HS);
+  /* USER CODE BEGIN OTG_HS_IRQn 1 */
+
+  /* USER CODE END OTG_HS_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
@@ -0,0 +1,85 @@
+/* usbd_bench.h */
+#ifndef __USBD_BENCH_H
+#define __USBD_BENCH_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* On-device regression benchmark. A run replays one canned workload for a
+   fixed number of frames through the normal SOF/scheduler/DataIn paths and
+   collects:
+     - completed reports per second (mouse + vendor; bulk counts packets)
+     - p50/p99 input-to-transfer latency, frames
+     - DWT cycles spent in the class SOF and DataIn handlers per report
+     - DWT cycles in the whole OTG interrupt and bytes moved on the data
+       endpoints, i.e. CPU cycles per KB; running the same workload on
+       each port compares the CPU-fed OTG_FS FIFO with OTG_HS DMA
+     - OTG interrupt entries, i.e. entries per frame against the events
+       they served (USBD_Irq_StatsTypeDef in usbd_conf.h)
+     - DWT cycles from the core's DataIn/DataOut/SOF dispatch to the
+       composite handler's first line, per dispatch; building with
+       USBD_STATIC_CLASS 0 and 1 compares table and direct dispatch
+
+   Result report on 0x82 (after CUSTOM_HID_CMD_BENCH_RESULT):
+     [0] report ID  [1..2] reports/s  [3] p50  [4] p99  [5..8] cycles/report
+   all little endian. With no reports completed (idle), cycles are per frame
+   instead. Tools/usbd_bench.py runs workloads and writes the results as
+   JSON. */
+#define USBD_BENCH_IDLE             0U       /* no input, SOF overhead only */
+#define USBD_BENCH_MOTION           1U       /* constant motion every frame */
+#define USBD_BENCH_BUTTONS          2U       /* button 1 toggling every frame */
+#define USBD_BENCH_VENDOR           3U       /* every vendor channel kept full, see usbd_stripe.h */
+#define USBD_BENCH_BULK             4U       /* 0x83 TX ring kept full, 64-byte packets */
+#define USBD_BENCH_NUM_WORKLOADS    5U
+
+#define USBD_BENCH_DEFAULT_FRAMES   1000U
+#define USBD_BENCH_MAX_FRAMES       60000U
+#define USBD_BENCH_LAT_BINS         16U      /* last bin collects >= 15 frames */
+
+#define USBD_BENCH_STOPPED          0U
+#define USBD_BENCH_RUNNING          1U
+#define USBD_BENCH_DONE             2U
+
+typedef struct
+{
+  uint8_t  workload;
+  uint8_t  state;
+  uint16_t frames;                         /* frames elapsed in the run */
+  uint16_t target;                         /* frames to run */
+  uint32_t reports;                        /* reports completed during the run */
+  uint32_t cycles;                         /* handler cycles during the run */
+  uint32_t irq_cycles;                     /* OTG interrupt cycles during the run */
+  uint32_t irq_entries;                    /* OTG interrupt entries during the run */
+  uint32_t bytes;                          /* data endpoint bytes, both directions */
+  uint32_t dispatches;                     /* class handler calls from the core */
+  uint32_t dispatch_cycles;                /* core to handler entry, summed */
+  uint32_t lat_hist[USBD_BENCH_LAT_BINS]; /* percentiles: USBD_Arb_Percentile */
+} USBD_Bench_TypeDef;
+
+uint8_t USBD_Bench_Start(USBD_HandleTypeDef *pdev, uint8_t workload, uint16_t frames);
+void    USBD_Bench_Abort(USBD_HandleTypeDef *pdev);
+void    USBD_Bench_SOF(USBD_HandleTypeDef *pdev);
+void    USBD_Bench_Report(USBD_HandleTypeDef *pdev, uint16_t latency);
+void    USBD_Bench_GetResult(USBD_HandleTypeDef *pdev, uint8_t *report);
+void    USBD_Bench_Irq(USBD_HandleTypeDef *pdev, uint32_t cycles);
+void    USBD_Bench_Bytes(USBD_HandleTypeDef *pdev, uint32_t len);
+void    USBD_Bench_Dispatch(USBD_HandleTypeDef *pdev, uint32_t cycles);
+
+/* Handler cycle accounting, only while a run is active on `hbench` */
+#define USBD_BENCH_CYCLES_BEGIN()   uint32_t bench_t0 = DWT->CYCCNT
+#define USBD_BENCH_CYCLES_END(hbench)                                    \
+  do {                                                                   \
+    if ((hbench)->state == USBD_BENCH_RUNNING)                           \
+    {                                                                    \
+      (hbench)->cycles += DWT->CYCCNT - bench_t0;                        \
+    }                                                                    \
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_BENCH_H */
@@ -0,0 +1,68 @@
+/* usbd_bulk.h */
+#ifndef __USBD_BULK_H
+#define __USBD_BULK_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* Vendor-class bulk interface for telemetry (0x83 IN, 0x03 OUT, 64 bytes).
+
+   Data written with USBD_Bulk_Write lands in a TX ring; whenever 0x83 is
+   idle the largest contiguous run of the ring (up to USBD_BULK_MAX_XFER) is
+   armed as one multi-packet transfer, so the core refills the TX FIFO from
+   the TXFE interrupt and the host can take as many packets per frame as it
+   has bulk bandwidth for. A transfer ending in a short packet ends the
+   host's read; a full-packet end simply continues in the next transfer.
+   OUT data goes to USBD_Bulk_RxCallback. */
+#define USBD_BULK_EPIN_ADDR         0x83U
+#define USBD_BULK_EPOUT_ADDR        0x03U
+#define USBD_BULK_PACKET_SIZE       64U
+
+#define USBD_BULK_TX_RING_SIZE      2048U    /* bytes, power of two */
+#define USBD_BULK_MAX_XFER          1024U    /* bytes per armed transfer */
+
+typedef struct
+{
+  uint32_t tx_bytes;      /* bytes the host has taken from 0x83 */
+  uint32_t tx_xfers;
+  uint32_t tx_dropped;    /* bytes refused by USBD_Bulk_Write, ring full */
+  uint16_t tx_high;       /* ring high-water mark, bytes */
+  uint32_t rx_bytes;      /* bytes received on 0x03 */
+} USBD_Bulk_StatsTypeDef;
+
+typedef struct
+{
+  /* Free-running indices: head is advanced by writers, tail by DataIn */
+  uint8_t  ring[USBD_BULK_TX_RING_SIZE] USBD_DMA_ALIGNED;
+  __IO uint16_t head;
+  __IO uint16_t tail;
+  /* Bytes armed on 0x83, 0 when idle */
+  __IO uint16_t inflight;
+  /* Frame the in-flight transfer was armed in, for the benchmark */
+  uint16_t frame;
+  uint8_t  pattern;
+  uint8_t  rx_buf[USBD_BULK_PACKET_SIZE] USBD_DMA_ALIGNED;
+  USBD_Bulk_StatsTypeDef stats;
+} USBD_Bulk_HandleTypeDef;
+
+uint8_t  USBD_Bulk_Init(USBD_HandleTypeDef *pdev);
+uint8_t  USBD_Bulk_DeInit(USBD_HandleTypeDef *pdev);
+uint8_t  USBD_Bulk_DataIn(USBD_HandleTypeDef *pdev);
+uint8_t  USBD_Bulk_DataOut(USBD_HandleTypeDef *pdev);
+void     USBD_Bulk_SOF(USBD_HandleTypeDef *pdev);
+void     USBD_Bulk_Kick(USBD_HandleTypeDef *pdev);
+uint16_t USBD_Bulk_Write(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len);
+uint16_t USBD_Bulk_TxFree(USBD_HandleTypeDef *pdev);
+
+/* Provided by the application: `len` bytes arrived on 0x03. Called from
+   the USB interrupt; the buffer is reused once it returns. */
+void     USBD_Bulk_RxCallback(USBD_HandleTypeDef *pdev, const uint8_t *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_BULK_H */
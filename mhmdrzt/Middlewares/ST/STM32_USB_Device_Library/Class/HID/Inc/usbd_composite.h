@@ -7,11 +7,96 @@
 #endif
 
 #include "usbd_def.h"
+#include "usbd_desc.h"
+#include "usbd_hid_mouse.h"
+#include "usbd_custom_hid.h"
+#include "usbd_bulk.h"
+#include "usbd_stripe.h"
+#include "usbd_in_arb.h"
+#include "usbd_report_sched.h"
+#include "usbd_hid_macro.h"
+#include "usbd_bench.h"
+#include "usbd_vendor_req.h"
 
 /* Declaration of the composite class structure */
 extern USBD_ClassTypeDef USBD_Composite;
 #define USBD_COMPOSITE_CLASS &USBD_Composite
 
+/* Personalities: which interfaces the device enumerates with. Switching
+   soft-detaches, rebuilds the configuration descriptor and reconnects with
+   idProduct = USBD_PID + personality, so the host never sees a changed
+   interface set under a cached VID/PID. Nothing is persisted: a hardware
+   reset comes back as FULL. Switching is requested with vendor HID
+   command CUSTOM_HID_CMD_PERSONALITY, or with vendor request
+   USBD_VREQ_SET_PERSONALITY on EP0, which every personality (MOUSE
+   included) answers. */
+#define USBD_PERSONALITY_FULL       0U       /* mouse + vendor HID + bulk */
+#define USBD_PERSONALITY_MOUSE      1U       /* boot mouse only */
+#define USBD_PERSONALITY_VENDOR     2U       /* vendor HID + bulk */
+#define USBD_PERSONALITY_VENDOR_X2  3U       /* vendor HID striped over 2 channels */
+#define USBD_PERSONALITY_VENDOR_X3  4U       /* vendor HID striped over 3 channels */
+#define USBD_PERSONALITY_COUNT      5U
+#define USBD_PERSONALITY_NONE       0xFFU
+
+#define USBD_COMPOSITE_NO_IF        0xFFU    /* interface absent */
+
+#define USBD_PERSONALITY_DETACH_MS  50U      /* D+ released before reconnecting */
+#define USBD_PERSONALITY_TIMEOUT_MS 3000U    /* request to SET_CONFIGURATION */
+
+typedef struct
+{
+  uint8_t  personality;     /* active personality */
+  uint16_t switches;        /* completed: host configured the new personality */
+  uint16_t timeouts;        /* not configured in time, fell back to FULL */
+  uint16_t switch_ms_last;  /* request taken to SET_CONFIGURATION */
+  uint16_t switch_ms_max;
+} USBD_Personality_StatsTypeDef;
+
+/* Everything one device instance owns: descriptors, personality and the
+   state of every interface. The application allocates one per USB core
+   (static, no heap) and binds it with USBD_Composite_RegisterContext after
+   USBD_Init, which clears pUserData. Class code reaches it only through
+   the handle, so any number of instances run side by side. The LL state
+   of the port (connection, low power, interrupt stats) and the event
+   trace are per instance too; only the clock governor (one HCLK) and the
+   lock-free log ring belong to the board. */
+typedef struct
+{
+  USBD_Desc_HandleTypeDef         desc;
+  USBD_Personality_StatsTypeDef   personality USBD_DMA_ALIGNED;
+  __IO uint8_t                    request;      /* USBD_PERSONALITY_NONE when idle */
+  /* Tick the running switch was taken at, 0 when none is in progress */
+  uint32_t                        switch_tick;
+  USBD_HID_Mouse_HandleTypeDef    mouse;
+  USBD_CustomHID_HandleTypeDef    custom;
+  USBD_Bulk_HandleTypeDef         bulk;
+  USBD_Stripe_HandleTypeDef       stripe;
+  USBD_Arb_HandleTypeDef          arb;
+  USBD_Sched_HandleTypeDef        sched;
+  USBD_HID_Macro_HandleTypeDef    macro;
+  USBD_Bench_TypeDef              bench;
+  USBD_VReq_HandleTypeDef         vreq;
+  USBD_Port_HandleTypeDef         port;
+  USBD_Trace_RingTypeDef          trace;
+} USBD_Composite_HandleTypeDef;
+
+#define USBD_COMPOSITE_CTX(pdev)    ((USBD_Composite_HandleTypeDef *)(pdev)->pUserData)
+#define USBD_PORT(pdev)             (&USBD_COMPOSITE_CTX(pdev)->port)
+
+/* Data-path handlers, called by the core directly when USBD_STATIC_CLASS
+   is set (usbd_conf.h) and through USBD_Composite otherwise */
+uint8_t USBD_Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+uint8_t USBD_Composite_EP0_RxReady(USBD_HandleTypeDef *pdev);
+uint8_t USBD_Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+uint8_t USBD_Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+uint8_t USBD_Composite_SOF(USBD_HandleTypeDef *pdev);
+
+void    USBD_Composite_RegisterContext(USBD_HandleTypeDef *pdev, USBD_Composite_HandleTypeDef *ctx);
+uint8_t USBD_Composite_SelectPersonality(USBD_HandleTypeDef *pdev, uint8_t personality);
+uint8_t USBD_Composite_RequestPersonality(USBD_HandleTypeDef *pdev, uint8_t personality);
+uint8_t USBD_Composite_NextPersonality(USBD_HandleTypeDef *pdev);
+void    USBD_Composite_GetPersonalityInfo(USBD_HandleTypeDef *pdev, uint8_t *report);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,12 +7,77 @@
 #endif
 
 #include "usbd_def.h"
+#include "usbd_trace.h"
+#include "usbd_log.h"
 extern uint8_t Custom_HID_ReportDesc[];
-#define CUSTOM_HID_REPORT_DESC_SIZE    29//sizeof(Custom_HID_ReportDesc)
+#define CUSTOM_HID_REPORT_DESC_SIZE    151//sizeof(Custom_HID_ReportDesc)
+/* Leading stream collection only, for the extra stripe channels */
+#define CUSTOM_HID_STREAM_DESC_SIZE    23U
+
+#define CUSTOM_HID_EPIN_ADDR           0x82U
+#define CUSTOM_HID_EPOUT_ADDR          0x02U
+#define CUSTOM_HID_EPIN_SIZE           9U
+#define CUSTOM_HID_EPOUT_SIZE          9U
+
+/* Report IDs carried on the custom HID interface */
+#define CUSTOM_HID_REPORT_ID_VENDOR    0x02U
+#define CUSTOM_HID_REPORT_ID_ABS       0x03U
+#define CUSTOM_HID_REPORT_ID_LOG       0x04U  /* input only: 8 bytes of log records, see usbd_log.h */
+#define CUSTOM_HID_REPORT_ID_TRACE     0x05U  /* input only: one trace dump entry, see usbd_trace.h */
+#define CUSTOM_HID_REPORT_ID_STREAM    0x06U  /* input only: one stream chunk, see usbd_stripe.h */
+
+/* Absolute pointer report: ID + buttons + X + Y */
+#define CUSTOM_HID_ABS_REPORT_SIZE     6U
+#define CUSTOM_HID_ABS_MAX             32767U
+
+/* Log words held between reports: one drain of whole records */
+#define CUSTOM_HID_LOG_BUF_WORDS       (USBD_LOG_MAX_WORDS + 1U)
+
+/* Vendor commands (byte 1 of a vendor OUT report) */
+#define CUSTOM_HID_CMD_ABS_MOVE        0x01U  /* buttons, X lo, X hi, Y lo, Y hi */
+#define CUSTOM_HID_CMD_MACRO_BEGIN     0x02U  /* stop playback, clear the buffer */
+#define CUSTOM_HID_CMD_MACRO_DATA      0x03U  /* count (1..6), bytes */
+#define CUSTOM_HID_CMD_MACRO_PLAY      0x04U  /* loops (0 = until stopped) */
+#define CUSTOM_HID_CMD_MACRO_STOP      0x05U
+#define CUSTOM_HID_CMD_SCHED_PHASE     0x06U  /* frames sampled ahead of the 0x81 poll */
+#define CUSTOM_HID_CMD_TRACE_DUMP      0x07U  /* entry count lo, hi (0 = all); see usbd_trace.h */
+#define CUSTOM_HID_CMD_BENCH_START     0x08U  /* workload, frames lo, frames hi; see usbd_bench.h */
+#define CUSTOM_HID_CMD_BENCH_RESULT    0x09U  /* reply: result report of the last run */
+#define CUSTOM_HID_CMD_PERSONALITY     0x0AU  /* personality; 0xFF = reply with switch timings, see usbd_composite.h */
+#define CUSTOM_HID_CMD_ARB_STATS       0x0BU  /* priority class; reply: latency stats, see usbd_in_arb.h */
+
+typedef struct
+{
+  uint8_t  rx_buf[USBD_DMA_SIZE(CUSTOM_HID_EPOUT_SIZE)] USBD_DMA_ALIGNED;
+  /* Absolute pointer report: ID, buttons, X (LE16), Y (LE16). Only the
+     latest position matters, so a report that arrives while the IN
+     endpoint is busy overwrites the pending one instead of queueing. */
+  uint8_t  abs_report[CUSTOM_HID_ABS_REPORT_SIZE] USBD_DMA_ALIGNED;
+  uint8_t  abs_pending;
+  __IO uint8_t in_busy;
+  /* Reply to a vendor command, sent once 0x82 is free */
+  uint8_t  reply_report[CUSTOM_HID_EPIN_SIZE] USBD_DMA_ALIGNED;
+  uint8_t  reply_pending;
+  /* Background traffic: trace dump entries (trace ID, frame LE16, type,
+     arg, cycles LE32) and stream chunks (see usbd_stripe.h). Only sent when
+     0x82 would otherwise be idle. */
+  uint8_t  tx_report[CUSTOM_HID_EPIN_SIZE] USBD_DMA_ALIGNED;
+  uint16_t chunk_frame;          /* stream chunk armed in, NO_FRAME if none in flight */
+  USBD_Trace_DumpTypeDef dump;
+  /* Log records taken from the ring, sent two words per report after
+     everything else (USBD_LOG_PORT only) */
+  uint32_t log_buf[CUSTOM_HID_LOG_BUF_WORDS];
+  uint8_t  log_pos;
+  uint8_t  log_len;
+} USBD_CustomHID_HandleTypeDef;
 
 uint8_t USBD_CustomHID_Init(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CustomHID_DeInit(USBD_HandleTypeDef *pdev);
 uint8_t USBD_CustomHID_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
 uint8_t USBD_CustomHID_DataOut(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CustomHID_DataIn(USBD_HandleTypeDef *pdev);
+void    USBD_CustomHID_Kick(USBD_HandleTypeDef *pdev);
+uint8_t USBD_CustomHID_SendAbsReport(USBD_HandleTypeDef *pdev, uint8_t buttons, uint16_t x, uint16_t y);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,57 @@
+/* usbd_hid_macro.h */
+#ifndef __USBD_HID_MACRO_H
+#define __USBD_HID_MACRO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* On-device macro buffer, uploaded once over the vendor channel and played
+   back on the mouse endpoint (0x81) one frame at a time, in step with SOF.
+
+   The sequence is a flat array of 4-byte steps:
+     [0] delay   frames since the previous step (first step: since PLAY)
+     [1] flags   bits 0..2 = buttons, USBD_MACRO_FLAG_WAIT = no report
+     [2] dx      int8 relative X
+     [3] dy      int8 relative Y
+   Steps that fall on the same frame, or that come faster than the host
+   polls 0x81, are merged: motion is summed, and a button change is never
+   merged with a different pending button state. */
+#define USBD_MACRO_BUF_SIZE         1024U
+#define USBD_MACRO_STEP_SIZE        4U
+#define USBD_MACRO_FLAG_WAIT        0x80U
+
+#define USBD_MACRO_IDLE             0U
+#define USBD_MACRO_PLAYING          1U
+
+typedef struct
+{
+  uint8_t  buf[USBD_MACRO_BUF_SIZE];
+  uint16_t len;
+  uint16_t pos;
+  uint8_t  wait;
+  uint8_t  loops;
+  __IO uint8_t state;
+  /* Report being assembled for the next free slot on 0x81 */
+  uint8_t  report[3] USBD_DMA_ALIGNED;
+  uint8_t  buttons;
+  int16_t  acc_x;
+  int16_t  acc_y;
+  uint8_t  dirty;
+} USBD_HID_Macro_HandleTypeDef;
+
+void    USBD_HID_Macro_Begin(USBD_HandleTypeDef *pdev);
+uint8_t USBD_HID_Macro_Append(USBD_HandleTypeDef *pdev, const uint8_t *data, uint8_t len);
+uint8_t USBD_HID_Macro_Play(USBD_HandleTypeDef *pdev, uint8_t loops);
+void    USBD_HID_Macro_Stop(USBD_HandleTypeDef *pdev);
+uint8_t USBD_HID_Macro_State(USBD_HandleTypeDef *pdev);
+void    USBD_HID_Macro_Tick(USBD_HandleTypeDef *pdev);
+uint8_t USBD_HID_Macro_Flush(USBD_HandleTypeDef *pdev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_HID_MACRO_H */
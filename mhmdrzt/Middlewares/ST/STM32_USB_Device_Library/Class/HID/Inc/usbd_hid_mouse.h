@@ -11,8 +11,19 @@
 extern uint8_t HID_Mouse_ReportDesc[];
 #define HID_MOUSE_REPORT_DESC_SIZE   50//(sizeof(HID_Mouse_ReportDesc))
 
+#define HID_MOUSE_EPIN_ADDR          0x81U
+#define HID_MOUSE_EPIN_SIZE          4U
+
+typedef struct
+{
+  __IO uint8_t in_busy;      /* set while a report is armed on 0x81, cleared by DataIn */
+} USBD_HID_Mouse_HandleTypeDef;
+
 uint8_t USBD_HID_MOUSE_Init(USBD_HandleTypeDef *pdev);
+uint8_t USBD_HID_MOUSE_DeInit(USBD_HandleTypeDef *pdev);
 uint8_t USBD_HID_MOUSE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+uint8_t USBD_HID_MOUSE_DataIn(USBD_HandleTypeDef *pdev);
+uint8_t USBD_HID_MOUSE_SendReport(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len);
 uint8_t* USBD_HID_MOUSE_GetReportDescriptor(uint16_t* length);
 
 #ifdef __cplusplus
@@ -0,0 +1,74 @@
+/* usbd_in_arb.h */
+#ifndef __USBD_IN_ARB_H
+#define __USBD_IN_ARB_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* Central IN arbiter. Every IN endpoint is armed through USBD_Arb_Transmit
+   and belongs to a priority class. After each SOF and each IN completion
+   the registered pumps run in class order, so background work is only
+   armed once everything more urgent has had its chance. Pointer reports
+   are armed from the scheduler's sampling slot at the top of the SOF,
+   ahead of all pumps.
+
+   Each endpoint has its own TX FIFO and the host polls interrupt
+   endpoints before bulk, so streaming traffic should not move pointer
+   latency; the per-class arm-to-completion histograms are there to show
+   it. A completion later than the class deadline counts as a miss.
+
+   Stats report on 0x82 (after CUSTOM_HID_CMD_ARB_STATS):
+     [0] report ID  [1] class  [2] p50  [3] p99  [4] max (frames)
+     [5..6] completions  [7..8] deadline misses, little endian */
+#define USBD_ARB_CLASS_POINTER      0U       /* mouse reports on 0x81 */
+#define USBD_ARB_CLASS_REPLY        1U       /* vendor channel 0: replies, abs pointer, trace */
+#define USBD_ARB_CLASS_STREAM       2U       /* stripe channels and bulk telemetry */
+#define USBD_ARB_NUM_CLASSES        3U
+#define USBD_ARB_NO_CLASS           0xFFU
+
+#define USBD_ARB_MAX_PUMPS          4U
+#define USBD_ARB_LAT_BINS           16U      /* last bin collects >= 15 frames */
+
+typedef struct
+{
+  uint32_t completions;
+  uint32_t misses;                        /* completed after the class deadline */
+  uint16_t lat_max;                       /* arm to completion, frames */
+  /* 32-bit: a 16-bit bin fills in about 65 s of 1 ms polls */
+  uint32_t lat_hist[USBD_ARB_LAT_BINS];
+} USBD_Arb_ClassStatsTypeDef;
+
+typedef struct
+{
+  uint8_t cls;
+  void (*pump)(USBD_HandleTypeDef *pdev);
+} USBD_Arb_PumpTypeDef;
+
+typedef struct
+{
+  /* Indexed by endpoint number */
+  uint8_t  ep_class[USBD_FS_DEV_ENDPOINTS];
+  uint16_t arm_frame[USBD_FS_DEV_ENDPOINTS];
+  USBD_Arb_PumpTypeDef pumps[USBD_ARB_MAX_PUMPS];
+  uint8_t  num_pumps;
+  USBD_Arb_ClassStatsTypeDef stats[USBD_ARB_NUM_CLASSES];
+} USBD_Arb_HandleTypeDef;
+
+void    USBD_Arb_Reset(USBD_HandleTypeDef *pdev);
+void    USBD_Arb_ClearStats(USBD_HandleTypeDef *pdev);
+void    USBD_Arb_Register(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t cls);
+void    USBD_Arb_AddPump(USBD_HandleTypeDef *pdev, uint8_t cls, void (*pump)(USBD_HandleTypeDef *pdev));
+void    USBD_Arb_Run(USBD_HandleTypeDef *pdev);
+uint8_t USBD_Arb_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *buf, uint32_t len);
+void    USBD_Arb_Complete(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+void    USBD_Arb_GetStats(USBD_HandleTypeDef *pdev, uint8_t cls, uint8_t *report);
+uint8_t USBD_Arb_Percentile(const uint32_t *hist, uint8_t bins, uint8_t pct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_IN_ARB_H */
@@ -0,0 +1,95 @@
+/* usbd_log.h */
+#ifndef __USBD_LOG_H
+#define __USBD_LOG_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+/* Deferred binary log behind USBD_UsrLog/USBD_ErrLog/USBD_DbgLog.
+
+   A call site formats nothing: it appends a record of 32-bit words to a
+   lock-free ring, in a few dozen cycles from any priority.
+
+     [0] header: format ID (15:0), argument count (17:16), level (19:18),
+                 records dropped so far, low 8 bits (31:24)
+     [1] DWT->CYCCNT
+     [2..] up to three arguments, each converted to uint32_t
+
+   The format string stays in flash in its own execution region, ER_LOGFMT
+   (see MDK-ARM/HID/HID.sct), and the format ID is its offset there. The
+   host decoder (Tools/usbd_log_decode.py) reads the strings back from
+   that section of HID.axf. Arguments are integers only; %s, %f and
+   friends have nothing to point at on the host.
+
+   The ring is drained on the USBD_LOG_PORT instance only, as vendor IN
+   reports (CUSTOM_HID_REPORT_ID_LOG + 8 bytes) on 0x82, and only when
+   that endpoint would otherwise be idle. Records are whole within the
+   stream; a zero word is padding. */
+#define USBD_LOG_DEPTH              256U     /* words, power of two */
+#define USBD_LOG_MAX_ARGS           3U
+#define USBD_LOG_MAX_WORDS          (2U + USBD_LOG_MAX_ARGS)
+
+/* Levels as in the ST template: USBD_DEBUG_LEVEL 1 keeps user messages,
+   2 adds errors, 3 adds debug. Never 0, so a header is never 0. */
+#define USBD_LOG_USR                1U
+#define USBD_LOG_ERR                2U
+#define USBD_LOG_DBG                3U
+
+/* Written by the clock governor whenever HCLK, and with it the rate of
+   the DWT stamps, changes; the decoder rescales from this record on */
+#define USBD_LOG_HCLK_FMT           "HCLK %u Hz"
+
+#define USBD_LOG_HDR_ARGS(hdr)      (((hdr) >> 16) & 0x3U)
+#define USBD_LOG_HDR_LEVEL(hdr)     (((hdr) >> 18) & 0x3U)
+#define USBD_LOG_HDR_WORDS(hdr)     (2U + USBD_LOG_HDR_ARGS(hdr))
+
+typedef struct
+{
+  uint32_t records;       /* records written */
+  uint32_t dropped;       /* records refused, ring full */
+  uint32_t drained;       /* words handed to the host */
+  uint16_t high;          /* ring high-water mark, words */
+} USBD_Log_StatsTypeDef;
+
+extern USBD_Log_StatsTypeDef USBD_Log_Stats;
+
+/* Start of the format string region, placed by the linker */
+extern const char Image$$ER_LOGFMT$$Base[];
+
+#define USBD_LOG_FMT_SECTION        __attribute__((section(".usbd_logfmt")))
+
+/* USBD_LOG(level, fmt, ...): fmt must be a string literal, with at most
+   USBD_LOG_MAX_ARGS arguments after it */
+#define USBD_LOG(level, ...)                                               \
+  USBD_LOG_CAT(USBD_LOG_, USBD_LOG_NARGS(__VA_ARGS__))(level, __VA_ARGS__)
+
+#define USBD_LOG_NARGS(...)                 USBD_LOG_NARGS_(__VA_ARGS__, 3, 2, 1, 0, ~)
+#define USBD_LOG_NARGS_(f, a, b, c, n, ...) n
+#define USBD_LOG_CAT(a, b)                  USBD_LOG_CAT_(a, b)
+#define USBD_LOG_CAT_(a, b)                 a##b
+
+#define USBD_LOG_0(level, fmt)              USBD_LOG_REC(level, fmt, 0U, 0U, 0U, 0U)
+#define USBD_LOG_1(level, fmt, a)           USBD_LOG_REC(level, fmt, 1U, a, 0U, 0U)
+#define USBD_LOG_2(level, fmt, a, b)        USBD_LOG_REC(level, fmt, 2U, a, b, 0U)
+#define USBD_LOG_3(level, fmt, a, b, c)     USBD_LOG_REC(level, fmt, 3U, a, b, c)
+
+#define USBD_LOG_REC(level, fmt, n, a, b, c)                                    \
+  do {                                                                          \
+    static const char usbd_log_fmt[] USBD_LOG_FMT_SECTION = fmt;                \
+    USBD_Log_Put((((uint32_t)usbd_log_fmt - (uint32_t)Image$$ER_LOGFMT$$Base)   \
+                  & 0xFFFFU) | ((n) << 16) | ((uint32_t)(level) << 18),         \
+                 (uint32_t)(a), (uint32_t)(b), (uint32_t)(c));                  \
+  } while (0)
+
+void     USBD_Log_Put(uint32_t hdr, uint32_t a, uint32_t b, uint32_t c);
+uint32_t USBD_Log_Drain(uint32_t *dst, uint32_t words);
+uint32_t USBD_Log_Pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_LOG_H */
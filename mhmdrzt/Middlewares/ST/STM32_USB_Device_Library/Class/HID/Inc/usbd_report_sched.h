@@ -0,0 +1,66 @@
+/* usbd_report_sched.h */
+#ifndef __USBD_REPORT_SCHED_H
+#define __USBD_REPORT_SCHED_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* SOF-driven scheduler for the mouse endpoint (0x81).
+
+   Completions on 0x81 tell us in which frame the host polls. From there the
+   scheduler predicts the next poll and samples inputs `phase` frames ahead
+   of it, so a report sits in the TX FIFO for as short a time as possible
+   instead of up to a whole interval. */
+#define USBD_SCHED_FRAME_MASK       0x7FFU   /* FS frame numbers are 11 bits */
+#define USBD_SCHED_DEFAULT_PERIOD   10U      /* mouse bInterval until measured */
+#define USBD_SCHED_DEFAULT_PHASE    1U
+#define USBD_SCHED_NO_FRAME         0xFFFFU
+
+typedef struct
+{
+  uint16_t period;       /* measured host poll period on 0x81, frames */
+  uint16_t phase;        /* lead between sampling and predicted poll, frames */
+  uint16_t frame;        /* frame number of the last SOF */
+  uint16_t last_poll;    /* frame of the last completion on 0x81 */
+  uint32_t reports;      /* reports completed on 0x81 */
+  uint16_t lat_last;     /* sample-to-transfer latency, frames */
+  uint16_t lat_min;
+  uint16_t lat_max;
+  uint32_t lat_sum;
+} USBD_Sched_StatsTypeDef;
+
+typedef struct
+{
+  USBD_Sched_StatsTypeDef stats;
+  uint8_t  report[3] USBD_DMA_ALIGNED;
+  /* Frame the in-flight report was sampled in, NO_FRAME when 0x81 is idle */
+  __IO uint16_t sample_frame;
+  /* Set when a poll came later than predicted: next report is armed as
+     soon as there is data, so the following completion measures the real
+     period */
+  uint8_t  probe;
+  /* Whether the in-flight report was timed from the prediction */
+  uint8_t  predicted;
+} USBD_Sched_HandleTypeDef;
+
+void    USBD_Sched_Reset(USBD_HandleTypeDef *pdev);
+void    USBD_Sched_SOF(USBD_HandleTypeDef *pdev);
+void    USBD_Sched_InComplete(USBD_HandleTypeDef *pdev);
+void    USBD_Sched_SetPhase(USBD_HandleTypeDef *pdev, uint16_t phase);
+
+/* Provided by the application: fill a 3-byte mouse report sampled now.
+   Return 1 to send it, 0 when there is nothing to report. */
+uint8_t USBD_Sched_SampleCallback(USBD_HandleTypeDef *pdev, uint8_t *report);
+/* Provided by the application: the report filled by the last sample is
+   armed on 0x81. Not called when arming failed, so state the sample
+   consumed can be kept for the next one. */
+void    USBD_Sched_SentCallback(USBD_HandleTypeDef *pdev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_REPORT_SCHED_H */
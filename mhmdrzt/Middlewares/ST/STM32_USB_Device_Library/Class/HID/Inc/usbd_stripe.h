@@ -0,0 +1,76 @@
+/* usbd_stripe.h */
+#ifndef __USBD_STRIPE_H
+#define __USBD_STRIPE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+#include "usbd_custom_hid.h"
+
+/* Striping of one logical vendor stream across several vendor HID
+   interfaces. Each interrupt IN endpoint moves at most one report per
+   frame, so N channels give N reports per frame.
+
+   Channel 0 is the custom HID interface (0x82); it keeps its command
+   replies, absolute pointer and trace dump, and carries stream chunks when
+   it has nothing else to send. Channels 1 and 2 are IN-only vendor HID
+   interfaces on the endpoints the personality leaves free. OTG_FS has
+   USBD_FS_DEV_ENDPOINTS endpoints including EP0, which bounds the count.
+
+   Every chunk is a stream report, on every channel:
+     [0] CUSTOM_HID_REPORT_ID_STREAM  [1] length << 5 | sequence (5 bits)
+     [2..8] data
+   Chunks are numbered in the order they leave the ring, whichever channel
+   carries them; the host merges the channels by sequence number. */
+#define USBD_STRIPE_MAX_CHANNELS    3U
+#define USBD_STRIPE_CH1_EPIN_ADDR   0x83U
+#define USBD_STRIPE_CH2_EPIN_ADDR   0x81U
+#define USBD_STRIPE_EPIN_ADDR(ch)   (((ch) == 1U) ? USBD_STRIPE_CH1_EPIN_ADDR : USBD_STRIPE_CH2_EPIN_ADDR)
+
+#define USBD_STRIPE_CHUNK_SIZE      7U       /* data bytes per report */
+#define USBD_STRIPE_RING_SIZE       1024U    /* bytes, power of two */
+
+#if (USBD_STRIPE_MAX_CHANNELS > (USBD_FS_DEV_ENDPOINTS - 1U))
+#error "usbd_stripe.h: more vendor channels than OTG_FS endpoints"
+#endif
+
+typedef struct
+{
+  uint8_t  channels;                              /* active, channel 0 included */
+  uint32_t chunks;                                /* chunks taken from the ring */
+  uint32_t bytes;
+  uint32_t dropped;                               /* bytes refused, ring full */
+  uint32_t reports[USBD_STRIPE_MAX_CHANNELS];     /* chunks completed per channel */
+} USBD_Stripe_StatsTypeDef;
+
+typedef struct
+{
+  uint8_t  ring[USBD_STRIPE_RING_SIZE];
+  __IO uint16_t head;
+  __IO uint16_t tail;
+  uint8_t  seq;
+  uint8_t  pattern;
+  /* Channels 1.. only; channel 0 is the custom HID's own report. Rows
+     are padded to whole words so each one can be a DMA source. */
+  uint8_t  report[USBD_STRIPE_MAX_CHANNELS - 1U][USBD_DMA_SIZE(CUSTOM_HID_EPIN_SIZE)] USBD_DMA_ALIGNED;
+  __IO uint8_t busy[USBD_STRIPE_MAX_CHANNELS - 1U];
+  uint16_t arm_frame[USBD_STRIPE_MAX_CHANNELS - 1U];
+  USBD_Stripe_StatsTypeDef stats;
+} USBD_Stripe_HandleTypeDef;
+
+void     USBD_Stripe_Init(USBD_HandleTypeDef *pdev, uint8_t channels);
+void     USBD_Stripe_DeInit(USBD_HandleTypeDef *pdev);
+void     USBD_Stripe_SOF(USBD_HandleTypeDef *pdev);
+void     USBD_Stripe_Kick(USBD_HandleTypeDef *pdev);
+uint8_t  USBD_Stripe_DataIn(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+uint8_t  USBD_Stripe_Fill(USBD_HandleTypeDef *pdev, uint8_t *report);
+void     USBD_Stripe_Complete(USBD_HandleTypeDef *pdev, uint8_t channel);
+uint16_t USBD_Stripe_Write(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_STRIPE_H */
@@ -0,0 +1,71 @@
+/* usbd_trace.h */
+#ifndef __USBD_TRACE_H
+#define __USBD_TRACE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* Circular event trace stamped with USB frame number + DWT cycles since
+   that frame's SOF. Each entry is 8 bytes, so a dump sends exactly one
+   entry per IN report (CUSTOM_HID_REPORT_ID_TRACE + 8 bytes) on 0x82.
+
+   Each device instance has its own ring (USBD_Composite_HandleTypeDef.trace),
+   stamped with its own SOFs, so ports never write the same memory. Clock
+   and key events have no device instance; USBD_Trace_Board puts them on
+   the ring of the instance serving USBD_TRACE_PORT. */
+#define USBD_TRACE_DEPTH            128U     /* entries, power of two */
+#define USBD_TRACE_PORT             DEVICE_FS
+
+#define USBD_TRACE_EV_KEY           0x01U    /* arg: key bitmap after the edge */
+#define USBD_TRACE_EV_CMD           0x02U    /* arg: vendor command */
+#define USBD_TRACE_EV_IN            0x03U    /* arg: IN endpoint address */
+#define USBD_TRACE_EV_CLOCK         0x04U    /* arg: 0 = HCLK throttled, 1 = back to full speed */
+#define USBD_TRACE_EV_POWER         0x05U    /* arg: 0 = bus suspend, 1 = resume */
+#define USBD_TRACE_EV_CONN          0x06U    /* arg: new USBD_CONN_* state */
+#define USBD_TRACE_EV_END           0xFFU    /* arg: entries lost to overrun, marks end of dump */
+
+typedef struct
+{
+  uint16_t frame;    /* frame number of the last SOF before the event */
+  uint8_t  type;
+  uint8_t  arg;
+  uint32_t cycles;   /* DWT cycles since that SOF */
+} USBD_Trace_EntryTypeDef;
+
+typedef struct
+{
+  USBD_Trace_EntryTypeDef buf[USBD_TRACE_DEPTH];
+  uint32_t head;           /* entries ever written */
+  uint32_t sof_cycles;     /* DWT->CYCCNT at the last SOF */
+  uint16_t frame;
+} USBD_Trace_RingTypeDef;
+
+/* Dump cursor, in the same units as the ring head */
+typedef struct
+{
+  uint32_t pos;
+  uint16_t left;
+  uint8_t  end;      /* end marker still to send */
+  uint8_t  lost;     /* entries overwritten before they were sent */
+} USBD_Trace_DumpTypeDef;
+
+void    USBD_Trace_Init(void);
+void    USBD_Trace_Bind(USBD_HandleTypeDef *pdev);
+void    USBD_Trace_SOF(USBD_HandleTypeDef *pdev, uint16_t frame);
+void    USBD_Trace_Record(USBD_HandleTypeDef *pdev, uint8_t type, uint8_t arg);
+void    USBD_Trace_Board(uint8_t type, uint8_t arg);
+void    USBD_Trace_StartDump(USBD_HandleTypeDef *pdev, USBD_Trace_DumpTypeDef *dump, uint16_t count);
+void    USBD_Trace_CancelDump(USBD_Trace_DumpTypeDef *dump);
+uint8_t USBD_Trace_Dumping(const USBD_Trace_DumpTypeDef *dump);
+uint8_t USBD_Trace_NextDumpEntry(USBD_HandleTypeDef *pdev, USBD_Trace_DumpTypeDef *dump, USBD_Trace_EntryTypeDef *entry);
+const USBD_Trace_EntryTypeDef *USBD_Trace_Ring(USBD_HandleTypeDef *pdev);
+const uint32_t *USBD_Trace_Head(USBD_HandleTypeDef *pdev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_TRACE_H */
@@ -0,0 +1,144 @@
+/* usbd_vendor_req.h */
+#ifndef __USBD_VENDOR_REQ_H
+#define __USBD_VENDOR_REQ_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+
+/* Out-of-band diagnostics as vendor control requests on EP0, so polling
+   them takes no interrupt endpoint bandwidth and needs no HID driver:
+
+     bmRequestType 0xC0 (vendor, device to host, device recipient;
+                   interface and endpoint recipients are accepted too)
+     bRequest      USBD_VREQ_*
+     wValue/wIndex 0
+     wLength       up to the size in USBD_VReq_Info.sizes[bRequest];
+                   a shorter wLength returns the head of the block
+
+   The reply is sent straight from the live structure, so a block larger
+   than one packet is read packet by packet while the firmware keeps
+   updating it; fields are consistent only within a 64-byte packet. The
+   layout is the ARM EABI layout of the structure in its header (little
+   endian, natural alignment). Requests that are not listed here or below
+   are stalled. */
+#define USBD_VREQ_INFO              0x00U    /* USBD_VReq_InfoTypeDef */
+#define USBD_VREQ_PERSONALITY       0x01U    /* USBD_Personality_StatsTypeDef */
+#define USBD_VREQ_CONN              0x02U    /* USBD_Conn_StatsTypeDef of this port */
+#define USBD_VREQ_LOW_POWER         0x03U    /* USBD_LP_StatsTypeDef of this port */
+#define USBD_VREQ_CLOCK_GOV         0x04U    /* ClockGov_StatsTypeDef */
+#define USBD_VREQ_SCHED             0x05U    /* USBD_Sched_StatsTypeDef */
+#define USBD_VREQ_BENCH             0x06U    /* USBD_Bench_TypeDef */
+#define USBD_VREQ_ARB               0x07U    /* USBD_Arb_ClassStatsTypeDef[USBD_ARB_NUM_CLASSES] */
+#define USBD_VREQ_BULK              0x08U    /* USBD_Bulk_StatsTypeDef */
+#define USBD_VREQ_STRIPE            0x09U    /* USBD_Stripe_StatsTypeDef */
+#define USBD_VREQ_TRACE_HEAD        0x0AU    /* uint32_t, entries ever written to this port's trace */
+#define USBD_VREQ_TRACE             0x0BU    /* USBD_Trace_EntryTypeDef[USBD_TRACE_DEPTH], this port's raw ring */
+#define USBD_VREQ_BLOB_STATS        0x0CU    /* USBD_VReq_BlobStatsTypeDef */
+#define USBD_VREQ_IRQ               0x0DU    /* USBD_Irq_StatsTypeDef of this port */
+#define USBD_VREQ_RAM               0x0EU    /* USBD_VReq_RamTypeDef */
+#define USBD_VREQ_LOG               0x0FU    /* USBD_Log_StatsTypeDef */
+#define USBD_VREQ_COUNT             0x10U
+
+/* Blob upload, host to device:
+
+     bmRequestType 0x40   bRequest USBD_VREQ_BLOB
+     wValue        blob id, passed to the consumer
+     wLength       up to USBD_VREQ_BLOB_MAX
+
+   It stalls until the device is configured. The data phase is streamed: each 64-byte packet goes to
+   USBD_VReq_BlobCallback as it arrives and the same packet buffer is
+   re-armed, so a blob of any size holds one packet of RAM. Building with
+   USBD_VREQ_BLOB_STAGING 1 receives the whole blob into a staging buffer
+   instead and hands it over in one call; USBD_VREQ_BLOB_STATS shows the
+   time, handler cycles and RAM of either build. */
+#define USBD_VREQ_BLOB              0x80U
+#define USBD_VREQ_BLOB_MAX          4096U    /* bytes */
+
+/* Personality switch, host to device, no data stage:
+
+     bmRequestType 0x40   bRequest USBD_VREQ_SET_PERSONALITY
+     wValue        USBD_PERSONALITY_*   wLength 0
+
+   The status stage completes before the device detaches, so it works
+   from any personality, MOUSE included. An unknown personality stalls. */
+#define USBD_VREQ_SET_PERSONALITY   0x81U
+
+#ifndef USBD_VREQ_BLOB_STAGING
+#define USBD_VREQ_BLOB_STAGING      0U
+#endif
+
+#if (USBD_VREQ_BLOB_STAGING != 0U)
+#define USBD_VREQ_BLOB_BUF_SIZE     USBD_VREQ_BLOB_MAX
+#else
+#define USBD_VREQ_BLOB_BUF_SIZE     USB_MAX_EP0_SIZE
+#endif
+
+/* Build configuration, and the reply size of every request so the host
+   can check its copy of the structure layouts */
+typedef struct
+{
+  uint8_t  personalities;
+  uint8_t  endpoints;                 /* OTG_FS endpoints, EP0 included */
+  uint8_t  interfaces;                /* USBD_MAX_NUM_INTERFACES */
+  uint8_t  arb_classes;
+  uint16_t trace_depth;               /* entries; oldest is head - depth */
+  uint16_t bulk_ring;                 /* bytes */
+  uint16_t stripe_ring;               /* bytes */
+  uint16_t blob_max;                  /* bytes */
+  uint16_t sizes[USBD_VREQ_COUNT];    /* reply size per bRequest, bytes */
+} USBD_VReq_InfoTypeDef;
+
+/* RAM held by the USB stack, sizes fixed at build time (bytes). Per port
+   unless noted. */
+typedef struct
+{
+  uint16_t ports;
+  uint16_t ep_max;                    /* USBD_MAX_EP_NUM */
+  uint16_t handle;                    /* USBD_HandleTypeDef */
+  uint16_t ep_table;                  /* its ep_in + ep_out */
+  uint16_t pcd;                       /* PCD_HandleTypeDef */
+  uint16_t context;                   /* USBD_Composite_HandleTypeDef */
+  uint16_t stripe_ring;               /* report queue, inside context */
+  uint16_t bulk_ring;                 /* inside context */
+  uint16_t trace;                     /* trace ring, inside context */
+  uint16_t log;                       /* log ring, shared by the ports */
+} USBD_VReq_RamTypeDef;
+
+typedef struct
+{
+  uint32_t blobs;                     /* data phases completed */
+  uint32_t bytes;
+  uint32_t packets;
+  uint16_t buf_size;                  /* RAM held for the data phase, bytes */
+  uint16_t ms_last;                   /* SETUP to last packet, last blob */
+  uint32_t cycles_last;               /* DWT cycles in the handler and consumer, last blob */
+  uint32_t cycles_max;
+} USBD_VReq_BlobStatsTypeDef;
+
+typedef struct
+{
+  uint8_t  blob_buf[USBD_VREQ_BLOB_BUF_SIZE] USBD_DMA_ALIGNED;
+  uint16_t blob_id;
+  uint16_t blob_len;                  /* wLength of the running upload */
+  uint16_t blob_pos;                  /* bytes handed to the consumer so far */
+  uint32_t blob_tick;
+  uint32_t blob_cycles;
+  USBD_VReq_BlobStatsTypeDef stats;
+} USBD_VReq_HandleTypeDef;
+
+uint8_t USBD_VReq_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+uint8_t USBD_VReq_EP0_RxReady(USBD_HandleTypeDef *pdev);
+
+/* Provided by the application: `len` bytes of blob `id` at `offset`, from
+   the USB interrupt. `last` is set on the final piece. The buffer is
+   reused once it returns. */
+void    USBD_VReq_BlobCallback(uint16_t id, uint32_t offset, const uint8_t *data, uint32_t len, uint8_t last);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_VENDOR_REQ_H */
@@ -0,0 +1,205 @@
+/* Src/usbd_bench.c */
+#include "usbd_bench.h"
+#include "usbd_hid_macro.h"
+#include "usbd_in_arb.h"
+#include "usbd_composite.h"
+#include "clock_gov.h"
+
+/* Canned macro steps, see usbd_hid_macro.h for the step layout */
+static const uint8_t BenchMotion[] =
+{
+  1U, 0x00U, 1U, 0U,
+};
+
+static const uint8_t BenchButtons[] =
+{
+  1U, 0x01U, 0U, 0U,
+  1U, 0x00U, 0U, 0U,
+};
+
+static uint8_t Bench_LoadMacro(USBD_HandleTypeDef *pdev, const uint8_t *steps, uint8_t len)
+{
+    USBD_HID_Macro_Begin(pdev);
+    if (USBD_HID_Macro_Append(pdev, steps, len) != USBD_OK)
+    {
+        return USBD_FAIL;
+    }
+    return USBD_HID_Macro_Play(pdev, 0U);
+}
+
+/**
+  * @brief  Start a run. Any macro playback in progress is replaced.
+  * @param  workload: USBD_BENCH_IDLE .. USBD_BENCH_BULK
+  * @param  frames: run length, 0 = USBD_BENCH_DEFAULT_FRAMES
+  */
+uint8_t USBD_Bench_Start(USBD_HandleTypeDef *pdev, uint8_t workload, uint16_t frames)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+    uint8_t ret = USBD_OK;
+    uint8_t i;
+
+    if (workload >= USBD_BENCH_NUM_WORKLOADS)
+    {
+        return USBD_FAIL;
+    }
+
+    hbench->state = USBD_BENCH_STOPPED;
+    hbench->workload = workload;
+    hbench->frames = 0U;
+    hbench->target = (frames == 0U) ? USBD_BENCH_DEFAULT_FRAMES : MIN(frames, USBD_BENCH_MAX_FRAMES);
+    hbench->reports = 0U;
+    hbench->cycles = 0U;
+    hbench->irq_cycles = 0U;
+    hbench->irq_entries = 0U;
+    hbench->bytes = 0U;
+    hbench->dispatches = 0U;
+    hbench->dispatch_cycles = 0U;
+    for (i = 0U; i < USBD_BENCH_LAT_BINS; i++)
+    {
+        hbench->lat_hist[i] = 0U;
+    }
+    /* Class latencies then cover exactly this run */
+    USBD_Arb_ClearStats(pdev);
+
+    switch (workload)
+    {
+        case USBD_BENCH_MOTION:
+            ret = Bench_LoadMacro(pdev, BenchMotion, sizeof(BenchMotion));
+            break;
+
+        case USBD_BENCH_BUTTONS:
+            ret = Bench_LoadMacro(pdev, BenchButtons, sizeof(BenchButtons));
+            break;
+
+        default:
+            USBD_HID_Macro_Stop(pdev);
+            break;
+    }
+
+    if (ret == USBD_OK)
+    {
+        hbench->state = USBD_BENCH_RUNNING;
+    }
+    return ret;
+}
+
+/* A run cut short (bus reset, disconnect) reports nothing */
+void USBD_Bench_Abort(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+
+    if (hbench->state == USBD_BENCH_RUNNING)
+    {
+        hbench->state = USBD_BENCH_STOPPED;
+    }
+}
+
+void USBD_Bench_SOF(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+
+    if (hbench->state != USBD_BENCH_RUNNING)
+    {
+        return;
+    }
+
+    /* Measure the stack at full HCLK, not the governor */
+    ClockGov_Activity();
+
+    if (++hbench->frames >= hbench->target)
+    {
+        hbench->state = USBD_BENCH_DONE;
+        if (hbench->workload != USBD_BENCH_VENDOR)
+        {
+            USBD_HID_Macro_Stop(pdev);
+        }
+    }
+}
+
+/**
+  * @brief  A report completed `latency` frames after its input was sampled.
+  */
+void USBD_Bench_Report(USBD_HandleTypeDef *pdev, uint16_t latency)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+    uint16_t bin = MIN(latency, USBD_BENCH_LAT_BINS - 1U);
+
+    if (hbench->state != USBD_BENCH_RUNNING)
+    {
+        return;
+    }
+
+    hbench->reports++;
+    hbench->lat_hist[bin]++;
+}
+
+/**
+  * @brief  Bytes 1..8 of the result report. Cycles are per frame when the
+  *         run completed no reports (idle workload).
+  */
+void USBD_Bench_GetResult(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+    const USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+    uint32_t rate = 0U;
+    uint32_t cycles = 0U;
+    uint8_t p50 = 0U, p99 = 0U;
+
+    if (hbench->frames != 0U)
+    {
+        rate = (hbench->reports * 1000U) / hbench->frames;
+        cycles = hbench->cycles / ((hbench->reports != 0U) ? hbench->reports : hbench->frames);
+    }
+    if (hbench->reports != 0U)
+    {
+        p50 = USBD_Arb_Percentile(hbench->lat_hist, USBD_BENCH_LAT_BINS, 50U);
+        p99 = USBD_Arb_Percentile(hbench->lat_hist, USBD_BENCH_LAT_BINS, 99U);
+    }
+
+    rate = MIN(rate, 0xFFFFU);
+    report[1] = LOBYTE(rate);
+    report[2] = HIBYTE(rate);
+    report[3] = p50;
+    report[4] = p99;
+    report[5] = (uint8_t)(cycles);
+    report[6] = (uint8_t)(cycles >> 8);
+    report[7] = (uint8_t)(cycles >> 16);
+    report[8] = (uint8_t)(cycles >> 24);
+}
+
+/**
+  * @brief  One OTG interrupt entry of this port and its cycles. Also called
+  *         before the instance state is bound, hence the check.
+  */
+void USBD_Bench_Irq(USBD_HandleTypeDef *pdev, uint32_t cycles)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+
+    if ((ctx != NULL) && (ctx->bench.state == USBD_BENCH_RUNNING))
+    {
+        ctx->bench.irq_cycles += cycles;
+        ctx->bench.irq_entries++;
+    }
+}
+
+/* A data endpoint transfer of `len` bytes completed */
+void USBD_Bench_Bytes(USBD_HandleTypeDef *pdev, uint32_t len)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+
+    if (hbench->state == USBD_BENCH_RUNNING)
+    {
+        hbench->bytes += len;
+    }
+}
+
+/* One class dispatch from the core took `cycles` */
+void USBD_Bench_Dispatch(USBD_HandleTypeDef *pdev, uint32_t cycles)
+{
+    USBD_Bench_TypeDef *hbench = &USBD_COMPOSITE_CTX(pdev)->bench;
+
+    if (hbench->state == USBD_BENCH_RUNNING)
+    {
+        hbench->dispatches++;
+        hbench->dispatch_cycles += cycles;
+    }
+}
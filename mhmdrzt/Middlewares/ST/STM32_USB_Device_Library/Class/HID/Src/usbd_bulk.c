@@ -0,0 +1,199 @@
+/* Src/usbd_bulk.c */
+#include "usbd_bulk.h"
+#include "usbd_core.h"
+#include "usbd_report_sched.h"
+#include "usbd_bench.h"
+#include "usbd_in_arb.h"
+#include "usbd_composite.h"
+#include "clock_gov.h"
+
+#define BULK_TX_RING_MASK   (USBD_BULK_TX_RING_SIZE - 1U)
+
+#if ((USBD_BULK_TX_RING_SIZE & BULK_TX_RING_MASK) != 0U)
+#error "usbd_bulk.h: USBD_BULK_TX_RING_SIZE must be a power of two"
+#endif
+
+static uint16_t Bulk_TxCount(const USBD_Bulk_HandleTypeDef *hbulk)
+{
+    return (uint16_t)(hbulk->head - hbulk->tail);
+}
+
+/* Arbiter pump: arm the next contiguous run of the ring. Interrupts masked
+   or USB ISR. */
+void USBD_Bulk_Kick(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+    uint16_t count = Bulk_TxCount(hbulk);
+    uint16_t off = hbulk->tail & BULK_TX_RING_MASK;
+    uint16_t len;
+
+    if ((hbulk->inflight != 0U) || (count == 0U) || (pdev->dev_state != USBD_STATE_CONFIGURED))
+    {
+        return;
+    }
+
+    len = MIN(count, USBD_BULK_TX_RING_SIZE - off);
+    len = MIN(len, USBD_BULK_MAX_XFER);
+
+    /* DMA fetches from word-aligned addresses only. The ring end and the
+       transfer limit are word multiples, so a run ending off a word is all
+       that is queued: move the head past the rest of the word, and the
+       next write starts on a word boundary again. */
+    if ((USBD_LL_IsDMA(pdev) != 0U) && ((len & 3U) != 0U))
+    {
+        hbulk->head = (uint16_t)USBD_DMA_SIZE(hbulk->head);
+    }
+
+    hbulk->inflight = len;
+    hbulk->frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    (void)USBD_Arb_Transmit(pdev, USBD_BULK_EPIN_ADDR, &hbulk->ring[off], len);
+}
+
+uint8_t USBD_Bulk_Init(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+
+    USBD_LL_OpenEP(pdev, USBD_BULK_EPIN_ADDR, USBD_EP_TYPE_BULK, USBD_BULK_PACKET_SIZE);
+    USBD_LL_OpenEP(pdev, USBD_BULK_EPOUT_ADDR, USBD_EP_TYPE_BULK, USBD_BULK_PACKET_SIZE);
+
+    hbulk->head = 0U;
+    hbulk->tail = 0U;
+    hbulk->inflight = 0U;
+
+    USBD_LL_PrepareReceive(pdev, USBD_BULK_EPOUT_ADDR, hbulk->rx_buf, sizeof(hbulk->rx_buf));
+
+    return USBD_OK;
+}
+
+/* Whatever is still queued belongs to the old session and is dropped */
+uint8_t USBD_Bulk_DeInit(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+
+    USBD_LL_CloseEP(pdev, USBD_BULK_EPIN_ADDR);
+    USBD_LL_CloseEP(pdev, USBD_BULK_EPOUT_ADDR);
+
+    hbulk->head = 0U;
+    hbulk->tail = 0U;
+    hbulk->inflight = 0U;
+
+    return USBD_OK;
+}
+
+uint8_t USBD_Bulk_DataIn(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+    uint16_t len = hbulk->inflight;
+    uint16_t frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    uint16_t lat = (frame - hbulk->frame) & USBD_SCHED_FRAME_MASK;
+    uint16_t packets;
+
+    hbulk->tail += len;
+    if (USBD_LL_IsDMA(pdev) != 0U)
+    {
+        /* Skip the padding left by Kick */
+        hbulk->tail = (uint16_t)USBD_DMA_SIZE(hbulk->tail);
+    }
+    hbulk->inflight = 0U;
+    hbulk->stats.tx_bytes += len;
+    hbulk->stats.tx_xfers++;
+
+    /* The benchmark counts bulk traffic in packets */
+    for (packets = (len + USBD_BULK_PACKET_SIZE - 1U) / USBD_BULK_PACKET_SIZE; packets != 0U; packets--)
+    {
+        USBD_Bench_Report(pdev, lat);
+    }
+
+    return USBD_OK;
+}
+
+uint8_t USBD_Bulk_DataOut(USBD_HandleTypeDef *pdev)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+    uint32_t len = USBD_LL_GetRxDataSize(pdev, USBD_BULK_EPOUT_ADDR);
+
+    hbulk->stats.rx_bytes += len;
+    USBD_Bulk_RxCallback(pdev, hbulk->rx_buf, len);
+
+    USBD_LL_PrepareReceive(pdev, USBD_BULK_EPOUT_ADDR, hbulk->rx_buf, sizeof(hbulk->rx_buf));
+    return USBD_OK;
+}
+
+/**
+  * @brief  Benchmark bulk workload: top the ring up with a counting pattern
+  *         every frame so 0x83 never runs dry. The arbiter arms it after.
+  */
+void USBD_Bulk_SOF(USBD_HandleTypeDef *pdev)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    USBD_Bulk_HandleTypeDef *hbulk = &ctx->bulk;
+    uint16_t free;
+    uint16_t head;
+
+    if ((ctx->bench.state != USBD_BENCH_RUNNING) || (ctx->bench.workload != USBD_BENCH_BULK))
+    {
+        return;
+    }
+
+    head = hbulk->head;
+    for (free = USBD_Bulk_TxFree(pdev); free != 0U; free--)
+    {
+        hbulk->ring[head & BULK_TX_RING_MASK] = hbulk->pattern++;
+        head++;
+    }
+    hbulk->head = head;
+    hbulk->stats.tx_high = MAX(hbulk->stats.tx_high, Bulk_TxCount(hbulk));
+}
+
+/**
+  * @brief  Queue telemetry for 0x83. Safe from thread and interrupt context.
+  * @retval Bytes accepted; the rest did not fit and is counted as dropped.
+  */
+uint16_t USBD_Bulk_Write(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &USBD_COMPOSITE_CTX(pdev)->bulk;
+    uint32_t primask;
+    uint16_t n, i, head;
+
+    if (pdev->dev_state != USBD_STATE_CONFIGURED)
+    {
+        return 0U;
+    }
+
+    ClockGov_Activity();
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    n = MIN(len, USBD_Bulk_TxFree(pdev));
+    head = hbulk->head;
+    for (i = 0U; i < n; i++)
+    {
+        hbulk->ring[head & BULK_TX_RING_MASK] = data[i];
+        head++;
+    }
+    hbulk->head = head;
+
+    hbulk->stats.tx_dropped += len - n;
+    hbulk->stats.tx_high = MAX(hbulk->stats.tx_high, Bulk_TxCount(hbulk));
+
+    USBD_Arb_Run(pdev);
+    __set_PRIMASK(primask);
+
+    return n;
+}
+
+uint16_t USBD_Bulk_TxFree(USBD_HandleTypeDef *pdev)
+{
+    return (uint16_t)(USBD_BULK_TX_RING_SIZE - Bulk_TxCount(&USBD_COMPOSITE_CTX(pdev)->bulk));
+}
+
+/**
+  * @brief  Default receiver: OUT data is counted and discarded. Overridden
+  *         by the application.
+  */
+__weak void USBD_Bulk_RxCallback(USBD_HandleTypeDef *pdev, const uint8_t *data, uint32_t len)
+{
+    UNUSED(pdev);
+    UNUSED(data);
+    UNUSED(len);
+}
@@ -3,6 +3,14 @@
 #include "usbd_def.h"
 #include "usbd_hid_mouse.h"
 #include "usbd_custom_hid.h"
+#include "usbd_bulk.h"
+#include "usbd_stripe.h"
+#include "usbd_in_arb.h"
+#include "usbd_vendor_req.h"
+#include "usbd_report_sched.h"
+#include "usbd_trace.h"
+#include "usbd_bench.h"
+#include "usbd_hid_macro.h"
 #include "usbd_ioreq.h"
 
 
@@ -11,14 +19,10 @@
 /* Forward declarations of composite class callbacks */
 static uint8_t Composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t Composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
-static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
-static uint8_t Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
-static uint8_t Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
-static uint8_t Composite_EP0_RxReady(USBD_HandleTypeDef *pdev);
-static uint8_t* USBD_Composite_GetFSConfigDescriptor(uint16_t *length)
-{
-    *length = USBD_Composite_CfgDescSize;
-    return USBD_Composite_CfgDesc;
+static uint8_t* USBD_Composite_GetFSConfigDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
+{
+    *length = USBD_COMPOSITE_CTX(pdev)->desc.cfg_size;
+    return USBD_COMPOSITE_CTX(pdev)->desc.cfg;
 }
 
 /* Composite Class callbacks structure */
@@ -26,12 +30,12 @@ USBD_ClassTypeDef USBD_Composite =
 {
   Composite_Init,
   Composite_DeInit,
-  Composite_Setup,
+  USBD_Composite_Setup,
   NULL,                       /* EP0_TxSent */
-  Composite_EP0_RxReady,
-  Composite_DataIn,
-  Composite_DataOut,
-  NULL,                       /* SOF */
+  USBD_Composite_EP0_RxReady,
+  USBD_Composite_DataIn,
+  USBD_Composite_DataOut,
+  USBD_Composite_SOF,
   NULL,                       /* IsoINIncomplete */
   NULL,                       /* IsoOUTIncomplete */
   NULL,                       /* GetHSConfigDescriptor (not used for FS) */
@@ -40,14 +44,88 @@ USBD_ClassTypeDef USBD_Composite =
   NULL                        /* GetDeviceQualifierDescriptor */
 };
 
-/* Composite_Init: Initialize both HID interfaces */
+/* Interface numbers per personality, in the order they are described.
+   Extra vendor channels follow vendor_if and take the endpoints that the
+   mouse and bulk interfaces leave free. */
+typedef struct
+{
+    uint8_t mouse_if;
+    uint8_t vendor_if;
+    uint8_t bulk_if;
+    uint8_t channels;     /* vendor channels, vendor_if included */
+} Composite_PersonalityTypeDef;
+
+static const Composite_PersonalityTypeDef CompositePersonalities[USBD_PERSONALITY_COUNT] =
+{
+    { 0U,                   1U,                   2U,                   1U },  /* FULL */
+    { 0U,                   USBD_COMPOSITE_NO_IF, USBD_COMPOSITE_NO_IF, 0U },  /* MOUSE */
+    { USBD_COMPOSITE_NO_IF, 0U,                   1U,                   1U },  /* VENDOR */
+    { USBD_COMPOSITE_NO_IF, 0U,                   USBD_COMPOSITE_NO_IF, 2U },  /* VENDOR_X2: ch1 on EP3 */
+    { USBD_COMPOSITE_NO_IF, 0U,                   USBD_COMPOSITE_NO_IF, 3U },  /* VENDOR_X3: ch2 on EP1 */
+};
+
+/* Personality the instance enumerates with */
+#define COMPOSITE_CUR(pdev)     (&CompositePersonalities[USBD_COMPOSITE_CTX(pdev)->personality.personality])
+
+#define COMPOSITE_HAS_MOUSE(cur)    ((cur)->mouse_if != USBD_COMPOSITE_NO_IF)
+#define COMPOSITE_HAS_VENDOR(cur)   ((cur)->vendor_if != USBD_COMPOSITE_NO_IF)
+#define COMPOSITE_HAS_BULK(cur)     ((cur)->bulk_if != USBD_COMPOSITE_NO_IF)
+/* Extra stripe channel interfaces: vendor_if + 1 .. vendor_if + channels - 1 */
+#define COMPOSITE_IS_STRIPE_IF(cur, i) (COMPOSITE_HAS_VENDOR(cur) && ((i) > (cur)->vendor_if) && \
+                                        ((i) < ((cur)->vendor_if + (cur)->channels)))
+
+/* Composite_Init: Initialize the interfaces of the active personality */
 static uint8_t Composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-    uint8_t ret_mouse, ret_custom;
-    ret_mouse = USBD_HID_MOUSE_Init(pdev);
-    ret_custom = USBD_CustomHID_Init(pdev);
-    
-    if ((ret_mouse == USBD_OK) && (ret_custom == USBD_OK))
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
+    uint8_t ret_mouse = USBD_OK, ret_custom = USBD_OK, ret_bulk = USBD_OK;
+    uint32_t elapsed;
+    uint8_t ch;
+
+    USBD_Arb_Reset(pdev);
+    if (COMPOSITE_HAS_MOUSE(cur))
+    {
+        ret_mouse = USBD_HID_MOUSE_Init(pdev);
+        USBD_Arb_Register(pdev, HID_MOUSE_EPIN_ADDR, USBD_ARB_CLASS_POINTER);
+    }
+    if (COMPOSITE_HAS_VENDOR(cur))
+    {
+        ret_custom = USBD_CustomHID_Init(pdev);
+        USBD_Arb_Register(pdev, CUSTOM_HID_EPIN_ADDR, USBD_ARB_CLASS_REPLY);
+        USBD_Arb_AddPump(pdev, USBD_ARB_CLASS_REPLY, USBD_CustomHID_Kick);
+    }
+    USBD_Stripe_Init(pdev, cur->channels);
+    if (cur->channels > 1U)
+    {
+        for (ch = 1U; ch < cur->channels; ch++)
+        {
+            USBD_Arb_Register(pdev, USBD_STRIPE_EPIN_ADDR(ch), USBD_ARB_CLASS_STREAM);
+        }
+        USBD_Arb_AddPump(pdev, USBD_ARB_CLASS_STREAM, USBD_Stripe_Kick);
+    }
+    if (COMPOSITE_HAS_BULK(cur))
+    {
+        ret_bulk = USBD_Bulk_Init(pdev);
+        USBD_Arb_Register(pdev, USBD_BULK_EPIN_ADDR, USBD_ARB_CLASS_STREAM);
+        USBD_Arb_AddPump(pdev, USBD_ARB_CLASS_STREAM, USBD_Bulk_Kick);
+    }
+    USBD_Sched_Reset(pdev);
+    /* Non-NULL pClassData tells the core a configuration is active, so bus
+       reset and disconnect call DeInit */
+    pdev->pClassData = ctx;
+
+    /* SET_CONFIGURATION ends a personality switch */
+    if (ctx->switch_tick != 0U)
+    {
+        elapsed = MIN(HAL_GetTick() - ctx->switch_tick, 0xFFFFU);
+        ctx->switch_tick = 0U;
+        ctx->personality.switches++;
+        ctx->personality.switch_ms_last = (uint16_t)elapsed;
+        ctx->personality.switch_ms_max = MAX(ctx->personality.switch_ms_max, (uint16_t)elapsed);
+    }
+
+    if ((ret_mouse == USBD_OK) && (ret_custom == USBD_OK) && (ret_bulk == USBD_OK))
     {
         return USBD_OK;
     }
@@ -57,26 +135,56 @@ static uint8_t Composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
     }
 }
 
-/* Composite_DeInit: Deinitialize both HID interfaces */
+/* Composite_DeInit: Close both HID interfaces and drop per-session state.
+   Only flags are reset, so this is O(1) however much was queued. */
 static uint8_t Composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-    /* Add per-interface deinitialization if necessary. */
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
+
+    if (pdev->pClassData == NULL)
+    {
+        return USBD_OK;
+    }
+
+    if (COMPOSITE_HAS_MOUSE(cur))
+    {
+        (void)USBD_HID_MOUSE_DeInit(pdev);
+    }
+    if (COMPOSITE_HAS_VENDOR(cur))
+    {
+        (void)USBD_CustomHID_DeInit(pdev);
+    }
+    USBD_Stripe_DeInit(pdev);
+    if (COMPOSITE_HAS_BULK(cur))
+    {
+        (void)USBD_Bulk_DeInit(pdev);
+    }
+    USBD_HID_Macro_Stop(pdev);
+    USBD_Sched_Reset(pdev);
+    USBD_Bench_Abort(pdev);
+    pdev->pClassData = NULL;
+
     return USBD_OK;
 }
 
-/* Composite_Setup: Dispatch class-specific requests based on request type and interface (wIndex) */
-static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+/* USBD_Composite_Setup: Dispatch class-specific requests based on request type and interface (wIndex).
+   Vendor requests are EP0 diagnostics, whatever the recipient. */
+USBD_RAMFUNC uint8_t USBD_Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
     uint8_t ret = USBD_OK;
 
-    /* Handle class requests only */
-    if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
+    if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR)
+    {
+        ret = USBD_VReq_Setup(pdev, req);
+    }
+    else if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
     {
-        if(req->wIndex == 0)
+        if(req->wIndex == cur->mouse_if)
         {
             ret = USBD_HID_MOUSE_Setup(pdev, req);
         }
-        else if(req->wIndex == 1)
+        else if((req->wIndex == cur->vendor_if) || COMPOSITE_IS_STRIPE_IF(cur, req->wIndex))
         {
             ret = USBD_CustomHID_Setup(pdev, req);
         }
@@ -87,16 +195,19 @@ static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
     }
     else if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_STANDARD)
     {
-			uint16_t len;
-			uint8_t *pbuf;
+			uint16_t len = 0U;
+			uint8_t *pbuf = NULL;
         if ((req->wValue >> 8) == 0x22U)
 				{
-					if(req->wIndex == 0) {
+					if(req->wIndex == cur->mouse_if) {
 						len = MIN(HID_MOUSE_REPORT_DESC_SIZE, req->wLength);
 						pbuf = HID_Mouse_ReportDesc;
-					} else if (req->wIndex == 1) {
+					} else if (req->wIndex == cur->vendor_if) {
 						len = MIN( CUSTOM_HID_REPORT_DESC_SIZE, req->wLength);
 						pbuf = Custom_HID_ReportDesc;
+					} else if (COMPOSITE_IS_STRIPE_IF(cur, req->wIndex)) {
+						len = MIN(CUSTOM_HID_STREAM_DESC_SIZE, req->wLength);
+						pbuf = Custom_HID_ReportDesc;
 					} else {
 						ret = USBD_FAIL; // Unknown interface
 					}
@@ -104,8 +215,8 @@ static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
 				}
 				else if ((req->wValue >> 8) == 0x21U)
 				{
-					pbuf = USBD_Composite_CfgDesc;
-					len = MIN(USBD_Composite_CfgDescSize, req->wLength);
+					pbuf = USBD_COMPOSITE_CTX(pdev)->desc.cfg;
+					len = MIN(USBD_COMPOSITE_CTX(pdev)->desc.cfg_size, req->wLength);
 				}
 				else {
 					/* Handle in ctlreq.c */
@@ -122,30 +233,199 @@ static uint8_t Composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
     return ret;
 }
 
-/* Composite_DataIn: Handle data IN events by endpoint number */
-static uint8_t Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+/* USBD_Composite_DataIn: Handle data IN events by endpoint number */
+USBD_RAMFUNC uint8_t USBD_Composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-    /* Dispatch based on endpoint number if needed.
-       For example:
-       if(epnum == 0x81) { return USBD_HID_MOUSE_DataIn(pdev, epnum); }
-       else if(epnum == 0x82) { return USBD_CustomHID_DataIn(pdev, epnum); }
-    */
-    return USBD_OK;
+    uint32_t dispatch = DWT->CYCCNT - pdev->class_stamp;
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
+    uint8_t ret = USBD_OK;
+    USBD_BENCH_CYCLES_BEGIN();
+
+    USBD_Bench_Dispatch(pdev, dispatch);
+    USBD_Arb_Complete(pdev, epnum | 0x80U);
+
+    /* epnum comes from the core without the direction bit. Bulk and
+       stripe channel completions would flood the trace ring and are not
+       recorded. */
+    if(COMPOSITE_HAS_MOUSE(cur) && ((epnum | 0x80U) == HID_MOUSE_EPIN_ADDR))
+    {
+        USBD_Trace_Record(pdev, USBD_TRACE_EV_IN, epnum | 0x80U);
+        USBD_Sched_InComplete(pdev);
+        ret = USBD_HID_MOUSE_DataIn(pdev);
+    }
+    else if((epnum | 0x80U) == CUSTOM_HID_EPIN_ADDR)
+    {
+        if (USBD_Trace_Dumping(&ctx->custom.dump) == 0U)
+        {
+            USBD_Trace_Record(pdev, USBD_TRACE_EV_IN, epnum | 0x80U);
+        }
+        ret = USBD_CustomHID_DataIn(pdev);
+    }
+    else if(COMPOSITE_HAS_BULK(cur) && ((epnum | 0x80U) == USBD_BULK_EPIN_ADDR)) { ret = USBD_Bulk_DataIn(pdev); }
+    else { (void)USBD_Stripe_DataIn(pdev, epnum | 0x80U); }
+
+    /* Re-arm whatever is idle, most urgent class first */
+    USBD_Arb_Run(pdev);
+
+    USBD_BENCH_CYCLES_END(&ctx->bench);
+    return ret;
 }
 
-/* Composite_DataOut: Handle data OUT events by endpoint number */
-static uint8_t Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+/* USBD_Composite_DataOut: Handle data OUT events by endpoint number */
+USBD_RAMFUNC uint8_t USBD_Composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
+    uint32_t dispatch = DWT->CYCCNT - pdev->class_stamp;
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
+
+    USBD_Bench_Dispatch(pdev, dispatch);
+
 //    Dispatch if your custom HID OUT endpoint (e.g., address 0x02)
 //       is used for receiving data.
 //       For example:
-       if(epnum == 0x02) { return USBD_CustomHID_DataOut(pdev); }
+       if((epnum == CUSTOM_HID_EPOUT_ADDR) && COMPOSITE_HAS_VENDOR(cur)) { return USBD_CustomHID_DataOut(pdev); }
+       if((epnum == USBD_BULK_EPOUT_ADDR) && COMPOSITE_HAS_BULK(cur)) { return USBD_Bulk_DataOut(pdev); }
     
     return USBD_OK;
 }
 
-/* Composite_EP0_RxReady: Endpoint 0 Rx Ready callback */
-static uint8_t Composite_EP0_RxReady(USBD_HandleTypeDef *pdev)
+/* USBD_Composite_EP0_RxReady: Endpoint 0 Rx Ready callback, per packet for streamed data phases */
+USBD_RAMFUNC uint8_t USBD_Composite_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+    return USBD_VReq_EP0_RxReady(pdev);
+}
+
+/* USBD_Composite_SOF: Start of frame. The pointer report is armed first by the
+   scheduler; benchmark load is generated next and the arbiter arms the
+   remaining endpoints in priority order. */
+USBD_RAMFUNC uint8_t USBD_Composite_SOF(USBD_HandleTypeDef *pdev)
+{
+    uint32_t dispatch = DWT->CYCCNT - pdev->class_stamp;
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    const Composite_PersonalityTypeDef *cur = COMPOSITE_CUR(pdev);
+    USBD_BENCH_CYCLES_BEGIN();
+
+    USBD_Bench_Dispatch(pdev, dispatch);
+    USBD_Trace_SOF(pdev, (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK));
+    if (COMPOSITE_HAS_MOUSE(cur))
+    {
+        USBD_Sched_SOF(pdev);
+    }
+    USBD_BENCH_CYCLES_END(&ctx->bench);
+
+    if (COMPOSITE_HAS_BULK(cur))
+    {
+        USBD_Bulk_SOF(pdev);
+    }
+    USBD_Stripe_SOF(pdev);
+    USBD_Arb_Run(pdev);
+    USBD_Bench_SOF(pdev);
+    return USBD_OK;
+}
+
+/**
+  * @brief  Bind the state of one device instance to `pdev` and reset it.
+  *         After USBD_Init and before anything else of this class.
+  */
+void USBD_Composite_RegisterContext(USBD_HandleTypeDef *pdev, USBD_Composite_HandleTypeDef *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->personality.personality = USBD_PERSONALITY_FULL;
+    ctx->request = USBD_PERSONALITY_NONE;
+    ctx->custom.chunk_frame = USBD_SCHED_NO_FRAME;
+    ctx->sched.stats.period = USBD_SCHED_DEFAULT_PERIOD;
+    ctx->sched.stats.phase = USBD_SCHED_DEFAULT_PHASE;
+    ctx->sched.sample_frame = USBD_SCHED_NO_FRAME;
+    ctx->vreq.stats.buf_size = USBD_VREQ_BLOB_BUF_SIZE;
+    pdev->pUserData = ctx;
+    USBD_Trace_Bind(pdev);
+}
+
+/**
+  * @brief  Make `personality` the active one and rebuild the descriptors.
+  *         Only while the device is stopped, see MX_USB_DEVICE_Process.
+  */
+uint8_t USBD_Composite_SelectPersonality(USBD_HandleTypeDef *pdev, uint8_t personality)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    const Composite_PersonalityTypeDef *cur;
+
+    if (personality >= USBD_PERSONALITY_COUNT)
+    {
+        return USBD_FAIL;
+    }
+
+    cur = &CompositePersonalities[personality];
+    ctx->personality.personality = personality;
+    USBD_Desc_Build(&ctx->desc, personality, cur->mouse_if, cur->vendor_if, cur->bulk_if, cur->channels);
+
+    return USBD_OK;
+}
+
+/**
+  * @brief  Ask for a re-enumeration as `personality`. Safe from interrupts;
+  *         the switch itself runs from the main loop.
+  */
+uint8_t USBD_Composite_RequestPersonality(USBD_HandleTypeDef *pdev, uint8_t personality)
 {
+    if (personality >= USBD_PERSONALITY_COUNT)
+    {
+        return USBD_FAIL;
+    }
+
+    USBD_COMPOSITE_CTX(pdev)->request = personality;
     return USBD_OK;
 }
+
+/**
+  * @brief  Personality to re-enumerate as now, USBD_PERSONALITY_NONE if
+  *         nothing to do. Taking a request starts the switch timer; a switch
+  *         the host has not configured within USBD_PERSONALITY_TIMEOUT_MS
+  *         falls back to FULL.
+  */
+uint8_t USBD_Composite_NextPersonality(USBD_HandleTypeDef *pdev)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    uint8_t next = ctx->request;
+
+    if (next == USBD_PERSONALITY_NONE)
+    {
+        if ((ctx->switch_tick == 0U) ||
+            ((HAL_GetTick() - ctx->switch_tick) < USBD_PERSONALITY_TIMEOUT_MS))
+        {
+            return USBD_PERSONALITY_NONE;
+        }
+
+        ctx->personality.timeouts++;
+        ctx->switch_tick = 0U;
+        if (ctx->personality.personality == USBD_PERSONALITY_FULL)
+        {
+            /* Nobody configures FULL either: no host, leave it attached */
+            return USBD_PERSONALITY_NONE;
+        }
+        next = USBD_PERSONALITY_FULL;
+    }
+
+    ctx->request = USBD_PERSONALITY_NONE;
+    /* 0 marks "no switch", so a request in the first tick starts at 1 */
+    ctx->switch_tick = MAX(HAL_GetTick(), 1U);
+    return next;
+}
+
+/**
+  * @brief  Bytes 1..8 of the personality info report: active personality,
+  *         completed switches, timeouts, last and worst switch time (ms).
+  */
+void USBD_Composite_GetPersonalityInfo(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+    const USBD_Personality_StatsTypeDef *st = &USBD_COMPOSITE_CTX(pdev)->personality;
+
+    report[1] = st->personality;
+    report[2] = (uint8_t)MIN(st->switches, 0xFFU);
+    report[3] = (uint8_t)MIN(st->timeouts, 0xFFU);
+    report[4] = LOBYTE(st->switch_ms_last);
+    report[5] = HIBYTE(st->switch_ms_last);
+    report[6] = LOBYTE(st->switch_ms_max);
+    report[7] = HIBYTE(st->switch_ms_max);
+    report[8] = USBD_PERSONALITY_DETACH_MS;
+}
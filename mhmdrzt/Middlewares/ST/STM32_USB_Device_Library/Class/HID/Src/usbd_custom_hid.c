@@ -1,8 +1,30 @@
 /* Src/usbd_custom_hid.c */
 #include "usbd_custom_hid.h"
 #include "usbd_def.h"
+#include "usbd_core.h"
+#include "usbd_hid_macro.h"
+#include "usbd_report_sched.h"
+#include "usbd_trace.h"
+#include "usbd_bench.h"
+#include "usbd_composite.h"
+#include "usbd_stripe.h"
+#include "usbd_in_arb.h"
 
 __ALIGN_BEGIN uint8_t Custom_HID_ReportDesc[] __ALIGN_END = {
+  /* Stream chunks (see usbd_stripe.h); first, since the extra stripe
+     channels report this collection alone */
+  0x06, 0x00, 0xFF,  // Usage Page (Vendor Defined 0xFF00)
+  0x09, 0x04,        // Usage (Vendor Usage 4)
+  0xA1, 0x01,        // Collection (Application)
+	0x85, 0x06,       //   << REPORT ID 6
+    0x15, 0x00,      //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,//   Logical Maximum (255)
+    0x75, 0x08,      //   Report Size (8)
+    0x95, 0x08,      //   Report Count (8)
+    0x09, 0x04,      //   Usage (Vendor Usage 4)
+    0x81, 0x00,      //   Input (Data, Array)
+  0xC0,              // End Collection
+
   0x06, 0x00, 0xFF,  // Usage Page (Vendor Defined 0xFF00)
   0x09, 0x01,        // Usage (Vendor Usage 1)
   0xA1, 0x01,        // Collection (Application)
@@ -16,10 +38,66 @@ __ALIGN_BEGIN uint8_t Custom_HID_ReportDesc[] __ALIGN_END = {
     0x95, 0x08,      //   Report Count (8)
     0x09, 0x01,      //   Usage (Vendor Usage 1)
     0x91, 0x00,      //   Output (Data, Array)
+  0xC0,              // End Collection
+
+  /* Absolute pointer, placed from the vendor channel (see CUSTOM_HID_CMD_ABS_MOVE) */
+  0x05, 0x01,        // Usage Page (Generic Desktop)
+  0x09, 0x02,        // Usage (Mouse)
+  0xA1, 0x01,        // Collection (Application)
+	0x85, 0x03,       //   << REPORT ID 3
+    0x09, 0x01,      //   Usage (Pointer)
+    0xA1, 0x00,      //   Collection (Physical)
+    0x05, 0x09,      //     Usage Page (Buttons)
+    0x19, 0x01,      //     Usage Minimum (1)
+    0x29, 0x03,      //     Usage Maximum (3)
+    0x15, 0x00,      //     Logical Minimum (0)
+    0x25, 0x01,      //     Logical Maximum (1)
+    0x95, 0x03,      //     Report Count (3)
+    0x75, 0x01,      //     Report Size (1)
+    0x81, 0x02,      //     Input (Data, Variable, Absolute) - 3 button bits
+    0x95, 0x01,      //     Report Count (1)
+    0x75, 0x05,      //     Report Size (5)
+    0x81, 0x03,      //     Input (Constant) - 5 bit padding
+    0x05, 0x01,      //     Usage Page (Generic Desktop)
+    0x09, 0x30,      //     Usage (X)
+    0x09, 0x31,      //     Usage (Y)
+    0x15, 0x00,      //     Logical Minimum (0)
+    0x26, 0xFF, 0x7F,//     Logical Maximum (32767)
+    0x75, 0x10,      //     Report Size (16)
+    0x95, 0x02,      //     Report Count (2)
+    0x81, 0x02,      //     Input (Data, Variable, Absolute)
+    0xC0,            //   End Collection
+  0xC0,              // End Collection
+
+  /* Binary log, drained when the channel is idle (see usbd_log.h) */
+  0x06, 0x00, 0xFF,  // Usage Page (Vendor Defined 0xFF00)
+  0x09, 0x02,        // Usage (Vendor Usage 2)
+  0xA1, 0x01,        // Collection (Application)
+	0x85, 0x04,       //   << REPORT ID 4
+    0x15, 0x00,      //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,//   Logical Maximum (255)
+    0x75, 0x08,      //   Report Size (8)
+    0x95, 0x08,      //   Report Count (8)
+    0x09, 0x02,      //   Usage (Vendor Usage 2)
+    0x81, 0x00,      //   Input (Data, Array)
+  0xC0,              // End Collection
+
+  /* Trace dump entries, after CUSTOM_HID_CMD_TRACE_DUMP (see usbd_trace.h) */
+  0x06, 0x00, 0xFF,  // Usage Page (Vendor Defined 0xFF00)
+  0x09, 0x03,        // Usage (Vendor Usage 3)
+  0xA1, 0x01,        // Collection (Application)
+	0x85, 0x05,       //   << REPORT ID 5
+    0x15, 0x00,      //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,//   Logical Maximum (255)
+    0x75, 0x08,      //   Report Size (8)
+    0x95, 0x08,      //   Report Count (8)
+    0x09, 0x03,      //   Usage (Vendor Usage 3)
+    0x81, 0x00,      //   Input (Data, Array)
   0xC0               // End Collection
 };
 
-static uint8_t CustomHIDRxBuffer[9];
+static void CustomHID_ProcessCommand(USBD_HandleTypeDef *pdev, uint8_t *cmd, uint32_t len);
+static uint8_t CustomHID_LogFill(USBD_HandleTypeDef *pdev, USBD_CustomHID_HandleTypeDef *hhid);
 
 uint8_t* USBD_CustomHID_GetReportDescriptor(uint16_t* length)
 {
@@ -28,27 +106,303 @@ uint8_t* USBD_CustomHID_GetReportDescriptor(uint16_t* length)
 }
 uint8_t USBD_CustomHID_Init(USBD_HandleTypeDef *pdev)
 {
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+
     /* Open IN endpoint 0x82 and OUT endpoint 0x02 for the custom HID */
-    USBD_LL_OpenEP(pdev, 0x82, USBD_EP_TYPE_INTR, 9);   // IN endpoint
-    USBD_LL_OpenEP(pdev, 0x02, USBD_EP_TYPE_INTR, 9);   // OUT endpoint
-		USBD_LL_PrepareReceive(pdev, 0x02, CustomHIDRxBuffer, sizeof(CustomHIDRxBuffer));
+    USBD_LL_OpenEP(pdev, CUSTOM_HID_EPIN_ADDR, USBD_EP_TYPE_INTR, CUSTOM_HID_EPIN_SIZE);   // IN endpoint
+    USBD_LL_OpenEP(pdev, CUSTOM_HID_EPOUT_ADDR, USBD_EP_TYPE_INTR, CUSTOM_HID_EPOUT_SIZE); // OUT endpoint
+
+    hhid->in_busy = 0U;
+    hhid->abs_pending = 0U;
+    hhid->reply_pending = 0U;
+    hhid->chunk_frame = USBD_SCHED_NO_FRAME;
+
+    USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->rx_buf, CUSTOM_HID_EPOUT_SIZE);
+
+    return USBD_OK;
+}
+
+/* Drop everything queued for 0x82 so nothing leaks into the next session */
+uint8_t USBD_CustomHID_DeInit(USBD_HandleTypeDef *pdev)
+{
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+
+    USBD_LL_CloseEP(pdev, CUSTOM_HID_EPIN_ADDR);
+    USBD_LL_CloseEP(pdev, CUSTOM_HID_EPOUT_ADDR);
+
+    hhid->in_busy = 0U;
+    hhid->abs_pending = 0U;
+    hhid->reply_pending = 0U;
+    hhid->chunk_frame = USBD_SCHED_NO_FRAME;
+    USBD_Trace_CancelDump(&hhid->dump);
 
     return USBD_OK;
 }
 
 uint8_t USBD_CustomHID_DataOut(USBD_HandleTypeDef *pdev)
 {
-        // پردازش دیتای دریافتی از CustomHIDRxBuffer (طول 9 بایت)
-        // مثلاً: uint8_t data = CustomHIDRxBuffer[1]; (0 index همون Report ID ـه)
+        USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+
+        // پردازش دیتای دریافتی از rx_buf (طول 9 بایت)
+        // مثلاً: uint8_t data = hhid->rx_buf[1]; (0 index همون Report ID ـه)
+        CustomHID_ProcessCommand(pdev, hhid->rx_buf,
+                                 USBD_LL_GetRxDataSize(pdev, CUSTOM_HID_EPOUT_ADDR));
 
-        USBD_LL_PrepareReceive(pdev, 0x02, CustomHIDRxBuffer, sizeof(CustomHIDRxBuffer));
+        USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->rx_buf, CUSTOM_HID_EPOUT_SIZE);
 
 
     return USBD_OK;
 }
 
+uint8_t USBD_CustomHID_DataIn(USBD_HandleTypeDef *pdev)
+{
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+    uint16_t frame;
+
+    if (hhid->chunk_frame != USBD_SCHED_NO_FRAME)
+    {
+        frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+        USBD_Bench_Report(pdev, (frame - hhid->chunk_frame) & USBD_SCHED_FRAME_MASK);
+        USBD_Stripe_Complete(pdev, 0U);
+        hhid->chunk_frame = USBD_SCHED_NO_FRAME;
+    }
+
+    hhid->in_busy = 0U;
+
+    return USBD_OK;
+}
+
 uint8_t USBD_CustomHID_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
     /* Handle custom HID class-specific requests (e.g. GET_REPORT, SET_REPORT, etc.) */
     return USBD_OK;
 }
+
+/**
+  * @brief  Place the absolute pointer at (x, y) in the 0..32767 logical range.
+  *         The report is armed immediately when EP 0x82 is free, otherwise it
+  *         replaces any pending position and goes out on the next DataIn.
+  */
+uint8_t USBD_CustomHID_SendAbsReport(USBD_HandleTypeDef *pdev, uint8_t buttons, uint16_t x, uint16_t y)
+{
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+
+    if (pdev->dev_state != USBD_STATE_CONFIGURED)
+    {
+        return USBD_FAIL;
+    }
+
+    x = MIN(x, CUSTOM_HID_ABS_MAX);
+    y = MIN(y, CUSTOM_HID_ABS_MAX);
+
+    hhid->abs_report[0] = CUSTOM_HID_REPORT_ID_ABS;
+    hhid->abs_report[1] = buttons & 0x07U;
+    hhid->abs_report[2] = LOBYTE(x);
+    hhid->abs_report[3] = HIBYTE(x);
+    hhid->abs_report[4] = LOBYTE(y);
+    hhid->abs_report[5] = HIBYTE(y);
+
+    if (hhid->in_busy != 0U)
+    {
+        hhid->abs_pending = 1U;
+        return USBD_BUSY;
+    }
+
+    hhid->in_busy = 1U;
+    return USBD_Arb_Transmit(pdev, CUSTOM_HID_EPIN_ADDR, hhid->abs_report, sizeof(hhid->abs_report));
+}
+
+/**
+  * @brief  Arm the next report on 0x82 if it is free. In order: a pending
+  *         absolute position, a command reply, a trace dump entry, a
+  *         stream chunk as channel 0 of the stripe, then log records.
+  */
+void USBD_CustomHID_Kick(USBD_HandleTypeDef *pdev)
+{
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+    USBD_Trace_EntryTypeDef e;
+    uint8_t id = CUSTOM_HID_REPORT_ID_VENDOR;
+
+    if (hhid->in_busy != 0U)
+    {
+        return;
+    }
+
+    if (hhid->abs_pending != 0U)
+    {
+        hhid->abs_pending = 0U;
+        hhid->in_busy = 1U;
+        USBD_Arb_Transmit(pdev, CUSTOM_HID_EPIN_ADDR, hhid->abs_report, sizeof(hhid->abs_report));
+        return;
+    }
+
+    if (hhid->reply_pending != 0U)
+    {
+        hhid->reply_pending = 0U;
+        hhid->in_busy = 1U;
+        USBD_Arb_Transmit(pdev, CUSTOM_HID_EPIN_ADDR, hhid->reply_report, sizeof(hhid->reply_report));
+        return;
+    }
+
+    if (USBD_Trace_NextDumpEntry(pdev, &hhid->dump, &e) != 0U)
+    {
+        id = CUSTOM_HID_REPORT_ID_TRACE;
+        hhid->tx_report[1] = LOBYTE(e.frame);
+        hhid->tx_report[2] = HIBYTE(e.frame);
+        hhid->tx_report[3] = e.type;
+        hhid->tx_report[4] = e.arg;
+        hhid->tx_report[5] = (uint8_t)(e.cycles);
+        hhid->tx_report[6] = (uint8_t)(e.cycles >> 8);
+        hhid->tx_report[7] = (uint8_t)(e.cycles >> 16);
+        hhid->tx_report[8] = (uint8_t)(e.cycles >> 24);
+    }
+    else if (USBD_Stripe_Fill(pdev, hhid->tx_report) != 0U)
+    {
+        id = CUSTOM_HID_REPORT_ID_STREAM;
+        hhid->chunk_frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    }
+    else if (CustomHID_LogFill(pdev, hhid) != 0U)
+    {
+        id = CUSTOM_HID_REPORT_ID_LOG;
+    }
+    else
+    {
+        return;
+    }
+
+    hhid->tx_report[0] = id;
+    hhid->in_busy = 1U;
+    USBD_Arb_Transmit(pdev, CUSTOM_HID_EPIN_ADDR, hhid->tx_report, sizeof(hhid->tx_report));
+}
+
+/* Next two log words into tx_report[1..8], little endian. A drain takes
+   whole records; the odd word at its end is padded with a zero word. */
+static uint8_t CustomHID_LogFill(USBD_HandleTypeDef *pdev, USBD_CustomHID_HandleTypeDef *hhid)
+{
+    uint32_t w0, w1;
+    uint8_t i;
+
+    if (pdev->id != USBD_LOG_PORT)
+    {
+        return 0U;
+    }
+
+    if (hhid->log_pos == hhid->log_len)
+    {
+        hhid->log_pos = 0U;
+        hhid->log_len = (uint8_t)USBD_Log_Drain(hhid->log_buf, CUSTOM_HID_LOG_BUF_WORDS);
+        if (hhid->log_len == 0U)
+        {
+            return 0U;
+        }
+    }
+
+    w0 = hhid->log_buf[hhid->log_pos++];
+    w1 = (hhid->log_pos < hhid->log_len) ? hhid->log_buf[hhid->log_pos++] : 0U;
+    for (i = 0U; i < 4U; i++)
+    {
+        hhid->tx_report[1U + i] = (uint8_t)(w0 >> (8U * i));
+        hhid->tx_report[5U + i] = (uint8_t)(w1 >> (8U * i));
+    }
+    return 1U;
+}
+
+/* Vendor OUT report: [0] report ID, [1] command, [2..8] arguments */
+static void CustomHID_ProcessCommand(USBD_HandleTypeDef *pdev, uint8_t *cmd, uint32_t len)
+{
+    USBD_CustomHID_HandleTypeDef *hhid = &USBD_COMPOSITE_CTX(pdev)->custom;
+
+    if ((len < 2U) || (cmd[0] != CUSTOM_HID_REPORT_ID_VENDOR))
+    {
+        return;
+    }
+
+    USBD_Trace_Record(pdev, USBD_TRACE_EV_CMD, cmd[1]);
+
+    switch (cmd[1])
+    {
+        case CUSTOM_HID_CMD_ABS_MOVE:
+            /* [2] buttons, [3..4] X, [5..6] Y */
+            if (len >= 7U)
+            {
+                (void)USBD_CustomHID_SendAbsReport(pdev, cmd[2],
+                                                   (uint16_t)(cmd[3] | (cmd[4] << 8)),
+                                                   (uint16_t)(cmd[5] | (cmd[6] << 8)));
+            }
+            break;
+
+        case CUSTOM_HID_CMD_MACRO_BEGIN:
+            USBD_HID_Macro_Begin(pdev);
+            break;
+
+        case CUSTOM_HID_CMD_MACRO_DATA:
+            if ((len >= 3U) && (cmd[2] <= (len - 3U)))
+            {
+                (void)USBD_HID_Macro_Append(pdev, &cmd[3], cmd[2]);
+            }
+            break;
+
+        case CUSTOM_HID_CMD_MACRO_PLAY:
+            (void)USBD_HID_Macro_Play(pdev, (len >= 3U) ? cmd[2] : 1U);
+            break;
+
+        case CUSTOM_HID_CMD_MACRO_STOP:
+            USBD_HID_Macro_Stop(pdev);
+            break;
+
+        case CUSTOM_HID_CMD_SCHED_PHASE:
+            if (len >= 3U)
+            {
+                USBD_Sched_SetPhase(pdev, cmd[2]);
+            }
+            break;
+
+        case CUSTOM_HID_CMD_TRACE_DUMP:
+            /* [2..3] entry count (LE16), 0 or absent = whole buffer */
+            USBD_Trace_StartDump(pdev, &hhid->dump, (len >= 4U) ? (uint16_t)(cmd[2] | (cmd[3] << 8)) : 0U);
+            USBD_Arb_Run(pdev);
+            break;
+
+        case CUSTOM_HID_CMD_BENCH_START:
+            /* [2] workload, [3..4] frames (LE16, 0 = default) */
+            if (len >= 3U)
+            {
+                (void)USBD_Bench_Start(pdev, cmd[2], (len >= 5U) ? (uint16_t)(cmd[3] | (cmd[4] << 8)) : 0U);
+                USBD_Arb_Run(pdev);
+            }
+            break;
+
+        case CUSTOM_HID_CMD_BENCH_RESULT:
+            hhid->reply_report[0] = CUSTOM_HID_REPORT_ID_VENDOR;
+            USBD_Bench_GetResult(pdev, hhid->reply_report);
+            hhid->reply_pending = 1U;
+            USBD_Arb_Run(pdev);
+            break;
+
+        case CUSTOM_HID_CMD_ARB_STATS:
+            /* [2] priority class */
+            hhid->reply_report[0] = CUSTOM_HID_REPORT_ID_VENDOR;
+            USBD_Arb_GetStats(pdev, (len >= 3U) ? cmd[2] : USBD_ARB_CLASS_POINTER, hhid->reply_report);
+            hhid->reply_pending = 1U;
+            USBD_Arb_Run(pdev);
+            break;
+
+        case CUSTOM_HID_CMD_PERSONALITY:
+            /* [2] personality; the bus drops, so no reply to a switch */
+            if ((len >= 3U) && (cmd[2] != USBD_PERSONALITY_NONE))
+            {
+                (void)USBD_Composite_RequestPersonality(pdev, cmd[2]);
+            }
+            else
+            {
+                hhid->reply_report[0] = CUSTOM_HID_REPORT_ID_VENDOR;
+                USBD_Composite_GetPersonalityInfo(pdev, hhid->reply_report);
+                hhid->reply_pending = 1U;
+                USBD_Arb_Run(pdev);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
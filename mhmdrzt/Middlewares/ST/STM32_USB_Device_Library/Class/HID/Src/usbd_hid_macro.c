@@ -0,0 +1,183 @@
+/* Src/usbd_hid_macro.c */
+#include "usbd_hid_macro.h"
+#include "usbd_hid_mouse.h"
+#include "usbd_def.h"
+#include "usbd_composite.h"
+#include <string.h>
+
+static int8_t Macro_Clamp(int16_t v)
+{
+    if (v > 127)  { return 127; }
+    if (v < -127) { return -127; }
+    return (int8_t)v;
+}
+
+/**
+  * @brief  Send what has accumulated so far; leftovers wait for the next slot.
+  * @retval 1 if a report was armed on 0x81
+  */
+uint8_t USBD_HID_Macro_Flush(USBD_HandleTypeDef *pdev)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+    int8_t x, y;
+
+    /* `report` is the transfer buffer while 0x81 is armed; leave it alone
+       until DataIn. Only the USB interrupt clears in_busy, and Flush runs
+       in it. */
+    if ((hmacro->dirty == 0U) || (USBD_COMPOSITE_CTX(pdev)->mouse.in_busy != 0U))
+    {
+        return 0U;
+    }
+
+    x = Macro_Clamp(hmacro->acc_x);
+    y = Macro_Clamp(hmacro->acc_y);
+
+    hmacro->report[0] = hmacro->buttons;
+    hmacro->report[1] = (uint8_t)x;
+    hmacro->report[2] = (uint8_t)y;
+
+    if (USBD_HID_MOUSE_SendReport(pdev, hmacro->report, sizeof(hmacro->report)) == USBD_OK)
+    {
+        hmacro->acc_x -= x;
+        hmacro->acc_y -= y;
+        if ((hmacro->acc_x == 0) && (hmacro->acc_y == 0))
+        {
+            hmacro->dirty = 0U;
+        }
+        return 1U;
+    }
+
+    return 0U;
+}
+
+/* Drop any running playback and start a new upload */
+void USBD_HID_Macro_Begin(USBD_HandleTypeDef *pdev)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+
+    hmacro->state = USBD_MACRO_IDLE;
+    hmacro->len = 0U;
+}
+
+uint8_t USBD_HID_Macro_Append(USBD_HandleTypeDef *pdev, const uint8_t *data, uint8_t len)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+
+    if ((hmacro->state != USBD_MACRO_IDLE) || ((hmacro->len + len) > USBD_MACRO_BUF_SIZE))
+    {
+        return USBD_FAIL;
+    }
+
+    memcpy(&hmacro->buf[hmacro->len], data, len);
+    hmacro->len += len;
+
+    return USBD_OK;
+}
+
+/**
+  * @brief  Start playback from the first step.
+  * @param  loops: number of passes over the sequence, 0 = until stopped
+  */
+uint8_t USBD_HID_Macro_Play(USBD_HandleTypeDef *pdev, uint8_t loops)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+
+    /* A trailing partial step is ignored */
+    hmacro->len -= hmacro->len % USBD_MACRO_STEP_SIZE;
+    if (hmacro->len == 0U)
+    {
+        return USBD_FAIL;
+    }
+
+    hmacro->state = USBD_MACRO_IDLE;
+    hmacro->pos = 0U;
+    hmacro->wait = hmacro->buf[0];
+    hmacro->loops = loops;
+    hmacro->buttons = 0U;
+    hmacro->acc_x = 0;
+    hmacro->acc_y = 0;
+    hmacro->dirty = 0U;
+    hmacro->state = USBD_MACRO_PLAYING;
+
+    return USBD_OK;
+}
+
+/* Also drops motion not yet sent: Stop ends the session on detach, and
+   none of it may reach the host after the next SET_CONFIGURATION */
+void USBD_HID_Macro_Stop(USBD_HandleTypeDef *pdev)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+
+    hmacro->state = USBD_MACRO_IDLE;
+    hmacro->buttons = 0U;
+    hmacro->acc_x = 0;
+    hmacro->acc_y = 0;
+    hmacro->dirty = 0U;
+}
+
+uint8_t USBD_HID_Macro_State(USBD_HandleTypeDef *pdev)
+{
+    return USBD_COMPOSITE_CTX(pdev)->macro.state;
+}
+
+/**
+  * @brief  Advance playback by one frame. Called from SOF; the report
+  *         scheduler decides when the result is flushed to 0x81.
+  * @param  pdev: device instance owning the mouse endpoint
+  */
+void USBD_HID_Macro_Tick(USBD_HandleTypeDef *pdev)
+{
+    USBD_HID_Macro_HandleTypeDef *hmacro = &USBD_COMPOSITE_CTX(pdev)->macro;
+    uint16_t steps = 0U;
+    uint8_t buttons;
+
+    if (hmacro->state != USBD_MACRO_PLAYING)
+    {
+        return;
+    }
+
+    if (hmacro->wait > 0U)
+    {
+        hmacro->wait--;
+    }
+
+    /* At most one pass per frame so an all-zero-delay loop cannot spin */
+    while ((hmacro->state == USBD_MACRO_PLAYING) && (hmacro->wait == 0U) &&
+           (steps < (hmacro->len / USBD_MACRO_STEP_SIZE)))
+    {
+        uint8_t *step = &hmacro->buf[hmacro->pos];
+
+        if ((step[1] & USBD_MACRO_FLAG_WAIT) == 0U)
+        {
+            buttons = step[1] & 0x07U;
+
+            /* Hold the timeline rather than lose a button edge */
+            if ((hmacro->dirty != 0U) && (buttons != hmacro->buttons))
+            {
+                break;
+            }
+
+            hmacro->buttons = buttons;
+            hmacro->acc_x += (int8_t)step[2];
+            hmacro->acc_y += (int8_t)step[3];
+            hmacro->dirty = 1U;
+        }
+
+        steps++;
+        hmacro->pos += USBD_MACRO_STEP_SIZE;
+        if (hmacro->pos >= hmacro->len)
+        {
+            if (hmacro->loops == 1U)
+            {
+                hmacro->state = USBD_MACRO_IDLE;
+                break;
+            }
+            if (hmacro->loops != 0U)
+            {
+                hmacro->loops--;
+            }
+            hmacro->pos = 0U;
+        }
+        hmacro->wait = hmacro->buf[hmacro->pos];
+    }
+}
@@ -1,8 +1,11 @@
 /* Src/usbd_hid_mouse.c */
 #include "usbd_hid_mouse.h"
 #include "usbd_def.h"
+#include "usbd_core.h"
 #include "usbd_ioreq.h"
 #include "usbd_desc.h"
+#include "usbd_in_arb.h"
+#include "usbd_composite.h"
 
 
 __ALIGN_BEGIN uint8_t HID_Mouse_ReportDesc[] __ALIGN_END = {
@@ -35,14 +38,18 @@ __ALIGN_BEGIN uint8_t HID_Mouse_ReportDesc[] __ALIGN_END = {
 };
 
 
-
-extern USBD_HandleTypeDef hUsbDeviceFS;  // Ensure this global is accessible
-
 uint8_t USBD_HID_MOUSE_Init(USBD_HandleTypeDef *pdev)
 {
     /* Open endpoint 0x81 as an interrupt IN endpoint with packet size 4 */
-    USBD_LL_OpenEP(pdev, 0x81, USBD_EP_TYPE_INTR, 4);
-    /* If required, allocate the HID report buffer or do additional init here */
+    USBD_LL_OpenEP(pdev, HID_MOUSE_EPIN_ADDR, USBD_EP_TYPE_INTR, HID_MOUSE_EPIN_SIZE);
+    USBD_COMPOSITE_CTX(pdev)->mouse.in_busy = 0U;
+    return USBD_OK;
+}
+
+uint8_t USBD_HID_MOUSE_DeInit(USBD_HandleTypeDef *pdev)
+{
+    USBD_LL_CloseEP(pdev, HID_MOUSE_EPIN_ADDR);
+    USBD_COMPOSITE_CTX(pdev)->mouse.in_busy = 0U;
     return USBD_OK;
 }
 
@@ -54,13 +61,39 @@ uint8_t USBD_HID_MOUSE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req
   return ret;
 }
 
+uint8_t USBD_HID_MOUSE_DataIn(USBD_HandleTypeDef *pdev)
+{
+    USBD_COMPOSITE_CTX(pdev)->mouse.in_busy = 0U;
+    return USBD_OK;
+}
+
+/* Called from thread, SysTick and USB interrupt context alike, so claiming
+   the endpoint is done with interrupts masked. */
 uint8_t USBD_HID_MOUSE_SendReport(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len)
 {
-    return USBD_LL_Transmit(pdev, 0x81, report, len);  // 0x81 is the endpoint defined in your descriptor for mouse IN
+    USBD_HID_Mouse_HandleTypeDef *hmouse = &USBD_COMPOSITE_CTX(pdev)->mouse;
+    uint32_t primask;
+
+    if (pdev->dev_state != USBD_STATE_CONFIGURED)
+    {
+        return USBD_FAIL;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (hmouse->in_busy != 0U)
+    {
+        __set_PRIMASK(primask);
+        return USBD_BUSY;
+    }
+    hmouse->in_busy = 1U;
+    __set_PRIMASK(primask);
+
+    return USBD_Arb_Transmit(pdev, HID_MOUSE_EPIN_ADDR, report, len);  // 0x81 is the endpoint defined in your descriptor for mouse IN
 }
 
 uint8_t* USBD_HID_MOUSE_GetReportDescriptor(uint16_t* length)
 {
     *length = HID_MOUSE_REPORT_DESC_SIZE;
     return (uint8_t*)HID_Mouse_ReportDesc;
-}
\ No newline at end of file
+}
@@ -0,0 +1,203 @@
+/* Src/usbd_in_arb.c */
+#include "usbd_in_arb.h"
+#include "usbd_core.h"
+#include "usbd_report_sched.h"
+#include "usbd_composite.h"
+
+/* Arm-to-completion deadline per class, frames */
+static const uint16_t ArbDeadline[USBD_ARB_NUM_CLASSES] =
+{
+    USBD_SCHED_DEFAULT_PERIOD,   /* POINTER: within one mouse bInterval */
+    2U,                          /* REPLY: polled every frame */
+    0xFFFFU,                     /* STREAM: best effort */
+};
+
+static uint16_t Arb_Frame(USBD_HandleTypeDef *pdev)
+{
+    return (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+}
+
+/**
+  * @brief  Smallest bin of a latency histogram that covers `pct` percent of
+  *         its entries; the last bin if the histogram is empty. Shared with
+  *         the bench runs (usbd_bench.c).
+  * @param  hist: `bins` counters, frames of latency per bin, the last one
+  *         open ended
+  */
+uint8_t USBD_Arb_Percentile(const uint32_t *hist, uint8_t bins, uint8_t pct)
+{
+    uint32_t total = 0U;
+    uint32_t need, seen = 0U;
+    uint8_t bin;
+
+    /* Counted from the bins, so it matches them whatever the caller's
+       own totals say */
+    for (bin = 0U; bin < bins; bin++)
+    {
+        total += hist[bin];
+    }
+    need = (uint32_t)(((uint64_t)total * pct + 99U) / 100U);
+
+    for (bin = 0U; bin < (bins - 1U); bin++)
+    {
+        seen += hist[bin];
+        if (seen >= need)
+        {
+            break;
+        }
+    }
+    return bin;
+}
+
+/* Session start: forget endpoints and pumps of the previous personality */
+void USBD_Arb_Reset(USBD_HandleTypeDef *pdev)
+{
+    USBD_Arb_HandleTypeDef *harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+    uint8_t i;
+
+    for (i = 0U; i < USBD_FS_DEV_ENDPOINTS; i++)
+    {
+        harb->ep_class[i] = USBD_ARB_NO_CLASS;
+        harb->arm_frame[i] = USBD_SCHED_NO_FRAME;
+    }
+    harb->num_pumps = 0U;
+    USBD_Arb_ClearStats(pdev);
+}
+
+void USBD_Arb_ClearStats(USBD_HandleTypeDef *pdev)
+{
+    USBD_Arb_HandleTypeDef *harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+    uint8_t c, i;
+
+    for (c = 0U; c < USBD_ARB_NUM_CLASSES; c++)
+    {
+        harb->stats[c].completions = 0U;
+        harb->stats[c].misses = 0U;
+        harb->stats[c].lat_max = 0U;
+        for (i = 0U; i < USBD_ARB_LAT_BINS; i++)
+        {
+            harb->stats[c].lat_hist[i] = 0U;
+        }
+    }
+}
+
+void USBD_Arb_Register(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t cls)
+{
+    USBD_Arb_HandleTypeDef *harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+    uint8_t ep = ep_addr & 0x0FU;
+
+    if ((ep < USBD_FS_DEV_ENDPOINTS) && (cls < USBD_ARB_NUM_CLASSES))
+    {
+        harb->ep_class[ep] = cls;
+        harb->arm_frame[ep] = USBD_SCHED_NO_FRAME;
+    }
+}
+
+/**
+  * @brief  Add a pump: arms its endpoint(s) if idle and there is data.
+  *         Must be cheap and safe to call when there is nothing to do.
+  */
+void USBD_Arb_AddPump(USBD_HandleTypeDef *pdev, uint8_t cls, void (*pump)(USBD_HandleTypeDef *pdev))
+{
+    USBD_Arb_HandleTypeDef *harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+
+    if ((harb->num_pumps < USBD_ARB_MAX_PUMPS) && (cls < USBD_ARB_NUM_CLASSES))
+    {
+        harb->pumps[harb->num_pumps].cls = cls;
+        harb->pumps[harb->num_pumps].pump = pump;
+        harb->num_pumps++;
+    }
+}
+
+/**
+  * @brief  Run the pumps, most urgent class first. From the USB interrupt or
+  *         with interrupts masked.
+  */
+void USBD_Arb_Run(USBD_HandleTypeDef *pdev)
+{
+    USBD_Arb_HandleTypeDef *harb;
+    uint8_t c, i;
+
+    if (pdev->dev_state != USBD_STATE_CONFIGURED)
+    {
+        return;
+    }
+
+    harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+    for (c = 0U; c < USBD_ARB_NUM_CLASSES; c++)
+    {
+        for (i = 0U; i < harb->num_pumps; i++)
+        {
+            if (harb->pumps[i].cls == c)
+            {
+                harb->pumps[i].pump(pdev);
+            }
+        }
+    }
+}
+
+uint8_t USBD_Arb_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *buf, uint32_t len)
+{
+    uint8_t ep = ep_addr & 0x0FU;
+
+    if (ep < USBD_FS_DEV_ENDPOINTS)
+    {
+        USBD_COMPOSITE_CTX(pdev)->arb.arm_frame[ep] = Arb_Frame(pdev);
+    }
+    return USBD_LL_Transmit(pdev, ep_addr, buf, len);
+}
+
+/**
+  * @brief  IN completion: account arm-to-completion latency to the class.
+  */
+void USBD_Arb_Complete(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    USBD_Arb_HandleTypeDef *harb = &USBD_COMPOSITE_CTX(pdev)->arb;
+    uint8_t ep = ep_addr & 0x0FU;
+    USBD_Arb_ClassStatsTypeDef *st;
+    uint16_t lat;
+
+    if ((ep >= USBD_FS_DEV_ENDPOINTS) || (harb->ep_class[ep] == USBD_ARB_NO_CLASS) ||
+        (harb->arm_frame[ep] == USBD_SCHED_NO_FRAME))
+    {
+        return;
+    }
+
+    st = &harb->stats[harb->ep_class[ep]];
+    lat = (Arb_Frame(pdev) - harb->arm_frame[ep]) & USBD_SCHED_FRAME_MASK;
+    harb->arm_frame[ep] = USBD_SCHED_NO_FRAME;
+
+    st->completions++;
+    st->lat_max = MAX(st->lat_max, lat);
+    st->lat_hist[MIN(lat, USBD_ARB_LAT_BINS - 1U)]++;
+    if (lat > ArbDeadline[harb->ep_class[ep]])
+    {
+        st->misses++;
+    }
+}
+
+/**
+  * @brief  Bytes 1..8 of the stats report for class `cls`.
+  */
+void USBD_Arb_GetStats(USBD_HandleTypeDef *pdev, uint8_t cls, uint8_t *report)
+{
+    const USBD_Arb_ClassStatsTypeDef *st;
+    uint32_t n, misses;
+
+    if (cls >= USBD_ARB_NUM_CLASSES)
+    {
+        cls = USBD_ARB_CLASS_POINTER;
+    }
+    st = &USBD_COMPOSITE_CTX(pdev)->arb.stats[cls];
+    n = MIN(st->completions, 0xFFFFU);
+    misses = MIN(st->misses, 0xFFFFU);
+
+    report[1] = cls;
+    report[2] = (st->completions != 0U) ? USBD_Arb_Percentile(st->lat_hist, USBD_ARB_LAT_BINS, 50U) : 0U;
+    report[3] = (st->completions != 0U) ? USBD_Arb_Percentile(st->lat_hist, USBD_ARB_LAT_BINS, 99U) : 0U;
+    report[4] = (uint8_t)MIN(st->lat_max, 0xFFU);
+    report[5] = LOBYTE(n);
+    report[6] = HIBYTE(n);
+    report[7] = LOBYTE(misses);
+    report[8] = HIBYTE(misses);
+}
@@ -0,0 +1,109 @@
+/* Src/usbd_log.c */
+#include "usbd_log.h"
+#include "usbd_def.h"
+
+#define LOG_MASK            (USBD_LOG_DEPTH - 1U)
+
+#if ((USBD_LOG_DEPTH & LOG_MASK) != 0U)
+#error "usbd_log.h: USBD_LOG_DEPTH must be a power of two"
+#endif
+
+/* Only the CPU touches the ring: the drain copies records into the report
+   buffer, so it can live in CCM. Words are zero while free. */
+static uint32_t LogRing[USBD_LOG_DEPTH] USBD_CCMRAM;
+static __IO uint32_t LogHead USBD_CCMRAM;     /* words ever reserved */
+static __IO uint32_t LogTail USBD_CCMRAM;     /* words ever drained */
+
+USBD_Log_StatsTypeDef USBD_Log_Stats;
+
+static void Log_Inc(__IO uint32_t *counter)
+{
+    do
+    {
+    } while (__STREXW(__LDREXW(counter) + 1U, counter) != 0U);
+}
+
+/**
+  * @brief  Append one record. Lock-free and safe from any priority: the
+  *         space is reserved with LDREX/STREX on the head, and the header
+  *         is stored last, so the drain never sees a half-written record.
+  *         A record that does not fit is dropped and counted.
+  */
+USBD_RAMFUNC void USBD_Log_Put(uint32_t hdr, uint32_t a, uint32_t b, uint32_t c)
+{
+    uint32_t n = USBD_LOG_HDR_WORDS(hdr);
+    uint32_t head;
+    uint32_t used;
+
+    do
+    {
+        head = __LDREXW(&LogHead);
+        used = head - LogTail;
+        if ((used + n) > USBD_LOG_DEPTH)
+        {
+            __CLREX();
+            Log_Inc(&USBD_Log_Stats.dropped);
+            return;
+        }
+    } while (__STREXW(head + n, &LogHead) != 0U);
+
+    LogRing[(head + 1U) & LOG_MASK] = DWT->CYCCNT;
+    switch (n)
+    {
+        case 5U: LogRing[(head + 4U) & LOG_MASK] = c; /* fall through */
+        case 4U: LogRing[(head + 3U) & LOG_MASK] = b; /* fall through */
+        case 3U: LogRing[(head + 2U) & LOG_MASK] = a; /* fall through */
+        default: break;
+    }
+    __DMB();
+    LogRing[head & LOG_MASK] = hdr | (USBD_Log_Stats.dropped << 24);
+
+    Log_Inc(&USBD_Log_Stats.records);
+    USBD_Log_Stats.high = (uint16_t)MAX(USBD_Log_Stats.high, used + n);
+}
+
+/**
+  * @brief  Move whole records, oldest first, into `dst` (up to `words`).
+  *         Stops at a record still being written. Single consumer: called
+  *         from the USBD_LOG_PORT interrupt, or with interrupts masked.
+  * @retval Words copied
+  */
+uint32_t USBD_Log_Drain(uint32_t *dst, uint32_t words)
+{
+    uint32_t tail = LogTail;
+    uint32_t count = 0U;
+    uint32_t hdr, n, i;
+
+    while (tail != LogHead)
+    {
+        hdr = LogRing[tail & LOG_MASK];
+        if (hdr == 0U)
+        {
+            break;
+        }
+        n = USBD_LOG_HDR_WORDS(hdr);
+        if ((count + n) > words)
+        {
+            break;
+        }
+        __DMB();
+        for (i = 0U; i < n; i++)
+        {
+            dst[count + i] = LogRing[(tail + i) & LOG_MASK];
+            LogRing[(tail + i) & LOG_MASK] = 0U;
+        }
+        tail += n;
+        count += n;
+    }
+
+    __DMB();
+    LogTail = tail;
+    USBD_Log_Stats.drained += count;
+    return count;
+}
+
+/* Words reserved and not drained yet, published or not */
+uint32_t USBD_Log_Pending(void)
+{
+    return LogHead - LogTail;
+}
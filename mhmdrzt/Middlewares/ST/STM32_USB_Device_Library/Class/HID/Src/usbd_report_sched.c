@@ -0,0 +1,131 @@
+/* Src/usbd_report_sched.c */
+#include "usbd_report_sched.h"
+#include "usbd_hid_mouse.h"
+#include "usbd_hid_macro.h"
+#include "usbd_trace.h"
+#include "usbd_bench.h"
+#include "usbd_core.h"
+#include "usbd_composite.h"
+
+/* Session start; the phase is kept */
+void USBD_Sched_Reset(USBD_HandleTypeDef *pdev)
+{
+    USBD_Sched_HandleTypeDef *hsched = &USBD_COMPOSITE_CTX(pdev)->sched;
+
+    hsched->stats.period = USBD_SCHED_DEFAULT_PERIOD;
+    hsched->stats.last_poll = USBD_SCHED_NO_FRAME;
+    hsched->stats.reports = 0U;
+    hsched->stats.lat_last = 0U;
+    hsched->stats.lat_min = 0xFFFFU;
+    hsched->stats.lat_max = 0U;
+    hsched->stats.lat_sum = 0U;
+
+    hsched->sample_frame = USBD_SCHED_NO_FRAME;
+    hsched->probe = 1U;
+}
+
+void USBD_Sched_SetPhase(USBD_HandleTypeDef *pdev, uint16_t phase)
+{
+    USBD_COMPOSITE_CTX(pdev)->sched.stats.phase = phase;
+}
+
+/**
+  * @brief  Per-frame work: advance the macro timeline and, in the sampling
+  *         slot ahead of the predicted poll, arm a fresh report on 0x81.
+  */
+void USBD_Sched_SOF(USBD_HandleTypeDef *pdev)
+{
+    USBD_Sched_HandleTypeDef *hsched = &USBD_COMPOSITE_CTX(pdev)->sched;
+    uint16_t frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    uint16_t elapsed;
+
+    hsched->stats.frame = frame;
+
+    USBD_HID_Macro_Tick(pdev);
+
+    if (hsched->sample_frame != USBD_SCHED_NO_FRAME)
+    {
+        return;
+    }
+
+    if ((hsched->probe == 0U) && (hsched->stats.last_poll != USBD_SCHED_NO_FRAME))
+    {
+        elapsed = (frame - hsched->stats.last_poll) & USBD_SCHED_FRAME_MASK;
+        if (((elapsed + hsched->stats.phase) % hsched->stats.period) != 0U)
+        {
+            return;
+        }
+    }
+
+    /* Macro playback owns the endpoint while it has motion to deliver */
+    if (USBD_HID_Macro_Flush(pdev) != 0U)
+    {
+        hsched->sample_frame = frame;
+    }
+    else if (USBD_Sched_SampleCallback(pdev, hsched->report) != 0U)
+    {
+        if (USBD_HID_MOUSE_SendReport(pdev, hsched->report, sizeof(hsched->report)) == USBD_OK)
+        {
+            hsched->sample_frame = frame;
+            USBD_Sched_SentCallback(pdev);
+        }
+    }
+    hsched->predicted = (hsched->probe == 0U) ? 1U : 0U;
+}
+
+/**
+  * @brief  A report on 0x81 reached the host: the poll happened this frame.
+  */
+void USBD_Sched_InComplete(USBD_HandleTypeDef *pdev)
+{
+    USBD_Sched_HandleTypeDef *hsched = &USBD_COMPOSITE_CTX(pdev)->sched;
+    uint16_t frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    uint16_t delta, lat;
+
+    if ((hsched->probe != 0U) && (hsched->stats.last_poll != USBD_SCHED_NO_FRAME))
+    {
+        delta = (frame - hsched->stats.last_poll) & USBD_SCHED_FRAME_MASK;
+        if ((delta > 0U) && (delta <= USBD_SCHED_DEFAULT_PERIOD))
+        {
+            hsched->stats.period = delta;
+            hsched->probe = 0U;
+        }
+    }
+    hsched->stats.last_poll = frame;
+    hsched->stats.reports++;
+
+    if (hsched->sample_frame != USBD_SCHED_NO_FRAME)
+    {
+        lat = (frame - hsched->sample_frame) & USBD_SCHED_FRAME_MASK;
+
+        hsched->stats.lat_last = lat;
+        hsched->stats.lat_sum += lat;
+        hsched->stats.lat_min = MIN(hsched->stats.lat_min, lat);
+        hsched->stats.lat_max = MAX(hsched->stats.lat_max, lat);
+        USBD_Bench_Report(pdev, lat);
+
+        /* Poll came later than predicted: measure the period again */
+        if ((hsched->predicted != 0U) && (lat > (hsched->stats.phase + 1U)))
+        {
+            hsched->probe = 1U;
+        }
+
+        hsched->sample_frame = USBD_SCHED_NO_FRAME;
+    }
+}
+
+/**
+  * @brief  Default sampler: nothing to report. Overridden by the application.
+  */
+__weak uint8_t USBD_Sched_SampleCallback(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+    UNUSED(pdev);
+    UNUSED(report);
+
+    return 0U;
+}
+
+__weak void USBD_Sched_SentCallback(USBD_HandleTypeDef *pdev)
+{
+    UNUSED(pdev);
+}
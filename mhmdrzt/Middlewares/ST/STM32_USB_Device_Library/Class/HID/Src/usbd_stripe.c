@@ -0,0 +1,207 @@
+/* Src/usbd_stripe.c */
+#include "usbd_stripe.h"
+#include "usbd_core.h"
+#include "usbd_custom_hid.h"
+#include "usbd_report_sched.h"
+#include "usbd_bench.h"
+#include "usbd_in_arb.h"
+#include "usbd_composite.h"
+#include "clock_gov.h"
+
+#define STRIPE_RING_MASK    (USBD_STRIPE_RING_SIZE - 1U)
+
+#if ((USBD_STRIPE_RING_SIZE & STRIPE_RING_MASK) != 0U)
+#error "usbd_stripe.h: USBD_STRIPE_RING_SIZE must be a power of two"
+#endif
+
+static uint16_t Stripe_Count(const USBD_Stripe_HandleTypeDef *hstripe)
+{
+    return (uint16_t)(hstripe->head - hstripe->tail);
+}
+
+/* Arm the next chunk on channel `ch` (1..). Interrupts masked or USB ISR. */
+static void Stripe_KickChannel(USBD_HandleTypeDef *pdev, uint8_t ch)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint8_t i = ch - 1U;
+
+    if ((hstripe->busy[i] != 0U) || (USBD_Stripe_Fill(pdev, hstripe->report[i]) == 0U))
+    {
+        return;
+    }
+
+    hstripe->busy[i] = 1U;
+    hstripe->arm_frame[i] = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    (void)USBD_Arb_Transmit(pdev, USBD_STRIPE_EPIN_ADDR(ch), hstripe->report[i], CUSTOM_HID_EPIN_SIZE);
+}
+
+/* Arbiter pump for channels 1..; channel 0 is pumped as the custom HID */
+void USBD_Stripe_Kick(USBD_HandleTypeDef *pdev)
+{
+    uint8_t ch;
+
+    for (ch = 1U; ch < USBD_COMPOSITE_CTX(pdev)->stripe.stats.channels; ch++)
+    {
+        Stripe_KickChannel(pdev, ch);
+    }
+}
+
+/**
+  * @brief  Start a session with `channels` vendor channels, channel 0
+  *         included. Opens the endpoints of channels 1 and up.
+  */
+void USBD_Stripe_Init(USBD_HandleTypeDef *pdev, uint8_t channels)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint8_t ch;
+
+    hstripe->stats.channels = MIN(channels, USBD_STRIPE_MAX_CHANNELS);
+    hstripe->head = 0U;
+    hstripe->tail = 0U;
+    hstripe->seq = 0U;
+
+    for (ch = 1U; ch < hstripe->stats.channels; ch++)
+    {
+        USBD_LL_OpenEP(pdev, USBD_STRIPE_EPIN_ADDR(ch), USBD_EP_TYPE_INTR, CUSTOM_HID_EPIN_SIZE);
+        hstripe->busy[ch - 1U] = 0U;
+    }
+}
+
+void USBD_Stripe_DeInit(USBD_HandleTypeDef *pdev)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint8_t ch;
+
+    for (ch = 1U; ch < hstripe->stats.channels; ch++)
+    {
+        USBD_LL_CloseEP(pdev, USBD_STRIPE_EPIN_ADDR(ch));
+        hstripe->busy[ch - 1U] = 0U;
+    }
+    hstripe->stats.channels = 0U;
+    hstripe->head = 0U;
+    hstripe->tail = 0U;
+}
+
+/**
+  * @brief  Benchmark vendor workload: keep the ring topped up with a
+  *         counting pattern so every channel has a chunk each frame. The
+  *         arbiter arms the channels after this.
+  */
+void USBD_Stripe_SOF(USBD_HandleTypeDef *pdev)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    USBD_Stripe_HandleTypeDef *hstripe = &ctx->stripe;
+    uint16_t free;
+    uint16_t head;
+
+    if ((ctx->bench.state != USBD_BENCH_RUNNING) || (ctx->bench.workload != USBD_BENCH_VENDOR) ||
+        (hstripe->stats.channels == 0U))
+    {
+        return;
+    }
+
+    head = hstripe->head;
+    for (free = USBD_STRIPE_RING_SIZE - Stripe_Count(hstripe); free != 0U; free--)
+    {
+        hstripe->ring[head & STRIPE_RING_MASK] = hstripe->pattern++;
+        head++;
+    }
+    hstripe->head = head;
+}
+
+/**
+  * @brief  IN completion on a stripe endpoint.
+  * @retval 1 if `ep_addr` belongs to an active channel 1.., 0 otherwise
+  */
+uint8_t USBD_Stripe_DataIn(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint16_t frame = (uint16_t)(USBD_LL_GetFrameNumber(pdev) & USBD_SCHED_FRAME_MASK);
+    uint8_t ch;
+
+    for (ch = 1U; ch < hstripe->stats.channels; ch++)
+    {
+        if (USBD_STRIPE_EPIN_ADDR(ch) == ep_addr)
+        {
+            USBD_Bench_Report(pdev, (frame - hstripe->arm_frame[ch - 1U]) & USBD_SCHED_FRAME_MASK);
+            USBD_Stripe_Complete(pdev, ch);
+            hstripe->busy[ch - 1U] = 0U;
+            return 1U;
+        }
+    }
+    return 0U;
+}
+
+/**
+  * @brief  Take the next chunk off the ring into a stream report.
+  * @retval 1 if `report` was filled, 0 if the ring is empty
+  */
+uint8_t USBD_Stripe_Fill(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint16_t n = MIN(Stripe_Count(hstripe), USBD_STRIPE_CHUNK_SIZE);
+    uint16_t tail = hstripe->tail;
+    uint8_t i;
+
+    if (n == 0U)
+    {
+        return 0U;
+    }
+
+    report[0] = CUSTOM_HID_REPORT_ID_STREAM;
+    report[1] = (uint8_t)((n << 5) | (hstripe->seq & 0x1FU));
+    for (i = 0U; i < USBD_STRIPE_CHUNK_SIZE; i++)
+    {
+        report[2U + i] = (i < n) ? hstripe->ring[(tail + i) & STRIPE_RING_MASK] : 0U;
+    }
+    hstripe->tail = tail + n;
+    hstripe->seq++;
+
+    hstripe->stats.chunks++;
+    hstripe->stats.bytes += n;
+    return 1U;
+}
+
+void USBD_Stripe_Complete(USBD_HandleTypeDef *pdev, uint8_t channel)
+{
+    if (channel < USBD_STRIPE_MAX_CHANNELS)
+    {
+        USBD_COMPOSITE_CTX(pdev)->stripe.stats.reports[channel]++;
+    }
+}
+
+/**
+  * @brief  Queue stream data for the vendor channels. Safe from thread and
+  *         interrupt context.
+  * @retval Bytes accepted; the rest did not fit and is counted as dropped.
+  */
+uint16_t USBD_Stripe_Write(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &USBD_COMPOSITE_CTX(pdev)->stripe;
+    uint32_t primask;
+    uint16_t n, i, head;
+
+    if ((pdev->dev_state != USBD_STATE_CONFIGURED) || (hstripe->stats.channels == 0U))
+    {
+        return 0U;
+    }
+
+    ClockGov_Activity();
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    n = MIN(len, USBD_STRIPE_RING_SIZE - Stripe_Count(hstripe));
+    head = hstripe->head;
+    for (i = 0U; i < n; i++)
+    {
+        hstripe->ring[head & STRIPE_RING_MASK] = data[i];
+        head++;
+    }
+    hstripe->head = head;
+    hstripe->stats.dropped += len - n;
+
+    USBD_Arb_Run(pdev);
+    __set_PRIMASK(primask);
+
+    return n;
+}
@@ -0,0 +1,158 @@
+/* Src/usbd_trace.c */
+#include "usbd_trace.h"
+#include "usbd_def.h"
+#include "usbd_composite.h"
+
+/* Ring that takes the board's events, NULL until USBD_TRACE_PORT is bound */
+static USBD_Trace_RingTypeDef *TraceBoard;
+
+/**
+  * @brief  Start the DWT cycle counter used for sub-frame stamps.
+  */
+void USBD_Trace_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* Instance context just registered: the USBD_TRACE_PORT one takes the
+   board's events from now on */
+void USBD_Trace_Bind(USBD_HandleTypeDef *pdev)
+{
+    if (pdev->id == USBD_TRACE_PORT)
+    {
+        TraceBoard = &USBD_COMPOSITE_CTX(pdev)->trace;
+    }
+}
+
+void USBD_Trace_SOF(USBD_HandleTypeDef *pdev, uint16_t frame)
+{
+    USBD_Trace_RingTypeDef *ring = &USBD_COMPOSITE_CTX(pdev)->trace;
+
+    ring->sof_cycles = DWT->CYCCNT;
+    ring->frame = frame;
+}
+
+static void Trace_Append(USBD_Trace_RingTypeDef *ring, uint8_t type, uint8_t arg)
+{
+    USBD_Trace_EntryTypeDef *e;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    e = &ring->buf[ring->head & (USBD_TRACE_DEPTH - 1U)];
+    e->frame = ring->frame;
+    e->type = type;
+    e->arg = arg;
+    e->cycles = DWT->CYCCNT - ring->sof_cycles;
+    ring->head++;
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Append one event to the ring of `pdev`. Safe from any interrupt
+  *         priority.
+  */
+void USBD_Trace_Record(USBD_HandleTypeDef *pdev, uint8_t type, uint8_t arg)
+{
+    Trace_Append(&USBD_COMPOSITE_CTX(pdev)->trace, type, arg);
+}
+
+/**
+  * @brief  Append a board event (clock, keys); dropped before the
+  *         USBD_TRACE_PORT instance is bound. Safe from any interrupt
+  *         priority.
+  */
+void USBD_Trace_Board(uint8_t type, uint8_t arg)
+{
+    if (TraceBoard != NULL)
+    {
+        Trace_Append(TraceBoard, type, arg);
+    }
+}
+
+/* Raw ring for the EP0 diagnostics requests: entry n (counting from 0 at
+   registration) sits at n % USBD_TRACE_DEPTH, and the newest is
+   *Head() - 1 */
+const USBD_Trace_EntryTypeDef *USBD_Trace_Ring(USBD_HandleTypeDef *pdev)
+{
+    return USBD_COMPOSITE_CTX(pdev)->trace.buf;
+}
+
+const uint32_t *USBD_Trace_Head(USBD_HandleTypeDef *pdev)
+{
+    return &USBD_COMPOSITE_CTX(pdev)->trace.head;
+}
+
+/**
+  * @brief  Queue the newest `count` entries (0 = everything held) for dumping.
+  */
+void USBD_Trace_StartDump(USBD_HandleTypeDef *pdev, USBD_Trace_DumpTypeDef *dump, uint16_t count)
+{
+    uint32_t head = USBD_COMPOSITE_CTX(pdev)->trace.head;
+    uint32_t held = MIN(head, USBD_TRACE_DEPTH);
+
+    if ((count == 0U) || (count > held))
+    {
+        count = (uint16_t)held;
+    }
+
+    dump->pos = head - count;
+    dump->left = count;
+    dump->lost = 0U;
+    dump->end = 1U;
+}
+
+/* Abandon a running dump; the recorded events are kept */
+void USBD_Trace_CancelDump(USBD_Trace_DumpTypeDef *dump)
+{
+    dump->left = 0U;
+    dump->end = 0U;
+}
+
+uint8_t USBD_Trace_Dumping(const USBD_Trace_DumpTypeDef *dump)
+{
+    return ((dump->left != 0U) || (dump->end != 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Next entry of a running dump. Entries overwritten while the dump
+  *         was in progress are skipped and counted in the end marker.
+  * @retval 1 if `entry` was filled
+  */
+uint8_t USBD_Trace_NextDumpEntry(USBD_HandleTypeDef *pdev, USBD_Trace_DumpTypeDef *dump, USBD_Trace_EntryTypeDef *entry)
+{
+    USBD_Trace_RingTypeDef *ring = &USBD_COMPOSITE_CTX(pdev)->trace;
+    uint32_t primask;
+
+    if (dump->left != 0U)
+    {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        if ((ring->head - dump->pos) > USBD_TRACE_DEPTH)
+        {
+            uint32_t lost = (ring->head - dump->pos) - USBD_TRACE_DEPTH;
+
+            dump->lost = (uint8_t)MIN(0xFFU, dump->lost + lost);
+            dump->left = (uint16_t)((lost >= dump->left) ? 1U : (dump->left - lost));
+            dump->pos = ring->head - USBD_TRACE_DEPTH;
+        }
+        *entry = ring->buf[dump->pos & (USBD_TRACE_DEPTH - 1U)];
+        dump->pos++;
+        dump->left--;
+        __set_PRIMASK(primask);
+        return 1U;
+    }
+
+    if (dump->end != 0U)
+    {
+        entry->frame = ring->frame;
+        entry->type = USBD_TRACE_EV_END;
+        entry->arg = dump->lost;
+        entry->cycles = 0U;
+        dump->end = 0U;
+        return 1U;
+    }
+
+    return 0U;
+}
@@ -0,0 +1,218 @@
+/* Src/usbd_vendor_req.c */
+#include "usbd_vendor_req.h"
+#include "usbd_ioreq.h"
+#include "usbd_ctlreq.h"
+#include "usbd_composite.h"
+#include "usbd_report_sched.h"
+#include "usbd_bench.h"
+#include "usbd_in_arb.h"
+#include "usbd_bulk.h"
+#include "usbd_stripe.h"
+#include "usbd_trace.h"
+#include "usbd_log.h"
+#include "clock_gov.h"
+
+__ALIGN_BEGIN static const USBD_VReq_InfoTypeDef VReqInfo __ALIGN_END =
+{
+    USBD_PERSONALITY_COUNT,
+    USBD_FS_DEV_ENDPOINTS,
+    USBD_MAX_NUM_INTERFACES,
+    USBD_ARB_NUM_CLASSES,
+    USBD_TRACE_DEPTH,
+    USBD_BULK_TX_RING_SIZE,
+    USBD_STRIPE_RING_SIZE,
+    USBD_VREQ_BLOB_MAX,
+    {
+        sizeof(USBD_VReq_InfoTypeDef),
+        sizeof(USBD_Personality_StatsTypeDef),
+        sizeof(USBD_Conn_StatsTypeDef),
+        sizeof(USBD_LP_StatsTypeDef),
+        sizeof(ClockGov_StatsTypeDef),
+        sizeof(USBD_Sched_StatsTypeDef),
+        sizeof(USBD_Bench_TypeDef),
+        USBD_ARB_NUM_CLASSES * sizeof(USBD_Arb_ClassStatsTypeDef),
+        sizeof(USBD_Bulk_StatsTypeDef),
+        sizeof(USBD_Stripe_StatsTypeDef),
+        sizeof(uint32_t),
+        USBD_TRACE_DEPTH * sizeof(USBD_Trace_EntryTypeDef),
+        sizeof(USBD_VReq_BlobStatsTypeDef),
+        sizeof(USBD_Irq_StatsTypeDef),
+        sizeof(USBD_VReq_RamTypeDef),
+        sizeof(USBD_Log_StatsTypeDef),
+    },
+};
+
+__ALIGN_BEGIN static const USBD_VReq_RamTypeDef VReqRam __ALIGN_END =
+{
+    USBD_NUM_PORTS,
+    USBD_MAX_EP_NUM,
+    sizeof(USBD_HandleTypeDef),
+    2U * USBD_MAX_EP_NUM * sizeof(USBD_EndpointTypeDef),
+    sizeof(PCD_HandleTypeDef),
+    sizeof(USBD_Composite_HandleTypeDef),
+    USBD_STRIPE_RING_SIZE,
+    USBD_BULK_TX_RING_SIZE,
+    USBD_TRACE_DEPTH * sizeof(USBD_Trace_EntryTypeDef),
+    USBD_LOG_DEPTH * sizeof(uint32_t),
+};
+
+static void VReq_BlobDone(USBD_VReq_HandleTypeDef *hvreq)
+{
+    hvreq->stats.blobs++;
+    hvreq->stats.ms_last = (uint16_t)MIN(HAL_GetTick() - hvreq->blob_tick, 0xFFFFU);
+    hvreq->stats.cycles_last = hvreq->blob_cycles;
+    hvreq->stats.cycles_max = MAX(hvreq->stats.cycles_max, hvreq->blob_cycles);
+}
+
+/* Host to device: start a blob upload. The core re-arms EP0 one packet at
+   a time, into blob_buf itself when streaming. Before SET_CONFIGURATION
+   the core hands no data to the class, so the request stalls rather than
+   dropping the blob after its status stage. */
+static uint8_t VReq_BlobSetup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+    USBD_VReq_HandleTypeDef *hvreq = &USBD_COMPOSITE_CTX(pdev)->vreq;
+
+    if ((req->bRequest != USBD_VREQ_BLOB) || (req->wLength > USBD_VREQ_BLOB_MAX) ||
+        (pdev->dev_state != USBD_STATE_CONFIGURED))
+    {
+        USBD_CtlError(pdev, req);
+        return USBD_FAIL;
+    }
+
+    hvreq->blob_id = req->wValue;
+    hvreq->blob_len = req->wLength;
+    hvreq->blob_pos = 0U;
+    hvreq->blob_tick = HAL_GetTick();
+    hvreq->blob_cycles = 0U;
+
+    if (req->wLength == 0U)
+    {
+        USBD_VReq_BlobCallback(hvreq->blob_id, 0U, hvreq->blob_buf, 0U, 1U);
+        VReq_BlobDone(hvreq);
+        (void)USBD_CtlSendStatus(pdev);
+        return USBD_OK;
+    }
+
+#if (USBD_VREQ_BLOB_STAGING == 0U)
+    pdev->pEP0Stream = hvreq->blob_buf;
+#endif
+    (void)USBD_CtlPrepareRx(pdev, hvreq->blob_buf, req->wLength);
+    return USBD_OK;
+}
+
+/* Host to device: re-enumerate as personality wValue once this request
+   has completed */
+static uint8_t VReq_SetPersonality(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+    if ((req->wLength != 0U) || (req->wValue > 0xFFU) ||
+        (USBD_Composite_RequestPersonality(pdev, (uint8_t)req->wValue) != USBD_OK))
+    {
+        USBD_CtlError(pdev, req);
+        return USBD_FAIL;
+    }
+
+    (void)USBD_CtlSendStatus(pdev);
+    return USBD_OK;
+}
+
+/**
+  * @brief  Vendor requests, any recipient. The reply points into the live
+  *         structure; nothing is copied.
+  */
+uint8_t USBD_VReq_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+    USBD_Composite_HandleTypeDef *ctx = USBD_COMPOSITE_CTX(pdev);
+    const void *pbuf;
+
+    if ((req->bmRequest & 0x80U) == 0U)
+    {
+        if (req->bRequest == USBD_VREQ_SET_PERSONALITY)
+        {
+            return VReq_SetPersonality(pdev, req);
+        }
+        return VReq_BlobSetup(pdev, req);
+    }
+    if (req->bRequest >= USBD_VREQ_COUNT)
+    {
+        USBD_CtlError(pdev, req);
+        return USBD_FAIL;
+    }
+
+    switch (req->bRequest)
+    {
+        case USBD_VREQ_INFO:        pbuf = &VReqInfo; break;
+        case USBD_VREQ_PERSONALITY: pbuf = &ctx->personality; break;
+        case USBD_VREQ_CONN:        pbuf = &USBD_PORT(pdev)->conn; break;
+        case USBD_VREQ_LOW_POWER:   pbuf = &USBD_PORT(pdev)->lp; break;
+        case USBD_VREQ_CLOCK_GOV:   pbuf = &ClockGov_Stats; break;
+        case USBD_VREQ_SCHED:       pbuf = &ctx->sched.stats; break;
+        case USBD_VREQ_BENCH:       pbuf = &ctx->bench; break;
+        case USBD_VREQ_ARB:         pbuf = ctx->arb.stats; break;
+        case USBD_VREQ_BULK:        pbuf = &ctx->bulk.stats; break;
+        case USBD_VREQ_STRIPE:      pbuf = &ctx->stripe.stats; break;
+        case USBD_VREQ_TRACE_HEAD:  pbuf = USBD_Trace_Head(pdev); break;
+        case USBD_VREQ_TRACE:       pbuf = USBD_Trace_Ring(pdev); break;
+        case USBD_VREQ_BLOB_STATS:  pbuf = &ctx->vreq.stats; break;
+        case USBD_VREQ_IRQ:         pbuf = &USBD_PORT(pdev)->irq; break;
+        case USBD_VREQ_RAM:         pbuf = &VReqRam; break;
+        default:                    pbuf = &USBD_Log_Stats; break;
+    }
+
+    if (req->wLength == 0U)
+    {
+        (void)USBD_CtlSendStatus(pdev);
+    }
+    else
+    {
+        (void)USBD_CtlSendData(pdev, (uint8_t *)pbuf, MIN(VReqInfo.sizes[req->bRequest], req->wLength));
+    }
+    return USBD_OK;
+}
+
+/**
+  * @brief  EP0 OUT data: one packet of the blob when streaming, all of it
+  *         when staging.
+  */
+uint8_t USBD_VReq_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+    USBD_VReq_HandleTypeDef *hvreq = &USBD_COMPOSITE_CTX(pdev)->vreq;
+    uint32_t t0 = DWT->CYCCNT;
+    uint16_t n;
+
+    if (((pdev->request.bmRequest & (0x80U | USB_REQ_TYPE_MASK)) != USB_REQ_TYPE_VENDOR) ||
+        (pdev->request.bRequest != USBD_VREQ_BLOB) || (hvreq->blob_pos >= hvreq->blob_len))
+    {
+        return USBD_OK;
+    }
+
+#if (USBD_VREQ_BLOB_STAGING != 0U)
+    n = hvreq->blob_len;
+    hvreq->stats.packets += (n + USB_MAX_EP0_SIZE - 1U) / USB_MAX_EP0_SIZE;
+#else
+    n = MIN((uint16_t)(hvreq->blob_len - hvreq->blob_pos), USB_MAX_EP0_SIZE);
+    hvreq->stats.packets++;
+#endif
+    USBD_VReq_BlobCallback(hvreq->blob_id, hvreq->blob_pos, hvreq->blob_buf, n, (hvreq->blob_pos + n) == hvreq->blob_len);
+    hvreq->blob_pos += n;
+    hvreq->stats.bytes += n;
+    hvreq->blob_cycles += DWT->CYCCNT - t0;
+
+    if (hvreq->blob_pos == hvreq->blob_len)
+    {
+        VReq_BlobDone(hvreq);
+    }
+    return USBD_OK;
+}
+
+/**
+  * @brief  Default consumer: blobs are counted and discarded. Overridden by
+  *         the application.
+  */
+__weak void USBD_VReq_BlobCallback(uint16_t id, uint32_t offset, const uint8_t *data, uint32_t len, uint8_t last)
+{
+    UNUSED(id);
+    UNUSED(offset);
+    UNUSED(data);
+    UNUSED(len);
+    UNUSED(last);
+}
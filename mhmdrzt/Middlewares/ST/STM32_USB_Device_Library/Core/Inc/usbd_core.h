@@ -131,6 +131,8 @@ USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_a
 
 uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t  ep_addr);
+uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev);
+uint8_t USBD_LL_IsDMA(USBD_HandleTypeDef *pdev);
 
 void  USBD_LL_Delay(uint32_t Delay);
 
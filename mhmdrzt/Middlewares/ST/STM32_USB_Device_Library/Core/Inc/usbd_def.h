@@ -53,6 +53,14 @@ extern "C" {
 #define USBD_MAX_NUM_CONFIGURATION                      1U
 #endif /* USBD_MAX_NUM_CONFIGURATION */
 
+#ifndef USBD_MAX_EP_NUM
+#define USBD_MAX_EP_NUM                                 16U
+#endif /* USBD_MAX_EP_NUM */
+
+#ifndef USBD_RAMFUNC
+#define USBD_RAMFUNC
+#endif /* USBD_RAMFUNC */
+
 #ifndef USBD_LPM_ENABLED
 #define USBD_LPM_ENABLED                                0U
 #endif /* USBD_LPM_ENABLED */
@@ -225,10 +233,10 @@ typedef struct _Device_cb
   uint8_t (*IsoINIncomplete)(struct _USBD_HandleTypeDef *pdev, uint8_t epnum);
   uint8_t (*IsoOUTIncomplete)(struct _USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-  uint8_t  *(*GetHSConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetFSConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetOtherSpeedConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetDeviceQualifierDescriptor)(uint16_t *length);
+  uint8_t  *(*GetHSConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetFSConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetOtherSpeedConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetDeviceQualifierDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
 #if (USBD_SUPPORT_USER_STRING_DESC == 1U)
   uint8_t  *(*GetUsrStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint8_t index,  uint16_t *length);
 #endif
@@ -256,18 +264,18 @@ typedef enum
 
 typedef struct
 {
-  uint8_t *(*GetDeviceDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetLangIDStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetManufacturerStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetProductStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetSerialStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetConfigurationStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
-  uint8_t *(*GetInterfaceStrDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length, uint8_t index);
+  uint8_t *(*GetDeviceDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetLangIDStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetManufacturerStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetProductStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetSerialStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetConfigurationStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t *(*GetInterfaceStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length, uint8_t index);
 #if (USBD_CLASS_USER_STRING_DESC == 1)
-  uint8_t *(*GetUserStrDescriptor)(USBD_SpeedTypeDef speed, uint8_t idx, uint16_t *length);
+  uint8_t *(*GetUserStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint8_t idx, uint16_t *length);
 #endif
 #if ((USBD_LPM_ENABLED == 1U) || (USBD_CLASS_BOS_ENABLED == 1))
-  uint8_t *(*GetBOSDescriptor)(USBD_SpeedTypeDef speed, uint16_t *length);
+  uint8_t *(*GetBOSDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
 #endif
 } USBD_DescriptorsTypeDef;
 
@@ -290,8 +298,8 @@ typedef struct _USBD_HandleTypeDef
   uint32_t                dev_default_config;
   uint32_t                dev_config_status;
   USBD_SpeedTypeDef       dev_speed;
-  USBD_EndpointTypeDef    ep_in[16];
-  USBD_EndpointTypeDef    ep_out[16];
+  USBD_EndpointTypeDef    ep_in[USBD_MAX_EP_NUM];
+  USBD_EndpointTypeDef    ep_out[USBD_MAX_EP_NUM];
   __IO uint32_t           ep0_state;
   uint32_t                ep0_data_len;
   __IO uint8_t            dev_state;
@@ -310,8 +318,31 @@ typedef struct _USBD_HandleTypeDef
   void                    *pData;
   void                    *pBosDesc;
   void                    *pConfDesc;
+  uint8_t                 *pEP0Stream;      /* set by the class: EP0 OUT data phase re-armed packet by packet into this buffer */
+  uint32_t                class_stamp;      /* DWT cycle count just before a DataIn/DataOut/SOF dispatch */
 } USBD_HandleTypeDef;
 
+/* Class callbacks on the data path. With USBD_STATIC_CLASS the core calls
+   the USBD_STATIC_CLASS_<callback> functions named in usbd_conf.h, which
+   must all exist; otherwise it goes through pClass and skips NULL entries.
+   Init, DeInit and the descriptor callbacks always use pClass. */
+#if (USBD_STATIC_CLASS != 0U)
+#define USBD_CLASS_HAS(pdev, cb)  (1U)
+#define USBD_CLASS_CB(pdev, cb)   USBD_STATIC_CLASS_##cb
+uint8_t USBD_STATIC_CLASS_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+uint8_t USBD_STATIC_CLASS_EP0_RxReady(USBD_HandleTypeDef *pdev);
+uint8_t USBD_STATIC_CLASS_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+uint8_t USBD_STATIC_CLASS_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+uint8_t USBD_STATIC_CLASS_SOF(USBD_HandleTypeDef *pdev);
+#else
+#define USBD_CLASS_HAS(pdev, cb)  ((pdev)->pClass->cb != NULL)
+#define USBD_CLASS_CB(pdev, cb)   ((pdev)->pClass->cb)
+#endif
+
+/* Taken by the core right before a data-path dispatch; the class reads it
+   on entry to measure the dispatch itself */
+#define USBD_CLASS_STAMP(pdev)    ((pdev)->class_stamp = DWT->CYCCNT)
+
 /**
   * @}
   */
@@ -321,6 +352,17 @@ typedef struct _USBD_HandleTypeDef
 /** @defgroup USBD_DEF_Exported_Macros
   * @{
   */
+/* Endpoint state of `ep_addr`, NULL when its number is beyond the table.
+   Endpoint addresses taken from a request go through here first. */
+__STATIC_INLINE USBD_EndpointTypeDef *USBD_GetEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  if ((ep_addr & 0x7FU) >= USBD_MAX_EP_NUM)
+  {
+    return NULL;
+  }
+  return ((ep_addr & 0x80U) != 0U) ? &pdev->ep_in[ep_addr & 0x7FU] : &pdev->ep_out[ep_addr & 0x7FU];
+}
+
 __STATIC_INLINE uint16_t SWAPBYTE(uint8_t *addr)
 {
   uint16_t _SwapVal, _Byte1, _Byte2;
@@ -181,12 +181,12 @@ USBD_StatusTypeDef USBD_RegisterClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDe
 #ifdef USE_USB_HS
   if (pdev->pClass->GetHSConfigDescriptor != NULL)
   {
-    pdev->pConfDesc = (void *)pdev->pClass->GetHSConfigDescriptor(&len);
+    pdev->pConfDesc = (void *)pdev->pClass->GetHSConfigDescriptor(pdev, &len);
   }
 #else /* Default USE_USB_FS */
   if (pdev->pClass->GetFSConfigDescriptor != NULL)
   {
-    pdev->pConfDesc = (void *)pdev->pClass->GetFSConfigDescriptor(&len);
+    pdev->pConfDesc = (void *)pdev->pClass->GetFSConfigDescriptor(pdev, &len);
   }
 #endif /* USE_USB_FS */
 
@@ -285,7 +285,7 @@ USBD_StatusTypeDef USBD_ClrClassConfig(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   * @param  pdev: device instance
   * @retval status
   */
-USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
 {
   USBD_StatusTypeDef ret;
 
@@ -294,6 +294,7 @@ USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
   pdev->ep0_state = USBD_EP0_SETUP;
 
   pdev->ep0_data_len = pdev->request.wLength;
+  pdev->pEP0Stream = NULL;
 
   switch (pdev->request.bmRequest & 0x1FU)
   {
@@ -325,7 +326,7 @@ USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
   * @param  pdata: data pointer
   * @retval status
   */
-USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
                                         uint8_t epnum, uint8_t *pdata)
 {
   USBD_EndpointTypeDef *pep;
@@ -341,15 +342,28 @@ USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
       {
         pep->rem_length -= pep->maxpacket;
 
-        (void)USBD_CtlContinueRx(pdev, pdata, MIN(pep->rem_length, pep->maxpacket));
+        if (pdev->pEP0Stream != NULL)
+        {
+          /* Streamed data phase: the class takes every packet through
+             EP0_RxReady and the same buffer is armed for the next one */
+          if ((pdev->dev_state == USBD_STATE_CONFIGURED) && USBD_CLASS_HAS(pdev, EP0_RxReady))
+          {
+            USBD_CLASS_CB(pdev, EP0_RxReady)(pdev);
+          }
+          (void)USBD_CtlContinueRx(pdev, pdev->pEP0Stream, MIN(pep->rem_length, pep->maxpacket));
+        }
+        else
+        {
+          (void)USBD_CtlContinueRx(pdev, pdata, MIN(pep->rem_length, pep->maxpacket));
+        }
       }
       else
       {
         if (pdev->dev_state == USBD_STATE_CONFIGURED)
         {
-          if (pdev->pClass->EP0_RxReady != NULL)
+          if (USBD_CLASS_HAS(pdev, EP0_RxReady))
           {
-            pdev->pClass->EP0_RxReady(pdev);
+            USBD_CLASS_CB(pdev, EP0_RxReady)(pdev);
           }
         }
 
@@ -374,9 +388,10 @@ USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
   {
     if (pdev->dev_state == USBD_STATE_CONFIGURED)
     {
-      if (pdev->pClass->DataOut != NULL)
+      if (USBD_CLASS_HAS(pdev, DataOut))
       {
-        ret = (USBD_StatusTypeDef)pdev->pClass->DataOut(pdev, epnum);
+        USBD_CLASS_STAMP(pdev);
+        ret = (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, DataOut)(pdev, epnum);
 
         if (ret != USBD_OK)
         {
@@ -396,7 +411,7 @@ USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
   * @param  epnum: endpoint index
   * @retval status
   */
-USBD_StatusTypeDef USBD_LL_DataInStage(USBD_HandleTypeDef *pdev,
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_DataInStage(USBD_HandleTypeDef *pdev,
                                        uint8_t epnum, uint8_t *pdata)
 {
   USBD_EndpointTypeDef *pep;
@@ -465,9 +480,10 @@ USBD_StatusTypeDef USBD_LL_DataInStage(USBD_HandleTypeDef *pdev,
   {
     if (pdev->dev_state == USBD_STATE_CONFIGURED)
     {
-      if (pdev->pClass->DataIn != NULL)
+      if (USBD_CLASS_HAS(pdev, DataIn))
       {
-        ret = (USBD_StatusTypeDef)pdev->pClass->DataIn(pdev, epnum);
+        USBD_CLASS_STAMP(pdev);
+        ret = (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, DataIn)(pdev, epnum);
 
         if (ret != USBD_OK)
         {
@@ -576,7 +592,7 @@ USBD_StatusTypeDef USBD_LL_Resume(USBD_HandleTypeDef *pdev)
   * @retval status
   */
 
-USBD_StatusTypeDef USBD_LL_SOF(USBD_HandleTypeDef *pdev)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_SOF(USBD_HandleTypeDef *pdev)
 {
   if (pdev->pClass == NULL)
   {
@@ -585,9 +601,10 @@ USBD_StatusTypeDef USBD_LL_SOF(USBD_HandleTypeDef *pdev)
 
   if (pdev->dev_state == USBD_STATE_CONFIGURED)
   {
-    if (pdev->pClass->SOF != NULL)
+    if (USBD_CLASS_HAS(pdev, SOF))
     {
-      (void)pdev->pClass->SOF(pdev);
+      USBD_CLASS_STAMP(pdev);
+      (void)USBD_CLASS_CB(pdev, SOF)(pdev);
     }
   }
 
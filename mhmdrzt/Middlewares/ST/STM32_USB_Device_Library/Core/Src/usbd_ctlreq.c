@@ -30,7 +30,7 @@ USBD_StatusTypeDef USBD_CtlReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       break;
     case USB_REQ_TYPE_CLASS:
       /* Dispatch class-specific requests to the class setup callback */
-      ret = (USBD_StatusTypeDef)pdev->pClass->Setup(pdev, req);
+      ret = (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, Setup)(pdev, req);
       break;
     case USB_REQ_TYPE_VENDOR:
       /* For vendor-specific requests, you might add a vendor handler here */
@@ -96,7 +96,7 @@ USBD_StatusTypeDef USBD_StdDevReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
 
     case USB_REQ_TYPE_CLASS:
     case USB_REQ_TYPE_VENDOR:
-      ret = (USBD_StatusTypeDef)pdev->pClass->Setup(pdev, req);
+      ret = (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, Setup)(pdev, req);
       break;
 
     default:
@@ -119,7 +119,7 @@ USBD_StatusTypeDef USBD_StdItfReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
 {
   if ((LOBYTE(req->wIndex)) < USBD_MAX_NUM_INTERFACES)
   {
-    return (USBD_StatusTypeDef)pdev->pClass->Setup(pdev, req);
+    return (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, Setup)(pdev, req);
   }
   else
   {
@@ -141,6 +141,12 @@ USBD_StatusTypeDef USBD_StdEPReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
   switch (req->bmRequest & USB_REQ_TYPE_MASK)
   {
     case USB_REQ_TYPE_STANDARD:
+      if (USBD_GetEP(pdev, ep_addr) == NULL)
+      {
+        USBD_ErrLog("port %u: request %u for endpoint 0x%02x, out of range", pdev->id, req->bRequest, ep_addr);
+        USBD_CtlError(pdev, req);
+        break;
+      }
       switch (req->bRequest)
       {
         case USB_REQ_SET_FEATURE:
@@ -172,7 +178,7 @@ USBD_StatusTypeDef USBD_StdEPReq(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
       break;
     case USB_REQ_TYPE_CLASS:
     case USB_REQ_TYPE_VENDOR:
-      return (USBD_StatusTypeDef)pdev->pClass->Setup(pdev, req);
+      return (USBD_StatusTypeDef)USBD_CLASS_CB(pdev, Setup)(pdev, req);
     default:
       USBD_CtlError(pdev, req);
       break;
@@ -210,7 +216,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
     case USB_DESC_TYPE_BOS:
       if (pdev->pDesc->GetBOSDescriptor != NULL)
       {
-        pbuf = pdev->pDesc->GetBOSDescriptor(pdev->dev_speed, &len);
+        pbuf = pdev->pDesc->GetBOSDescriptor(pdev, &len);
       }
       else
       {
@@ -220,7 +226,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       break;
 #endif
     case USB_DESC_TYPE_DEVICE:
-      pbuf = pdev->pDesc->GetDeviceDescriptor(pdev->dev_speed, &len);
+      pbuf = pdev->pDesc->GetDeviceDescriptor(pdev, &len);
       break;
 
     case USB_DESC_TYPE_CONFIGURATION:
@@ -228,14 +234,14 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       {
         if (pdev->pClass->GetHSConfigDescriptor != NULL)
         {
-          pbuf = pdev->pClass->GetHSConfigDescriptor(&len);
+          pbuf = pdev->pClass->GetHSConfigDescriptor(pdev, &len);
         }
       }
       else
       {
         if (pdev->pClass->GetFSConfigDescriptor != NULL)
         {
-          pbuf = pdev->pClass->GetFSConfigDescriptor(&len);
+          pbuf = pdev->pClass->GetFSConfigDescriptor(pdev, &len);
         }
       }
       if(pbuf != NULL)
@@ -250,7 +256,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
         case USBD_IDX_LANGID_STR:
           if (pdev->pDesc->GetLangIDStrDescriptor != NULL)
           {
-            pbuf = pdev->pDesc->GetLangIDStrDescriptor(pdev->dev_speed, &len);
+            pbuf = pdev->pDesc->GetLangIDStrDescriptor(pdev, &len);
           }
           else
           {
@@ -262,7 +268,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
         case USBD_IDX_MFC_STR:
           if (pdev->pDesc->GetManufacturerStrDescriptor != NULL)
           {
-            pbuf = pdev->pDesc->GetManufacturerStrDescriptor(pdev->dev_speed, &len);
+            pbuf = pdev->pDesc->GetManufacturerStrDescriptor(pdev, &len);
           }
           else
           {
@@ -274,7 +280,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
         case USBD_IDX_PRODUCT_STR:
           if (pdev->pDesc->GetProductStrDescriptor != NULL)
           {
-            pbuf = pdev->pDesc->GetProductStrDescriptor(pdev->dev_speed, &len);
+            pbuf = pdev->pDesc->GetProductStrDescriptor(pdev, &len);
           }
           else
           {
@@ -286,7 +292,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
         case USBD_IDX_SERIAL_STR:
           if (pdev->pDesc->GetSerialStrDescriptor != NULL)
           {
-            pbuf = pdev->pDesc->GetSerialStrDescriptor(pdev->dev_speed, &len);
+            pbuf = pdev->pDesc->GetSerialStrDescriptor(pdev, &len);
           }
           else
           {
@@ -298,7 +304,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
 //        case USBD_IDX_CONFIG_STR:
 //          if (pdev->pDesc->GetConfigurationStrDescriptor != NULL)
 //          {
-//            pbuf = pdev->pDesc->GetConfigurationStrDescriptor(pdev->dev_speed, &len);
+//            pbuf = pdev->pDesc->GetConfigurationStrDescriptor(pdev, &len);
 //          }
 //          else
 //          {
@@ -310,7 +316,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
 //        case USBD_IDX_INTERFACE_STR:
 //          if (pdev->pDesc->GetInterfaceStrDescriptor != NULL)
 //          {
-//            pbuf = pdev->pDesc->GetInterfaceStrDescriptor(pdev->dev_speed, &len, );
+//            pbuf = pdev->pDesc->GetInterfaceStrDescriptor(pdev, &len, );
 //          }
 //          else
 //          {
@@ -324,10 +330,18 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
 					{
 						uint8_t str_index = (uint8_t)(req->wValue & 0xFF);
 
-						if (pdev->pDesc->GetInterfaceStrDescriptor != NULL &&
-								(str_index == 4 || str_index == 5))
+						/* Interface strings start at USBD_IDX_CONFIG_STR (the
+						   device has no configuration string); the callback
+						   returns NULL for an index it does not know */
+						if ((pdev->pDesc->GetInterfaceStrDescriptor != NULL) &&
+								(str_index >= USBD_IDX_CONFIG_STR))
 						{
-							pbuf = pdev->pDesc->GetInterfaceStrDescriptor(pdev->dev_speed, &len, str_index);
+							pbuf = pdev->pDesc->GetInterfaceStrDescriptor(pdev, &len, str_index);
+							if (pbuf == NULL)
+							{
+								USBD_CtlError(pdev, req);
+								err++;
+							}
 						}
 				#if (USBD_SUPPORT_USER_STRING_DESC == 1U)
 						else if (pdev->pClass->GetUsrStrDescriptor != NULL)
@@ -354,7 +368,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
     case USB_DESC_TYPE_DEVICE_QUALIFIER:
       if (pdev->dev_speed == USBD_SPEED_HIGH)
       {
-        //pbuf = pdev->pDesc->GetDeviceQualifierDescriptor(pdev->dev_speed, &len);
+        //pbuf = pdev->pDesc->GetDeviceQualifierDescriptor(pdev, &len);
       }
       else
       {
@@ -368,7 +382,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       {
         if (pdev->pClass->GetOtherSpeedConfigDescriptor != NULL)
         {
-          pbuf = pdev->pClass->GetOtherSpeedConfigDescriptor(&len);
+          pbuf = pdev->pClass->GetOtherSpeedConfigDescriptor(pdev, &len);
           pbuf[1] = USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION;
         }
       }
@@ -39,20 +39,20 @@
 
 /* Private macro -------------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
-uint8_t *USBD_Class_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
-uint8_t *USBD_Class_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+uint8_t *USBD_Class_DeviceDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_LangIDStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_ManufacturerStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_ProductStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_SerialStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_ConfigStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_Class_InterfaceStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 #if (USBD_CLASS_USER_STRING_DESC == 1)
-uint8_t *USBD_Class_UserStrDescriptor(USBD_SpeedTypeDef speed, uint8_t idx, uint16_t *length);
+uint8_t *USBD_Class_UserStrDescriptor(USBD_HandleTypeDef *pdev, uint8_t idx, uint16_t *length);
 #endif /* USB_CLASS_USER_STRING_DESC */
 
 #if ((USBD_LPM_ENABLED == 1) || (USBD_CLASS_BOS_ENABLED == 1))
-uint8_t *USBD_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+uint8_t *USBD_USR_BOSDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 #endif
 
 /* Private variables ---------------------------------------------------------*/
@@ -249,13 +249,13 @@ static void Get_SerialNum(void);
 
 /**
   * @brief  Returns the device descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_DeviceDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  UNUSED(speed);
+  UNUSED(pdev);
 
   *length = sizeof(USBD_DeviceDesc);
   return (uint8_t *)USBD_DeviceDesc;
@@ -263,13 +263,13 @@ uint8_t *USBD_Class_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 
 /**
   * @brief  Returns the LangID string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_LangIDStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  UNUSED(speed);
+  UNUSED(pdev);
 
   *length = sizeof(USBD_LangIDDesc);
   return (uint8_t *)USBD_LangIDDesc;
@@ -277,13 +277,13 @@ uint8_t *USBD_Class_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *lengt
 
 /**
   * @brief  Returns the product string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_ProductStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  if (speed == USBD_SPEED_HIGH)
+  if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     USBD_GetString((uint8_t *)USBD_PRODUCT_HS_STRING, USBD_StrDesc, length);
   }
@@ -296,13 +296,13 @@ uint8_t *USBD_Class_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *leng
 
 /**
   * @brief  Returns the manufacturer string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_ManufacturerStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  UNUSED(speed);
+  UNUSED(pdev);
 
   USBD_GetString((uint8_t *)USBD_MANUFACTURER_STRING, USBD_StrDesc, length);
   return USBD_StrDesc;
@@ -310,13 +310,13 @@ uint8_t *USBD_Class_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t
 
 /**
   * @brief  Returns the serial number string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_SerialStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  UNUSED(speed);
+  UNUSED(pdev);
 
   *length = USB_SIZ_STRING_SERIAL;
 
@@ -328,13 +328,13 @@ uint8_t *USBD_Class_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *lengt
 
 /**
   * @brief  Returns the configuration string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_ConfigStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  if (speed == USBD_SPEED_HIGH)
+  if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     USBD_GetString((uint8_t *)USBD_CONFIGURATION_HS_STRING, USBD_StrDesc, length);
   }
@@ -347,13 +347,13 @@ uint8_t *USBD_Class_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *lengt
 
 /**
   * @brief  Returns the interface string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_Class_InterfaceStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  if (speed == USBD_SPEED_HIGH)
+  if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     USBD_GetString((uint8_t *)USBD_INTERFACE_HS_STRING, USBD_StrDesc, length);
   }
@@ -391,11 +391,11 @@ static void Get_SerialNum(void)
 /**
   * @brief  USBD_USR_BOSDescriptor
   *         return the BOS descriptor
-  * @param  speed : current device speed
+  * @param  pdev : device instance
   * @param  length : pointer to data length variable
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_USR_BOSDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
   *length = sizeof(USBD_BOSDesc);
   return (uint8_t *)USBD_BOSDesc;
@@ -406,12 +406,12 @@ uint8_t *USBD_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 #if (USBD_CLASS_USER_STRING_DESC == 1)
 /**
   * @brief  Returns the Class User string descriptor.
-  * @param  speed: Current device speed
+  * @param  pdev: device instance
   * @param  idx: index of string descriptor
   * @param  length: Pointer to data length variable
   * @retval Pointer to descriptor buffer
   */
-uint8_t *USBD_Class_UserStrDescriptor(USBD_SpeedTypeDef speed, uint8_t idx, uint16_t *length)
+uint8_t *USBD_Class_UserStrDescriptor(USBD_HandleTypeDef *pdev, uint8_t idx, uint16_t *length)
 {
   static uint8_t USBD_StrDesc[255];
 
@@ -0,0 +1,76 @@
+/* host_otg.h */
+#ifndef __HOST_OTG_H
+#define __HOST_OTG_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal.h"
+
+/* Register model of the OTG_FS core, for running usbd_conf.c and the
+   lean driver (usbd_ll_fs.c) as they ship instead of host_usb.c.
+
+   The register block is plain memory mapped at USB_OTG_FS_PERIPH_BASE,
+   below 4 GB as the drivers need. The model plays the core's side of
+   each bus event: it queues GRXSTSP entries and FIFO words, sets the
+   endpoint interrupt bits and DAINT, and calls USBD_LLFS_IRQHandler for
+   every source it raises. What memory cannot do is routed through the
+   stubs: the data FIFO window is a call (Host_Otg_Fifo) and the
+   self-clearing GRSTCTL bits finish when polled (Host_Otg_Grstctl).
+
+   Memory cannot tell a W1C acknowledge from a write either, so the model
+   retires the bits it raised once the handler returns, and calls the
+   handler directly rather than through USBD_LL_IRQService, whose drain
+   loop re-reads GINTSTS. Each handler call is timed and counted by the
+   kind of event it served, in Host_Otg_Stats.
+
+   Every Host_Otg_* bus call first delivers what is already pending, such
+   as TXFE for a transfer armed from thread code. */
+#define HOST_OTG_NAK                (-1)
+#define HOST_OTG_STALL              (-2)
+
+/* Device address the host assigns in Host_Otg_Enumerate */
+#define HOST_OTG_DEV_ADDRESS        5U
+
+/* Handler calls, by the event that raised them */
+#define HOST_OTG_EV_RX              0U       /* RXFLVL: one GRXSTSP entry */
+#define HOST_OTG_EV_SETUP           1U       /* OEPINT: SETUP done */
+#define HOST_OTG_EV_OUT             2U       /* OEPINT: OUT transfer complete */
+#define HOST_OTG_EV_IN              3U       /* IEPINT: IN transfer complete */
+#define HOST_OTG_EV_TXFE            4U       /* IEPINT: TX FIFO refill only */
+#define HOST_OTG_EV_SOF             5U
+#define HOST_OTG_EV_RESET           6U
+#define HOST_OTG_EV_ENUM            7U
+#define HOST_OTG_NUM_EVENTS         8U
+
+typedef struct
+{
+  uint32_t irqs[HOST_OTG_NUM_EVENTS];
+  uint64_t cycles[HOST_OTG_NUM_EVENTS];    /* host cycles in the handler */
+  /* The driver broke the register contract: FIFO over- or underrun, an
+     RX entry not drained, interrupts that never settle. Each one is
+     printed as it happens. */
+  uint32_t errors;
+} Host_Otg_StatsTypeDef;
+
+extern Host_Otg_StatsTypeDef Host_Otg_Stats;
+extern const char *const Host_Otg_EventNames[HOST_OTG_NUM_EVENTS];
+
+uint8_t  Host_Otg_Map(void);
+void     Host_Otg_BusReset(void);
+void     Host_Otg_SOF(void);
+void     Host_Otg_Setup(const uint8_t *setup);
+int32_t  Host_Otg_In(uint8_t ep, uint8_t *data);
+int32_t  Host_Otg_Out(uint8_t ep, const uint8_t *data, uint32_t len);
+int32_t  Host_Otg_Control(uint8_t bmRequest, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                          uint16_t wLength, uint8_t *data);
+uint8_t  Host_Otg_Enumerate(void);
+uint64_t Host_Otg_Cycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_OTG_H */
@@ -0,0 +1,106 @@
+/* host_usb.h */
+#ifndef __HOST_USB_H
+#define __HOST_USB_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "usbd_def.h"
+#include "usbd_composite.h"
+#include <pthread.h>
+
+/* Both ends of the bus for host-side runs of the USB stack.
+
+   The device end replaces usbd_conf.c: USBD_LL_* calls land in the
+   endpoint table of the Host_DeviceTypeDef that pdev->pData points to, so
+   the core, the composite class and the descriptors run unchanged. The
+   host end drives an instance the way a host controller would: bus reset,
+   control transfers, one SOF per frame and one poll per armed IN endpoint
+   per frame.
+
+   Each Host_DeviceTypeDef is one complete device: core handle, class
+   context (LL port state and event trace included), bus state and its
+   own interrupt mask. Instances share nothing but the board state of
+   host_board.c (log ring, clock governor), exactly as two ports share the
+   board on the target.
+
+   Every Host_* call stands for the interrupt of its instance: it selects
+   the instance for the calling thread (Host_Select), so masking inside
+   the stack takes that instance's lock only. Code that calls into the
+   stack directly from several threads selects the instance itself. */
+#define HOST_EP_NUM                 USBD_MAX_EP_NUM
+
+/* Device address the host assigns in Host_Enumerate */
+#define HOST_DEV_ADDRESS            5U
+
+typedef struct
+{
+  uint8_t  *buf;
+  uint32_t len;           /* IN: bytes armed; OUT: buffer size */
+  uint32_t count;         /* OUT: bytes of the last packet */
+  uint8_t  open;
+  uint8_t  armed;
+  uint8_t  stalled;
+} Host_EPTypeDef;
+
+typedef struct Host_Device
+{
+  USBD_HandleTypeDef           dev;
+  USBD_Composite_HandleTypeDef ctx;
+  uint32_t frame;
+  uint8_t  dma;           /* what USBD_LL_IsDMA reports */
+  uint8_t  address;
+  uint8_t  started;
+  Host_EPTypeDef in[HOST_EP_NUM];
+  Host_EPTypeDef out[HOST_EP_NUM];
+  /* Misuse of the LL layer: an IN endpoint armed twice, a transfer on a
+     closed endpoint, a misaligned buffer while `dma` is set */
+  uint32_t ll_errors;
+  /* Every IN transfer the host takes, before the completion is signalled */
+  void (*on_in)(struct Host_Device *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len);
+  void *user;
+  /* Held while this instance's "interrupt" is masked, see host_board.c */
+  pthread_mutex_t irq_lock;
+} Host_DeviceTypeDef;
+
+/* A byte stream written to the device through one of its Write calls
+   (USBD_Bulk_Write, USBD_Stripe_Write), as the device accepted it: byte
+   values count up from the seed, so the host side can compare what
+   arrived against `data` */
+#define HOST_STREAM_MAX             65536U
+
+typedef uint16_t (*Host_WriteFn)(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len);
+
+typedef struct
+{
+  uint8_t  data[HOST_STREAM_MAX];
+  uint32_t len;           /* bytes accepted */
+  uint8_t  seed;          /* value of the next byte */
+} Host_StreamTypeDef;
+
+uint8_t Host_Attach(Host_DeviceTypeDef *hd, uint8_t id, uint8_t personality);
+void    Host_BusReset(Host_DeviceTypeDef *hd);
+int32_t Host_Control(Host_DeviceTypeDef *hd, uint8_t bmRequest, uint8_t bRequest,
+                     uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data);
+uint8_t Host_Enumerate(Host_DeviceTypeDef *hd);
+void    Host_SOF(Host_DeviceTypeDef *hd);
+int32_t Host_PollIn(Host_DeviceTypeDef *hd, uint8_t ep_addr);
+void    Host_Frame(Host_DeviceTypeDef *hd);
+int32_t Host_Out(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len);
+int32_t Host_VendorCommand(Host_DeviceTypeDef *hd, uint8_t cmd, const uint8_t *args, uint8_t len);
+void    Host_StreamReset(Host_StreamTypeDef *hs, uint8_t seed);
+uint16_t Host_StreamWrite(Host_DeviceTypeDef *hd, Host_StreamTypeDef *hs, Host_WriteFn write, uint16_t len);
+
+/* Board side, see host_board.c */
+Host_DeviceTypeDef *Host_Select(Host_DeviceTypeDef *hd);
+uint32_t Host_MaskContended(void);
+
+extern __IO uint32_t Host_Tick;
+extern __thread uint32_t Host_Activity;     /* ClockGov_Activity calls of this thread */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_USB_H */
@@ -0,0 +1,39 @@
+/* test.h */
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Minimal checks for the host tests. A failed check prints where and
+   what, counts, and the test goes on; Test_Report sets the exit code. */
+extern unsigned Test_Checks;
+extern unsigned Test_Failures;
+
+#define CHECK(cond)                                                         \
+  do {                                                                      \
+    Test_Checks++;                                                          \
+    if (!(cond))                                                            \
+    {                                                                       \
+      Test_Failures++;                                                      \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);       \
+    }                                                                       \
+  } while (0)
+
+#define CHECK_EQ(got, want)                                                 \
+  do {                                                                      \
+    long long test_got_ = (long long)(got);                                 \
+    long long test_want_ = (long long)(want);                               \
+    Test_Checks++;                                                          \
+    if (test_got_ != test_want_)                                            \
+    {                                                                       \
+      Test_Failures++;                                                      \
+      printf("%s:%d: %s == %lld, want %s == %lld\n", __FILE__, __LINE__,    \
+             #got, test_got_, #want, test_want_);                           \
+    }                                                                       \
+  } while (0)
+
+/* Prints the totals; returns the exit code for main */
+int Test_Report(const char *name);
+
+#endif /* __TEST_H */
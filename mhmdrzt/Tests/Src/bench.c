@@ -0,0 +1,142 @@
+/* Src/bench.c */
+#include "host_usb.h"
+#include "usbd_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The benchmark workloads of usbd_bench.h on the host: each run goes
+   through USBD_Bench_Start and the composite class as on the device, with
+   the host of host_usb.c taking every armed IN transfer once per frame,
+   and the result comes from USBD_Bench_GetResult, percentiles included.
+
+     bench [-w workload]... [-f frames]
+
+   Prints the runs as JSON, in the layout of Tools/usbd_bench.py, so host
+   and device runs can be compared with the same tools. DWT does not count
+   on the host: the cycles are host cycles spent in the frames of the run,
+   per report (per frame when none completed). */
+
+static const char *const Workloads[USBD_BENCH_NUM_WORKLOADS] =
+{
+    "idle", "motion", "buttons", "vendor", "bulk",
+};
+
+static Host_DeviceTypeDef Dev;
+
+static uint64_t Bench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static int Bench_Run(uint8_t workload, uint16_t frames, int first)
+{
+    const USBD_Bench_TypeDef *hbench = &Dev.ctx.bench;
+    uint8_t result[CUSTOM_HID_EPIN_SIZE];
+    uint64_t cycles = 0U;
+    uint64_t t0;
+    uint32_t rate;
+
+    if (USBD_Bench_Start(&Dev.dev, workload, frames) != USBD_OK)
+    {
+        fprintf(stderr, "bench: %s: start failed\n", Workloads[workload]);
+        return 1;
+    }
+    while (hbench->state == USBD_BENCH_RUNNING)
+    {
+        t0 = Bench_Cycles();
+        Host_Frame(&Dev);
+        cycles += Bench_Cycles() - t0;
+    }
+
+    memset(result, 0, sizeof(result));
+    USBD_Bench_GetResult(&Dev.dev, result);
+    rate = (uint32_t)(result[1] | (result[2] << 8));
+
+    printf("%s    {\n", first ? "" : ",\n");
+    printf("      \"workload\": \"%s\",\n", Workloads[workload]);
+    printf("      \"frames\": %u,\n", hbench->frames);
+    printf("      \"reports_per_s\": %u,\n", rate);
+    printf("      \"latency_frames_p50\": %u,\n", result[3]);
+    printf("      \"latency_frames_p99\": %u,\n", result[4]);
+    printf("      \"%s\": %llu\n", (hbench->reports != 0U) ? "cycles_per_report" : "cycles_per_frame",
+           (unsigned long long)(cycles / ((hbench->reports != 0U) ? hbench->reports : hbench->frames)));
+    printf("    }");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t runs[USBD_BENCH_NUM_WORKLOADS * 4U];
+    uint8_t nruns = 0U;
+    long frames = USBD_BENCH_DEFAULT_FRAMES;
+    int ret = 0;
+    uint8_t w;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-w") == 0) && ((i + 1) < argc) && (nruns < sizeof(runs)))
+        {
+            i++;
+            for (w = 0U; (w < USBD_BENCH_NUM_WORKLOADS) && (strcmp(argv[i], Workloads[w]) != 0); w++)
+            {
+            }
+            if (w == USBD_BENCH_NUM_WORKLOADS)
+            {
+                fprintf(stderr, "bench: unknown workload %s\n", argv[i]);
+                return 2;
+            }
+            runs[nruns++] = w;
+        }
+        else if ((strcmp(argv[i], "-f") == 0) && ((i + 1) < argc))
+        {
+            frames = strtol(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: bench [-w idle|motion|buttons|vendor|bulk]... [-f frames]\n");
+            return 2;
+        }
+    }
+    if ((frames < 1) || (frames > (long)USBD_BENCH_MAX_FRAMES))
+    {
+        fprintf(stderr, "bench: -f must be 1..%u\n", USBD_BENCH_MAX_FRAMES);
+        return 2;
+    }
+    if (nruns == 0U)
+    {
+        for (nruns = 0U; nruns < USBD_BENCH_NUM_WORKLOADS; nruns++)
+        {
+            runs[nruns] = nruns;
+        }
+    }
+
+    if ((Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL) != USBD_OK) || (Host_Enumerate(&Dev) != USBD_OK))
+    {
+        fprintf(stderr, "bench: enumeration failed\n");
+        return 1;
+    }
+
+    printf("{\n  \"runs\": [\n");
+    for (w = 0U; (w < nruns) && (ret == 0); w++)
+    {
+        ret = Bench_Run(runs[w], (uint16_t)frames, w == 0U);
+    }
+    printf("\n  ]\n}\n");
+
+    if (Dev.ll_errors != 0U)
+    {
+        fprintf(stderr, "bench: %u LL errors\n", Dev.ll_errors);
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,141 @@
+/* Src/host_board.c */
+#include "host_usb.h"
+#include "usbd_conf.h"
+#include "usbd_log.h"
+#include "clock_gov.h"
+#include <pthread.h>
+#include <sched.h>
+
+/* Board state the target keeps in main.c and clock_gov.c; the LL state
+   of each port lives in its instance */
+DWT_Type Host_DWT;
+CoreDebug_Type Host_CoreDebug;
+uint32_t SystemCoreClock = 168000000U;
+
+ClockGov_StatsTypeDef ClockGov_Stats;
+
+__IO uint32_t Host_Tick;
+/* Per host thread, so instances on different threads do not bounce one
+   counter between cores on every transfer */
+__thread uint32_t Host_Activity;
+
+/* Stands in for the linker symbol of HID.sct. Format IDs are offsets from
+   here within .usbd_logfmt, in whatever order the host linker put the
+   strings; decode them as signed 16-bit. */
+const char Image$$ER_LOGFMT$$Base[] USBD_LOG_FMT_SECTION = "";
+
+uint32_t HAL_GetTick(void)
+{
+    return Host_Tick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    __atomic_add_fetch(&Host_Tick, Delay, __ATOMIC_SEQ_CST);
+}
+
+void ClockGov_Activity(void)
+{
+    Host_Activity++;
+}
+
+/* ---- PRIMASK: one lock per device instance, held while masked ----
+
+   Masking keeps the interrupt of the instance being served from running,
+   and on the target that interrupt touches only its own instance. So a
+   thread masks with the lock of the instance it has selected, and threads
+   serving different instances never wait for each other. With nothing
+   selected (test set-up, board code) the board lock stands in. */
+
+static pthread_mutex_t Host_BoardLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread Host_DeviceTypeDef *Host_Current;
+static __thread pthread_mutex_t *Host_Held;
+static __thread uint32_t Host_Primask;
+static __thread uint32_t Host_Contended;
+
+/**
+  * @brief  Make `hd` the instance whose interrupt this thread stands for.
+  * @retval The one selected before, to hand back when done
+  */
+Host_DeviceTypeDef *Host_Select(Host_DeviceTypeDef *hd)
+{
+    Host_DeviceTypeDef *prev = Host_Current;
+
+    Host_Current = hd;
+    return prev;
+}
+
+/* Masks on this thread that found the lock taken by another one */
+uint32_t Host_MaskContended(void)
+{
+    return Host_Contended;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return Host_Primask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+    if ((primask != 0U) && (Host_Primask == 0U))
+    {
+        /* Unmasking releases this one even if the selection moves meanwhile */
+        Host_Held = (Host_Current != NULL) ? &Host_Current->irq_lock : &Host_BoardLock;
+        if (pthread_mutex_trylock(Host_Held) != 0)
+        {
+            Host_Contended++;
+            pthread_mutex_lock(Host_Held);
+        }
+    }
+    else if ((primask == 0U) && (Host_Primask != 0U))
+    {
+        pthread_mutex_unlock(Host_Held);
+    }
+    Host_Primask = primask & 1U;
+}
+
+void __disable_irq(void)
+{
+    __set_PRIMASK(1U);
+}
+
+void __enable_irq(void)
+{
+    __set_PRIMASK(0U);
+}
+
+/* ---- LDREX/STREX: the reservation is the address and the value read ---- */
+
+static __thread __IO uint32_t *Host_ExclAddr;
+static __thread uint32_t Host_ExclValue;
+
+uint32_t __LDREXW(__IO uint32_t *addr)
+{
+    Host_ExclAddr = addr;
+    Host_ExclValue = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+    return Host_ExclValue;
+}
+
+uint32_t __STREXW(uint32_t value, __IO uint32_t *addr)
+{
+    uint32_t expected = Host_ExclValue;
+    uint8_t ok = 0U;
+
+    if (Host_ExclAddr == addr)
+    {
+        ok = __atomic_compare_exchange_n(addr, &expected, value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+    Host_ExclAddr = NULL;
+    if (ok == 0U)
+    {
+        /* Lost the race; let the owner of the word run */
+        sched_yield();
+    }
+    return ok ? 0U : 1U;
+}
+
+void __CLREX(void)
+{
+    Host_ExclAddr = NULL;
+}
@@ -0,0 +1,627 @@
+/* Src/host_otg.c */
+#include "host_otg.h"
+#include "usbd_ll_fs.h"
+#include "usbd_def.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* The OTG_FS handle of usbd_conf.c */
+extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
+
+#define OTG                 USB_OTG_FS
+#define USBx_BASE           USB_OTG_FS_PERIPH_BASE
+#define OTG_NUM_EP          USBD_FS_DEV_ENDPOINTS
+#define OTG_MAP_SIZE        0x2000UL     /* globals, device, endpoints, PCGCCTL */
+#define OTG_TX_WORDS        0x100U       /* deepest TX FIFO the model holds */
+#define OTG_SETTLE_PASSES   8U
+
+/* GRXSTSP packet status */
+#define OTG_STS_OUT_DATA    2U
+#define OTG_STS_OUT_DONE    3U
+#define OTG_STS_SETUP_DONE  4U
+#define OTG_STS_SETUP_DATA  6U
+
+typedef struct
+{
+    uint32_t words[OTG_TX_WORDS];
+    uint16_t head;
+    uint16_t count;                  /* words queued */
+    uint16_t depth;                  /* words, from the FIFO plan */
+    /* Free words and DIEPTSIZ when TXFE was last served: TXFE is a level,
+       and the driver only hears it again once either has moved */
+    uint32_t txfe_free;
+    uint32_t txfe_tsiz;
+} Otg_TxFifoTypeDef;
+
+/* The GRXSTSP entry being served and its data words */
+typedef struct
+{
+    uint32_t words[16];
+    uint8_t  n;
+    uint8_t  pos;
+} Otg_RxEntryTypeDef;
+
+Host_Otg_StatsTypeDef Host_Otg_Stats;
+
+const char *const Host_Otg_EventNames[HOST_OTG_NUM_EVENTS] =
+{
+    "rx", "setup", "out", "in", "txfe", "sof", "reset", "enum"
+};
+
+static Otg_TxFifoTypeDef TxFifo[OTG_NUM_EP];
+static Otg_RxEntryTypeDef RxEntry;
+/* Endpoint interrupt bits raised and not yet served */
+static uint32_t InPend[OTG_NUM_EP];
+static uint32_t OutPend[OTG_NUM_EP];
+/* The FIFO word the driver is reading or writing; a write lands in the
+   TX FIFO of SlotEp on the next FIFO access or when the handler returns */
+static uint32_t FifoSlot;
+static int8_t SlotEp = -1;
+
+static void Otg_Error(const char *fmt, ...)
+{
+    va_list ap;
+
+    Host_Otg_Stats.errors++;
+    printf("host_otg: ");
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+uint64_t Host_Otg_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint16_t Otg_TxDepth(uint8_t ep)
+{
+    return (uint16_t)(((ep == 0U) ? OTG->DIEPTXF0_HNPTXFSIZ : OTG->DIEPTXF[ep - 1U]) >> 16);
+}
+
+static void Otg_Commit(void)
+{
+    Otg_TxFifoTypeDef *f;
+
+    if (SlotEp >= 0)
+    {
+        f = &TxFifo[SlotEp];
+        f->words[(f->head + f->count) % OTG_TX_WORDS] = FifoSlot;
+        f->count++;
+        SlotEp = -1;
+    }
+}
+
+static void Otg_FlushTx(uint32_t num)
+{
+    Otg_TxFifoTypeDef *f;
+    uint8_t ep;
+
+    for (ep = 0U; ep < OTG_NUM_EP; ep++)
+    {
+        if ((num != 0x10U) && (num != ep))
+        {
+            continue;
+        }
+        f = &TxFifo[ep];
+        if (SlotEp == (int8_t)ep)
+        {
+            SlotEp = -1;
+        }
+        f->head = 0U;
+        f->count = 0U;
+        f->depth = Otg_TxDepth(ep);
+        if (f->depth > OTG_TX_WORDS)
+        {
+            Otg_Error("TX FIFO %u: %u words, the model holds %u", ep, f->depth, OTG_TX_WORDS);
+            f->depth = OTG_TX_WORDS;
+        }
+        f->txfe_free = 0xFFFFFFFFU;
+        USBx_INEP(ep)->DTXFSTS = f->depth;
+    }
+}
+
+/**
+  * @brief  The data FIFO window, USBx_DFIFO in the stubs. The driver reads
+  *         it only with RXFLVL masked, in the RX level handler, and
+  *         writes it otherwise, so the mask tells a pop from a push.
+  */
+__IO uint32_t *Host_Otg_Fifo(uint32_t base, uint32_t num)
+{
+    USB_OTG_INEndpointTypeDef *in;
+
+    Otg_Commit();
+    if ((base != USB_OTG_FS_PERIPH_BASE) || (num >= OTG_NUM_EP))
+    {
+        Otg_Error("FIFO %u of core 0x%08x", num, base);
+        return &FifoSlot;
+    }
+
+    if ((OTG->GINTMSK & USB_OTG_GINTMSK_RXFLVLM) == 0U)
+    {
+        if (RxEntry.pos >= RxEntry.n)
+        {
+            Otg_Error("RX FIFO read past the packet");
+            FifoSlot = 0U;
+        }
+        else
+        {
+            FifoSlot = RxEntry.words[RxEntry.pos++];
+        }
+        return &FifoSlot;
+    }
+
+    in = USBx_INEP(num);
+    if ((in->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) == 0U)
+    {
+        Otg_Error("TX FIFO %u written while full", num);
+        return &FifoSlot;
+    }
+    in->DTXFSTS--;
+    SlotEp = (int8_t)num;
+    return &FifoSlot;
+}
+
+/**
+  * @brief  A self-clearing GRSTCTL bit, as the stubs define them. Writing
+  *         the bit starts the operation; the poll that finds it set
+  *         carries it out and clears it.
+  * @retval The bit, for the expression it stands in
+  */
+uint32_t Host_Otg_Grstctl(uint32_t bit)
+{
+    uint32_t reg = OTG->GRSTCTL;
+
+    if ((reg & bit) != 0U)
+    {
+        if (bit == USB_OTG_GRSTCTL_TXFFLSH_Msk)
+        {
+            Otg_FlushTx((reg & USB_OTG_GRSTCTL_TXFNUM) >> USB_OTG_GRSTCTL_TXFNUM_Pos);
+        }
+        else if (bit == USB_OTG_GRSTCTL_RXFFLSH_Msk)
+        {
+            RxEntry.n = 0U;
+            RxEntry.pos = 0U;
+        }
+        else
+        {
+            Otg_FlushTx(0x10U);
+            RxEntry.n = 0U;
+            RxEntry.pos = 0U;
+            OTG->GINTSTS = 0U;
+        }
+        OTG->GRSTCTL = (reg & ~bit) | USB_OTG_GRSTCTL_AHBIDL;
+    }
+    return bit;
+}
+
+/* Refill due on `ep`: TXFE unmasked, the FIFO at least half empty, and
+   something moved since the driver last heard it */
+static uint8_t Otg_TxfeDue(uint8_t ep)
+{
+    Otg_TxFifoTypeDef *f = &TxFifo[ep];
+    uint32_t free = USBx_INEP(ep)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV;
+
+    return (((USBx_DEVICE->DIEPEMPMSK >> ep) & 1U) != 0U) && (f->depth != 0U) &&
+           (free >= (f->depth / 2U)) &&
+           ((free != f->txfe_free) || (USBx_INEP(ep)->DIEPTSIZ != f->txfe_tsiz));
+}
+
+/* Endpoint interrupt registers and DAINT from what is pending
+   @retval DAINT bits the handler will serve */
+static uint32_t Otg_Load(void)
+{
+    Otg_TxFifoTypeDef *f;
+    uint32_t daint = 0U;
+    uint32_t free;
+    uint8_t ep;
+
+    for (ep = 0U; ep < OTG_NUM_EP; ep++)
+    {
+        f = &TxFifo[ep];
+        free = USBx_INEP(ep)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV;
+
+        USBx_OUTEP(ep)->DOEPINT = OutPend[ep];
+        if ((OutPend[ep] & USBx_DEVICE->DOEPMSK) != 0U)
+        {
+            daint |= 1UL << (16U + ep);
+        }
+
+        USBx_INEP(ep)->DIEPINT = InPend[ep] |
+                                 (((f->depth != 0U) && (free >= (f->depth / 2U))) ? USB_OTG_DIEPINT_TXFE : 0U);
+        if (((InPend[ep] & USBx_DEVICE->DIEPMSK) != 0U) || (Otg_TxfeDue(ep) != 0U))
+        {
+            daint |= 1UL << ep;
+        }
+    }
+    USBx_DEVICE->DAINT = daint;
+    return daint & USBx_DEVICE->DAINTMSK;
+}
+
+/**
+  * @brief  Raise `gintsts` and run the handler once, if the core would
+  *         interrupt for it.
+  * @retval 1 if the handler ran
+  */
+static uint8_t Otg_Irq(uint32_t gintsts, uint8_t kind)
+{
+    uint64_t t0, t;
+
+    if (((OTG->GAHBCFG & USB_OTG_GAHBCFG_GINT) == 0U) || ((OTG->GINTMSK & gintsts) == 0U))
+    {
+        return 0U;
+    }
+
+    OTG->GINTSTS = gintsts;
+    t0 = Host_Otg_Cycles();
+    USBD_LLFS_IRQHandler(&hpcd_USB_OTG_FS);
+    t = Host_Otg_Cycles() - t0;
+    Otg_Commit();
+    /* Whatever the acknowledges wrote, the sources are served */
+    OTG->GINTSTS = 0U;
+
+    Host_Otg_Stats.irqs[kind]++;
+    Host_Otg_Stats.cycles[kind] += t;
+    if ((OTG->GINTMSK & USB_OTG_GINTMSK_RXFLVLM) == 0U)
+    {
+        Otg_Error("RXFLVL left masked");
+    }
+    return 1U;
+}
+
+/* Deliver pending endpoint interrupts until none is left */
+static void Otg_Settle(void)
+{
+    uint32_t daint, diepmsk, doepmsk, txfe, gintsts;
+    uint8_t pass, ep, in_done, out_done, setup;
+
+    for (pass = 0U; pass < OTG_SETTLE_PASSES; pass++)
+    {
+        daint = Otg_Load();
+        if (daint == 0U)
+        {
+            return;
+        }
+
+        diepmsk = USBx_DEVICE->DIEPMSK;
+        doepmsk = USBx_DEVICE->DOEPMSK;
+        gintsts = 0U;
+        txfe = 0U;
+        in_done = 0U;
+        out_done = 0U;
+        setup = 0U;
+        for (ep = 0U; ep < OTG_NUM_EP; ep++)
+        {
+            if (((daint >> ep) & 1U) == 0U)
+            {
+                continue;
+            }
+            gintsts |= USB_OTG_GINTSTS_IEPINT;
+            in_done |= ((InPend[ep] & diepmsk & USB_OTG_DIEPINT_XFRC) != 0U) ? 1U : 0U;
+            if (((USBx_INEP(ep)->DIEPINT & USB_OTG_DIEPINT_TXFE) != 0U) &&
+                (((USBx_DEVICE->DIEPEMPMSK >> ep) & 1U) != 0U))
+            {
+                txfe |= 1UL << ep;
+            }
+        }
+        for (ep = 0U; ep < OTG_NUM_EP; ep++)
+        {
+            if (((daint >> (16U + ep)) & 1U) == 0U)
+            {
+                continue;
+            }
+            gintsts |= USB_OTG_GINTSTS_OEPINT;
+            out_done = 1U;
+            setup |= ((OutPend[ep] & doepmsk & USB_OTG_DOEPINT_STUP) != 0U) ? 1U : 0U;
+        }
+
+        /* One call serves everything pending; it counts as the most
+           significant event among them */
+        if (Otg_Irq(gintsts, (setup != 0U) ? HOST_OTG_EV_SETUP : (out_done != 0U) ? HOST_OTG_EV_OUT :
+                             (in_done != 0U) ? HOST_OTG_EV_IN : HOST_OTG_EV_TXFE) == 0U)
+        {
+            /* Masked: stays pending */
+            return;
+        }
+
+        for (ep = 0U; ep < OTG_NUM_EP; ep++)
+        {
+            if (((daint >> ep) & 1U) != 0U)
+            {
+                InPend[ep] &= ~diepmsk;
+            }
+            if (((daint >> (16U + ep)) & 1U) != 0U)
+            {
+                OutPend[ep] &= ~doepmsk;
+            }
+            if (((txfe >> ep) & 1U) != 0U)
+            {
+                TxFifo[ep].txfe_free = USBx_INEP(ep)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV;
+                TxFifo[ep].txfe_tsiz = USBx_INEP(ep)->DIEPTSIZ;
+            }
+        }
+    }
+    (void)Otg_Load();
+    Otg_Error("endpoint interrupts still pending after %u handler calls", OTG_SETTLE_PASSES);
+}
+
+/* Queue one GRXSTSP entry and serve it; the driver must take every word */
+static void Otg_Rx(uint8_t ep, uint32_t pktsts, const uint8_t *data, uint32_t len)
+{
+    memset(RxEntry.words, 0, sizeof(RxEntry.words));
+    if (len != 0U)
+    {
+        memcpy(RxEntry.words, data, len);
+    }
+    RxEntry.n = (uint8_t)((len + 3U) / 4U);
+    RxEntry.pos = 0U;
+    OTG->GRXSTSP = ep | (len << USB_OTG_GRXSTSP_BCNT_Pos) | (pktsts << USB_OTG_GRXSTSP_PKTSTS_Pos);
+
+    if (Otg_Irq(USB_OTG_GINTSTS_RXFLVL, HOST_OTG_EV_RX) == 0U)
+    {
+        Otg_Error("RXFLVL masked with a packet on EP%u", ep);
+    }
+    else if (RxEntry.pos != RxEntry.n)
+    {
+        Otg_Error("EP%u: %u of %u RX words left in the FIFO", ep, RxEntry.n - RxEntry.pos, RxEntry.n);
+    }
+    RxEntry.n = 0U;
+    RxEntry.pos = 0U;
+}
+
+/**
+  * @brief  Map the register block and bring it to its reset state.
+  * @retval USBD_OK, USBD_FAIL if the address is taken
+  */
+uint8_t Host_Otg_Map(void)
+{
+    void *want = (void *)(uintptr_t)USB_OTG_FS_PERIPH_BASE;
+    void *got;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    got = mmap(want, OTG_MAP_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (got != want)
+    {
+        if (got != MAP_FAILED)
+        {
+            (void)munmap(got, OTG_MAP_SIZE);
+        }
+        printf("host_otg: cannot map the OTG_FS block at %p\n", want);
+        return USBD_FAIL;
+    }
+
+    OTG->GRSTCTL = USB_OTG_GRSTCTL_AHBIDL;
+    memset(&Host_Otg_Stats, 0, sizeof(Host_Otg_Stats));
+    memset(TxFifo, 0, sizeof(TxFifo));
+    memset(InPend, 0, sizeof(InPend));
+    memset(OutPend, 0, sizeof(OutPend));
+    SlotEp = -1;
+    return USBD_OK;
+}
+
+/* USB reset, then enumeration done at full speed */
+void Host_Otg_BusReset(void)
+{
+    Otg_Settle();
+    if ((USBx_DEVICE->DCTL & USB_OTG_DCTL_SDIS) != 0U)
+    {
+        Otg_Error("bus reset while soft-disconnected");
+    }
+    memset(InPend, 0, sizeof(InPend));
+    memset(OutPend, 0, sizeof(OutPend));
+    (void)Otg_Irq(USB_OTG_GINTSTS_USBRST, HOST_OTG_EV_RESET);
+    USBx_DEVICE->DSTS = (USBx_DEVICE->DSTS & ~USB_OTG_DSTS_ENUMSPD) | USB_OTG_DSTS_ENUMSPD;
+    (void)Otg_Irq(USB_OTG_GINTSTS_ENUMDNE, HOST_OTG_EV_ENUM);
+    Otg_Settle();
+}
+
+/* Start of the next frame, 11-bit frame number in DSTS */
+void Host_Otg_SOF(void)
+{
+    uint32_t fn;
+
+    Otg_Settle();
+    fn = (((USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> USB_OTG_DSTS_FNSOF_Pos) + 1U) & 0x7FFU;
+    USBx_DEVICE->DSTS = (USBx_DEVICE->DSTS & ~USB_OTG_DSTS_FNSOF) | (fn << USB_OTG_DSTS_FNSOF_Pos);
+    (void)Otg_Irq(USB_OTG_GINTSTS_SOF, HOST_OTG_EV_SOF);
+    Otg_Settle();
+}
+
+/* SETUP on EP0: the data entry, the done entry, then STUP */
+void Host_Otg_Setup(const uint8_t *setup)
+{
+    Otg_Settle();
+    /* A SETUP is always taken and ends a STALL on EP0 */
+    USBx_INEP(0U)->DIEPCTL &= ~USB_OTG_DIEPCTL_STALL;
+    USBx_OUTEP(0U)->DOEPCTL &= ~USB_OTG_DOEPCTL_STALL;
+    Otg_Rx(0U, OTG_STS_SETUP_DATA, setup, 8U);
+    Otg_Rx(0U, OTG_STS_SETUP_DONE, NULL, 0U);
+    OutPend[0] |= USB_OTG_DOEPINT_STUP;
+    Otg_Settle();
+}
+
+/**
+  * @brief  The host sends an IN token to `ep` and takes one packet from
+  *         its TX FIFO into `data` (up to the max packet size).
+  * @retval Bytes taken, HOST_OTG_NAK or HOST_OTG_STALL
+  */
+int32_t Host_Otg_In(uint8_t ep, uint8_t *data)
+{
+    USB_OTG_INEndpointTypeDef *in = USBx_INEP(ep);
+    Otg_TxFifoTypeDef *f = &TxFifo[ep];
+    uint32_t tsiz, pktcnt, xfrsiz, mps, len, words, w, i;
+
+    Otg_Settle();
+    if ((in->DIEPCTL & USB_OTG_DIEPCTL_STALL) != 0U)
+    {
+        return HOST_OTG_STALL;
+    }
+    if ((in->DIEPCTL & USB_OTG_DIEPCTL_EPENA) == 0U)
+    {
+        return HOST_OTG_NAK;
+    }
+
+    tsiz = in->DIEPTSIZ;
+    pktcnt = (tsiz & USB_OTG_DIEPTSIZ_PKTCNT) >> USB_OTG_DIEPTSIZ_PKTCNT_Pos;
+    xfrsiz = tsiz & USB_OTG_DIEPTSIZ_XFRSIZ;
+    /* EP0 MPSIZ 0 is 64 bytes */
+    mps = (ep == 0U) ? USB_MAX_EP0_SIZE : (in->DIEPCTL & USB_OTG_DIEPCTL_MPSIZ);
+    len = MIN(xfrsiz, mps);
+    words = (len + 3U) / 4U;
+    if ((pktcnt == 0U) || (f->count < words))
+    {
+        /* The packet is not in the FIFO yet */
+        return HOST_OTG_NAK;
+    }
+
+    for (i = 0U; i < words; i++)
+    {
+        w = f->words[f->head];
+        f->head = (uint16_t)((f->head + 1U) % OTG_TX_WORDS);
+        f->count--;
+        memcpy(&data[4U * i], &w, MIN(4U, len - (4U * i)));
+    }
+    in->DTXFSTS += words;
+
+    pktcnt--;
+    in->DIEPTSIZ = (pktcnt << USB_OTG_DIEPTSIZ_PKTCNT_Pos) | (xfrsiz - len);
+    if (pktcnt == 0U)
+    {
+        in->DIEPCTL &= ~USB_OTG_DIEPCTL_EPENA;
+        InPend[ep] |= USB_OTG_DIEPINT_XFRC;
+    }
+    Otg_Settle();
+    return (int32_t)len;
+}
+
+/**
+  * @brief  The host sends one OUT packet of `len` bytes to `ep`. A short
+  *         packet or the last one armed completes the transfer.
+  * @retval Bytes sent, HOST_OTG_NAK or HOST_OTG_STALL
+  */
+int32_t Host_Otg_Out(uint8_t ep, const uint8_t *data, uint32_t len)
+{
+    USB_OTG_OUTEndpointTypeDef *out = USBx_OUTEP(ep);
+    uint32_t tsiz, pktcnt, xfrsiz, mps;
+
+    Otg_Settle();
+    if ((out->DOEPCTL & USB_OTG_DOEPCTL_STALL) != 0U)
+    {
+        return HOST_OTG_STALL;
+    }
+    if ((out->DOEPCTL & USB_OTG_DOEPCTL_EPENA) == 0U)
+    {
+        return HOST_OTG_NAK;
+    }
+
+    tsiz = out->DOEPTSIZ;
+    pktcnt = (tsiz & USB_OTG_DOEPTSIZ_PKTCNT) >> USB_OTG_DOEPTSIZ_PKTCNT_Pos;
+    xfrsiz = tsiz & USB_OTG_DOEPTSIZ_XFRSIZ;
+    mps = (ep == 0U) ? USB_MAX_EP0_SIZE : (out->DOEPCTL & USB_OTG_DOEPCTL_MPSIZ);
+    if ((pktcnt == 0U) || (len > mps))
+    {
+        Otg_Error("EP%u: OUT packet of %u bytes, %u packets of %u armed", ep, len, pktcnt, mps);
+        return HOST_OTG_NAK;
+    }
+
+    Otg_Rx(ep, OTG_STS_OUT_DATA, data, len);
+    pktcnt--;
+    xfrsiz -= MIN(len, xfrsiz);
+    out->DOEPTSIZ = (tsiz & USB_OTG_DOEPTSIZ_STUPCNT) | (pktcnt << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | xfrsiz;
+    if ((pktcnt == 0U) || (len < mps))
+    {
+        Otg_Rx(ep, OTG_STS_OUT_DONE, NULL, 0U);
+        out->DOEPCTL &= ~USB_OTG_DOEPCTL_EPENA;
+        OutPend[ep] |= USB_OTG_DOEPINT_XFRC;
+    }
+    Otg_Settle();
+    return (int32_t)len;
+}
+
+/**
+  * @brief  One control transfer on EP0: setup, data stage in 64-byte
+  *         packets, status stage.
+  * @retval Bytes moved in the data stage, -1 if the device stalled or
+  *         NAKed a stage
+  */
+int32_t Host_Otg_Control(uint8_t bmRequest, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                         uint16_t wLength, uint8_t *data)
+{
+    uint8_t setup[8] = { bmRequest, bRequest, LOBYTE(wValue), HIBYTE(wValue),
+                         LOBYTE(wIndex), HIBYTE(wIndex), LOBYTE(wLength), HIBYTE(wLength) };
+    uint8_t packet[USB_MAX_EP0_SIZE];
+    uint32_t done = 0U;
+    int32_t n;
+
+    Host_Otg_Setup(setup);
+
+    if (((bmRequest & 0x80U) != 0U) && (wLength != 0U))
+    {
+        do
+        {
+            n = Host_Otg_In(0U, packet);
+            if (n < 0)
+            {
+                return -1;
+            }
+            memcpy(&data[done], packet, MIN((uint32_t)n, wLength - done));
+            done += MIN((uint32_t)n, wLength - done);
+        } while ((n == USB_MAX_EP0_SIZE) && (done < wLength));
+
+        return (Host_Otg_Out(0U, NULL, 0U) == 0) ? (int32_t)done : -1;
+    }
+
+    while (done < wLength)
+    {
+        n = Host_Otg_Out(0U, &data[done], MIN(wLength - done, USB_MAX_EP0_SIZE));
+        if (n < 0)
+        {
+            return -1;
+        }
+        done += (uint32_t)n;
+    }
+    return (Host_Otg_In(0U, packet) == 0) ? (int32_t)done : -1;
+}
+
+/**
+  * @brief  What a host does after reset: device descriptor, address,
+  *         configuration descriptor (header, then all of it), configure.
+  * @retval USBD_OK if every request went through and the address is set
+  */
+uint8_t Host_Otg_Enumerate(void)
+{
+    uint8_t buf[256];
+    uint16_t total;
+
+    if ((Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_DEVICE << 8, 0U, 64U, buf) != USB_LEN_DEV_DESC) ||
+        (Host_Otg_Control(0x00U, USB_REQ_SET_ADDRESS, HOST_OTG_DEV_ADDRESS, 0U, 0U, NULL) != 0) ||
+        (Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U, 9U, buf) != 9))
+    {
+        return USBD_FAIL;
+    }
+
+    total = (uint16_t)(buf[2] | (buf[3] << 8));
+    if ((total > sizeof(buf)) ||
+        (Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U, total, buf) != total) ||
+        (Host_Otg_Control(0x00U, USB_REQ_SET_CONFIGURATION, buf[5], 0U, 0U, NULL) != 0))
+    {
+        return USBD_FAIL;
+    }
+
+    return (((USBx_DEVICE->DCFG & USB_OTG_DCFG_DAD) >> USB_OTG_DCFG_DAD_Pos) == HOST_OTG_DEV_ADDRESS) ?
+           USBD_OK : USBD_FAIL;
+}
@@ -0,0 +1,422 @@
+/* Src/host_usb.c */
+#include "host_usb.h"
+#include "usbd_core.h"
+#include "usbd_desc.h"
+#include <string.h>
+
+#define HOST_DEV(pdev)      ((Host_DeviceTypeDef *)(pdev)->pData)
+#define HOST_EP_IN(ep)      (((ep) & 0x80U) != 0U)
+
+static Host_EPTypeDef *Host_EP(Host_DeviceTypeDef *hd, uint8_t ep_addr, uint8_t in)
+{
+    uint8_t n = ep_addr & 0x0FU;
+
+    if (n >= HOST_EP_NUM)
+    {
+        hd->ll_errors++;
+        n = 0U;
+    }
+    return in ? &hd->in[n] : &hd->out[n];
+}
+
+/* ---- Device end: the LL layer usbd_conf.c provides on the target ---- */
+
+USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
+{
+    UNUSED(pdev);
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev)
+{
+    UNUSED(pdev);
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Start(USBD_HandleTypeDef *pdev)
+{
+    HOST_DEV(pdev)->started = 1U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Stop(USBD_HandleTypeDef *pdev)
+{
+    HOST_DEV(pdev)->started = 0U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t ep_type, uint16_t ep_mps)
+{
+    Host_EPTypeDef *ep = Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr));
+
+    UNUSED(ep_type);
+    UNUSED(ep_mps);
+    ep->open = 1U;
+    ep->armed = 0U;
+    ep->stalled = 0U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    Host_EPTypeDef *ep = Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr));
+
+    ep->open = 0U;
+    ep->armed = 0U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr))->armed = 0U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr))->stalled = 1U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr))->stalled = 0U;
+    return USBD_OK;
+}
+
+uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    return Host_EP(HOST_DEV(pdev), ep_addr, HOST_EP_IN(ep_addr))->stalled;
+}
+
+USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr)
+{
+    HOST_DEV(pdev)->address = dev_addr;
+    return USBD_OK;
+}
+
+/* The core passes EP0 as 0x00 in both directions; Transmit is always IN */
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+{
+    Host_DeviceTypeDef *hd = HOST_DEV(pdev);
+    Host_EPTypeDef *ep = Host_EP(hd, ep_addr, 1U);
+
+    if ((ep->armed != 0U) || (((ep_addr & 0x0FU) != 0U) && (ep->open == 0U)) ||
+        ((hd->dma != 0U) && (((uintptr_t)pbuf & 3U) != 0U)))
+    {
+        hd->ll_errors++;
+    }
+    ep->buf = pbuf;
+    ep->len = size;
+    ep->armed = 1U;
+    ep->stalled = 0U;
+    return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+{
+    Host_DeviceTypeDef *hd = HOST_DEV(pdev);
+    Host_EPTypeDef *ep = Host_EP(hd, ep_addr, 0U);
+
+    if ((((ep_addr & 0x0FU) != 0U) && (ep->open == 0U)) ||
+        ((hd->dma != 0U) && (((uintptr_t)pbuf & 3U) != 0U)))
+    {
+        hd->ll_errors++;
+    }
+    ep->buf = pbuf;
+    ep->len = size;
+    ep->count = 0U;
+    ep->armed = 1U;
+    return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+    return Host_EP(HOST_DEV(pdev), ep_addr, 0U)->count;
+}
+
+uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev)
+{
+    return HOST_DEV(pdev)->frame;
+}
+
+uint8_t USBD_LL_IsDMA(USBD_HandleTypeDef *pdev)
+{
+    return HOST_DEV(pdev)->dma;
+}
+
+void USBD_LL_Delay(uint32_t Delay)
+{
+    HAL_Delay(Delay);
+}
+
+/* ---- Host end ---- */
+
+/**
+  * @brief  Bring up one device instance as MX_USB_DEVICE_Init does, then
+  *         attach it and reset the bus. `hd` is cleared first.
+  */
+uint8_t Host_Attach(Host_DeviceTypeDef *hd, uint8_t id, uint8_t personality)
+{
+    Host_DeviceTypeDef *prev;
+    uint8_t ret = USBD_FAIL;
+
+    memset(hd, 0, sizeof(*hd));
+    hd->dev.pData = hd;
+    pthread_mutex_init(&hd->irq_lock, NULL);
+
+    prev = Host_Select(hd);
+    if (USBD_Init(&hd->dev, &FS_Desc, id) == USBD_OK)
+    {
+        USBD_Composite_RegisterContext(&hd->dev, &hd->ctx);
+        if ((USBD_Composite_SelectPersonality(&hd->dev, personality) == USBD_OK) &&
+            (USBD_RegisterClass(&hd->dev, &USBD_Composite) == USBD_OK) &&
+            (USBD_Start(&hd->dev) == USBD_OK))
+        {
+            Host_BusReset(hd);
+            ret = USBD_OK;
+        }
+    }
+    (void)Host_Select(prev);
+    return ret;
+}
+
+void Host_BusReset(Host_DeviceTypeDef *hd)
+{
+    Host_DeviceTypeDef *prev = Host_Select(hd);
+
+    (void)USBD_LL_SetSpeed(&hd->dev, USBD_SPEED_FULL);
+    (void)USBD_LL_Reset(&hd->dev);
+    (void)Host_Select(prev);
+}
+
+/* Host_Control, with the instance already selected */
+static int32_t Host_ControlXfer(Host_DeviceTypeDef *hd, uint8_t bmRequest, uint8_t bRequest,
+                                uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
+{
+    uint8_t setup[8] = { bmRequest, bRequest, LOBYTE(wValue), HIBYTE(wValue),
+                         LOBYTE(wIndex), HIBYTE(wIndex), LOBYTE(wLength), HIBYTE(wLength) };
+    Host_EPTypeDef *in0 = &hd->in[0];
+    Host_EPTypeDef *out0 = &hd->out[0];
+    uint32_t done = 0U;
+    uint32_t n;
+
+    in0->armed = 0U;
+    in0->stalled = 0U;
+    out0->armed = 0U;
+    out0->stalled = 0U;
+    (void)USBD_LL_SetupStage(&hd->dev, setup);
+
+    if (((bmRequest & 0x80U) != 0U) && (wLength != 0U))
+    {
+        if (in0->armed == 0U)
+        {
+            return -1;
+        }
+        /* The core re-arms EP0 IN after each packet until the data stage
+           is over, a ZLP included */
+        while (in0->armed != 0U)
+        {
+            n = MIN(MIN(in0->len, USB_MAX_EP0_SIZE), wLength - done);
+            if (n != 0U)
+            {
+                memcpy(&data[done], in0->buf, n);
+            }
+            done += n;
+            in0->armed = 0U;
+            (void)USBD_LL_DataInStage(&hd->dev, 0U, (in0->buf != NULL) ? &in0->buf[n] : NULL);
+        }
+        if (out0->armed != 0U)
+        {
+            out0->armed = 0U;
+            (void)USBD_LL_DataOutStage(&hd->dev, 0U, NULL);
+        }
+        return (int32_t)done;
+    }
+
+    while ((done < wLength) && (out0->armed != 0U))
+    {
+        n = MIN(MIN(wLength - done, USB_MAX_EP0_SIZE), out0->len);
+        memcpy(out0->buf, &data[done], n);
+        done += n;
+        out0->count = n;
+        out0->armed = 0U;
+        (void)USBD_LL_DataOutStage(&hd->dev, 0U, &out0->buf[n]);
+    }
+
+    /* Status stage: the device answers with a ZLP, or stalls */
+    if ((in0->armed == 0U) || (in0->len != 0U) || (done != wLength))
+    {
+        return -1;
+    }
+    in0->armed = 0U;
+    (void)USBD_LL_DataInStage(&hd->dev, 0U, NULL);
+    return (int32_t)done;
+}
+
+/**
+  * @brief  One control transfer on EP0: setup, data stage in 64-byte
+  *         packets, status stage.
+  * @retval Bytes moved in the data stage, -1 if the device stalled the
+  *         request or never answered it
+  */
+int32_t Host_Control(Host_DeviceTypeDef *hd, uint8_t bmRequest, uint8_t bRequest,
+                     uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
+{
+    Host_DeviceTypeDef *prev = Host_Select(hd);
+    int32_t ret = Host_ControlXfer(hd, bmRequest, bRequest, wValue, wIndex, wLength, data);
+
+    (void)Host_Select(prev);
+    return ret;
+}
+
+/**
+  * @brief  What a host does after reset: device descriptor, address,
+  *         configuration descriptor (header, then all of it), configure.
+  * @retval USBD_OK if the device ended up configured
+  */
+uint8_t Host_Enumerate(Host_DeviceTypeDef *hd)
+{
+    uint8_t buf[256];
+    uint16_t total;
+
+    if ((Host_Control(hd, 0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_DEVICE << 8, 0U, 64U, buf) != USB_LEN_DEV_DESC) ||
+        (Host_Control(hd, 0x00U, USB_REQ_SET_ADDRESS, HOST_DEV_ADDRESS, 0U, 0U, NULL) != 0) ||
+        (Host_Control(hd, 0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U, 9U, buf) != 9))
+    {
+        return USBD_FAIL;
+    }
+
+    total = (uint16_t)(buf[2] | (buf[3] << 8));
+    if ((total > sizeof(buf)) ||
+        (Host_Control(hd, 0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U, total, buf) != total) ||
+        (Host_Control(hd, 0x00U, USB_REQ_SET_CONFIGURATION, buf[5], 0U, 0U, NULL) != 0))
+    {
+        return USBD_FAIL;
+    }
+
+    return (hd->dev.dev_state == USBD_STATE_CONFIGURED) ? USBD_OK : USBD_FAIL;
+}
+
+/* Start of the next frame, 11-bit frame number */
+void Host_SOF(Host_DeviceTypeDef *hd)
+{
+    Host_DeviceTypeDef *prev = Host_Select(hd);
+
+    hd->frame = (hd->frame + 1U) & 0x7FFU;
+    (void)USBD_LL_SOF(&hd->dev);
+    (void)Host_Select(prev);
+}
+
+/**
+  * @brief  The host polls `ep_addr` and takes the whole armed transfer.
+  * @retval Bytes taken, -1 if nothing was armed (NAK)
+  */
+int32_t Host_PollIn(Host_DeviceTypeDef *hd, uint8_t ep_addr)
+{
+    Host_EPTypeDef *ep = Host_EP(hd, ep_addr, 1U);
+    Host_DeviceTypeDef *prev;
+    uint32_t len;
+
+    if ((ep->armed == 0U) || (ep->stalled != 0U))
+    {
+        return -1;
+    }
+
+    len = ep->len;
+    ep->armed = 0U;
+    if (hd->on_in != NULL)
+    {
+        hd->on_in(hd, ep_addr | 0x80U, ep->buf, len);
+    }
+    prev = Host_Select(hd);
+    (void)USBD_LL_DataInStage(&hd->dev, ep_addr & 0x0FU, &ep->buf[len]);
+    (void)Host_Select(prev);
+    return (int32_t)len;
+}
+
+/* One frame: SOF, then one poll of every data IN endpoint */
+void Host_Frame(Host_DeviceTypeDef *hd)
+{
+    uint8_t n;
+
+    Host_SOF(hd);
+    for (n = 1U; n < HOST_EP_NUM; n++)
+    {
+        (void)Host_PollIn(hd, 0x80U | n);
+    }
+}
+
+/**
+  * @brief  Send one OUT packet on `ep_addr`.
+  * @retval Bytes delivered, -1 if the endpoint was not ready (NAK)
+  */
+int32_t Host_Out(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    Host_EPTypeDef *ep = Host_EP(hd, ep_addr, 0U);
+    Host_DeviceTypeDef *prev;
+
+    if ((ep->armed == 0U) || (ep->stalled != 0U) || (len > ep->len))
+    {
+        return -1;
+    }
+
+    memcpy(ep->buf, data, len);
+    ep->count = len;
+    ep->armed = 0U;
+    prev = Host_Select(hd);
+    (void)USBD_LL_DataOutStage(&hd->dev, ep_addr & 0x0FU, &ep->buf[len]);
+    (void)Host_Select(prev);
+    return (int32_t)len;
+}
+
+/* Vendor OUT report on 0x02: [0] report ID, [1] command, [2..8] arguments */
+int32_t Host_VendorCommand(Host_DeviceTypeDef *hd, uint8_t cmd, const uint8_t *args, uint8_t len)
+{
+    uint8_t report[CUSTOM_HID_EPOUT_SIZE] = { CUSTOM_HID_REPORT_ID_VENDOR, cmd };
+
+    if (len > (sizeof(report) - 2U))
+    {
+        return -1;
+    }
+    if (len != 0U)
+    {
+        memcpy(&report[2], args, len);
+    }
+    return Host_Out(hd, CUSTOM_HID_EPOUT_ADDR, report, sizeof(report));
+}
+
+/* ---- Streams ---- */
+
+void Host_StreamReset(Host_StreamTypeDef *hs, uint8_t seed)
+{
+    hs->len = 0U;
+    hs->seed = seed;
+}
+
+/**
+  * @brief  Write the next `len` bytes of the stream through `write` and
+  *         record what the device took. Refused bytes are not part of the
+  *         stream: the next write starts with them again.
+  * @retval Bytes the device took
+  */
+uint16_t Host_StreamWrite(Host_DeviceTypeDef *hd, Host_StreamTypeDef *hs, Host_WriteFn write, uint16_t len)
+{
+    Host_DeviceTypeDef *prev;
+    uint8_t *buf = &hs->data[hs->len];
+    uint16_t i, n;
+
+    len = (uint16_t)MIN(len, HOST_STREAM_MAX - hs->len);
+    for (i = 0U; i < len; i++)
+    {
+        buf[i] = (uint8_t)(hs->seed + i);
+    }
+
+    prev = Host_Select(hd);
+    n = write(&hd->dev, buf, len);
+    (void)Host_Select(prev);
+
+    hs->len += n;
+    hs->seed = (uint8_t)(hs->seed + n);
+    return n;
+}
@@ -0,0 +1,11 @@
+/* Src/test.c */
+#include "test.h"
+
+unsigned Test_Checks;
+unsigned Test_Failures;
+
+int Test_Report(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, Test_Checks, Test_Failures);
+    return (Test_Failures == 0U) ? 0 : 1;
+}
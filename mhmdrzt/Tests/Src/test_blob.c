@@ -0,0 +1,175 @@
+/* Src/test_blob.c */
+#include "host_usb.h"
+#include "usbd_vendor_req.h"
+#include "test.h"
+#include <string.h>
+#include <time.h>
+
+/* Blob upload (usbd_vendor_req.h) through the core's EP0 data phase: every
+   byte reaches the consumer once, at its offset, with the last piece
+   flagged, at sizes around the packet size and at USBD_VREQ_BLOB_MAX.
+   Streaming hands over one packet per call through the streamed branch of
+   USBD_LL_DataOutStage; built with USBD_VREQ_BLOB_STAGING 1 (see the
+   Makefile) the same checks run against one call per blob. Both builds
+   print the RAM they hold for the data phase and the host time per blob,
+   to compare the two. */
+
+#define TIMED_BLOBS     256U
+
+static Host_DeviceTypeDef Dev;
+static uint8_t Got[USBD_VREQ_BLOB_MAX];
+static uint32_t GotLen;
+static uint32_t Calls;
+static uint32_t Lasts;
+static uint32_t MaxPiece;
+static uint32_t Misplaced;       /* pieces not at the next offset, or of another blob */
+static uint16_t Id;
+
+void USBD_VReq_BlobCallback(uint16_t id, uint32_t offset, const uint8_t *data, uint32_t len, uint8_t last)
+{
+    Calls++;
+    Lasts += last;
+    MaxPiece = MAX(MaxPiece, len);
+    if ((id != Id) || (offset != GotLen) || ((offset + len) > sizeof(Got)))
+    {
+        Misplaced++;
+        return;
+    }
+    memcpy(&Got[offset], data, len);
+    GotLen += len;
+}
+
+static void Consumer_Reset(uint16_t id)
+{
+    Id = id;
+    GotLen = 0U;
+    Calls = 0U;
+    Lasts = 0U;
+    MaxPiece = 0U;
+    Misplaced = 0U;
+}
+
+static void Blob_Fill(uint8_t *data, uint16_t len, uint8_t seed)
+{
+    uint16_t i;
+
+    for (i = 0U; i < len; i++)
+    {
+        data[i] = (uint8_t)(seed + (i * 13U) + (i >> 8));
+    }
+}
+
+static USBD_VReq_BlobStatsTypeDef Blob_Stats(void)
+{
+    USBD_VReq_BlobStatsTypeDef stats;
+
+    memset(&stats, 0, sizeof(stats));
+    CHECK_EQ(Host_Control(&Dev, 0xC0U, USBD_VREQ_BLOB_STATS, 0U, 0U, sizeof(stats), (uint8_t *)&stats),
+             sizeof(stats));
+    return stats;
+}
+
+static void Upload(uint16_t len)
+{
+    uint8_t data[USBD_VREQ_BLOB_MAX];
+    USBD_VReq_BlobStatsTypeDef before = Blob_Stats();
+    USBD_VReq_BlobStatsTypeDef after;
+
+    Blob_Fill(data, len, (uint8_t)len);
+    Consumer_Reset(len);
+    CHECK_EQ(Host_Control(&Dev, 0x40U, USBD_VREQ_BLOB, len, 0U, len, data), len);
+
+    CHECK_EQ(GotLen, len);
+    CHECK_EQ(Misplaced, 0U);
+    CHECK_EQ(Lasts, 1U);
+    CHECK(memcmp(Got, data, len) == 0);
+#if (USBD_VREQ_BLOB_STAGING != 0U)
+    CHECK_EQ(Calls, 1U);
+#else
+    CHECK_EQ(Calls, (len + USB_MAX_EP0_SIZE - 1U) / USB_MAX_EP0_SIZE);
+    CHECK(MaxPiece <= USB_MAX_EP0_SIZE);
+#endif
+
+    after = Blob_Stats();
+    CHECK_EQ(after.blobs, before.blobs + 1U);
+    CHECK_EQ(after.bytes, before.bytes + len);
+    CHECK_EQ(after.packets, before.packets + ((len + USB_MAX_EP0_SIZE - 1U) / USB_MAX_EP0_SIZE));
+}
+
+/* One packet, one byte over, two packets, the largest blob */
+static void Test_Sizes(void)
+{
+    Upload(64U);
+    Upload(65U);
+    Upload(128U);
+    Upload(USBD_VREQ_BLOB_MAX);
+}
+
+/* Over USBD_VREQ_BLOB_MAX stalls in the setup stage: nothing reaches the
+   consumer and EP0 takes the next request */
+static void Test_TooLong(void)
+{
+    static uint8_t data[USBD_VREQ_BLOB_MAX + 1U];
+
+    Consumer_Reset(1U);
+    CHECK_EQ(Host_Control(&Dev, 0x40U, USBD_VREQ_BLOB, 1U, 0U, sizeof(data), data), -1);
+    CHECK_EQ(Calls, 0U);
+    Upload(100U);
+}
+
+/* Before SET_CONFIGURATION the request stalls, addressed or not */
+static void Test_NotConfigured(void)
+{
+    uint8_t data[USB_MAX_EP0_SIZE];
+
+    Blob_Fill(data, sizeof(data), 0x5AU);
+    Consumer_Reset(2U);
+    Host_BusReset(&Dev);
+    CHECK_EQ(Host_Control(&Dev, 0x40U, USBD_VREQ_BLOB, 2U, 0U, sizeof(data), data), -1);
+    CHECK_EQ(Host_Control(&Dev, 0x00U, USB_REQ_SET_ADDRESS, HOST_DEV_ADDRESS, 0U, 0U, NULL), 0);
+    CHECK_EQ(Host_Control(&Dev, 0x40U, USBD_VREQ_BLOB, 2U, 0U, sizeof(data), data), -1);
+    CHECK_EQ(Calls, 0U);
+
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    Upload(sizeof(data));
+}
+
+/* The RAM held for the data phase, and host time per largest blob */
+static void Report_Blob(void)
+{
+    static uint8_t data[USBD_VREQ_BLOB_MAX];
+    USBD_VReq_BlobStatsTypeDef stats = Blob_Stats();
+    struct timespec t0, t1;
+    double ns;
+    uint32_t i;
+
+    CHECK_EQ(stats.buf_size, USBD_VREQ_BLOB_BUF_SIZE);
+
+    Blob_Fill(data, sizeof(data), 0x3CU);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0U; i < TIMED_BLOBS; i++)
+    {
+        Consumer_Reset((uint16_t)i);
+        CHECK_EQ(Host_Control(&Dev, 0x40U, USBD_VREQ_BLOB, (uint16_t)i, 0U, sizeof(data), data), sizeof(data));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((double)(t1.tv_sec - t0.tv_sec) * 1e9) + (double)(t1.tv_nsec - t0.tv_nsec);
+
+    printf("test_blob: %s, %u bytes held for the data phase, %.0f ns per %u-byte blob (%.0f MB/s host)\n",
+           (USBD_VREQ_BLOB_STAGING != 0U) ? "staging" : "streaming", stats.buf_size, ns / TIMED_BLOBS,
+           USBD_VREQ_BLOB_MAX, (TIMED_BLOBS * (double)USBD_VREQ_BLOB_MAX * 1e3) / ns);
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+
+    Test_Sizes();
+    Test_TooLong();
+    Test_NotConfigured();
+    Report_Blob();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report((USBD_VREQ_BLOB_STAGING != 0U) ? "test_blob staging" : "test_blob");
+}
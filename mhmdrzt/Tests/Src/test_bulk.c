@@ -0,0 +1,203 @@
+/* Src/test_bulk.c */
+#include "host_usb.h"
+#include "test.h"
+#include <string.h>
+
+/* Bulk telemetry ring (usbd_bulk.h): what the host reads on 0x83 is the
+   byte stream written, across ring wraps and transfer splits, and with
+   DMA every transfer starts word aligned. */
+
+#define STREAM_MAX      65536U
+
+typedef struct
+{
+  uint8_t  data[STREAM_MAX];
+  uint32_t len;
+  uint32_t xfers;
+  uint32_t max_xfer;
+  uint32_t misaligned;
+} Bulk_Capture;
+
+static Host_DeviceTypeDef Dev;
+static Bulk_Capture Cap;
+static Host_StreamTypeDef Sent;
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if (ep_addr != USBD_BULK_EPIN_ADDR)
+    {
+        return;
+    }
+    if (((uintptr_t)data & 3U) != 0U)
+    {
+        Cap.misaligned++;
+    }
+    if ((Cap.len + len) <= STREAM_MAX)
+    {
+        memcpy(&Cap.data[Cap.len], data, len);
+    }
+    Cap.len += len;
+    Cap.xfers++;
+    Cap.max_xfer = MAX(Cap.max_xfer, len);
+}
+
+static void Bulk_Start(uint8_t dma, uint8_t seed)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    Dev.dma = dma;
+    Dev.on_in = On_In;
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    memset(&Cap, 0, sizeof(Cap));
+    Host_StreamReset(&Sent, seed);
+}
+
+static uint16_t Bulk_Write(uint16_t len)
+{
+    return Host_StreamWrite(&Dev, &Sent, USBD_Bulk_Write, len);
+}
+
+static void Bulk_Settle(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < 8U; i++)
+    {
+        Host_Frame(&Dev);
+    }
+}
+
+/* Odd-sized writes with the host reading every frame or two: the ring
+   wraps many times and every byte arrives once, in order */
+static void Test_Stream(uint8_t dma)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &Dev.ctx.bulk;
+    uint32_t i;
+
+    Bulk_Start(dma, 0x5AU);
+    for (i = 0U; Sent.len < (8U * USBD_BULK_TX_RING_SIZE); i++)
+    {
+        CHECK_EQ(Bulk_Write((uint16_t)(1U + (i * 37U) % 301U)), (uint16_t)(1U + (i * 37U) % 301U));
+        if ((i % 3U) != 0U)
+        {
+            Host_Frame(&Dev);
+        }
+    }
+    Bulk_Settle();
+
+    CHECK_EQ(Cap.len, Sent.len);
+    CHECK(memcmp(Cap.data, Sent.data, Sent.len) == 0);
+    CHECK_EQ(hbulk->stats.tx_bytes, Sent.len);
+    CHECK_EQ(hbulk->stats.tx_dropped, 0U);
+    CHECK_EQ(hbulk->stats.tx_xfers, Cap.xfers);
+    CHECK_EQ(hbulk->inflight, 0U);
+    CHECK(Cap.max_xfer <= USBD_BULK_MAX_XFER);
+    if (dma != 0U)
+    {
+        CHECK_EQ(Cap.misaligned, 0U);
+        CHECK_EQ(hbulk->head & 3U, 0U);
+    }
+    CHECK_EQ(hbulk->head, hbulk->tail);
+    CHECK_EQ(Dev.ll_errors, 0U);
+}
+
+/* With DMA a transfer ending off a word moves the head to the next word,
+   and the completion moves the tail past the same padding */
+static void Test_DMA_Padding(void)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &Dev.ctx.bulk;
+
+    Bulk_Start(1U, 1U);
+
+    CHECK_EQ(Bulk_Write(5U), 5U);
+    CHECK_EQ(hbulk->inflight, 5U);
+    CHECK_EQ(hbulk->head, 8U);
+    CHECK(Dev.in[3].armed != 0U);
+    CHECK_EQ(Dev.in[3].len, 5U);
+    CHECK(Dev.in[3].buf == &hbulk->ring[0]);
+
+    /* Queued behind the transfer, from the padded head */
+    CHECK_EQ(Bulk_Write(6U), 6U);
+    CHECK_EQ(hbulk->head, 14U);
+    CHECK_EQ(USBD_Bulk_TxFree(&Dev.dev), USBD_BULK_TX_RING_SIZE - 14U);
+
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 5);
+    /* DataIn skipped the padding and armed the next run right away */
+    CHECK_EQ(hbulk->tail, 8U);
+    CHECK_EQ(hbulk->inflight, 6U);
+    CHECK_EQ(hbulk->head, 16U);
+    CHECK(Dev.in[3].buf == &hbulk->ring[8]);
+
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 6);
+    CHECK_EQ(hbulk->tail, 16U);
+    CHECK_EQ(hbulk->inflight, 0U);
+    CHECK_EQ(Cap.len, 11U);
+    CHECK(memcmp(Cap.data, Sent.data, 11U) == 0);
+
+    /* A word multiple needs no padding */
+    CHECK_EQ(Bulk_Write(8U), 8U);
+    CHECK_EQ(hbulk->head, 24U);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 8);
+    CHECK_EQ(hbulk->tail, 24U);
+    CHECK_EQ(Dev.ll_errors, 0U);
+
+    /* Without DMA nothing is padded */
+    Bulk_Start(0U, 1U);
+    CHECK_EQ(Bulk_Write(5U), 5U);
+    CHECK_EQ(hbulk->head, 5U);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 5);
+    CHECK_EQ(hbulk->tail, 5U);
+}
+
+/* Transfers are capped at USBD_BULK_MAX_XFER and split at the ring end */
+static void Test_Split(void)
+{
+    USBD_Bulk_HandleTypeDef *hbulk = &Dev.ctx.bulk;
+
+    Bulk_Start(1U, 0U);
+
+    /* Nothing is read: the ring takes what fits, the rest is dropped */
+    CHECK_EQ(Bulk_Write(USBD_BULK_TX_RING_SIZE + 100U), USBD_BULK_TX_RING_SIZE);
+    CHECK_EQ(hbulk->stats.tx_dropped, 100U);
+    CHECK_EQ(hbulk->stats.tx_high, USBD_BULK_TX_RING_SIZE);
+    CHECK_EQ(hbulk->inflight, USBD_BULK_MAX_XFER);
+    CHECK_EQ(Bulk_Write(1U), 0U);
+
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), USBD_BULK_MAX_XFER);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), USBD_BULK_MAX_XFER);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), -1);
+
+    /* 3 bytes short of the ring end, then across it: two transfers, the
+       second from ring[0] */
+    CHECK_EQ(Bulk_Write(USBD_BULK_TX_RING_SIZE - 4U), USBD_BULK_TX_RING_SIZE - 4U);
+    Bulk_Settle();
+    CHECK_EQ(hbulk->tail & (USBD_BULK_TX_RING_SIZE - 1U), USBD_BULK_TX_RING_SIZE - 4U);
+    CHECK_EQ(Bulk_Write(10U), 10U);
+    CHECK_EQ(Dev.in[3].len, 4U);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 4);
+    CHECK(Dev.in[3].buf == &hbulk->ring[0]);
+    CHECK_EQ(Host_PollIn(&Dev, USBD_BULK_EPIN_ADDR), 6);
+
+    CHECK_EQ(Cap.len, Sent.len);
+    CHECK(memcmp(Cap.data, Sent.data, Sent.len) == 0);
+    CHECK_EQ(Dev.ll_errors, 0U);
+}
+
+/* Only a configured device queues anything */
+static void Test_Unconfigured(void)
+{
+    uint8_t seed = 0U;
+
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(USBD_Bulk_Write(&Dev.dev, &seed, 1U), 0U);
+    CHECK_EQ(Dev.in[3].armed, 0U);
+}
+
+int main(void)
+{
+    Test_Stream(0U);
+    Test_Stream(1U);
+    Test_DMA_Padding();
+    Test_Split();
+    Test_Unconfigured();
+    return Test_Report("test_bulk");
+}
@@ -0,0 +1,91 @@
+/* Src/test_clock_profile.c */
+#include "clock_profile.h"
+#include "test.h"
+
+/* Built once per HSE_VALUE and CLOCK_PROFILE (see the Makefile). The
+   solution the preprocessor found is checked against the table worked
+   out by hand from RM0090, and against the PLL limits themselves. */
+typedef struct
+{
+  uint32_t profile;
+  uint32_t hse;
+  uint32_t m;
+  uint32_t n;
+  uint32_t p;
+  uint32_t q;
+} PLL_Expected;
+
+static const PLL_Expected Expected[] =
+{
+  { CLOCK_PROFILE_PERFORMANCE,  5000000U,  5U, 336U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE,  8000000U,  4U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 12000000U,  6U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 16000000U,  8U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 24000000U, 12U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 25000000U, 25U, 336U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 26000000U, 13U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_PERFORMANCE, 50000000U, 25U, 168U, 2U, 7U },
+  { CLOCK_PROFILE_EFFICIENCY,   8000000U,  4U,  96U, 4U, 4U },
+  { CLOCK_PROFILE_EFFICIENCY,  25000000U, 25U, 192U, 4U, 4U },
+};
+
+int main(void)
+{
+    const PLL_Expected *e = NULL;
+    uint32_t i;
+    uint32_t vco_in = HSE_VALUE / CLOCK_PLLM;
+    uint32_t vco = vco_in * CLOCK_PLLN;
+
+    printf("HSE %u Hz, profile %u: M %u N %u P %u Q %u\n", (unsigned)HSE_VALUE, (unsigned)CLOCK_PROFILE,
+           (unsigned)CLOCK_PLLM, (unsigned)CLOCK_PLLN, (unsigned)CLOCK_PLLP_DIV, (unsigned)CLOCK_PLLQ);
+
+    for (i = 0U; i < (sizeof(Expected) / sizeof(Expected[0])); i++)
+    {
+        if ((Expected[i].profile == CLOCK_PROFILE) && (Expected[i].hse == HSE_VALUE))
+        {
+            e = &Expected[i];
+        }
+    }
+    CHECK(e != NULL);
+    if (e != NULL)
+    {
+        CHECK_EQ(CLOCK_PLLM, e->m);
+        CHECK_EQ(CLOCK_PLLN, e->n);
+        CHECK_EQ(CLOCK_PLLP_DIV, e->p);
+        CHECK_EQ(CLOCK_PLLQ, e->q);
+    }
+
+    /* The hardware limits, independent of the table */
+    CHECK_EQ(HSE_VALUE % CLOCK_PLLM, 0U);
+    CHECK(vco_in == 1000000U || vco_in == 2000000U);
+    CHECK(vco >= 100000000U && vco <= 432000000U);
+    CHECK_EQ(vco / CLOCK_PLLP_DIV, CLOCK_SYSCLK_HZ);
+    CHECK_EQ(vco % CLOCK_PLLQ, 0U);
+    CHECK_EQ(vco / CLOCK_PLLQ, 48000000U);
+    CHECK(CLOCK_PLLQ >= 2U && CLOCK_PLLQ <= 15U);
+    CHECK_EQ(CLOCK_PLLP, CLOCK_PLLP_DIV);
+    /* 2 MHz VCO input whenever HSE allows it: less PLL jitter */
+    if ((HSE_VALUE % 2000000U) == 0U)
+    {
+        CHECK_EQ(vco_in, 2000000U);
+    }
+    CHECK(CLOCK_IDLE_HCLK_HZ >= 14200000U);
+
+#if (CLOCK_PROFILE == CLOCK_PROFILE_PERFORMANCE)
+    CHECK_EQ(CLOCK_FLASH_LATENCY, 5U);
+    CHECK_EQ(CLOCK_VOLTAGE_SCALE, PWR_REGULATOR_VOLTAGE_SCALE1);
+    CHECK_EQ(CLOCK_APB1_DIV, RCC_HCLK_DIV4);
+    CHECK_EQ(CLOCK_APB2_DIV, RCC_HCLK_DIV2);
+    CHECK_EQ(CLOCK_IDLE_AHB_DIV, RCC_SYSCLK_DIV8);
+    CHECK_EQ(CLOCK_IDLE_HCLK_HZ, 21000000U);
+#else
+    CHECK_EQ(CLOCK_FLASH_LATENCY, 1U);
+    CHECK_EQ(CLOCK_VOLTAGE_SCALE, PWR_REGULATOR_VOLTAGE_SCALE3);
+    CHECK_EQ(CLOCK_APB1_DIV, RCC_HCLK_DIV2);
+    CHECK_EQ(CLOCK_APB2_DIV, RCC_HCLK_DIV1);
+    CHECK_EQ(CLOCK_IDLE_AHB_DIV, RCC_SYSCLK_DIV2);
+    CHECK_EQ(CLOCK_IDLE_HCLK_HZ, 24000000U);
+#endif
+
+    return Test_Report("test_clock_profile");
+}
@@ -0,0 +1,213 @@
+/* Src/test_in_arb.c */
+#include "host_usb.h"
+#include "test.h"
+#include <string.h>
+
+/* IN arbiter latency accounting (usbd_in_arb.h): arm-to-completion
+   latency per class, the histogram percentiles and deadline misses, as
+   reported by USBD_Arb_GetStats and the ARB_STATS vendor command. */
+
+static Host_DeviceTypeDef Dev;
+static uint8_t Reply[CUSTOM_HID_EPIN_SIZE];
+static uint8_t ReplySeen;
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if ((ep_addr == CUSTOM_HID_EPIN_ADDR) && (len == CUSTOM_HID_EPIN_SIZE) &&
+        (data[0] == CUSTOM_HID_REPORT_ID_VENDOR))
+    {
+        memcpy(Reply, data, sizeof(Reply));
+        ReplySeen = 1U;
+    }
+}
+
+/* One mouse report completed `lat` frames after it was armed */
+static void Pointer_Completion(uint16_t lat)
+{
+    static uint8_t report[3] USBD_DMA_ALIGNED;
+    uint16_t i;
+
+    CHECK_EQ(USBD_HID_MOUSE_SendReport(&Dev.dev, report, sizeof(report)), USBD_OK);
+    for (i = 0U; i < lat; i++)
+    {
+        Host_SOF(&Dev);
+    }
+    CHECK_EQ(Host_PollIn(&Dev, HID_MOUSE_EPIN_ADDR), (int32_t)sizeof(report));
+}
+
+static void Pointer_Completions(uint16_t lat, uint32_t count)
+{
+    while (count-- != 0U)
+    {
+        Pointer_Completion(lat);
+    }
+}
+
+static void Stats(uint8_t cls, uint8_t *report)
+{
+    memset(report, 0xEE, CUSTOM_HID_EPIN_SIZE);
+    USBD_Arb_GetStats(&Dev.dev, cls, report);
+}
+
+static void Test_Percentiles(void)
+{
+    uint8_t r[CUSTOM_HID_EPIN_SIZE];
+
+    /* Nothing completed yet */
+    USBD_Arb_ClearStats(&Dev.dev);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[1], USBD_ARB_CLASS_POINTER);
+    CHECK_EQ(r[2], 0U);
+    CHECK_EQ(r[3], 0U);
+    CHECK_EQ(r[4], 0U);
+    CHECK_EQ(r[5] | r[6] | r[7] | r[8], 0U);
+
+    /* 50 x 1, 40 x 2, 9 x 3, 1 x 20 frames */
+    Pointer_Completions(1U, 50U);
+    Pointer_Completions(2U, 40U);
+    Pointer_Completions(3U, 9U);
+    Pointer_Completions(20U, 1U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 1U);             /* 50th completion is at 1 */
+    CHECK_EQ(r[3], 3U);             /* 99th is at 3 */
+    CHECK_EQ(r[4], 20U);
+    CHECK_EQ(r[5] | (r[6] << 8), 100U);
+    CHECK_EQ(r[7] | (r[8] << 8), 1U);   /* over one bInterval */
+
+    /* Percentiles round the count up: 3 completions, p50 needs 2 */
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(0U, 1U);
+    Pointer_Completions(4U, 2U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 4U);
+    CHECK_EQ(r[3], 4U);
+
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(0U, 2U);
+    Pointer_Completions(4U, 1U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 0U);
+    CHECK_EQ(r[3], 4U);
+
+    /* One slow completion in 200 stays out of p99 */
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(1U, 199U);
+    Pointer_Completions(9U, 1U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[3], 1U);
+    CHECK_EQ(r[4], 9U);
+    CHECK_EQ(r[7] | (r[8] << 8), 0U);
+}
+
+/* The last bin collects everything from 15 frames on; max is exact up
+   to 255 */
+static void Test_LastBin(void)
+{
+    uint8_t r[CUSTOM_HID_EPIN_SIZE];
+
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(40U, 2U);
+    Pointer_Completions(15U, 1U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], USBD_ARB_LAT_BINS - 1U);
+    CHECK_EQ(r[3], USBD_ARB_LAT_BINS - 1U);
+    CHECK_EQ(r[4], 40U);
+    CHECK_EQ(Dev.ctx.arb.stats[USBD_ARB_CLASS_POINTER].lat_hist[USBD_ARB_LAT_BINS - 1U], 3U);
+    CHECK_EQ(r[7] | (r[8] << 8), 3U);
+
+    Pointer_Completion(300U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(Dev.ctx.arb.stats[USBD_ARB_CLASS_POINTER].lat_max, 300U);
+    CHECK_EQ(r[4], 0xFFU);
+}
+
+/* Over a minute of 1 ms polls puts more than 65535 completions in one
+   bin; the percentiles must still come from the real distribution */
+static void Test_FullBin(void)
+{
+    uint8_t r[CUSTOM_HID_EPIN_SIZE];
+
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(1U, 70000U);
+    Pointer_Completions(3U, 100U);
+    CHECK_EQ(Dev.ctx.arb.stats[USBD_ARB_CLASS_POINTER].lat_hist[1], 70000U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 1U);
+    CHECK_EQ(r[3], 1U);
+    CHECK_EQ(r[4], 3U);
+    CHECK_EQ(r[5] | (r[6] << 8), 0xFFFFU);
+
+    /* Then the tail grows past 1% */
+    Pointer_Completions(3U, 1000U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 1U);
+    CHECK_EQ(r[3], 3U);
+}
+
+/* Latency is taken modulo the 11-bit frame number */
+static void Test_FrameWrap(void)
+{
+    uint8_t r[CUSTOM_HID_EPIN_SIZE];
+
+    USBD_Arb_ClearStats(&Dev.dev);
+    Dev.frame = 0x7FEU;
+    Pointer_Completion(3U);
+    CHECK_EQ(Dev.frame, 1U);
+    Stats(USBD_ARB_CLASS_POINTER, r);
+    CHECK_EQ(r[2], 3U);
+    CHECK_EQ(r[4], 3U);
+}
+
+/* Classes are kept apart; the reply class misses after 2 frames */
+static void Test_Classes(void)
+{
+    uint8_t abs[5] = { 0, 0, 1, 0, 1 };
+    uint8_t r[CUSTOM_HID_EPIN_SIZE];
+    uint8_t cls = USBD_ARB_CLASS_REPLY;
+
+    USBD_Arb_ClearStats(&Dev.dev);
+    Pointer_Completions(1U, 5U);
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_ABS_MOVE, abs, sizeof(abs)), CUSTOM_HID_EPOUT_SIZE);
+    Host_SOF(&Dev);
+    Host_SOF(&Dev);
+    Host_SOF(&Dev);
+    CHECK_EQ(Host_PollIn(&Dev, CUSTOM_HID_EPIN_ADDR), CUSTOM_HID_ABS_REPORT_SIZE);
+
+    Stats(USBD_ARB_CLASS_REPLY, r);
+    CHECK_EQ(r[1], USBD_ARB_CLASS_REPLY);
+    CHECK_EQ(r[2], 3U);
+    CHECK_EQ(r[5] | (r[6] << 8), 1U);
+    CHECK_EQ(r[7] | (r[8] << 8), 1U);
+    Stats(USBD_ARB_CLASS_STREAM, r);
+    CHECK_EQ(r[5] | (r[6] << 8), 0U);
+    /* An unknown class reads as POINTER */
+    Stats(0x7FU, r);
+    CHECK_EQ(r[1], USBD_ARB_CLASS_POINTER);
+    CHECK_EQ(r[5] | (r[6] << 8), 5U);
+
+    /* The same numbers over the vendor channel */
+    ReplySeen = 0U;
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_ARB_STATS, &cls, 1U), CUSTOM_HID_EPOUT_SIZE);
+    Host_Frame(&Dev);
+    CHECK_EQ(ReplySeen, 1U);
+    CHECK_EQ(Reply[1], USBD_ARB_CLASS_REPLY);
+    CHECK_EQ(Reply[2], 3U);
+    CHECK_EQ(Reply[5] | (Reply[6] << 8), 1U);
+    CHECK_EQ(Reply[7] | (Reply[8] << 8), 1U);
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    Dev.on_in = On_In;
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+
+    Test_Percentiles();
+    Test_LastBin();
+    Test_FullBin();
+    Test_FrameWrap();
+    Test_Classes();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report("test_in_arb");
+}
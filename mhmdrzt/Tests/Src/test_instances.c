@@ -0,0 +1,143 @@
+/* Src/test_instances.c */
+#include "host_usb.h"
+#include "test.h"
+#include <string.h>
+
+/* Two device instances side by side in one process, as the FS and HS
+   cores run on the board: each has its own core handle and composite
+   context, and nothing one does may show up on the other. */
+
+typedef struct
+{
+  uint32_t reports[HOST_EP_NUM];
+  uint8_t  last[HOST_EP_NUM][16];
+} Capture;
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    Capture *cap = (Capture *)hd->user;
+    uint8_t n = ep_addr & 0x0FU;
+
+    cap->reports[n]++;
+    memcpy(cap->last[n], data, MIN(len, sizeof(cap->last[n])));
+}
+
+/* Endpoint addresses of a configuration descriptor, in order */
+static uint32_t Config_Endpoints(const uint8_t *cfg, uint16_t len, uint8_t *eps)
+{
+    uint32_t n = 0U;
+    uint16_t pos = 0U;
+
+    while ((pos + 2U) <= len && cfg[pos] != 0U)
+    {
+        if (cfg[pos + 1U] == USB_DESC_TYPE_ENDPOINT)
+        {
+            eps[n++] = cfg[pos + 2U];
+        }
+        pos += cfg[pos];
+    }
+    return n;
+}
+
+static int32_t Get_Descriptor(Host_DeviceTypeDef *hd, uint8_t type, uint8_t index, uint16_t len, uint8_t *buf)
+{
+    return Host_Control(hd, 0x80U, USB_REQ_GET_DESCRIPTOR, (uint16_t)((type << 8) | index),
+                        (type == USB_DESC_TYPE_STRING) ? 0x0409U : 0U, len, buf);
+}
+
+static Host_DeviceTypeDef A, B;
+static Capture CapA, CapB;
+
+int main(void)
+{
+    static const uint8_t full_eps[] = { 0x81, 0x82, 0x02, 0x83, 0x03 };
+    static const uint8_t x3_eps[] = { 0x82, 0x02, 0x83, 0x81 };
+    uint8_t dev_a[USB_LEN_DEV_DESC], dev_b[USB_LEN_DEV_DESC];
+    uint8_t cfg_a[256], cfg_b[256], again[256];
+    uint8_t str_a[64], str_b[64];
+    uint8_t eps[16];
+    uint8_t abs[5] = { 0x01, 0x34, 0x12, 0x78, 0x56 };
+    uint16_t len_a, len_b;
+    uint32_t i;
+
+    CHECK_EQ(Host_Attach(&A, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(Host_Attach(&B, DEVICE_FS, USBD_PERSONALITY_VENDOR_X3), USBD_OK);
+    A.on_in = On_In;
+    A.user = &CapA;
+    B.on_in = On_In;
+    B.user = &CapB;
+
+    /* Interleave the descriptor reads of the two instances */
+    CHECK_EQ(Get_Descriptor(&A, USB_DESC_TYPE_DEVICE, 0U, sizeof(dev_a), dev_a), USB_LEN_DEV_DESC);
+    CHECK_EQ(Get_Descriptor(&B, USB_DESC_TYPE_DEVICE, 0U, sizeof(dev_b), dev_b), USB_LEN_DEV_DESC);
+    CHECK_EQ(Get_Descriptor(&A, USB_DESC_TYPE_CONFIGURATION, 0U, 9U, cfg_a), 9);
+    CHECK_EQ(Get_Descriptor(&B, USB_DESC_TYPE_CONFIGURATION, 0U, 9U, cfg_b), 9);
+    len_a = (uint16_t)(cfg_a[2] | (cfg_a[3] << 8));
+    len_b = (uint16_t)(cfg_b[2] | (cfg_b[3] << 8));
+    CHECK_EQ(len_a, CFG_HEADER_SIZE + CFG_FULL_IFS_SIZE);
+    CHECK_EQ(len_b, CFG_HEADER_SIZE + CFG_STRIPE_IFS_SIZE);
+    CHECK_EQ(Get_Descriptor(&B, USB_DESC_TYPE_CONFIGURATION, 0U, len_b, cfg_b), len_b);
+    CHECK_EQ(Get_Descriptor(&A, USB_DESC_TYPE_CONFIGURATION, 0U, len_a, cfg_a), len_a);
+
+    /* idProduct is USBD_PID + personality */
+    CHECK_EQ((dev_b[10] | (dev_b[11] << 8)) - (dev_a[10] | (dev_a[11] << 8)), USBD_PERSONALITY_VENDOR_X3);
+    CHECK_EQ(cfg_a[4], 3U);
+    CHECK_EQ(cfg_b[4], 3U);
+
+    CHECK_EQ(Config_Endpoints(cfg_a, len_a, eps), sizeof(full_eps));
+    CHECK(memcmp(eps, full_eps, sizeof(full_eps)) == 0);
+    CHECK_EQ(Config_Endpoints(cfg_b, len_b, eps), sizeof(x3_eps));
+    CHECK(memcmp(eps, x3_eps, sizeof(x3_eps)) == 0);
+
+    /* B's descriptors are built in B's context: A reads back unchanged,
+       also after B rendered a string into its own scratch buffer */
+    CHECK(Get_Descriptor(&B, USB_DESC_TYPE_STRING, USBD_IDX_PRODUCT_STR, sizeof(str_b), str_b) > 2);
+    CHECK_EQ(Get_Descriptor(&A, USB_DESC_TYPE_CONFIGURATION, 0U, len_a, again), len_a);
+    CHECK(memcmp(again, cfg_a, len_a) == 0);
+    CHECK(Get_Descriptor(&A, USB_DESC_TYPE_STRING, USBD_IDX_PRODUCT_STR, sizeof(str_a), str_a) > 2);
+
+    /* Both configured; each instance opened only its own endpoints */
+    Host_BusReset(&A);
+    Host_BusReset(&B);
+    CHECK_EQ(Host_Enumerate(&A), USBD_OK);
+    CHECK_EQ(Host_Enumerate(&B), USBD_OK);
+    CHECK_EQ(A.address, HOST_DEV_ADDRESS);
+    CHECK_EQ(A.in[1].open + A.in[2].open + A.in[3].open, 3U);
+    CHECK_EQ(B.in[1].open + B.in[2].open + B.in[3].open, 3U);
+    CHECK_EQ(A.ctx.personality.personality, USBD_PERSONALITY_FULL);
+    CHECK_EQ(B.ctx.personality.personality, USBD_PERSONALITY_VENDOR_X3);
+
+    /* Traffic on A stays on A */
+    for (i = 0U; i < 4U; i++)
+    {
+        Host_Frame(&A);
+        Host_Frame(&B);
+    }
+    memset(&CapA, 0, sizeof(CapA));
+    memset(&CapB, 0, sizeof(CapB));
+    CHECK_EQ(Host_VendorCommand(&A, CUSTOM_HID_CMD_ABS_MOVE, abs, sizeof(abs)), CUSTOM_HID_EPOUT_SIZE);
+    for (i = 0U; i < 8U; i++)
+    {
+        Host_Frame(&A);
+        Host_Frame(&B);
+    }
+    CHECK_EQ(CapA.reports[2], 1U);
+    CHECK_EQ(CapA.last[2][0], CUSTOM_HID_REPORT_ID_ABS);
+    CHECK(memcmp(&CapA.last[2][1], abs, sizeof(abs)) == 0);
+    CHECK_EQ(CapB.reports[1] + CapB.reports[2] + CapB.reports[3], 0U);
+
+    /* Taking B down leaves A configured and running */
+    Host_BusReset(&B);
+    CHECK_EQ(B.dev.dev_state, USBD_STATE_DEFAULT);
+    CHECK_EQ(A.dev.dev_state, USBD_STATE_CONFIGURED);
+    CHECK_EQ(Host_VendorCommand(&A, CUSTOM_HID_CMD_ABS_MOVE, abs, sizeof(abs)), CUSTOM_HID_EPOUT_SIZE);
+    for (i = 0U; i < 8U; i++)
+    {
+        Host_Frame(&A);
+    }
+    CHECK_EQ(CapA.reports[2], 2U);
+
+    CHECK_EQ(A.ll_errors, 0U);
+    CHECK_EQ(B.ll_errors, 0U);
+    return Test_Report("test_instances");
+}
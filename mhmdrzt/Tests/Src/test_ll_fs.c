@@ -0,0 +1,310 @@
+/* Src/test_ll_fs.c */
+#include "host_otg.h"
+#include "main.h"
+#include "usb_device.h"
+#include "usbd_core.h"
+#include "usbd_composite.h"
+#include "usbd_bulk.h"
+#include "usbd_vendor_req.h"
+#include "clock_gov.h"
+#include "test.h"
+#include <string.h>
+
+/* usbd_conf.c and the lean OTG_FS driver (usbd_ll_fs.c) as they ship,
+   brought up by MX_USB_DEVICE_Init, on the register model of host_otg.h:
+   enumeration, EP0 data stages of several packets both ways, bulk IN
+   through TXFE refills, and stalls. This file is the rest of the board
+   under it.
+
+   The HAL PCD driver is not in this tree, so the HAL path cannot run
+   here; the HAL_PCD_* calls below only stand in for OTG_HS, which the
+   shipped build leaves out. The cycles printed at the end are host
+   cycles per handler call, by event, to compare changes to the lean
+   driver against each other. */
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+SCB_Type Host_SCB;
+static uint32_t Errors;          /* Error_Handler calls */
+
+static uint8_t Blob[USBD_VREQ_BLOB_MAX];
+static uint32_t BlobBytes;
+static uint32_t BlobCalls;
+static uint32_t BlobLast;
+static uint32_t BlobMisplaced;   /* chunks not at the next offset */
+
+/* ---- Board ---- */
+
+void Error_Handler(void)
+{
+    Errors++;
+}
+
+void SystemClock_Restore(void)
+{
+}
+
+void ClockGov_SOF(void)
+{
+}
+
+/* HCLK is 168 MHz here, for which the table of clock_gov.c gives 6 */
+uint32_t ClockGov_Trdt(uint32_t hclk)
+{
+    return 0x6U;
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return SystemCoreClock;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+}
+
+/* The HAL PCD driver, for OTG_HS only: never called on this board */
+HAL_StatusTypeDef HAL_PCD_Init(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_DeInit(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_Start(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_Stop(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_Flush(PCD_HandleTypeDef *hpcd, uint8_t ep_addr) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_SetAddress(PCD_HandleTypeDef *hpcd, uint8_t address) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_ActivateRemoteWakeup(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+HAL_StatusTypeDef HAL_PCD_DeActivateRemoteWakeup(PCD_HandleTypeDef *hpcd) { return HAL_ERROR; }
+void HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd) { }
+
+/* usbd_conf.c uses this one for both drivers: the handle's byte count */
+uint32_t HAL_PCD_EP_GetRxCount(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+    return hpcd->OUT_ep[ep_addr & EP_ADDR_MSK].xfer_count;
+}
+
+/* ---- Host ---- */
+
+void USBD_VReq_BlobCallback(uint16_t id, uint32_t offset, const uint8_t *data, uint32_t len, uint8_t last)
+{
+    BlobCalls++;
+    BlobLast += last;
+    if ((offset != BlobBytes) || ((offset + len) > sizeof(Blob)))
+    {
+        BlobMisplaced++;
+        return;
+    }
+    memcpy(&Blob[offset], data, len);
+    BlobBytes += len;
+}
+
+/* FIFO plan of the endpoint table, the same as the HAL path's */
+static void Test_Init(void)
+{
+    CHECK_EQ(Host_Otg_Map(), USBD_OK);
+    MX_USB_DEVICE_Init();
+
+    CHECK_EQ(Errors, 0U);
+    CHECK_EQ(USB_OTG_FS->GRXFSIZ, 0x80U);
+    CHECK_EQ(USB_OTG_FS->DIEPTXF0_HNPTXFSIZ, (0x20UL << 16) | 0x80U);
+    CHECK_EQ(USB_OTG_FS->DIEPTXF[0], (0x10UL << 16) | 0xA0U);
+    CHECK_EQ(USB_OTG_FS->DIEPTXF[1], (0x10UL << 16) | 0xB0U);
+    CHECK_EQ(USB_OTG_FS->DIEPTXF[2], (0x80UL << 16) | 0xC0U);
+    CHECK((USB_OTG_FS->GAHBCFG & USB_OTG_GAHBCFG_GINT) != 0U);
+    CHECK((USB_OTG_FS->GINTMSK & USB_OTG_GINTMSK_RXFLVLM) != 0U);
+    CHECK_EQ(USB_OTG_FS->GINTMSK & (USB_OTG_GINTSTS_IEPINT | USB_OTG_GINTSTS_OEPINT),
+             USB_OTG_GINTSTS_IEPINT | USB_OTG_GINTSTS_OEPINT);
+}
+
+/* Reset and enumeration done set up EP0 and the turnaround time; the
+   host then enumerates through EP0 data stages of several packets */
+static void Test_Enumerate(void)
+{
+    uint32_t USBx_BASE = USB_OTG_FS_PERIPH_BASE;
+
+    Host_Otg_BusReset();
+    CHECK_EQ(USBx_DEVICE->DAINTMSK & 0x10001U, 0x10001U);
+    CHECK_EQ((USB_OTG_FS->GUSBCFG & USB_OTG_GUSBCFG_TRDT) >> USB_OTG_GUSBCFG_TRDT_Pos, 6U);
+    CHECK_EQ((USBx_OUTEP(0U)->DOEPTSIZ & USB_OTG_DOEPTSIZ_STUPCNT) >> USB_OTG_DOEPTSIZ_STUPCNT_Pos, 3U);
+    CHECK_EQ(hUsbDeviceFS.dev_state, USBD_STATE_DEFAULT);
+
+    CHECK_EQ(Host_Otg_Enumerate(), USBD_OK);
+    CHECK_EQ(hUsbDeviceFS.dev_state, USBD_STATE_CONFIGURED);
+    CHECK_EQ((USBx_DEVICE->DCFG & USB_OTG_DCFG_DAD) >> USB_OTG_DCFG_DAD_Pos, HOST_OTG_DEV_ADDRESS);
+}
+
+/* An IN data stage of several packets arrives whole and in order */
+static void Test_Ep0In(void)
+{
+    uint8_t got[256];
+    uint8_t *want;
+    uint16_t len;
+
+    want = hUsbDeviceFS.pClass->GetFSConfigDescriptor(&hUsbDeviceFS, &len);
+    CHECK(len > USB_MAX_EP0_SIZE);
+    CHECK_EQ(Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U, len, got), len);
+    CHECK(memcmp(got, want, len) == 0);
+
+    /* The host asks for more than there is: short last packet */
+    CHECK_EQ(Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, USB_DESC_TYPE_CONFIGURATION << 8, 0U,
+                              sizeof(got), got), len);
+}
+
+/* An OUT data stage of several packets: each chunk at its offset, the
+   last one flagged */
+static void Upload(uint16_t len, uint8_t seed)
+{
+    uint8_t data[USBD_VREQ_BLOB_MAX];
+    uint16_t i;
+
+    for (i = 0U; i < len; i++)
+    {
+        data[i] = (uint8_t)(seed + (i * 7U));
+    }
+    BlobBytes = 0U;
+    BlobCalls = 0U;
+    BlobLast = 0U;
+    BlobMisplaced = 0U;
+
+    CHECK_EQ(Host_Otg_Control(0x40U, USBD_VREQ_BLOB, 0x0001U, 0U, len, data), len);
+    CHECK_EQ(BlobBytes, len);
+    CHECK_EQ(BlobCalls, (len + USB_MAX_EP0_SIZE - 1U) / USB_MAX_EP0_SIZE);
+    CHECK_EQ(BlobLast, 1U);
+    CHECK_EQ(BlobMisplaced, 0U);
+    CHECK(memcmp(Blob, data, len) == 0);
+}
+
+static void Test_Ep0Out(void)
+{
+    Upload(200U, 0x11U);
+    Upload(128U, 0x22U);
+    Upload(USBD_VREQ_BLOB_MAX, 0x33U);
+}
+
+/* One armed bulk transfer is twice the 0x83 FIFO: TXFE refills it as the
+   host takes packets */
+static void Test_BulkRefill(void)
+{
+    uint8_t data[USBD_BULK_MAX_XFER];
+    uint8_t got[USBD_BULK_MAX_XFER];
+    uint8_t packet[USBD_BULK_PACKET_SIZE];
+    uint32_t refills = Host_Otg_Stats.irqs[HOST_OTG_EV_TXFE];
+    uint32_t done = 0U;
+    uint32_t frames, i;
+    int32_t n;
+
+    for (i = 0U; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(i ^ (i >> 8));
+    }
+    CHECK_EQ(USBD_Bulk_Write(&hUsbDeviceFS, data, sizeof(data)), sizeof(data));
+
+    for (frames = 0U; (frames < 10U) && (done < sizeof(got)); frames++)
+    {
+        Host_Otg_SOF();
+        /* 19 full-speed bulk packets fit a frame */
+        for (i = 0U; (i < 19U) && (done < sizeof(got)); i++)
+        {
+            n = Host_Otg_In(USBD_BULK_EPIN_ADDR & 0x0FU, packet);
+            if (n < 0)
+            {
+                break;
+            }
+            CHECK_EQ(n, USBD_BULK_PACKET_SIZE);
+            memcpy(&got[done], packet, (uint32_t)n);
+            done += (uint32_t)n;
+        }
+    }
+
+    CHECK_EQ(done, sizeof(data));
+    CHECK(memcmp(got, data, sizeof(data)) == 0);
+    /* The first fill, then one per four packets taken */
+    CHECK(Host_Otg_Stats.irqs[HOST_OTG_EV_TXFE] - refills >= 2U);
+    CHECK_EQ(Host_Otg_In(USBD_BULK_EPIN_ADDR & 0x0FU, packet), HOST_OTG_NAK);
+}
+
+/* Request errors stall EP0 until the next SETUP; a halted data endpoint
+   stalls until CLEAR_FEATURE, which resets its toggle */
+static void Test_Stall(void)
+{
+    uint32_t USBx_BASE = USB_OTG_FS_PERIPH_BASE;
+    uint8_t buf[USBD_VREQ_BLOB_MAX + 1U];
+    uint8_t packet[USBD_BULK_PACKET_SIZE];
+
+    CHECK_EQ(Host_Otg_Control(0x80U, USB_REQ_GET_DESCRIPTOR, 0x0F00U, 0U, 64U, buf), -1);
+    CHECK((USBx_INEP(0U)->DIEPCTL & USB_OTG_DIEPCTL_STALL) != 0U);
+    CHECK_EQ(Host_Otg_Control(0x80U, USB_REQ_GET_STATUS, 0U, 0U, 2U, buf), 2);
+
+    /* A blob over USBD_VREQ_BLOB_MAX is refused in its setup stage */
+    memset(buf, 0, sizeof(buf));
+    CHECK_EQ(Host_Otg_Control(0x40U, USBD_VREQ_BLOB, 0x0002U, 0U, sizeof(buf), buf), -1);
+    CHECK_EQ(Host_Otg_Control(0x80U, USB_REQ_GET_STATUS, 0U, 0U, 2U, buf), 2);
+
+    CHECK_EQ(Host_Otg_Control(0x02U, USB_REQ_SET_FEATURE, USB_FEATURE_EP_HALT, USBD_BULK_EPIN_ADDR, 0U, NULL), 0);
+    CHECK((USBx_INEP(3U)->DIEPCTL & USB_OTG_DIEPCTL_STALL) != 0U);
+    CHECK_EQ(Host_Otg_In(3U, packet), HOST_OTG_STALL);
+
+    /* SD0PID reads back as the toggle on the part; clear the model's copy
+       so the write can be seen */
+    USBx_INEP(3U)->DIEPCTL &= ~USB_OTG_DIEPCTL_SD0PID_SEVNFRM;
+    CHECK_EQ(Host_Otg_Control(0x02U, USB_REQ_CLEAR_FEATURE, USB_FEATURE_EP_HALT, USBD_BULK_EPIN_ADDR, 0U, NULL), 0);
+    CHECK_EQ(USBx_INEP(3U)->DIEPCTL & USB_OTG_DIEPCTL_STALL, 0U);
+    CHECK((USBx_INEP(3U)->DIEPCTL & USB_OTG_DIEPCTL_SD0PID_SEVNFRM) != 0U);
+    CHECK_EQ(Host_Otg_In(3U, packet), HOST_OTG_NAK);
+}
+
+static void Report_Cycles(void)
+{
+    uint8_t i;
+
+    for (i = 0U; i < HOST_OTG_NUM_EVENTS; i++)
+    {
+        if (Host_Otg_Stats.irqs[i] != 0U)
+        {
+            printf("test_ll_fs: %-5s %6u handler calls, %8llu host cycles per call\n", Host_Otg_EventNames[i],
+                   Host_Otg_Stats.irqs[i], (unsigned long long)(Host_Otg_Stats.cycles[i] / Host_Otg_Stats.irqs[i]));
+        }
+    }
+}
+
+int main(void)
+{
+    Test_Init();
+    Test_Enumerate();
+    Test_Ep0In();
+    Test_Ep0Out();
+    Test_BulkRefill();
+    Test_Stall();
+
+    CHECK_EQ(Host_Otg_Stats.errors, 0U);
+    CHECK_EQ(Errors, 0U);
+    Report_Cycles();
+    return Test_Report("test_ll_fs");
+}
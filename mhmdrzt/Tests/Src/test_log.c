@@ -0,0 +1,262 @@
+/* Src/test_log.c */
+#include "host_usb.h"
+#include "usbd_log.h"
+#include "test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+/* Deferred log ring (usbd_log.h): record layout, whole-record draining,
+   drops when full, wrap-around, and concurrent writers against one
+   drain. */
+
+#define HDR(id, n, level)   ((uint32_t)(id) | ((uint32_t)(n) << 16) | ((uint32_t)(level) << 18))
+
+static void Drain_All(void)
+{
+    uint32_t buf[USBD_LOG_DEPTH];
+
+    while (USBD_Log_Drain(buf, USBD_LOG_DEPTH) != 0U)
+    {
+    }
+}
+
+static void Test_Layout(void)
+{
+    uint32_t buf[32];
+    uint32_t records = USBD_Log_Stats.records;
+
+    Host_DWT.CYCCNT = 1000U;
+    USBD_Log_Put(HDR(0x0123, 0, USBD_LOG_USR), 0xAU, 0xBU, 0xCU);
+    Host_DWT.CYCCNT = 2000U;
+    USBD_Log_Put(HDR(0x0456, 1, USBD_LOG_ERR), 0xAU, 0xBU, 0xCU);
+    Host_DWT.CYCCNT = 3000U;
+    USBD_Log_Put(HDR(0x0789, 3, USBD_LOG_DBG), 0xAU, 0xBU, 0xCU);
+
+    CHECK_EQ(USBD_Log_Pending(), 2U + 3U + 5U);
+    CHECK_EQ(USBD_Log_Stats.records - records, 3U);
+
+    memset(buf, 0xFF, sizeof(buf));
+    CHECK_EQ(USBD_Log_Drain(buf, 32U), 10U);
+    CHECK_EQ(buf[0], HDR(0x0123, 0, USBD_LOG_USR));
+    CHECK_EQ(buf[1], 1000U);
+    CHECK_EQ(buf[2], HDR(0x0456, 1, USBD_LOG_ERR));
+    CHECK_EQ(buf[3], 2000U);
+    CHECK_EQ(buf[4], 0xAU);
+    CHECK_EQ(buf[5], HDR(0x0789, 3, USBD_LOG_DBG));
+    CHECK_EQ(buf[6], 3000U);
+    CHECK_EQ(buf[7], 0xAU);
+    CHECK_EQ(buf[8], 0xBU);
+    CHECK_EQ(buf[9], 0xCU);
+    CHECK_EQ(buf[10], 0xFFFFFFFFU);
+    CHECK_EQ(USBD_Log_Pending(), 0U);
+    CHECK_EQ(USBD_Log_Drain(buf, 32U), 0U);
+}
+
+/* A drain never splits a record */
+static void Test_WholeRecords(void)
+{
+    uint32_t buf[8];
+
+    USBD_Log_Put(HDR(1, 3, USBD_LOG_USR), 1U, 2U, 3U);
+    USBD_Log_Put(HDR(2, 0, USBD_LOG_USR), 0U, 0U, 0U);
+    USBD_Log_Put(HDR(3, 0, USBD_LOG_USR), 0U, 0U, 0U);
+
+    CHECK_EQ(USBD_Log_Drain(buf, 4U), 0U);
+    CHECK_EQ(USBD_Log_Pending(), 9U);
+    CHECK_EQ(USBD_Log_Drain(buf, 6U), 5U);
+    CHECK_EQ(buf[0] & 0xFFFFU, 1U);
+    CHECK_EQ(USBD_Log_Drain(buf, 3U), 2U);
+    CHECK_EQ(buf[0] & 0xFFFFU, 2U);
+    CHECK_EQ(USBD_Log_Drain(buf, 2U), 2U);
+    CHECK_EQ(buf[0] & 0xFFFFU, 3U);
+    CHECK_EQ(USBD_Log_Pending(), 0U);
+}
+
+/* A full ring drops whole records and counts them; the count rides in
+   the header of every later record */
+static void Test_Full(void)
+{
+    uint32_t buf[USBD_LOG_DEPTH];
+    uint32_t dropped = USBD_Log_Stats.dropped;
+    uint32_t i, n;
+
+    for (i = 0U; i < (USBD_LOG_DEPTH / 5U); i++)
+    {
+        USBD_Log_Put(HDR(i, 3, USBD_LOG_ERR), i, i, i);
+    }
+    CHECK_EQ(USBD_Log_Pending(), (USBD_LOG_DEPTH / 5U) * 5U);
+    CHECK_EQ(USBD_Log_Stats.high, (USBD_LOG_DEPTH / 5U) * 5U);
+    CHECK_EQ(USBD_Log_Stats.dropped, dropped);
+
+    /* 255 of 256 words used: neither a 5- nor a 2-word record fits */
+    USBD_Log_Put(HDR(0x7777, 3, USBD_LOG_ERR), 0U, 0U, 0U);
+    USBD_Log_Put(HDR(0x7778, 0, USBD_LOG_ERR), 0U, 0U, 0U);
+    CHECK_EQ(USBD_Log_Stats.dropped - dropped, 2U);
+    CHECK_EQ(USBD_Log_Pending(), (USBD_LOG_DEPTH / 5U) * 5U);
+
+    /* Make room for one record */
+    CHECK_EQ(USBD_Log_Drain(buf, 5U), 5U);
+    CHECK_EQ(buf[0] >> 24, dropped & 0xFFU);
+    USBD_Log_Put(HDR(0x0ABC, 0, USBD_LOG_ERR), 0U, 0U, 0U);
+
+    n = USBD_Log_Drain(buf, USBD_LOG_DEPTH);
+    CHECK_EQ(n, ((USBD_LOG_DEPTH / 5U) - 1U) * 5U + 2U);
+    CHECK_EQ(buf[n - 2U] & 0xFFFFU, 0x0ABCU);
+    CHECK_EQ(buf[n - 2U] >> 24, (dropped + 2U) & 0xFFU);
+}
+
+/* Many laps of the ring, records straddling its end */
+static void Test_Wrap(void)
+{
+    uint32_t buf[USBD_LOG_DEPTH];
+    uint32_t expect = 0U, got, i, k, n, pos;
+
+    for (i = 0U; i < 2000U; i++)
+    {
+        USBD_Log_Put(HDR(i & 0xFFFFU, i % 4U, USBD_LOG_DBG), i, i + 1U, i + 2U);
+        if ((i % 5U) == 4U)
+        {
+            n = USBD_Log_Drain(buf, USBD_LOG_DEPTH);
+            for (pos = 0U; pos < n; pos += USBD_LOG_HDR_WORDS(buf[pos]))
+            {
+                got = buf[pos] & 0xFFFFU;
+                CHECK_EQ(got, expect);
+                CHECK_EQ(USBD_LOG_HDR_ARGS(buf[pos]), expect % 4U);
+                for (k = 0U; k < USBD_LOG_HDR_ARGS(buf[pos]); k++)
+                {
+                    CHECK_EQ(buf[pos + 2U + k], expect + k);
+                }
+                expect++;
+            }
+            CHECK_EQ(pos, n);
+        }
+    }
+    CHECK_EQ(expect, 2000U);
+    CHECK(USBD_Log_Stats.drained > (4U * USBD_LOG_DEPTH));
+}
+
+/* The call-site macro: format ID, argument count and level */
+static void Test_Macro(void)
+{
+    uint32_t buf[8];
+    int16_t id;
+
+    USBD_LOG(USBD_LOG_ERR, "test %u of %u", 3, 7);
+    USBD_LOG(USBD_LOG_USR, "no arguments");
+
+    CHECK_EQ(USBD_Log_Drain(buf, 8U), 6U);
+    CHECK_EQ(USBD_LOG_HDR_ARGS(buf[0]), 2U);
+    CHECK_EQ(USBD_LOG_HDR_LEVEL(buf[0]), USBD_LOG_ERR);
+    id = (int16_t)(buf[0] & 0xFFFFU);
+    CHECK(strcmp(&Image$$ER_LOGFMT$$Base[id], "test %u of %u") == 0);
+    CHECK_EQ(buf[2], 3U);
+    CHECK_EQ(buf[3], 7U);
+
+    CHECK_EQ(USBD_LOG_HDR_ARGS(buf[4]), 0U);
+    CHECK_EQ(USBD_LOG_HDR_LEVEL(buf[4]), USBD_LOG_USR);
+    id = (int16_t)(buf[4] & 0xFFFFU);
+    CHECK(strcmp(&Image$$ER_LOGFMT$$Base[id], "no arguments") == 0);
+}
+
+/* ---- Concurrent writers, one drain ---- */
+
+#define WRITERS         4U
+#define PER_WRITER      20000U
+
+static __IO uint32_t WritersDone;
+
+static void *Writer(void *arg)
+{
+    uint32_t w = (uint32_t)(uintptr_t)arg;
+    uint32_t i;
+
+    for (i = 0U; i < PER_WRITER; i++)
+    {
+        /* Keep the drain in the race rather than dropping nearly all */
+        while (USBD_Log_Pending() > (USBD_LOG_DEPTH / 2U))
+        {
+            sched_yield();
+        }
+        /* Record length varies with the writer: 2..5 words */
+        USBD_Log_Put(HDR(w, w % 4U, USBD_LOG_DBG), i, ~i, w);
+    }
+    __atomic_add_fetch(&WritersDone, 1U, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+static void Test_Concurrent(void)
+{
+    pthread_t th[WRITERS];
+    uint32_t buf[USBD_LOG_DEPTH];
+    uint32_t next[WRITERS] = { 0 };
+    uint32_t seen = 0U, bad = 0U;
+    uint32_t records = USBD_Log_Stats.records;
+    uint32_t dropped = USBD_Log_Stats.dropped;
+    uint32_t w, n, pos, hdr, idle = 0U;
+
+    for (w = 0U; w < WRITERS; w++)
+    {
+        pthread_create(&th[w], NULL, Writer, (void *)(uintptr_t)w);
+    }
+
+    while (idle < 2U)
+    {
+        if (__atomic_load_n(&WritersDone, __ATOMIC_SEQ_CST) == WRITERS)
+        {
+            idle++;
+        }
+        n = USBD_Log_Drain(buf, USBD_LOG_DEPTH);
+        if (n == 0U)
+        {
+            sched_yield();
+        }
+        for (pos = 0U; pos < n; pos += USBD_LOG_HDR_WORDS(hdr))
+        {
+            hdr = buf[pos];
+            w = hdr & 0xFFFFU;
+            if ((w >= WRITERS) || (USBD_LOG_HDR_ARGS(hdr) != (w % 4U)))
+            {
+                bad++;
+                break;
+            }
+            /* Each writer's records arrive in order; drops leave gaps */
+            if (((USBD_LOG_HDR_ARGS(hdr) >= 1U) && (buf[pos + 2U] < next[w])) ||
+                ((USBD_LOG_HDR_ARGS(hdr) >= 2U) && (buf[pos + 3U] != ~buf[pos + 2U])) ||
+                ((USBD_LOG_HDR_ARGS(hdr) >= 3U) && (buf[pos + 4U] != w)))
+            {
+                bad++;
+            }
+            if (USBD_LOG_HDR_ARGS(hdr) >= 1U)
+            {
+                next[w] = buf[pos + 2U] + 1U;
+            }
+            seen++;
+        }
+    }
+
+    for (w = 0U; w < WRITERS; w++)
+    {
+        pthread_join(th[w], NULL);
+    }
+
+    CHECK_EQ(bad, 0U);
+    CHECK_EQ(USBD_Log_Pending(), 0U);
+    CHECK_EQ(USBD_Log_Stats.records - records, seen);
+    CHECK_EQ((USBD_Log_Stats.records - records) + (USBD_Log_Stats.dropped - dropped), WRITERS * PER_WRITER);
+    CHECK(seen > ((WRITERS * PER_WRITER) / 2U));
+    printf("test_log: %u of %u concurrent records drained, %u dropped\n", (unsigned)seen,
+           (unsigned)(WRITERS * PER_WRITER), (unsigned)(USBD_Log_Stats.dropped - dropped));
+}
+
+int main(void)
+{
+    Drain_All();
+    Test_Layout();
+    Test_WholeRecords();
+    Test_Full();
+    Test_Wrap();
+    Test_Macro();
+    Test_Concurrent();
+    return Test_Report("test_log");
+}
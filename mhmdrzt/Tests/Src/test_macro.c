@@ -0,0 +1,340 @@
+/* Src/test_macro.c */
+#include "host_usb.h"
+#include "usbd_core.h"
+#include "test.h"
+#include <string.h>
+
+/* Macro playback (usbd_hid_macro.h): the step stream uploaded over the
+   vendor channel, and the per-frame merge rules of USBD_HID_Macro_Tick
+   and USBD_HID_Macro_Flush. */
+
+typedef struct
+{
+  uint32_t reports;
+  int32_t  sum_x;
+  int32_t  sum_y;
+  uint32_t presses;       /* reports where button 1 went down */
+  uint8_t  buttons;
+  uint8_t  last[3];
+} Mouse_Capture;
+
+static Host_DeviceTypeDef Dev;
+static Mouse_Capture Cap;
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if ((ep_addr != HID_MOUSE_EPIN_ADDR) || (len != 3U))
+    {
+        return;
+    }
+    Cap.reports++;
+    Cap.sum_x += (int8_t)data[1];
+    Cap.sum_y += (int8_t)data[2];
+    if (((data[0] & 1U) != 0U) && ((Cap.buttons & 1U) == 0U))
+    {
+        Cap.presses++;
+    }
+    Cap.buttons = data[0];
+    memcpy(Cap.last, data, 3U);
+}
+
+/* The encoder a host tool uses: BEGIN, the step bytes in DATA chunks of up
+   to 6 (steps straddle chunks), PLAY */
+static void Macro_Upload(const uint8_t *steps, uint32_t len, uint8_t loops)
+{
+    uint8_t args[7];
+    uint32_t off, n;
+
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_BEGIN, NULL, 0U), CUSTOM_HID_EPOUT_SIZE);
+    for (off = 0U; off < len; off += n)
+    {
+        n = MIN(len - off, 6U);
+        args[0] = (uint8_t)n;
+        memcpy(&args[1], &steps[off], n);
+        CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_DATA, args, (uint8_t)(n + 1U)), CUSTOM_HID_EPOUT_SIZE);
+    }
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_PLAY, &loops, 1U), CUSTOM_HID_EPOUT_SIZE);
+}
+
+static void Macro_Load(const uint8_t *steps, uint16_t len, uint8_t loops)
+{
+    USBD_HID_Macro_Begin(&Dev.dev);
+    CHECK_EQ(USBD_HID_Macro_Append(&Dev.dev, steps, (uint8_t)len), USBD_OK);
+    CHECK_EQ(USBD_HID_Macro_Play(&Dev.dev, loops), USBD_OK);
+}
+
+/* Take whatever Flush armed on 0x81 */
+static void Take(void)
+{
+    memset(Cap.last, 0, sizeof(Cap.last));
+    (void)Host_PollIn(&Dev, HID_MOUSE_EPIN_ADDR);
+}
+
+static void Test_Upload_Playback(void)
+{
+    static const uint8_t steps[] =
+    {
+        0,   0x00,                    10,   0,
+        1,   0x00,                    20, (uint8_t)-5,
+        2,   0x01,                     0,   0,      /* press */
+        1,   0x00,                     0,   0,      /* release */
+        0,   USBD_MACRO_FLAG_WAIT,    99,  99,      /* no report */
+        3,   0x00,   (uint8_t)-100, (uint8_t)-100,
+        0,   0x00,   (uint8_t)-100, (uint8_t)-100,  /* same frame: merged */
+    };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+    uint32_t frame;
+
+    memset(&Cap, 0, sizeof(Cap));
+    Macro_Upload(steps, sizeof(steps), 2U);
+    CHECK_EQ(hmacro->len, sizeof(steps));
+    CHECK(memcmp(hmacro->buf, steps, sizeof(steps)) == 0);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_PLAYING);
+
+    /* Appending while playing is refused */
+    CHECK_EQ(USBD_HID_Macro_Append(&Dev.dev, steps, 4U), USBD_FAIL);
+
+    for (frame = 0U; (frame < 100U) && (USBD_HID_Macro_State(&Dev.dev) == USBD_MACRO_PLAYING); frame++)
+    {
+        Host_Frame(&Dev);
+    }
+    for (frame = 0U; frame < 10U; frame++)
+    {
+        Host_Frame(&Dev);
+    }
+
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+    CHECK_EQ(Cap.sum_x, 2 * (10 + 20 - 200));
+    CHECK_EQ(Cap.sum_y, 2 * (-5 - 200));
+    CHECK_EQ(Cap.presses, 2U);
+    CHECK_EQ(Cap.buttons, 0U);
+    CHECK_EQ(hmacro->dirty, 0U);
+}
+
+static void Test_Upload_Limits(void)
+{
+    uint8_t args[8] = { 7, 1, 2, 3, 4, 5, 6, 7 };
+    uint32_t i;
+
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_BEGIN, NULL, 0U), CUSTOM_HID_EPOUT_SIZE);
+    /* More than fits in the report */
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_DATA, args, 7U), CUSTOM_HID_EPOUT_SIZE);
+    CHECK_EQ(Dev.ctx.macro.len, 0U);
+    args[0] = 6U;
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_DATA, args, 7U), CUSTOM_HID_EPOUT_SIZE);
+    CHECK_EQ(Dev.ctx.macro.len, 6U);
+
+    /* The trailing partial step is dropped at PLAY */
+    CHECK_EQ(USBD_HID_Macro_Play(&Dev.dev, 1U), USBD_OK);
+    CHECK_EQ(Dev.ctx.macro.len, USBD_MACRO_STEP_SIZE);
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_MACRO_STOP, NULL, 0U), CUSTOM_HID_EPOUT_SIZE);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+
+    /* Nothing to play */
+    USBD_HID_Macro_Begin(&Dev.dev);
+    CHECK_EQ(USBD_HID_Macro_Play(&Dev.dev, 1U), USBD_FAIL);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+
+    /* The buffer bound */
+    memset(args, 0, sizeof(args));
+    for (i = 0U; i < (USBD_MACRO_BUF_SIZE / 4U); i++)
+    {
+        CHECK_EQ(USBD_HID_Macro_Append(&Dev.dev, args, 4U), USBD_OK);
+    }
+    CHECK_EQ(USBD_HID_Macro_Append(&Dev.dev, args, 1U), USBD_FAIL);
+}
+
+/* Zero-delay steps land in the same frame and are summed */
+static void Test_Tick_Merge(void)
+{
+    static const uint8_t steps[] = { 0, 0, 5, 1,   0, 0, 6, 2 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+
+    Macro_Load(steps, sizeof(steps), 1U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->acc_x, 11);
+    CHECK_EQ(hmacro->acc_y, 3);
+    CHECK_EQ(hmacro->dirty, 1U);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+    CHECK_EQ(Cap.last[1], 11U);
+    CHECK_EQ(Cap.last[2], 3U);
+    CHECK_EQ(hmacro->dirty, 0U);
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 0U);
+}
+
+/* An all-zero-delay loop advances one pass per frame, not forever */
+static void Test_Tick_OnePass(void)
+{
+    static const uint8_t steps[] = { 0, 0, 5, 0,   0, 0, 6, 0 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+
+    Macro_Load(steps, sizeof(steps), 0U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->acc_x, 11);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->acc_x, 22);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_PLAYING);
+    /* Stop ends playback and drops what was not sent */
+    USBD_HID_Macro_Stop(&Dev.dev);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->acc_x, 0);
+    CHECK_EQ(hmacro->dirty, 0U);
+}
+
+/* A button change is not merged into pending motion of another button
+   state: the timeline holds until that motion has been sent */
+static void Test_Tick_ButtonHold(void)
+{
+    static const uint8_t steps[] = { 0, 1, 1, 0,   0, 0, 2, 0 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+
+    Macro_Load(steps, sizeof(steps), 1U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->buttons, 1U);
+    CHECK_EQ(hmacro->acc_x, 1);
+    CHECK_EQ(hmacro->pos, USBD_MACRO_STEP_SIZE);
+
+    /* Still held while the press has not gone out */
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->pos, USBD_MACRO_STEP_SIZE);
+
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+    CHECK_EQ(Cap.last[0], 1U);
+    CHECK_EQ(Cap.last[1], 1U);
+
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->buttons, 0U);
+    CHECK_EQ(hmacro->acc_x, 2);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+    CHECK_EQ(Cap.last[0], 0U);
+    CHECK_EQ(Cap.last[1], 2U);
+}
+
+/* Motion beyond int8 goes out as +-127 with the rest carried */
+static void Test_Flush_Clamp(void)
+{
+    static const uint8_t steps[] =
+    {
+        0, 0, 100, (uint8_t)-100,
+        0, 0, 100, (uint8_t)-100,
+    };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+
+    Macro_Load(steps, sizeof(steps), 1U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->acc_x, 200);
+    CHECK_EQ(hmacro->acc_y, -200);
+
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    /* 0x81 is still busy: nothing more goes out, nothing is lost */
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 0U);
+    Take();
+    CHECK_EQ((int8_t)Cap.last[1], 127);
+    CHECK_EQ((int8_t)Cap.last[2], -127);
+    CHECK_EQ(hmacro->acc_x, 73);
+    CHECK_EQ(hmacro->acc_y, -73);
+    CHECK_EQ(hmacro->dirty, 1U);
+
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+    CHECK_EQ((int8_t)Cap.last[1], 73);
+    CHECK_EQ((int8_t)Cap.last[2], -73);
+    CHECK_EQ(hmacro->dirty, 0U);
+}
+
+/* WAIT steps take time but produce nothing; delays count frames */
+static void Test_Tick_Wait(void)
+{
+    static const uint8_t steps[] = { 0, USBD_MACRO_FLAG_WAIT, 50, 50,   2, 0, 1, 0 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+
+    Macro_Load(steps, sizeof(steps), 1U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->dirty, 0U);
+    CHECK_EQ(hmacro->acc_x, 0);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->dirty, 0U);
+    USBD_HID_Macro_Tick(&Dev.dev);
+    CHECK_EQ(hmacro->dirty, 1U);
+    CHECK_EQ(hmacro->acc_x, 1);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+}
+
+/* `loops` passes, then idle */
+static void Test_Tick_Loops(void)
+{
+    static const uint8_t steps[] = { 1, 0, 1, 0 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+    uint32_t ticks;
+
+    Macro_Load(steps, sizeof(steps), 3U);
+    for (ticks = 0U; (ticks < 10U) && (USBD_HID_Macro_State(&Dev.dev) == USBD_MACRO_PLAYING); ticks++)
+    {
+        USBD_HID_Macro_Tick(&Dev.dev);
+    }
+    CHECK_EQ(ticks, 3U);
+    CHECK_EQ(hmacro->acc_x, 3);
+    CHECK_EQ(USBD_HID_Macro_Flush(&Dev.dev), 1U);
+    Take();
+}
+
+/* Motion left over when the cable goes stays with that session */
+static void Test_Detach(void)
+{
+    static const uint8_t steps[] = { 0, 0x01, 100, 100 };
+    USBD_HID_Macro_HandleTypeDef *hmacro = &Dev.ctx.macro;
+    uint32_t frame;
+
+    Macro_Upload(steps, sizeof(steps), 0U);
+    /* The host stops polling: 0x81 stays busy while motion piles up */
+    for (frame = 0U; frame < 5U; frame++)
+    {
+        Host_SOF(&Dev);
+    }
+    CHECK_EQ(hmacro->dirty, 1U);
+    CHECK(hmacro->acc_x > 127);
+
+    (void)USBD_LL_DevDisconnected(&Dev.dev);
+    CHECK_EQ(USBD_HID_Macro_State(&Dev.dev), USBD_MACRO_IDLE);
+    CHECK_EQ(hmacro->dirty, 0U);
+
+    Host_BusReset(&Dev);
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    memset(&Cap, 0, sizeof(Cap));
+    for (frame = 0U; frame < 20U; frame++)
+    {
+        Host_Frame(&Dev);
+    }
+    CHECK_EQ(Cap.reports, 0U);
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    Dev.on_in = On_In;
+
+    Test_Upload_Playback();
+    Test_Upload_Limits();
+
+    /* Tick and Flush driven by hand, no SOF */
+    USBD_HID_Macro_Stop(&Dev.dev);
+    Test_Tick_Merge();
+    Test_Tick_OnePass();
+    Test_Tick_ButtonHold();
+    Test_Flush_Clamp();
+    Test_Tick_Wait();
+    Test_Tick_Loops();
+    Test_Detach();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report("test_macro");
+}
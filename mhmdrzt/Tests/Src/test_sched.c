@@ -0,0 +1,140 @@
+/* Src/test_sched.c */
+#include "host_usb.h"
+#include "usbd_report_sched.h"
+#include "test.h"
+
+/* Mouse report scheduler (usbd_report_sched.h) against a host that polls
+   0x81 once every bInterval frames, in a slot of its own choosing: the
+   report is sampled `phase` frames ahead of the poll at every phase the
+   interval allows, and when the host moves its slot the scheduler
+   re-measures and locks on to the new one. */
+
+#define INTERVAL        10U      /* mouse bInterval, frames */
+
+static Host_DeviceTypeDef Dev;
+static uint16_t Slot;            /* the host polls 0x81 when frame % INTERVAL == Slot */
+static uint32_t Polls;
+static uint32_t Taken;
+
+/* Something to report in every frame */
+uint8_t USBD_Sched_SampleCallback(USBD_HandleTypeDef *pdev, uint8_t *report)
+{
+    report[0] = 0U;
+    report[1] = 1U;
+    report[2] = 0U;
+    return 1U;
+}
+
+static void Frames(uint32_t n)
+{
+    while (n-- != 0U)
+    {
+        Host_SOF(&Dev);
+        if ((Dev.frame % INTERVAL) == Slot)
+        {
+            Polls++;
+            Taken += (Host_PollIn(&Dev, HID_MOUSE_EPIN_ADDR) > 0) ? 1U : 0U;
+        }
+    }
+}
+
+/* Frames up to the next poll, that one included */
+static void To_Poll(void)
+{
+    uint32_t polls = Polls;
+
+    while (Polls == polls)
+    {
+        Frames(1U);
+    }
+}
+
+static void Lat_Clear(void)
+{
+    Dev.ctx.sched.stats.lat_min = 0xFFFFU;
+    Dev.ctx.sched.stats.lat_max = 0U;
+}
+
+/* Every phase 0..INTERVAL-1: each report waits exactly `phase` frames, and
+   no poll goes without one */
+static void Test_PhaseSweep(void)
+{
+    const USBD_Sched_StatsTypeDef *stats = &Dev.ctx.sched.stats;
+    uint32_t reports, polls, taken;
+    uint16_t phase;
+
+    for (phase = 0U; phase < INTERVAL; phase++)
+    {
+        USBD_Sched_SetPhase(&Dev.dev, phase);
+        Frames(3U * INTERVAL);
+        Lat_Clear();
+        reports = stats->reports;
+        polls = Polls;
+        taken = Taken;
+
+        Frames(8U * INTERVAL);
+        CHECK_EQ(stats->period, INTERVAL);
+        CHECK_EQ(stats->lat_last, phase);
+        CHECK_EQ(stats->lat_min, phase);
+        CHECK_EQ(stats->lat_max, phase);
+        CHECK_EQ(Taken - taken, Polls - polls);
+        CHECK_EQ(stats->reports - reports, Polls - polls);
+    }
+}
+
+/* The host moves its slot `shift` frames later. A report that waits more
+   than a frame past its prediction, or a poll NAKed because it came
+   before the sample, makes the scheduler probe the period again; a
+   smaller miss is absorbed. Either way every report waits `phase` frames
+   again within a few polls. */
+static void Slot_Move(uint16_t shift, uint16_t phase, uint8_t reprobe)
+{
+    const USBD_Sched_StatsTypeDef *stats = &Dev.ctx.sched.stats;
+    uint8_t probed = 0U;
+    uint32_t reports;
+    uint8_t i;
+
+    USBD_Sched_SetPhase(&Dev.dev, phase);
+    Frames(3U * INTERVAL);
+    CHECK_EQ(stats->lat_last, phase);
+    To_Poll();
+
+    Slot = (uint16_t)((Slot + shift) % INTERVAL);
+    for (i = 0U; i < 4U; i++)
+    {
+        To_Poll();
+        probed |= Dev.ctx.sched.probe;
+    }
+    CHECK_EQ(probed, reprobe);
+    CHECK_EQ(Dev.ctx.sched.probe, 0U);
+    CHECK_EQ(stats->period, INTERVAL);
+
+    Lat_Clear();
+    reports = stats->reports;
+    Frames(8U * INTERVAL);
+    CHECK_EQ(stats->lat_min, phase);
+    CHECK_EQ(stats->lat_max, phase);
+    CHECK_EQ(stats->reports - reports, 8U);
+}
+
+static void Test_SlotMove(void)
+{
+    Slot_Move(3U, 2U, 1U);                          /* 5 frames instead of 2 */
+    Slot_Move(INTERVAL - 4U, 2U, 1U);               /* NAKed, then 8 frames */
+    Slot_Move(1U, 0U, 0U);                          /* 1 frame instead of 0 */
+    Slot_Move(INTERVAL - 1U, 0U, 1U);               /* NAKed, then 9 frames */
+    Slot_Move(INTERVAL - 1U, INTERVAL - 1U, 0U);    /* 8 frames instead of 9 */
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    Slot = 7U;
+
+    Test_PhaseSweep();
+    Test_SlotMove();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report("test_sched");
+}
@@ -0,0 +1,268 @@
+/* Src/test_stripe.c */
+#include "host_usb.h"
+#include "test.h"
+#include <string.h>
+
+/* Vendor stream striping (usbd_stripe.h) as a host sees it: chunks arrive
+   on three endpoints in whatever order the host polls them, and merging
+   them by the 5-bit sequence number gives back the stream written. */
+
+#define STREAM_MAX      16384U
+#define SEQ_WINDOW      32U
+
+typedef struct
+{
+  /* Chunks waiting for their turn, by sequence number */
+  uint8_t  pending[SEQ_WINDOW][USBD_STRIPE_CHUNK_SIZE];
+  uint8_t  pending_len[SEQ_WINDOW];
+  uint8_t  have[SEQ_WINDOW];
+  uint8_t  next;
+  uint8_t  data[STREAM_MAX];
+  uint32_t len;
+  uint32_t chunks;
+  uint32_t per_ep[4];
+  uint32_t bad;           /* length field out of range, nonzero padding, duplicate */
+  uint32_t abs_reports;
+  uint32_t replies;       /* vendor reports: command replies */
+} Stripe_Merge;
+
+static Host_DeviceTypeDef Dev;
+static Stripe_Merge M;
+static Host_StreamTypeDef Sent;
+
+static void Merge_Chunk(uint8_t ep, const uint8_t *report)
+{
+    uint8_t n = report[1] >> 5;
+    uint8_t seq = report[1] & 0x1FU;
+    uint8_t i;
+
+    if ((n == 0U) || (n > USBD_STRIPE_CHUNK_SIZE) || (M.have[seq] != 0U))
+    {
+        M.bad++;
+        return;
+    }
+    for (i = n; i < USBD_STRIPE_CHUNK_SIZE; i++)
+    {
+        if (report[2U + i] != 0U)
+        {
+            M.bad++;
+        }
+    }
+
+    memcpy(M.pending[seq], &report[2], n);
+    M.pending_len[seq] = n;
+    M.have[seq] = 1U;
+    M.chunks++;
+    M.per_ep[ep & 0x0FU]++;
+
+    while (M.have[M.next] != 0U)
+    {
+        if ((M.len + M.pending_len[M.next]) <= STREAM_MAX)
+        {
+            memcpy(&M.data[M.len], M.pending[M.next], M.pending_len[M.next]);
+        }
+        M.len += M.pending_len[M.next];
+        M.have[M.next] = 0U;
+        M.next = (M.next + 1U) & 0x1FU;
+    }
+}
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if ((len == CUSTOM_HID_EPIN_SIZE) && (data[0] == CUSTOM_HID_REPORT_ID_STREAM))
+    {
+        Merge_Chunk(ep_addr, data);
+    }
+    else if ((len == CUSTOM_HID_EPIN_SIZE) && (data[0] == CUSTOM_HID_REPORT_ID_VENDOR))
+    {
+        M.replies++;
+    }
+    else if ((len == CUSTOM_HID_ABS_REPORT_SIZE) && (data[0] == CUSTOM_HID_REPORT_ID_ABS))
+    {
+        M.abs_reports++;
+    }
+}
+
+/* One frame with the three channels polled in a rotating order, and
+   `skip` (if any) not polled at all */
+static void Stripe_Frame(uint32_t frame, uint8_t skip)
+{
+    static const uint8_t eps[3] = { 0x82U, USBD_STRIPE_CH1_EPIN_ADDR, USBD_STRIPE_CH2_EPIN_ADDR };
+    uint8_t i, ep;
+
+    Host_SOF(&Dev);
+    for (i = 0U; i < 3U; i++)
+    {
+        ep = eps[(frame + i) % 3U];
+        if (ep != skip)
+        {
+            (void)Host_PollIn(&Dev, ep);
+        }
+    }
+}
+
+static uint16_t Stripe_Write(uint16_t len)
+{
+    return Host_StreamWrite(&Dev, &Sent, USBD_Stripe_Write, len);
+}
+
+static void Stripe_Start(uint8_t seed)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_VENDOR_X3), USBD_OK);
+    Dev.on_in = On_In;
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    CHECK_EQ(Dev.ctx.stripe.stats.channels, 3U);
+    memset(&M, 0, sizeof(M));
+    Host_StreamReset(&Sent, seed);
+}
+
+/* Chunk layout and the length field */
+static void Test_Chunks(void)
+{
+    uint8_t *report;
+
+    Stripe_Start(0x10U);
+
+    /* 7 + 3: the first chunk is armed at once on a free channel, the
+       second on the next one */
+    CHECK_EQ(Stripe_Write(10U), 10U);
+    CHECK_EQ(Dev.ctx.stripe.stats.chunks, 2U);
+    CHECK_EQ(Dev.ctx.stripe.tail, Dev.ctx.stripe.head);
+
+    CHECK(Dev.in[2].armed != 0U);
+    report = Dev.in[2].buf;
+    CHECK_EQ(report[0], CUSTOM_HID_REPORT_ID_STREAM);
+    CHECK_EQ(report[1], (7U << 5) | 0U);
+    CHECK(memcmp(&report[2], &Sent.data[0], 7U) == 0);
+
+    CHECK(Dev.in[3].armed != 0U);
+    report = Dev.in[3].buf;
+    CHECK_EQ(report[1], (3U << 5) | 1U);
+    CHECK(memcmp(&report[2], &Sent.data[7], 3U) == 0);
+    CHECK_EQ(report[5] | report[6] | report[7] | report[8], 0U);
+    CHECK_EQ(Dev.in[1].armed, 0U);
+
+    Stripe_Frame(0U, 0U);
+    CHECK_EQ(M.len, 10U);
+    CHECK(memcmp(M.data, Sent.data, 10U) == 0);
+    CHECK_EQ(M.bad, 0U);
+}
+
+/* A long stream: every channel used, the sequence number wraps many
+   times, the merged stream is what was written */
+static void Test_Merge(void)
+{
+    USBD_Stripe_HandleTypeDef *hstripe = &Dev.ctx.stripe;
+    uint32_t frame;
+
+    Stripe_Start(0U);
+    for (frame = 0U; Sent.len < (12U * 1024U); frame++)
+    {
+        (void)Stripe_Write((uint16_t)(1U + (frame * 29U) % 23U));
+        /* The host now and then skips a channel for a frame */
+        Stripe_Frame(frame, ((frame % 7U) == 3U) ? USBD_STRIPE_CH1_EPIN_ADDR :
+                            ((frame % 11U) == 5U) ? 0x82U : 0U);
+    }
+    for (frame = 0U; frame < 64U; frame++)
+    {
+        Stripe_Frame(frame, 0U);
+    }
+
+    CHECK_EQ(hstripe->stats.dropped, 0U);
+    CHECK_EQ(M.bad, 0U);
+    CHECK_EQ(M.len, Sent.len);
+    CHECK(memcmp(M.data, Sent.data, Sent.len) == 0);
+    CHECK_EQ(M.chunks, hstripe->stats.chunks);
+    CHECK(M.chunks > (4U * SEQ_WINDOW));
+    CHECK_EQ(hstripe->seq & 0x1FU, M.next);
+    CHECK(M.per_ep[1] != 0U);
+    CHECK(M.per_ep[2] != 0U);
+    CHECK(M.per_ep[3] != 0U);
+    CHECK_EQ(hstripe->stats.reports[0] + hstripe->stats.reports[1] + hstripe->stats.reports[2], M.chunks);
+    CHECK_EQ(hstripe->stats.reports[0], M.per_ep[2]);
+    CHECK_EQ(hstripe->stats.reports[1], M.per_ep[3]);
+    CHECK_EQ(hstripe->stats.reports[2], M.per_ep[1]);
+    CHECK_EQ(Dev.ll_errors, 0U);
+}
+
+/* Channel 0 still carries its own reports; the stream flows around them,
+   and the stream ID keeps replies out of the merge */
+static void Test_Channel0_Reports(void)
+{
+    uint8_t abs[5] = { 0, 1, 2, 3, 4 };
+    uint8_t cls = USBD_ARB_CLASS_STREAM;
+    uint32_t frame;
+
+    Stripe_Start(0x77U);
+    for (frame = 0U; frame < 200U; frame++)
+    {
+        (void)Stripe_Write(14U);
+        if ((frame % 10U) == 0U)
+        {
+            CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_ABS_MOVE, abs, sizeof(abs)), CUSTOM_HID_EPOUT_SIZE);
+        }
+        if ((frame % 25U) == 5U)
+        {
+            CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_ARB_STATS, &cls, 1U), CUSTOM_HID_EPOUT_SIZE);
+        }
+        Stripe_Frame(frame, 0U);
+    }
+    for (frame = 0U; frame < 64U; frame++)
+    {
+        Stripe_Frame(frame, 0U);
+    }
+
+    CHECK_EQ(M.abs_reports, 20U);
+    CHECK_EQ(M.replies, 8U);
+    CHECK_EQ(M.bad, 0U);
+    CHECK_EQ(M.len, Sent.len);
+    CHECK(memcmp(M.data, Sent.data, Sent.len) == 0);
+}
+
+/* A full ring refuses the rest and counts it */
+static void Test_Full(void)
+{
+    uint32_t frame;
+
+    Stripe_Start(0U);
+    CHECK_EQ(Stripe_Write(USBD_STRIPE_RING_SIZE), USBD_STRIPE_RING_SIZE);
+    /* The three channels took one chunk each at once, freeing 21 bytes */
+    CHECK_EQ(Stripe_Write(30U), 21U);
+    CHECK_EQ(Dev.ctx.stripe.stats.dropped, 9U);
+    for (frame = 0U; frame < 100U; frame++)
+    {
+        Stripe_Frame(frame, 0U);
+    }
+    CHECK_EQ(M.len, Sent.len);
+    CHECK(memcmp(M.data, Sent.data, Sent.len) == 0);
+}
+
+/* The extra channels report the stream collection alone */
+static void Test_Descriptors(void)
+{
+    uint8_t desc[256];
+    uint8_t i;
+
+    Stripe_Start(0U);
+    for (i = 1U; i < 3U; i++)
+    {
+        CHECK_EQ(Host_Control(&Dev, 0x81U, USB_REQ_GET_DESCRIPTOR, 0x22U << 8, i, sizeof(desc), desc),
+                 CUSTOM_HID_STREAM_DESC_SIZE);
+        CHECK_EQ(desc[7], 0x85U);
+        CHECK_EQ(desc[8], CUSTOM_HID_REPORT_ID_STREAM);
+        CHECK_EQ(desc[CUSTOM_HID_STREAM_DESC_SIZE - 1U], 0xC0U);
+    }
+    CHECK_EQ(Host_Control(&Dev, 0x81U, USB_REQ_GET_DESCRIPTOR, 0x22U << 8, 0U, sizeof(desc), desc),
+             CUSTOM_HID_REPORT_DESC_SIZE);
+    CHECK_EQ(desc[8], CUSTOM_HID_REPORT_ID_STREAM);
+}
+
+int main(void)
+{
+    Test_Chunks();
+    Test_Merge();
+    Test_Channel0_Reports();
+    Test_Full();
+    Test_Descriptors();
+    return Test_Report("test_stripe");
+}
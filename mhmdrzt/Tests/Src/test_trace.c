@@ -0,0 +1,242 @@
+/* Src/test_trace.c */
+#include "host_usb.h"
+#include "usbd_trace.h"
+#include "test.h"
+#include <string.h>
+
+/* Event trace (usbd_trace.h): ring stamps, and the dump on 0x82 as a host
+   sees it. Dump entries carry their own report ID, declared in the
+   report descriptor, so nothing else on 0x82 can be taken for one. Each
+   instance has its own ring; board events land on the USBD_TRACE_PORT
+   one. */
+
+#define MAX_ENTRIES     512U
+
+static Host_DeviceTypeDef Dev;
+static Host_DeviceTypeDef Other;
+static USBD_Trace_EntryTypeDef Got[MAX_ENTRIES];
+static uint32_t GotCount;
+static uint32_t Others;          /* 0x82 reports that are not trace entries */
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if (ep_addr != CUSTOM_HID_EPIN_ADDR)
+    {
+        return;
+    }
+    if ((len == CUSTOM_HID_EPIN_SIZE) && (data[0] == CUSTOM_HID_REPORT_ID_TRACE))
+    {
+        if (GotCount < MAX_ENTRIES)
+        {
+            Got[GotCount].frame = (uint16_t)(data[1] | (data[2] << 8));
+            Got[GotCount].type = data[3];
+            Got[GotCount].arg = data[4];
+            Got[GotCount].cycles = (uint32_t)data[5] | ((uint32_t)data[6] << 8) |
+                                   ((uint32_t)data[7] << 16) | ((uint32_t)data[8] << 24);
+        }
+        GotCount++;
+    }
+    else
+    {
+        Others++;
+    }
+}
+
+static void Frames(uint32_t n)
+{
+    while (n-- != 0U)
+    {
+        Host_Frame(&Dev);
+    }
+}
+
+static void Dump(uint16_t count)
+{
+    uint8_t args[2] = { LOBYTE(count), HIBYTE(count) };
+
+    GotCount = 0U;
+    Others = 0U;
+    CHECK_EQ(Host_VendorCommand(&Dev, CUSTOM_HID_CMD_TRACE_DUMP, args, sizeof(args)), CUSTOM_HID_EPOUT_SIZE);
+}
+
+/* Each entry is stamped with the last SOF's frame and the cycles since it;
+   board events go to the instance of USBD_TRACE_PORT */
+static void Test_Stamps(void)
+{
+    const USBD_Trace_EntryTypeDef *ring = USBD_Trace_Ring(&Dev.dev);
+    uint32_t head = *USBD_Trace_Head(&Dev.dev);
+
+    Host_DWT.CYCCNT = 5000U;
+    USBD_Trace_SOF(&Dev.dev, 0x123U);
+    Host_DWT.CYCCNT = 5250U;
+    USBD_Trace_Board(USBD_TRACE_EV_KEY, 0x02U);
+    Host_DWT.CYCCNT = 5400U;
+    USBD_Trace_Board(USBD_TRACE_EV_CLOCK, 1U);
+
+    CHECK_EQ(*USBD_Trace_Head(&Dev.dev), head + 2U);
+    CHECK_EQ(ring[head & (USBD_TRACE_DEPTH - 1U)].frame, 0x123U);
+    CHECK_EQ(ring[head & (USBD_TRACE_DEPTH - 1U)].type, USBD_TRACE_EV_KEY);
+    CHECK_EQ(ring[head & (USBD_TRACE_DEPTH - 1U)].arg, 0x02U);
+    CHECK_EQ(ring[head & (USBD_TRACE_DEPTH - 1U)].cycles, 250U);
+    CHECK_EQ(ring[(head + 1U) & (USBD_TRACE_DEPTH - 1U)].type, USBD_TRACE_EV_CLOCK);
+    CHECK_EQ(ring[(head + 1U) & (USBD_TRACE_DEPTH - 1U)].cycles, 400U);
+}
+
+/* The report descriptor of the vendor interface declares the trace ID,
+   and its length is the one the HID descriptor announces */
+static void Test_Descriptor(void)
+{
+    uint8_t desc[256];
+    uint8_t ids[8];
+    uint8_t n = 0U, i, size, trace = 0U;
+    int32_t len;
+    int32_t pos;
+
+    len = Host_Control(&Dev, 0x81U, USB_REQ_GET_DESCRIPTOR, 0x22U << 8, 1U, sizeof(desc), desc);
+    CHECK_EQ(len, CUSTOM_HID_REPORT_DESC_SIZE);
+    CHECK_EQ(desc[len - 1], 0xC0U);
+
+    for (pos = 0; pos < len; pos += 1 + size)
+    {
+        size = ((desc[pos] & 0x03U) == 3U) ? 4U : (desc[pos] & 0x03U);
+        if ((desc[pos] == 0x85U) && (n < sizeof(ids)))
+        {
+            ids[n++] = desc[pos + 1];
+        }
+    }
+    CHECK_EQ(pos, len);
+    for (i = 0U; i < n; i++)
+    {
+        trace += (ids[i] == CUSTOM_HID_REPORT_ID_TRACE) ? 1U : 0U;
+        CHECK(ids[i] != 0U);
+    }
+    CHECK_EQ(trace, 1U);
+}
+
+/* The newest entries in order, then the end marker; the IN completions of
+   the dump itself are not recorded */
+static void Test_Dump(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        USBD_Trace_Record(&Dev.dev, USBD_TRACE_EV_KEY, (uint8_t)(0x10U + i));
+    }
+    /* The command is recorded first, so the newest five are the keys and it */
+    Dump(5U);
+    Frames(20U);
+
+    CHECK_EQ(GotCount, 6U);
+    CHECK_EQ(Others, 0U);
+    for (i = 0U; i < 4U; i++)
+    {
+        CHECK_EQ(Got[i].type, USBD_TRACE_EV_KEY);
+        CHECK_EQ(Got[i].arg, 0x10U + i);
+    }
+    CHECK_EQ(Got[4].type, USBD_TRACE_EV_CMD);
+    CHECK_EQ(Got[4].arg, CUSTOM_HID_CMD_TRACE_DUMP);
+    CHECK_EQ(Got[5].type, USBD_TRACE_EV_END);
+    CHECK_EQ(Got[5].arg, 0U);
+
+    /* Nothing further once the dump is over */
+    GotCount = 0U;
+    Frames(5U);
+    CHECK_EQ(GotCount, 0U);
+}
+
+/* Count 0 sends everything held, never more than the ring */
+static void Test_DumpAll(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < (2U * USBD_TRACE_DEPTH); i++)
+    {
+        USBD_Trace_Record(&Dev.dev, USBD_TRACE_EV_KEY, (uint8_t)i);
+    }
+    Dump(0U);
+    Frames(USBD_TRACE_DEPTH + 10U);
+
+    CHECK_EQ(GotCount, USBD_TRACE_DEPTH + 1U);
+    CHECK_EQ(Got[USBD_TRACE_DEPTH - 2U].arg, 0xFFU);
+    CHECK_EQ(Got[USBD_TRACE_DEPTH - 1U].type, USBD_TRACE_EV_CMD);
+    CHECK_EQ(Got[USBD_TRACE_DEPTH].type, USBD_TRACE_EV_END);
+}
+
+/* Entries overwritten mid-dump are skipped and counted in the end marker */
+static void Test_Overrun(void)
+{
+    uint32_t i;
+
+    Dump(0U);
+    Frames(10U);
+    CHECK_EQ(GotCount, 10U);
+    /* The 11th entry is already armed, 117 are left; 40 new entries
+       overwrite the oldest 29 of them */
+    for (i = 0U; i < 40U; i++)
+    {
+        USBD_Trace_Record(&Dev.dev, USBD_TRACE_EV_KEY, 0xEEU);
+    }
+    Frames(USBD_TRACE_DEPTH + 10U);
+
+    CHECK_EQ(Got[GotCount - 1U].type, USBD_TRACE_EV_END);
+    CHECK_EQ(Got[GotCount - 1U].arg, 29U);
+    /* Every entry of the request either arrived or was counted lost */
+    CHECK_EQ((GotCount - 1U) + Got[GotCount - 1U].arg, USBD_TRACE_DEPTH);
+    CHECK_EQ(Others, 0U);
+}
+
+/* A bus reset drops the running dump */
+static void Test_Reset(void)
+{
+    Dump(0U);
+    Frames(3U);
+    Host_BusReset(&Dev);
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+    GotCount = 0U;
+    Frames(USBD_TRACE_DEPTH + 10U);
+    CHECK_EQ(GotCount, 0U);
+}
+
+/* Instances keep separate rings and frame stamps; the last instance bound
+   on USBD_TRACE_PORT takes the board events */
+static void Test_Instances(void)
+{
+    uint32_t head = *USBD_Trace_Head(&Dev.dev);
+    uint32_t other;
+
+    CHECK_EQ(Host_Attach(&Other, USBD_TRACE_PORT, USBD_PERSONALITY_FULL), USBD_OK);
+    CHECK_EQ(Host_Enumerate(&Other), USBD_OK);
+    other = *USBD_Trace_Head(&Other.dev);
+    CHECK_EQ(*USBD_Trace_Head(&Dev.dev), head);
+
+    USBD_Trace_SOF(&Dev.dev, 0x111U);
+    USBD_Trace_SOF(&Other.dev, 0x222U);
+    USBD_Trace_Record(&Dev.dev, USBD_TRACE_EV_KEY, 0x01U);
+    USBD_Trace_Board(USBD_TRACE_EV_CLOCK, 0U);
+
+    CHECK_EQ(*USBD_Trace_Head(&Dev.dev), head + 1U);
+    CHECK_EQ(*USBD_Trace_Head(&Other.dev), other + 1U);
+    CHECK_EQ(USBD_Trace_Ring(&Dev.dev)[head & (USBD_TRACE_DEPTH - 1U)].frame, 0x111U);
+    CHECK_EQ(USBD_Trace_Ring(&Other.dev)[other & (USBD_TRACE_DEPTH - 1U)].frame, 0x222U);
+    CHECK_EQ(USBD_Trace_Ring(&Other.dev)[other & (USBD_TRACE_DEPTH - 1U)].type, USBD_TRACE_EV_CLOCK);
+    CHECK_EQ(Other.ll_errors, 0U);
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, USBD_TRACE_PORT, USBD_PERSONALITY_FULL), USBD_OK);
+    Dev.on_in = On_In;
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+
+    Test_Stamps();
+    Test_Descriptor();
+    Test_Dump();
+    Test_DumpAll();
+    Test_Overrun();
+    Test_Reset();
+    Test_Instances();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report("test_trace");
+}
@@ -0,0 +1,181 @@
+/* Src/test_wake.c */
+#include "host_usb.h"
+#include "main.h"
+#include "usb_device.h"
+#include "clock_gov.h"
+#include "usbd_core.h"
+#include "test.h"
+
+/* Key sampling and remote wakeup of main.c, built as it ships (its main()
+   renamed, see the Makefile) on top of one FS instance. This file is the
+   rest of the board under it: the two keys, the low-power hooks of
+   usbd_conf.c, and the HAL calls main.c makes. */
+
+static Host_DeviceTypeDef Dev;
+static uint8_t Keys;             /* bit 0 = KEY1, bit 1 = KEY2 */
+static uint32_t WakeRequests;
+static uint32_t Reports;
+static int32_t SumX;
+
+/* ---- Board ---- */
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    uint8_t bit = ((GPIOx == KEY1_GPIO_Port) && (GPIO_Pin == KEY1_Pin)) ? 0x01U : 0x02U;
+
+    /* Active low */
+    return ((Keys & bit) != 0U) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+}
+
+uint8_t USBD_LP_Suspended(void)
+{
+    return (Dev.dev.dev_state == USBD_STATE_SUSPENDED) ? 1U : 0U;
+}
+
+uint8_t USBD_LP_RequestWakeup(void)
+{
+    WakeRequests++;
+    return USBD_OK;
+}
+
+uint8_t USBD_LP_WakeupPending(void)
+{
+    return 0U;
+}
+
+void USBD_LP_Process(void)
+{
+}
+
+void MX_GPIO_Init(void)
+{
+}
+
+void MX_USB_DEVICE_Init(void)
+{
+}
+
+void MX_USB_DEVICE_Process(void)
+{
+}
+
+void ClockGov_Init(void)
+{
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+    return HAL_OK;
+}
+
+void HAL_SuspendTick(void)
+{
+}
+
+void HAL_ResumeTick(void)
+{
+}
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry)
+{
+}
+
+/* ---- Host ---- */
+
+static void On_In(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    if ((ep_addr == HID_MOUSE_EPIN_ADDR) && (len == 3U))
+    {
+        Reports++;
+        SumX += (int8_t)data[1];
+    }
+}
+
+static void Frames(uint32_t n)
+{
+    while (n-- != 0U)
+    {
+        Host_Frame(&Dev);
+    }
+}
+
+/* Keys go down while the bus is suspended, and are up again by the time
+   the host has resumed it */
+static void Press_While_Suspended(uint8_t keys)
+{
+    uint32_t requests = WakeRequests;
+
+    (void)USBD_LL_Suspend(&Dev.dev);
+    Keys = keys;
+    HAL_GPIO_EXTI_Callback(KEY1_Pin);
+    CHECK_EQ(WakeRequests - requests, 1U);
+    Keys = 0U;
+    (void)USBD_LL_Resume(&Dev.dev);
+}
+
+/* A held key moves the pointer by 10 per report */
+static void Test_Held(void)
+{
+    Reports = 0U;
+    SumX = 0;
+    Keys = 0x02U;
+    Frames(50U);
+    Keys = 0U;
+    Frames(20U);
+    CHECK(Reports > 0U);
+    CHECK_EQ(SumX, 10 * (int32_t)Reports);
+}
+
+/* A press that is over before the resume still goes out, once */
+static void Test_WakeKey(void)
+{
+    Press_While_Suspended(0x01U);
+    Reports = 0U;
+    SumX = 0;
+    Frames(50U);
+    CHECK_EQ(Reports, 1U);
+    CHECK_EQ(SumX, -10);
+}
+
+/* Both keys queued cancel out, so the wake sample sends nothing; the
+   queue must still be spent, or it cancels every later press */
+static void Test_BothWakeKeys(void)
+{
+    Press_While_Suspended(0x03U);
+    Reports = 0U;
+    SumX = 0;
+    Frames(50U);
+    CHECK_EQ(Reports, 0U);
+
+    Keys = 0x01U;
+    Frames(50U);
+    Keys = 0U;
+    Frames(20U);
+    CHECK(Reports > 0U);
+    CHECK_EQ(SumX, -10 * (int32_t)Reports);
+}
+
+int main(void)
+{
+    CHECK_EQ(Host_Attach(&Dev, DEVICE_FS, USBD_PERSONALITY_FULL), USBD_OK);
+    Dev.on_in = On_In;
+    CHECK_EQ(Host_Enumerate(&Dev), USBD_OK);
+
+    Test_Held();
+    Test_WakeKey();
+    Test_BothWakeKeys();
+    Test_Held();
+
+    CHECK_EQ(Dev.ll_errors, 0U);
+    return Test_Report("test_wake");
+}
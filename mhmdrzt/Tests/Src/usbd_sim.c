@@ -0,0 +1,364 @@
+/* Src/usbd_sim.c */
+#include "host_usb.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Multi-instance simulator: N complete device instances (core handle plus
+   composite context each) driven by T host threads. Every instance is
+   owned by one thread, the way each OTG core is served by its own
+   interrupt. Instances share only the board state of host_board.c (log
+   ring, clock governor), and masking interrupts locks the instance being
+   served, so threads never wait for each other.
+
+     usbd_sim [-n instances] [-t threads[,threads...]] [-f frames]
+
+   Each instance enumerates through the real core, then every frame takes
+   instance-seeded bulk data on 0x83, and regularly plays a macro whose
+   motion is specific to the instance on 0x81 and places the absolute
+   pointer on 0x82 at an instance-specific position. Anything that
+   arrives on the wrong instance, out of order or not at all is counted.
+   Instance 0 is the OTG_FS port (the log drain and the trace clock);
+   the others carry the OTG_HS port ID.
+
+   Reported per thread count: instance-frames per second, the speedup
+   over the first thread count of the list, masks that had to wait for
+   another thread (0 unless instances share state), and PASS or FAIL for
+   cross-talk and LL misuse. Speedup needs as many free cores as threads. */
+
+#define SIM_MACRO_EVERY     250U     /* frames between macro runs */
+#define SIM_MACRO_LOOPS     100U
+#define SIM_ABS_EVERY       50U
+#define SIM_BULK_CHUNK      37U
+
+typedef struct
+{
+  Host_DeviceTypeDef hd;
+  uint32_t index;
+  /* 0x81: motion of this instance's macro runs */
+  int8_t   dx;
+  int32_t  sum_x;
+  int32_t  sum_y;
+  uint32_t macro_runs;
+  /* 0x82: absolute pointer at (index, n) */
+  uint16_t abs_next;
+  uint32_t abs_sent;
+  uint32_t abs_seen;
+  /* 0x83: byte k of the stream is Sim_Byte(index, k) */
+  uint32_t bulk_written;
+  uint32_t bulk_read;
+  uint32_t errors;
+} Sim_Instance;
+
+typedef struct
+{
+  Sim_Instance *inst;
+  uint32_t count;
+  uint32_t thread;
+  uint32_t threads;
+  uint32_t frames;
+  uint32_t contended;       /* out: Host_MaskContended of the thread */
+} Sim_Thread;
+
+static uint8_t Sim_Byte(uint32_t index, uint32_t k)
+{
+    return (uint8_t)((k * 7U) ^ (k >> 8) ^ (index * 0x45U));
+}
+
+static void Sim_OnIn(Host_DeviceTypeDef *hd, uint8_t ep_addr, const uint8_t *data, uint32_t len)
+{
+    Sim_Instance *s = (Sim_Instance *)hd->user;
+    uint32_t i;
+
+    switch (ep_addr)
+    {
+        case HID_MOUSE_EPIN_ADDR:
+            if (len != 3U)
+            {
+                s->errors++;
+                break;
+            }
+            s->sum_x += (int8_t)data[1];
+            s->sum_y += (int8_t)data[2];
+            break;
+
+        case CUSTOM_HID_EPIN_ADDR:
+            if ((len == CUSTOM_HID_ABS_REPORT_SIZE) && (data[0] == CUSTOM_HID_REPORT_ID_ABS))
+            {
+                if (((uint32_t)(data[2] | (data[3] << 8)) != s->index) ||
+                    ((uint32_t)(data[4] | (data[5] << 8)) != (s->abs_seen & CUSTOM_HID_ABS_MAX)))
+                {
+                    s->errors++;
+                }
+                s->abs_seen++;
+            }
+            break;
+
+        case USBD_BULK_EPIN_ADDR:
+            for (i = 0U; i < len; i++)
+            {
+                if (data[i] != Sim_Byte(s->index, s->bulk_read + i))
+                {
+                    s->errors++;
+                    break;
+                }
+            }
+            s->bulk_read += len;
+            break;
+
+        default:
+            s->errors++;
+            break;
+    }
+}
+
+static void Sim_Start(Sim_Instance *s)
+{
+    uint8_t id = (s->index == 0U) ? DEVICE_FS : DEVICE_HS;
+
+    if ((Host_Attach(&s->hd, id, USBD_PERSONALITY_FULL) != USBD_OK))
+    {
+        s->errors++;
+        return;
+    }
+    s->hd.user = s;
+    s->hd.on_in = Sim_OnIn;
+    if (Host_Enumerate(&s->hd) != USBD_OK)
+    {
+        s->errors++;
+    }
+}
+
+static void Sim_Macro(Sim_Instance *s)
+{
+    uint8_t step[7] = { 4U, 1U, 0U, (uint8_t)s->dx, (uint8_t)-s->dx };
+    uint8_t loops = SIM_MACRO_LOOPS;
+
+    (void)Host_VendorCommand(&s->hd, CUSTOM_HID_CMD_MACRO_BEGIN, NULL, 0U);
+    (void)Host_VendorCommand(&s->hd, CUSTOM_HID_CMD_MACRO_DATA, step, 5U);
+    (void)Host_VendorCommand(&s->hd, CUSTOM_HID_CMD_MACRO_PLAY, &loops, 1U);
+    s->macro_runs++;
+}
+
+static void Sim_Abs(Sim_Instance *s)
+{
+    uint8_t args[5] = { 0U, LOBYTE(s->index), HIBYTE(s->index), LOBYTE(s->abs_next), HIBYTE(s->abs_next) };
+
+    /* The next one waits until the last has been taken: the device keeps
+       only the newest position */
+    if (s->abs_seen != s->abs_sent)
+    {
+        return;
+    }
+    (void)Host_VendorCommand(&s->hd, CUSTOM_HID_CMD_ABS_MOVE, args, sizeof(args));
+    s->abs_next = (uint16_t)((s->abs_next + 1U) & CUSTOM_HID_ABS_MAX);
+    s->abs_sent++;
+}
+
+static void Sim_Bulk(Sim_Instance *s)
+{
+    uint8_t buf[SIM_BULK_CHUNK];
+    Host_DeviceTypeDef *prev;
+    uint32_t i;
+
+    for (i = 0U; i < sizeof(buf); i++)
+    {
+        buf[i] = Sim_Byte(s->index, s->bulk_written + i);
+    }
+    /* A direct call into the stack: mask with this instance's lock */
+    prev = Host_Select(&s->hd);
+    s->bulk_written += USBD_Bulk_Write(&s->hd.dev, buf, sizeof(buf));
+    (void)Host_Select(prev);
+}
+
+static void *Sim_Run(void *arg)
+{
+    Sim_Thread *t = (Sim_Thread *)arg;
+    Sim_Instance *s;
+    uint32_t f, i;
+
+    for (i = t->thread; i < t->count; i += t->threads)
+    {
+        Sim_Start(&t->inst[i]);
+    }
+
+    for (f = 0U; f < t->frames; f++)
+    {
+        for (i = t->thread; i < t->count; i += t->threads)
+        {
+            s = &t->inst[i];
+            if ((f % SIM_MACRO_EVERY) == 0U)
+            {
+                Sim_Macro(s);
+            }
+            if ((f % SIM_ABS_EVERY) == (i % SIM_ABS_EVERY))
+            {
+                Sim_Abs(s);
+            }
+            Sim_Bulk(s);
+            Host_Frame(&s->hd);
+        }
+    }
+
+    /* Let the last macro run and the bulk ring drain */
+    for (f = 0U; f < (4U * SIM_MACRO_LOOPS + 16U); f++)
+    {
+        for (i = t->thread; i < t->count; i += t->threads)
+        {
+            Host_Frame(&t->inst[i].hd);
+        }
+    }
+    t->contended = Host_MaskContended();
+    return NULL;
+}
+
+static uint32_t Sim_Check(Sim_Instance *s)
+{
+    int32_t want = (int32_t)(s->macro_runs * SIM_MACRO_LOOPS) * s->dx;
+    uint32_t bad = s->errors + s->hd.ll_errors;
+
+    if ((s->sum_x != want) || (s->sum_y != -want))
+    {
+        printf("  instance %u: 0x81 moved (%d, %d), want (%d, %d)\n", (unsigned)s->index,
+               (int)s->sum_x, (int)s->sum_y, (int)want, (int)-want);
+        bad++;
+    }
+    if ((s->bulk_read != s->bulk_written) || (s->bulk_written == 0U))
+    {
+        printf("  instance %u: 0x83 %u of %u bytes\n", (unsigned)s->index,
+               (unsigned)s->bulk_read, (unsigned)s->bulk_written);
+        bad++;
+    }
+    if ((s->abs_seen != s->abs_sent) || (s->abs_sent == 0U))
+    {
+        printf("  instance %u: 0x82 %u of %u positions\n", (unsigned)s->index,
+               (unsigned)s->abs_seen, (unsigned)s->abs_sent);
+        bad++;
+    }
+    if ((s->errors + s->hd.ll_errors) != 0U)
+    {
+        printf("  instance %u: %u stream errors, %u LL errors\n", (unsigned)s->index,
+               (unsigned)s->errors, (unsigned)s->hd.ll_errors);
+    }
+    return bad;
+}
+
+static double Sim_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* One run: `count` fresh instances on `threads` threads. `base` is the
+   rate of the first run, 0 before it. */
+static uint32_t Sim_Once(uint32_t count, uint32_t threads, uint32_t frames, double *base)
+{
+    Sim_Instance *inst = calloc(count, sizeof(*inst));
+    pthread_t *th = calloc(threads, sizeof(*th));
+    Sim_Thread *arg = calloc(threads, sizeof(*arg));
+    uint32_t bad = 0U;
+    uint32_t contended = 0U;
+    uint32_t i;
+    double t0, dt, rate;
+
+    if ((inst == NULL) || (th == NULL) || (arg == NULL))
+    {
+        fprintf(stderr, "usbd_sim: out of memory\n");
+        exit(2);
+    }
+
+    for (i = 0U; i < count; i++)
+    {
+        inst[i].index = i;
+        inst[i].dx = (int8_t)(1 + (i % 50U));
+    }
+
+    t0 = Sim_Now();
+    for (i = 0U; i < threads; i++)
+    {
+        arg[i] = (Sim_Thread){ inst, count, i, threads, frames };
+        pthread_create(&th[i], NULL, Sim_Run, &arg[i]);
+    }
+    for (i = 0U; i < threads; i++)
+    {
+        pthread_join(th[i], NULL);
+        contended += arg[i].contended;
+    }
+    dt = Sim_Now() - t0;
+    rate = (double)count * (frames + 4U * SIM_MACRO_LOOPS + 16U) / dt;
+    if (*base == 0.0)
+    {
+        *base = rate;
+    }
+
+    for (i = 0U; i < count; i++)
+    {
+        bad += Sim_Check(&inst[i]);
+    }
+    printf("%3u instances %3u threads %10.0f instance-frames/s  x%.2f  %u contended  %s\n",
+           (unsigned)count, (unsigned)threads, rate, rate / *base, (unsigned)contended,
+           (bad == 0U) ? "PASS" : "FAIL");
+
+    free(arg);
+    free(th);
+    free(inst);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 4U;
+    uint32_t frames = 2000U;
+    const char *threads = "1,2,4";
+    const char *p;
+    uint32_t bad = 0U;
+    uint32_t t;
+    double base = 0.0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-n") == 0) && ((i + 1) < argc))
+        {
+            count = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-t") == 0) && ((i + 1) < argc))
+        {
+            threads = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-f") == 0) && ((i + 1) < argc))
+        {
+            frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: usbd_sim [-n instances] [-t threads[,threads...]] [-f frames]\n");
+            return 2;
+        }
+    }
+    if ((count == 0U) || (count > CUSTOM_HID_ABS_MAX) || (frames == 0U))
+    {
+        fprintf(stderr, "usbd_sim: need 1..32767 instances and at least one frame\n");
+        return 2;
+    }
+
+    for (p = threads; *p != '\0'; )
+    {
+        t = (uint32_t)strtoul(p, (char **)&p, 10);
+        if ((t == 0U) || ((*p != ',') && (*p != '\0')))
+        {
+            fprintf(stderr, "usbd_sim: bad thread list '%s'\n", threads);
+            return 2;
+        }
+        bad += Sim_Once(count, MIN(t, count), frames, &base);
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return (bad == 0U) ? 0 : 1;
+}
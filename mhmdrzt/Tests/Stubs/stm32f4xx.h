@@ -0,0 +1,317 @@
+/* stm32f4xx.h -- host stand-in for the CMSIS device header */
+#ifndef __STM32F4XX_H
+#define __STM32F4XX_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Just enough of the device header and the Cortex-M intrinsics for the
+   USB stack, the log ring and clock_profile.h to build and run on the
+   build machine. Everything the stack does to hardware goes through the
+   USBD_LL_* layer, which the tests replace (see host_usb.h); only
+   test_ll_fs runs usbd_conf.c and the lean OTG_FS driver as they ship,
+   on the register model of host_otg.h. The OTG register block below is
+   laid out as on the part for it.
+
+   Interrupt masking and exclusive access are emulated so several host
+   threads can drive device instances at once, the way the interrupt
+   and thread contexts of one core share the board:
+     PRIMASK        one lock per device instance (host_board.c); a
+                    thread that masks interrupts holds the lock of the
+                    instance it serves until it unmasks
+     LDREX/STREX    the reservation is the value read; STREX succeeds
+                    only if the word still holds it */
+#define STM32F429xx
+
+#define __IO                        volatile
+#define __I                         volatile const
+#define __STATIC_INLINE             static inline
+#define __weak                      __attribute__((weak))
+#define __ALIGNED(x)                __attribute__((aligned(x)))
+#define UNUSED(x)                   ((void)(x))
+
+#define READ_REG(REG)               ((REG))
+#define WRITE_REG(REG, VAL)         ((REG) = (VAL))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+  WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+typedef enum
+{
+  DISABLE = 0U,
+  ENABLE = !DISABLE
+} FunctionalState;
+
+typedef enum
+{
+  EXTI0_IRQn        = 6,
+  EXTI3_IRQn        = 9,
+  OTG_FS_WKUP_IRQn  = 42,
+  OTG_FS_IRQn       = 67,
+  OTG_HS_WKUP_IRQn  = 76,
+  OTG_HS_IRQn       = 77
+} IRQn_Type;
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  __IO uint32_t DHCSR;
+  __IO uint32_t DCRSR;
+  __IO uint32_t DCRDR;
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type Host_DWT;
+extern CoreDebug_Type Host_CoreDebug;
+#define DWT                         (&Host_DWT)
+#define CoreDebug                   (&Host_CoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+typedef struct
+{
+  __IO uint32_t CPUID;
+  __IO uint32_t ICSR;
+  __IO uint32_t VTOR;
+  __IO uint32_t AIRCR;
+  __IO uint32_t SCR;
+} SCB_Type;
+
+extern SCB_Type Host_SCB;
+#define SCB                         (&Host_SCB)
+#define SCB_SCR_SLEEPONEXIT_Msk     (1UL << 1)
+#define SCB_SCR_SLEEPDEEP_Msk       (1UL << 2)
+
+extern uint32_t SystemCoreClock;
+
+void     NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void     NVIC_SetPendingIRQ(IRQn_Type IRQn);
+
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t primask);
+void     __disable_irq(void);
+void     __enable_irq(void);
+uint32_t __LDREXW(__IO uint32_t *addr);
+uint32_t __STREXW(uint32_t value, __IO uint32_t *addr);
+void     __CLREX(void);
+
+#define __DMB()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __ISB()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __CLZ(x)                    ((uint8_t)__builtin_clz(x))
+#define __UNALIGNED_UINT32_READ(p)  (*(const uint32_t *)(const void *)(p))
+#define __UNALIGNED_UINT32_WRITE(p, v) ((*(uint32_t *)(void *)(p)) = (v))
+
+__STATIC_INLINE uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0U;
+  uint8_t i;
+
+  for (i = 0U; i < 32U; i++)
+  {
+    result = (result << 1) | (value & 1U);
+    value >>= 1;
+  }
+  return result;
+}
+
+/* ---- USB OTG core ---- */
+
+typedef struct
+{
+  __IO uint32_t GOTGCTL;
+  __IO uint32_t GOTGINT;
+  __IO uint32_t GAHBCFG;
+  __IO uint32_t GUSBCFG;
+  __IO uint32_t GRSTCTL;
+  __IO uint32_t GINTSTS;
+  __IO uint32_t GINTMSK;
+  __IO uint32_t GRXSTSR;
+  __IO uint32_t GRXSTSP;
+  __IO uint32_t GRXFSIZ;
+  __IO uint32_t DIEPTXF0_HNPTXFSIZ;
+  __IO uint32_t HNPTXSTS;
+  uint32_t      Reserved30[2];
+  __IO uint32_t GCCFG;
+  __IO uint32_t CID;
+  uint32_t      Reserved40[48];
+  __IO uint32_t HPTXFSIZ;
+  __IO uint32_t DIEPTXF[0x0F];
+} USB_OTG_GlobalTypeDef;
+
+typedef struct
+{
+  __IO uint32_t DCFG;
+  __IO uint32_t DCTL;
+  __IO uint32_t DSTS;
+  uint32_t      Reserved0C;
+  __IO uint32_t DIEPMSK;
+  __IO uint32_t DOEPMSK;
+  __IO uint32_t DAINT;
+  __IO uint32_t DAINTMSK;
+  uint32_t      Reserved20;
+  uint32_t      Reserved9;
+  __IO uint32_t DVBUSDIS;
+  __IO uint32_t DVBUSPULSE;
+  __IO uint32_t DTHRCTL;
+  __IO uint32_t DIEPEMPMSK;
+  __IO uint32_t DEACHINT;
+  __IO uint32_t DEACHMSK;
+} USB_OTG_DeviceTypeDef;
+
+typedef struct
+{
+  __IO uint32_t DIEPCTL;
+  uint32_t      Reserved04;
+  __IO uint32_t DIEPINT;
+  uint32_t      Reserved0C;
+  __IO uint32_t DIEPTSIZ;
+  __IO uint32_t DIEPDMA;
+  __IO uint32_t DTXFSTS;
+  uint32_t      Reserved18;
+} USB_OTG_INEndpointTypeDef;
+
+typedef struct
+{
+  __IO uint32_t DOEPCTL;
+  uint32_t      Reserved04;
+  __IO uint32_t DOEPINT;
+  uint32_t      Reserved0C;
+  __IO uint32_t DOEPTSIZ;
+  __IO uint32_t DOEPDMA;
+  uint32_t      Reserved18[2];
+} USB_OTG_OUTEndpointTypeDef;
+
+/* The block must sit below 4 GB: the drivers keep its address in a
+   uint32_t. host_otg.c maps the OTG_FS one; OTG_HS is never touched. */
+#define USB_OTG_FS_PERIPH_BASE      0x50000000UL
+#define USB_OTG_HS_PERIPH_BASE      0x40040000UL
+#define USB_OTG_FS                  ((USB_OTG_GlobalTypeDef *)USB_OTG_FS_PERIPH_BASE)
+#define USB_OTG_HS                  ((USB_OTG_GlobalTypeDef *)USB_OTG_HS_PERIPH_BASE)
+
+#define USB_OTG_DEVICE_BASE         0x800UL
+#define USB_OTG_IN_ENDPOINT_BASE    0x900UL
+#define USB_OTG_OUT_ENDPOINT_BASE   0xB00UL
+#define USB_OTG_EP_REG_SIZE         0x20UL
+#define USB_OTG_PCGCCTL_BASE        0xE00UL
+#define USB_OTG_FIFO_BASE           0x1000UL
+#define USB_OTG_FIFO_SIZE           0x1000UL
+
+/* GRSTCTL bits the core clears when done. The drivers poll them, so the
+   poll is what finishes the operation in the model (Host_Otg_Grstctl);
+   the _Msk values are the plain bits. */
+#define USB_OTG_GRSTCTL_CSRST_Msk   (1UL << 0)
+#define USB_OTG_GRSTCTL_RXFFLSH_Msk (1UL << 4)
+#define USB_OTG_GRSTCTL_TXFFLSH_Msk (1UL << 5)
+#define USB_OTG_GRSTCTL_CSRST       Host_Otg_Grstctl(USB_OTG_GRSTCTL_CSRST_Msk)
+#define USB_OTG_GRSTCTL_RXFFLSH     Host_Otg_Grstctl(USB_OTG_GRSTCTL_RXFFLSH_Msk)
+#define USB_OTG_GRSTCTL_TXFFLSH     Host_Otg_Grstctl(USB_OTG_GRSTCTL_TXFFLSH_Msk)
+#define USB_OTG_GRSTCTL_TXFNUM_Pos  6U
+#define USB_OTG_GRSTCTL_TXFNUM      (0x1FUL << 6)
+#define USB_OTG_GRSTCTL_AHBIDL      (1UL << 31)
+
+uint32_t Host_Otg_Grstctl(uint32_t bit);
+
+#define USB_OTG_GOTGINT_SEDET       (1UL << 2)
+#define USB_OTG_GAHBCFG_GINT        (1UL << 0)
+#define USB_OTG_GUSBCFG_PHYSEL      (1UL << 6)
+#define USB_OTG_GUSBCFG_TRDT_Pos    10U
+#define USB_OTG_GUSBCFG_TRDT        (0xFUL << 10)
+#define USB_OTG_GUSBCFG_FHMOD       (1UL << 29)
+#define USB_OTG_GUSBCFG_FDMOD       (1UL << 30)
+#define USB_OTG_GCCFG_PWRDWN        (1UL << 16)
+#define USB_OTG_GCCFG_VBUSBSEN      (1UL << 19)
+
+#define USB_OTG_GINTSTS_CMOD        (1UL << 0)
+#define USB_OTG_GINTSTS_OTGINT      (1UL << 2)
+#define USB_OTG_GINTSTS_SOF         (1UL << 3)
+#define USB_OTG_GINTSTS_RXFLVL      (1UL << 4)
+#define USB_OTG_GINTSTS_USBSUSP     (1UL << 11)
+#define USB_OTG_GINTSTS_USBRST      (1UL << 12)
+#define USB_OTG_GINTSTS_ENUMDNE     (1UL << 13)
+#define USB_OTG_GINTSTS_IEPINT      (1UL << 18)
+#define USB_OTG_GINTSTS_OEPINT      (1UL << 19)
+#define USB_OTG_GINTSTS_SRQINT      (1UL << 30)
+#define USB_OTG_GINTSTS_WKUINT      (1UL << 31)
+#define USB_OTG_GINTMSK_OTGINT      USB_OTG_GINTSTS_OTGINT
+#define USB_OTG_GINTMSK_SOFM        USB_OTG_GINTSTS_SOF
+#define USB_OTG_GINTMSK_RXFLVLM     USB_OTG_GINTSTS_RXFLVL
+#define USB_OTG_GINTMSK_USBSUSPM    USB_OTG_GINTSTS_USBSUSP
+#define USB_OTG_GINTMSK_USBRST      USB_OTG_GINTSTS_USBRST
+#define USB_OTG_GINTMSK_ENUMDNEM    USB_OTG_GINTSTS_ENUMDNE
+#define USB_OTG_GINTMSK_IEPINT      USB_OTG_GINTSTS_IEPINT
+#define USB_OTG_GINTMSK_OEPINT      USB_OTG_GINTSTS_OEPINT
+#define USB_OTG_GINTMSK_SRQIM       USB_OTG_GINTSTS_SRQINT
+#define USB_OTG_GINTMSK_WUIM        USB_OTG_GINTSTS_WKUINT
+
+#define USB_OTG_GRXSTSP_EPNUM       (0xFUL << 0)
+#define USB_OTG_GRXSTSP_BCNT_Pos    4U
+#define USB_OTG_GRXSTSP_BCNT        (0x7FFUL << 4)
+#define USB_OTG_GRXSTSP_PKTSTS_Pos  17U
+#define USB_OTG_GRXSTSP_PKTSTS      (0xFUL << 17)
+
+#define USB_OTG_DCFG_DSPD           (3UL << 0)
+#define USB_OTG_DCFG_DAD_Pos        4U
+#define USB_OTG_DCFG_DAD            (0x7FUL << 4)
+#define USB_OTG_DCTL_RWUSIG         (1UL << 0)
+#define USB_OTG_DCTL_SDIS           (1UL << 1)
+#define USB_OTG_DCTL_CGINAK         (1UL << 8)
+#define USB_OTG_DSTS_SUSPSTS        (1UL << 0)
+#define USB_OTG_DSTS_ENUMSPD        (3UL << 1)
+#define USB_OTG_DSTS_FNSOF_Pos      8U
+#define USB_OTG_DSTS_FNSOF          (0x3FFFUL << 8)
+
+#define USB_OTG_DIEPMSK_XFRCM       (1UL << 0)
+#define USB_OTG_DOEPMSK_XFRCM       (1UL << 0)
+#define USB_OTG_DOEPMSK_STUPM       (1UL << 3)
+
+#define USB_OTG_DIEPCTL_MPSIZ       (0x7FFUL << 0)
+#define USB_OTG_DIEPCTL_USBAEP      (1UL << 15)
+#define USB_OTG_DIEPCTL_EPTYP_Pos   18U
+#define USB_OTG_DIEPCTL_EPTYP       (3UL << 18)
+#define USB_OTG_DIEPCTL_STALL       (1UL << 21)
+#define USB_OTG_DIEPCTL_TXFNUM_Pos  22U
+#define USB_OTG_DIEPCTL_TXFNUM      (0xFUL << 22)
+#define USB_OTG_DIEPCTL_CNAK        (1UL << 26)
+#define USB_OTG_DIEPCTL_SNAK        (1UL << 27)
+#define USB_OTG_DIEPCTL_SD0PID_SEVNFRM (1UL << 28)
+#define USB_OTG_DIEPCTL_EPDIS       (1UL << 30)
+#define USB_OTG_DIEPCTL_EPENA       (1UL << 31)
+#define USB_OTG_DOEPCTL_MPSIZ       USB_OTG_DIEPCTL_MPSIZ
+#define USB_OTG_DOEPCTL_USBAEP      USB_OTG_DIEPCTL_USBAEP
+#define USB_OTG_DOEPCTL_EPTYP       USB_OTG_DIEPCTL_EPTYP
+#define USB_OTG_DOEPCTL_STALL       USB_OTG_DIEPCTL_STALL
+#define USB_OTG_DOEPCTL_CNAK        USB_OTG_DIEPCTL_CNAK
+#define USB_OTG_DOEPCTL_SNAK        USB_OTG_DIEPCTL_SNAK
+#define USB_OTG_DOEPCTL_SD0PID_SEVNFRM USB_OTG_DIEPCTL_SD0PID_SEVNFRM
+#define USB_OTG_DOEPCTL_EPDIS       USB_OTG_DIEPCTL_EPDIS
+#define USB_OTG_DOEPCTL_EPENA       USB_OTG_DIEPCTL_EPENA
+
+#define USB_OTG_DIEPINT_XFRC        (1UL << 0)
+#define USB_OTG_DIEPINT_TXFE        (1UL << 7)
+#define USB_OTG_DOEPINT_XFRC        (1UL << 0)
+#define USB_OTG_DOEPINT_STUP        (1UL << 3)
+
+#define USB_OTG_DIEPTSIZ_XFRSIZ     (0x7FFFFUL << 0)
+#define USB_OTG_DIEPTSIZ_PKTCNT_Pos 19U
+#define USB_OTG_DIEPTSIZ_PKTCNT     (0x3FFUL << 19)
+#define USB_OTG_DOEPTSIZ_XFRSIZ     USB_OTG_DIEPTSIZ_XFRSIZ
+#define USB_OTG_DOEPTSIZ_PKTCNT_Pos 19U
+#define USB_OTG_DOEPTSIZ_PKTCNT     USB_OTG_DIEPTSIZ_PKTCNT
+#define USB_OTG_DOEPTSIZ_STUPCNT_Pos 29U
+#define USB_OTG_DOEPTSIZ_STUPCNT    (3UL << 29)
+#define USB_OTG_DTXFSTS_INEPTFSAV   (0xFFFFUL << 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4XX_H */
@@ -0,0 +1,265 @@
+/* stm32f4xx_hal.h -- host stand-in for the HAL */
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#ifndef HSE_VALUE
+#define HSE_VALUE                   25000000U
+#endif
+
+/* The key pins of main.h; the board under main.c (test_wake.c) reads them */
+typedef struct GPIO_TypeDef GPIO_TypeDef;
+#define GPIOA                       ((GPIO_TypeDef *)0x40020000UL)
+#define GPIOH                       ((GPIO_TypeDef *)0x40021C00UL)
+#define GPIO_PIN_0                  0x0001U
+#define GPIO_PIN_3                  0x0008U
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0U,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+/* The rest of the pins and the calls MX_GPIO_Init and the OTG MSP make */
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIOB                       ((GPIO_TypeDef *)0x40020400UL)
+#define GPIO_PIN_9                  0x0200U
+#define GPIO_PIN_11                 0x0800U
+#define GPIO_PIN_12                 0x1000U
+#define GPIO_PIN_13                 0x2000U
+#define GPIO_PIN_14                 0x4000U
+#define GPIO_PIN_15                 0x8000U
+#define GPIO_MODE_INPUT             0x00000000U
+#define GPIO_MODE_AF_PP             0x00000002U
+#define GPIO_NOPULL                 0x00000000U
+#define GPIO_SPEED_FREQ_VERY_HIGH   0x00000003U
+#define GPIO_AF10_OTG_FS            0x0AU
+#define GPIO_AF12_OTG_HS_FS         0x0CU
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()                    do {} while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()                    do {} while (0)
+#define __HAL_RCC_USB_OTG_FS_CLK_ENABLE()               do {} while (0)
+#define __HAL_RCC_USB_OTG_FS_CLK_DISABLE()              do {} while (0)
+#define __HAL_RCC_USB_OTG_HS_CLK_ENABLE()               do {} while (0)
+#define __HAL_RCC_USB_OTG_HS_CLK_DISABLE()              do {} while (0)
+#define __HAL_RCC_USB_OTG_HS_ULPI_CLK_SLEEP_DISABLE()   do {} while (0)
+#define __HAL_USB_OTG_FS_WAKEUP_EXTI_CLEAR_FLAG()       do {} while (0)
+#define __HAL_USB_OTG_FS_WAKEUP_EXTI_ENABLE_RISING_EDGE() do {} while (0)
+#define __HAL_USB_OTG_FS_WAKEUP_EXTI_ENABLE_IT()        do {} while (0)
+#define __HAL_USB_OTG_HS_WAKEUP_EXTI_CLEAR_FLAG()       do {} while (0)
+#define __HAL_USB_OTG_HS_WAKEUP_EXTI_ENABLE_RISING_EDGE() do {} while (0)
+#define __HAL_USB_OTG_HS_WAKEUP_EXTI_ENABLE_IT()        do {} while (0)
+
+/* PCD handle as in the F4 HAL: the lean OTG_FS driver and usbd_conf.c
+   keep endpoint and setup state in it. Only test_ll_fs builds them; the
+   other tests replace the OTG driver as a whole and leave it unused. */
+typedef struct
+{
+  uint32_t dev_endpoints;
+  uint32_t speed;
+  uint32_t dma_enable;
+  uint32_t ep0_mps;
+  uint32_t phy_itface;
+  uint32_t Sof_enable;
+  uint32_t low_power_enable;
+  uint32_t lpm_enable;
+  uint32_t vbus_sensing_enable;
+  uint32_t use_dedicated_ep1;
+  uint32_t use_external_vbus;
+} PCD_InitTypeDef;
+
+typedef struct
+{
+  uint8_t   num;
+  uint8_t   is_in;
+  uint8_t   is_stall;
+  uint8_t   type;
+  uint8_t   data_pid_start;
+  uint16_t  tx_fifo_num;
+  uint32_t  maxpacket;
+  uint8_t   *xfer_buff;
+  uint32_t  dma_addr;
+  uint32_t  xfer_len;
+  uint32_t  xfer_count;
+} PCD_EPTypeDef;
+
+typedef struct __PCD_HandleTypeDef
+{
+  USB_OTG_GlobalTypeDef *Instance;
+  PCD_InitTypeDef       Init;
+  __IO uint8_t          USB_Address;
+  PCD_EPTypeDef         IN_ep[16];
+  PCD_EPTypeDef         OUT_ep[16];
+  uint32_t              Setup[12];
+  void                  *pData;
+} PCD_HandleTypeDef;
+
+#define PCD_SPEED_HIGH              0U
+#define PCD_SPEED_FULL              2U
+#define PCD_PHY_EMBEDDED            2U
+
+#define EP_ADDR_MSK                 0xFU
+#define EP_TYPE_CTRL                0U
+#define EP_TYPE_ISOC                1U
+#define EP_TYPE_BULK                2U
+#define EP_TYPE_INTR                3U
+
+#define __HAL_PCD_GATE_PHYCLOCK(h)  ((void)(h))
+#define __HAL_PCD_UNGATE_PHYCLOCK(h) ((void)(h))
+
+/* Register windows of stm32f4xx_ll_usb.h, for a `USBx_BASE` in scope. The
+   data FIFO pushes and pops, which memory cannot, so it is a call into
+   the register model. */
+#define USBx_DEVICE                 ((USB_OTG_DeviceTypeDef *)(uintptr_t)((uint32_t)USBx_BASE + USB_OTG_DEVICE_BASE))
+#define USBx_INEP(i)                ((USB_OTG_INEndpointTypeDef *)(uintptr_t)((uint32_t)USBx_BASE + \
+                                     USB_OTG_IN_ENDPOINT_BASE + ((i) * USB_OTG_EP_REG_SIZE)))
+#define USBx_OUTEP(i)               ((USB_OTG_OUTEndpointTypeDef *)(uintptr_t)((uint32_t)USBx_BASE + \
+                                     USB_OTG_OUT_ENDPOINT_BASE + ((i) * USB_OTG_EP_REG_SIZE)))
+#define USBx_PCGCCTL                (*(__IO uint32_t *)(uintptr_t)((uint32_t)USBx_BASE + USB_OTG_PCGCCTL_BASE))
+#define USBx_DFIFO(i)               (*Host_Otg_Fifo((uint32_t)USBx_BASE, (i)))
+
+__IO uint32_t *Host_Otg_Fifo(uint32_t base, uint32_t num);
+
+HAL_StatusTypeDef HAL_PCD_Init(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef HAL_PCD_DeInit(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef HAL_PCD_Start(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef HAL_PCD_Stop(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef HAL_PCD_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type);
+HAL_StatusTypeDef HAL_PCD_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef HAL_PCD_EP_Flush(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef HAL_PCD_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef HAL_PCD_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef HAL_PCD_SetAddress(PCD_HandleTypeDef *hpcd, uint8_t address);
+HAL_StatusTypeDef HAL_PCD_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+HAL_StatusTypeDef HAL_PCD_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+uint32_t          HAL_PCD_EP_GetRxCount(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef HAL_PCD_ActivateRemoteWakeup(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef HAL_PCD_DeActivateRemoteWakeup(PCD_HandleTypeDef *hpcd);
+void              HAL_PCD_IRQHandler(PCD_HandleTypeDef *hpcd);
+
+void HAL_PCD_MspInit(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_MspDeInit(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum);
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum);
+void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd);
+void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd);
+
+/* Values as in the F4 HAL, for clock_profile.h */
+#define RCC_PLLP_DIV2               0x00000002U
+#define RCC_PLLP_DIV4               0x00000004U
+#define RCC_PLLP_DIV6               0x00000006U
+#define RCC_PLLP_DIV8               0x00000008U
+#define RCC_SYSCLK_DIV1             0x00000000U
+#define RCC_SYSCLK_DIV2             0x00000080U
+#define RCC_SYSCLK_DIV4             0x00000090U
+#define RCC_SYSCLK_DIV8             0x000000A0U
+#define RCC_HCLK_DIV1               0x00000000U
+#define RCC_HCLK_DIV2               0x00001000U
+#define RCC_HCLK_DIV4               0x00001400U
+#define PWR_REGULATOR_VOLTAGE_SCALE1 0x0000C000U
+#define PWR_REGULATOR_VOLTAGE_SCALE2 0x00008000U
+#define PWR_REGULATOR_VOLTAGE_SCALE3 0x00004000U
+
+uint32_t HAL_GetTick(void);
+void     HAL_Delay(uint32_t delay);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+
+/* Clock bring-up and STOP entry in main.c: compiled on the host, never
+   run there, so the register macros do nothing */
+typedef struct
+{
+  uint32_t PLLState;
+  uint32_t PLLSource;
+  uint32_t PLLM;
+  uint32_t PLLN;
+  uint32_t PLLP;
+  uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct
+{
+  uint32_t OscillatorType;
+  uint32_t HSEState;
+  RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct
+{
+  uint32_t ClockType;
+  uint32_t SYSCLKSource;
+  uint32_t AHBCLKDivider;
+  uint32_t APB1CLKDivider;
+  uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RESET                       0U
+#define RCC_OSCILLATORTYPE_HSE      0x00000001U
+#define RCC_HSE_ON                  0x00010000U
+#define RCC_PLL_ON                  0x00000002U
+#define RCC_PLLSOURCE_HSE           0x00400000U
+#define RCC_CLOCKTYPE_SYSCLK        0x00000001U
+#define RCC_CLOCKTYPE_HCLK          0x00000002U
+#define RCC_CLOCKTYPE_PCLK1         0x00000004U
+#define RCC_CLOCKTYPE_PCLK2         0x00000008U
+#define RCC_SYSCLKSOURCE_PLLCLK     0x00000002U
+#define RCC_SYSCLKSOURCE_STATUS_PLLCLK 0x00000008U
+#define RCC_FLAG_HSERDY             0x31U
+#define RCC_FLAG_PLLRDY             0x39U
+#define PWR_LOWPOWERREGULATOR_ON    0x00000001U
+#define PWR_STOPENTRY_WFI           0x01U
+
+#define __HAL_RCC_PWR_CLK_ENABLE()              do {} while (0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(scale)  ((void)(scale))
+#define __HAL_RCC_GET_SYSCLK_SOURCE()           RCC_SYSCLKSOURCE_STATUS_PLLCLK
+#define __HAL_RCC_HSE_CONFIG(state)             ((void)(state))
+#define __HAL_RCC_GET_FLAG(flag)                ((void)(flag), 1U)
+#define __HAL_RCC_PLL_ENABLE()                  do {} while (0)
+#define __HAL_RCC_SYSCLK_CONFIG(source)         ((void)(source))
+
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+void     HAL_SuspendTick(void);
+void     HAL_ResumeTick(void);
+void     HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4xx_HAL_H */
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Run the on-device benchmark (usbd_bench.h) and write the results as JSON.
+
+Talks to the vendor HID channel through a Linux hidraw node: each run
+sends CUSTOM_HID_CMD_BENCH_START (0x08) with the workload and length,
+keeps reading 0x82 so vendor traffic flows, waits for the run to end and
+asks for the result report with CUSTOM_HID_CMD_BENCH_RESULT (0x09):
+
+  [0] report ID 0x02  [1..2] reports/s  [3] p50  [4] p99
+  [5..8] cycles/report (cycles/frame when no report completed)
+
+  usbd_bench.py /dev/hidraw3
+  usbd_bench.py /dev/hidraw3 -w motion -w vendor -f 5000 -o bench.json
+
+The bulk workload only measures something while a host reads 0x83; run
+a bulk reader alongside it. The full counters of the last run (interrupt
+cycles, bytes, dispatch cycles, latency histogram) are on EP0 vendor
+request 0x06, see usbd_vendor_req.h.
+"""
+
+import argparse
+import json
+import os
+import select
+import struct
+import sys
+import time
+
+REPORT_ID_VENDOR = 0x02
+REPORT_SIZE = 9
+CMD_BENCH_START = 0x08
+CMD_BENCH_RESULT = 0x09
+
+WORKLOADS = {"idle": 0, "motion": 1, "buttons": 2, "vendor": 3, "bulk": 4}
+MAX_FRAMES = 60000
+DEFAULT_FRAMES = 1000
+
+
+def command(fd, cmd, args=b""):
+    report = bytes([REPORT_ID_VENDOR, cmd]) + args
+    os.write(fd, report.ljust(REPORT_SIZE, b"\0"))
+
+
+def drain(fd, seconds):
+    """Read and discard reports for `seconds`, so 0x82 keeps moving"""
+    end = time.monotonic() + seconds
+    while True:
+        left = end - time.monotonic()
+        if left <= 0:
+            return
+        if select.select([fd], [], [], left)[0]:
+            os.read(fd, 64)
+
+
+def read_vendor(fd, timeout):
+    """First vendor report within `timeout` seconds, None if none came"""
+    end = time.monotonic() + timeout
+    while True:
+        left = end - time.monotonic()
+        if left <= 0 or not select.select([fd], [], [], left)[0]:
+            return None
+        report = os.read(fd, 64)
+        if len(report) >= REPORT_SIZE and report[0] == REPORT_ID_VENDOR:
+            return report[:REPORT_SIZE]
+
+
+def run(fd, name, frames):
+    command(fd, CMD_BENCH_START, bytes([WORKLOADS[name]]) + struct.pack("<H", frames))
+    # One frame per millisecond on full speed; settle the stripe ring after
+    drain(fd, frames / 1000.0 + 0.2)
+
+    command(fd, CMD_BENCH_RESULT)
+    report = read_vendor(fd, 1.0)
+    if report is None:
+        sys.exit("%s: no result report (is the vendor HID interface enumerated?)" % name)
+
+    rate, p50, p99, cycles = struct.unpack_from("<HBBI", report, 1)
+    return {
+        "workload": name,
+        "frames": frames,
+        "reports_per_s": rate,
+        "latency_frames_p50": p50,
+        "latency_frames_p99": p99,
+        # The firmware reports per frame when the run completed no reports
+        "cycles_per_report" if rate else "cycles_per_frame": cycles,
+    }
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("hidraw", help="hidraw node of the custom HID interface")
+    ap.add_argument("-w", "--workload", action="append", choices=sorted(WORKLOADS, key=WORKLOADS.get),
+                    help="workload to run, repeatable (default: all)")
+    ap.add_argument("-f", "--frames", type=int, default=DEFAULT_FRAMES,
+                    help="run length in frames, 1..%u (default %u)" % (MAX_FRAMES, DEFAULT_FRAMES))
+    ap.add_argument("-o", "--output", help="JSON file to write (default: stdout)")
+    opts = ap.parse_args()
+
+    if not 1 <= opts.frames <= MAX_FRAMES:
+        ap.error("--frames must be 1..%u" % MAX_FRAMES)
+
+    fd = os.open(opts.hidraw, os.O_RDWR)
+    try:
+        results = [run(fd, name, opts.frames) for name in (opts.workload or sorted(WORKLOADS, key=WORKLOADS.get))]
+    finally:
+        os.close(fd)
+
+    text = json.dumps({"runs": results}, indent=2)
+    if opts.output:
+        with open(opts.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Decode the binary USB log (usbd_log.h) back to text.
+
+The firmware sends log records as vendor IN reports with report ID 0x04
+on the custom HID interface (endpoint 0x82). Each report carries 8 bytes,
+two little-endian 32-bit words of the record stream:
+
+  header  format ID (15:0), argument count (17:16), level (19:18),
+          records dropped so far, low 8 bits (31:24); 0 = padding
+  stamp   DWT->CYCCNT when the record was written
+  args    0..3 words
+
+The format ID is the offset of the format string in the ER_LOGFMT section
+of the image the board runs, so pass the matching HID.axf.
+
+Time deltas are DWT cycles divided by HCLK. The clock governor changes
+HCLK at runtime and logs each change ("HCLK %u Hz"); the decoder switches
+to the new rate from that record on. --hclk only sets the rate assumed
+until the first such record.
+
+  usbd_log_decode.py MDK-ARM/HID/HID.axf /dev/hidraw3
+  usbd_log_decode.py MDK-ARM/HID/HID.axf capture.bin
+
+A device node is read one report per read(). Any other file is taken as
+back-to-back 9-byte reports (report ID first); reports with another ID
+are skipped.
+"""
+
+import argparse
+import os
+import re
+import stat
+import struct
+import sys
+
+REPORT_ID_LOG = 0x04
+REPORT_SIZE = 9
+HCLK_FMT = "HCLK %u Hz"     # USBD_LOG_HCLK_FMT
+LEVELS = {1: "USR", 2: "ERR", 3: "DBG"}
+
+CONV = re.compile(r"%([-+ #0]*)(\d+)?(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcps%])")
+
+
+def load_formats(elf_path, name="ER_LOGFMT"):
+    """Raw bytes of the named section of a little-endian ELF32 image."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s: not a little-endian ELF32 image" % elf_path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(i):
+        return struct.unpack_from("<IIIIII", elf, shoff + i * shentsize)
+
+    strtab = section(shstrndx)
+    for i in range(shnum):
+        sh_name, _, _, _, sh_offset, sh_size = section(i)
+        start = strtab[4] + sh_name
+        if elf[start:elf.index(b"\0", start)].decode() == name:
+            return elf[sh_offset:sh_offset + sh_size]
+    sys.exit("%s: no %s section; linked without MDK-ARM/HID/HID.sct?" % (elf_path, name))
+
+
+def format_string(fmts, fmt_id):
+    end = fmts.find(b"\0", fmt_id)
+    if fmt_id >= len(fmts) or end < 0:
+        return None
+    return fmts[fmt_id:end].decode("latin-1")
+
+
+def render(fmt, args):
+    """printf with 32-bit integer arguments"""
+    out = []
+    pos = 0
+    args = list(args)
+    for m in CONV.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        value = args.pop(0) if args else 0
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+        if conv in "di":
+            out.append((spec + "d") % (value - (1 << 32) if value & 0x80000000 else value))
+        elif conv == "p":
+            out.append("0x%08x" % value)
+        elif conv == "c":
+            out.append((spec + "c") % (value & 0xFF))
+        elif conv == "s":
+            out.append("<0x%08x>" % value)
+        else:
+            out.append((spec + conv) % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def reports(path):
+    """8-byte payloads of the log reports from a device node or a capture"""
+    if stat.S_ISCHR(os.stat(path).st_mode):
+        fd = os.open(path, os.O_RDONLY)
+        while True:
+            report = os.read(fd, 64)
+            if len(report) >= REPORT_SIZE and report[0] == REPORT_ID_LOG:
+                yield report[1:REPORT_SIZE]
+    else:
+        with open(path, "rb") as f:
+            while True:
+                report = f.read(REPORT_SIZE)
+                if len(report) < REPORT_SIZE:
+                    return
+                if report[0] == REPORT_ID_LOG:
+                    yield report[1:]
+
+
+def words(payloads):
+    for payload in payloads:
+        for w in struct.unpack("<II", payload):
+            yield w
+
+
+def decode(fmts, stream, hclk):
+    lost_seen = None
+    last_stamp = None
+    it = iter(stream)
+    for hdr in it:
+        if hdr == 0:
+            continue
+        nargs = (hdr >> 16) & 0x3
+        level = (hdr >> 18) & 0x3
+        lost = hdr >> 24
+        try:
+            stamp = next(it)
+            args = [next(it) for _ in range(nargs)]
+        except StopIteration:
+            return
+
+        if lost_seen is not None and lost != lost_seen:
+            print("-- %u record(s) dropped on the device" % ((lost - lost_seen) & 0xFF))
+        lost_seen = lost
+
+        delta = 0 if last_stamp is None else (stamp - last_stamp) & 0xFFFFFFFF
+        last_stamp = stamp
+
+        fmt = format_string(fmts, hdr & 0xFFFF)
+        if fmt is None:
+            text = "unknown format ID 0x%04x %s" % (hdr & 0xFFFF, " ".join("0x%08x" % a for a in args))
+        else:
+            text = render(fmt, args)
+        print("%10u %+12.1fus %s %s" % (stamp, delta * 1e6 / hclk, LEVELS.get(level, "?"), text))
+        sys.stdout.flush()
+
+        # Cycles up to this record ran at the old rate
+        if fmt == HCLK_FMT and args and args[0] != 0:
+            hclk = float(args[0])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf", help="image the board runs (HID.axf)")
+    ap.add_argument("source", help="hidraw node of the custom HID interface, or a capture file")
+    ap.add_argument("--hclk", type=float, default=168e6,
+                    help="HCLK in Hz until the first HCLK record (default 168e6)")
+    opts = ap.parse_args()
+
+    try:
+        decode(load_formats(opts.elf), words(reports(opts.source)), opts.hclk)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
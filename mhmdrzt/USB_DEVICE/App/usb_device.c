@@ -32,6 +32,15 @@
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
+/* Class and descriptor state of the FS instance. OTG_FS has no DMA, so
+   it sits in CCM RAM with its report queues, off the SRAM bus the OTG_HS
+   DMA uses. */
+__ALIGN_BEGIN static USBD_Composite_HandleTypeDef hCompositeFS __ALIGN_END USBD_CCMRAM;
+#if (USBD_USE_OTG_HS != 0U)
+/* Same for the OTG_HS instance, which enumerates on its own. Its transfer
+   buffers live in here, so with USBD_HS_DMA it must stay in SRAM1/2. */
+__ALIGN_BEGIN static USBD_Composite_HandleTypeDef hCompositeHS __ALIGN_END;
+#endif
 
 /* USER CODE END PV */
 
@@ -42,6 +51,9 @@
 
 /* USB Device Core handle declaration. */
 USBD_HandleTypeDef hUsbDeviceFS;
+#if (USBD_USE_OTG_HS != 0U)
+USBD_HandleTypeDef hUsbDeviceHS;
+#endif
 
 /*
  * -- Insert your variables declaration here --
@@ -54,6 +66,46 @@ USBD_HandleTypeDef hUsbDeviceFS;
  * -- Insert your external function declaration here --
  */
 /* USER CODE BEGIN 1 */
+/**
+  * Re-enumerate one port with a new personality when one was requested:
+  * soft-detach (USBD_Stop also closes the class), keep D+ released long
+  * enough for the host to see the detach, swap descriptors and class,
+  * reconnect. Blocks for USBD_PERSONALITY_DETACH_MS.
+  */
+static void USB_DEVICE_SwitchPersonality(USBD_HandleTypeDef *pdev)
+{
+  uint8_t next = USBD_Composite_NextPersonality(pdev);
+
+  if (next == USBD_PERSONALITY_NONE)
+  {
+    return;
+  }
+
+  (void)USBD_Stop(pdev);
+  HAL_Delay(USBD_PERSONALITY_DETACH_MS);
+
+  (void)USBD_Composite_SelectPersonality(pdev, next);
+  if (USBD_RegisterClass(pdev, &USBD_Composite) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_Start(pdev) != USBD_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * Personality switches of every port. Runs from the main loop.
+  * @retval None
+  */
+void MX_USB_DEVICE_Process(void)
+{
+  USB_DEVICE_SwitchPersonality(&hUsbDeviceFS);
+#if (USBD_USE_OTG_HS != 0U)
+  USB_DEVICE_SwitchPersonality(&hUsbDeviceHS);
+#endif
+}
 
 /* USER CODE END 1 */
 
@@ -72,6 +124,9 @@ void MX_USB_DEVICE_Init(void)
   {
     Error_Handler();
   }
+  /* USBD_Init clears pUserData: bind the instance state after it */
+  USBD_Composite_RegisterContext(&hUsbDeviceFS, &hCompositeFS);
+  (void)USBD_Composite_SelectPersonality(&hUsbDeviceFS, USBD_PERSONALITY_FULL);
   if (USBD_RegisterClass(&hUsbDeviceFS, &USBD_Composite) != USBD_OK)
   {
     Error_Handler();
@@ -82,7 +137,30 @@ void MX_USB_DEVICE_Init(void)
   }
 
   /* USER CODE BEGIN USB_DEVICE_Init_PostTreatment */
-
+#if (USBD_USE_OTG_HS != 0U)
+  /* Second instance on OTG_HS, same descriptors and class, own state */
+  if (USBD_Init(&hUsbDeviceHS, &FS_Desc, DEVICE_HS) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_HS_DMA != 0U)
+  /* The OTG_HS DMA master has no path to CCM RAM */
+  if (((uint32_t)&hCompositeHS & 0xFFFF0000U) == CCMDATARAM_BASE)
+  {
+    Error_Handler();
+  }
+#endif
+  USBD_Composite_RegisterContext(&hUsbDeviceHS, &hCompositeHS);
+  (void)USBD_Composite_SelectPersonality(&hUsbDeviceHS, USBD_PERSONALITY_FULL);
+  if (USBD_RegisterClass(&hUsbDeviceHS, &USBD_Composite) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_Start(&hUsbDeviceHS) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#endif
   /* USER CODE END USB_DEVICE_Init_PostTreatment */
 }
 
@@ -1,8 +1,12 @@
 /* Src/usbd_desc.c */
 #include "usbd_desc.h"
 #include "usbd_def.h"
+#include "usbd_ctlreq.h"
 #include "usbd_hid_mouse.h"
 #include "usbd_custom_hid.h"
+#include "usbd_composite.h"
+#include "usbd_bulk.h"
+#include "usbd_stripe.h"
 
 /* Definitions for USB descriptors */
 #define USBD_VID                      0x1234
@@ -12,15 +16,18 @@
 #define USBD_MANUFACTURER_STRING      "Your Manufacturer"
 #define USBD_PRODUCT_STRING           "Composite HID Device"
 #define USBD_SERIALNUMBER_STRING      "00000000001A"
+/* OTG_HS port: same VID/PID on the same host, so it needs its own serial */
+#define USBD_SERIALNUMBER_STRING_HS   "00000000001B"
 #define USBD_CONFIGURATION_STRING     "Composite Config"
 
-/* Define two interface strings for the two HID interfaces */
+/* Interface strings: two HID interfaces and the telemetry bulk interface */
 #define USBD_HID_MOUSE_INTERFACE_STRING   "HID Mouse Interface"
 #define USBD_CUSTOM_HID_INTERFACE_STRING  "Custom HID Interface"
+#define USBD_BULK_INTERFACE_STRING        "Telemetry Bulk Interface"
+#define USBD_STRIPE_INTERFACE_STRING      "Vendor Stream Channel"
 
-/* --- Device Descriptor --- */
-#define USB_LEN_DEV_DESC              18
-__ALIGN_BEGIN static uint8_t USBD_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END = {
+/* --- Device Descriptor, idProduct patched per personality --- */
+static const uint8_t DeviceDescTemplate[USB_LEN_DEV_DESC] = {
   0x12,                       /* bLength */
   USB_DESC_TYPE_DEVICE,       /* bDescriptorType */
   0x00, 0x02,                 /* bcdUSB = 2.00 */
@@ -37,29 +44,37 @@ __ALIGN_BEGIN static uint8_t USBD_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END = {
   0x01                        /* bNumConfigurations */
 };
 
-/* --- Composite Configuration Descriptor ---
-   We define two interfaces:
-     Interface 0: Mouse HID, using bInterfaceNumber = 0 and iInterface = 0x04
-     Interface 1: Custom HID, using bInterfaceNumber = 1 and iInterface = 0x05
+/* --- Configuration Descriptor, built per personality ---
+   The interfaces of the active personality follow the header in interface
+   number order:
+     Mouse HID:  9 + 9 + 7 bytes, iInterface = 0x04
+     Custom HID: 9 + 9 + 7 + 7 bytes, iInterface = 0x05
+     Stripe:     9 + 9 + 7 bytes per extra vendor channel, iInterface = 0x07
+     Bulk:       9 + 7 + 7 bytes, iInterface = 0x06
+   Every function is a single interface, so no Interface Association
+   Descriptor is needed; interfaces are numbered from 0 without gaps.
 */
 
-#define COMPOSITE_CONFIG_DESC_SIZE  (9 + (9+9+7) + (9+9+7+7))
-__ALIGN_BEGIN uint8_t USBD_Composite_CfgDesc[COMPOSITE_CONFIG_DESC_SIZE] __ALIGN_END = {
+#define CFG_IF_NUMBER_OFFSET        2    /* bInterfaceNumber */
+#define CFG_STRIPE_EP_OFFSET        (9+9+2)  /* bEndpointAddress */
+
+static const uint8_t CfgHeader[CFG_HEADER_SIZE] = {
   /* Configuration Descriptor */
   0x09,                               /* bLength: Configuration Descriptor size */
   USB_DESC_TYPE_CONFIGURATION,        /* bDescriptorType: Configuration */
-  LOBYTE(COMPOSITE_CONFIG_DESC_SIZE),   /* wTotalLength */
-  HIBYTE(COMPOSITE_CONFIG_DESC_SIZE),
-  0x02,                               /* bNumInterfaces: 2 interfaces */
+  0x00, 0x00,                         /* wTotalLength: set by USBD_Desc_Build */
+  0x00,                               /* bNumInterfaces: set by USBD_Desc_Build */
   0x01,                               /* bConfigurationValue */
   0x00,                               /* iConfiguration */
-  0xC0,                               /* bmAttributes: Self-powered */
+  0xE0,                               /* bmAttributes: Self-powered, remote wakeup */
   0x32,                               /* bMaxPower: 100 mA */
+};
 
-  /* --- Interface 0: Mouse HID --- */
+static const uint8_t CfgMouseIf[CFG_MOUSE_IF_SIZE] = {
+  /* Interface descriptor */
   0x09,                               /* bLength: Interface Descriptor size */
   USB_DESC_TYPE_INTERFACE,            /* bDescriptorType: Interface */
-  0x00,                               /* bInterfaceNumber: 0 (Mouse HID) */
+  0x00,                               /* bInterfaceNumber: patched */
   0x00,                               /* bAlternateSetting */
   0x01,                               /* bNumEndpoints: 1 */
   0x03,                               /* bInterfaceClass: HID */
@@ -83,11 +98,13 @@ __ALIGN_BEGIN uint8_t USBD_Composite_CfgDesc[COMPOSITE_CONFIG_DESC_SIZE] __ALIGN
   0x03,                               /* bmAttributes: Interrupt */
   0x04, 0x00,                         /* wMaxPacketSize: 4 bytes */
   0x0A,                               /* bInterval: 10 ms */
+};
 
-  /* --- Interface 1: Custom HID --- */
+static const uint8_t CfgCustomIf[CFG_CUSTOM_IF_SIZE] = {
+  /* Interface descriptor */
   0x09,                               /* bLength: Interface Descriptor size */
   USB_DESC_TYPE_INTERFACE,            /* bDescriptorType: Interface */
-  0x01,                               /* bInterfaceNumber: 1 (Custom HID) */
+  0x00,                               /* bInterfaceNumber: patched */
   0x00,                               /* bAlternateSetting */
   0x02,                               /* bNumEndpoints: 2 (IN and OUT) */
   0x03,                               /* bInterfaceClass: HID */
@@ -110,7 +127,7 @@ __ALIGN_BEGIN uint8_t USBD_Composite_CfgDesc[COMPOSITE_CONFIG_DESC_SIZE] __ALIGN
   0x82,                               /* bEndpointAddress: IN (address 2) */
   0x03,                               /* bmAttributes: Interrupt */
   0x09, 0x00,                         /* wMaxPacketSize: 9 bytes */
-  0x0A,                               /* bInterval: 10 ms */
+  0x01,                               /* bInterval: 1 ms (absolute pointer rides here) */
 
   /* Endpoint Descriptor for Custom HID OUT endpoint */
   0x07,                               /* bLength: Endpoint Descriptor size */
@@ -118,79 +135,205 @@ __ALIGN_BEGIN uint8_t USBD_Composite_CfgDesc[COMPOSITE_CONFIG_DESC_SIZE] __ALIGN
   0x02,                               /* bEndpointAddress: OUT (address 2) */
   0x03,                               /* bmAttributes: Interrupt */
   0x09, 0x00,                         /* wMaxPacketSize: 9 bytes */
-  0x0A                                /* bInterval: 10 ms */
+  0x01                                /* bInterval: 1 ms */
 };
-uint16_t USBD_Composite_CfgDescSize = COMPOSITE_CONFIG_DESC_SIZE;
+
+static const uint8_t CfgStripeIf[CFG_STRIPE_IF_SIZE] = {
+  /* Interface descriptor */
+  0x09,                               /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,            /* bDescriptorType: Interface */
+  0x00,                               /* bInterfaceNumber: patched */
+  0x00,                               /* bAlternateSetting */
+  0x01,                               /* bNumEndpoints: 1 (IN) */
+  0x03,                               /* bInterfaceClass: HID */
+  0x00,                               /* bInterfaceSubClass: None */
+  0x00,                               /* bInterfaceProtocol: None */
+  0x07,                               /* iInterface: Use string index 7 */
+
+  /* HID Descriptor: stream collection of the custom HID report descriptor */
+  0x09,                               /* bLength: HID Descriptor size */
+  0x21,                               /* bDescriptorType: HID */
+  0x11, 0x01,                         /* bcdHID: HID Class Spec release number (1.11) */
+  0x00,                               /* bCountryCode */
+  0x01,                               /* bNumDescriptors: 1 */
+  0x22,                               /* bDescriptorType: Report descriptor */
+  LOBYTE(CUSTOM_HID_STREAM_DESC_SIZE), HIBYTE(CUSTOM_HID_STREAM_DESC_SIZE),
+
+  /* Endpoint Descriptor for the channel IN endpoint */
+  0x07,                               /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,             /* bDescriptorType: Endpoint */
+  0x00,                               /* bEndpointAddress: patched */
+  0x03,                               /* bmAttributes: Interrupt */
+  0x09, 0x00,                         /* wMaxPacketSize: 9 bytes */
+  0x01                                /* bInterval: 1 ms */
+};
+
+static const uint8_t CfgBulkIf[CFG_BULK_IF_SIZE] = {
+  /* Interface descriptor */
+  0x09,                               /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,            /* bDescriptorType: Interface */
+  0x00,                               /* bInterfaceNumber: patched */
+  0x00,                               /* bAlternateSetting */
+  0x02,                               /* bNumEndpoints: 2 (IN and OUT) */
+  0xFF,                               /* bInterfaceClass: Vendor specific */
+  0x00,                               /* bInterfaceSubClass */
+  0x00,                               /* bInterfaceProtocol */
+  0x06,                               /* iInterface: Use string index 6 */
+
+  /* Endpoint Descriptor for bulk IN endpoint */
+  0x07,                               /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,             /* bDescriptorType: Endpoint */
+  USBD_BULK_EPIN_ADDR,                /* bEndpointAddress: IN (address 3) */
+  0x02,                               /* bmAttributes: Bulk */
+  LOBYTE(USBD_BULK_PACKET_SIZE), HIBYTE(USBD_BULK_PACKET_SIZE), /* wMaxPacketSize: 64 bytes */
+  0x00,                               /* bInterval: ignored for bulk */
+
+  /* Endpoint Descriptor for bulk OUT endpoint */
+  0x07,                               /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,             /* bDescriptorType: Endpoint */
+  USBD_BULK_EPOUT_ADDR,               /* bEndpointAddress: OUT (address 3) */
+  0x02,                               /* bmAttributes: Bulk */
+  LOBYTE(USBD_BULK_PACKET_SIZE), HIBYTE(USBD_BULK_PACKET_SIZE), /* wMaxPacketSize: 64 bytes */
+  0x00                                /* bInterval: ignored for bulk */
+};
+
+static uint16_t Desc_AppendIf(USBD_Desc_HandleTypeDef *hdesc, uint16_t pos, const uint8_t *block,
+                              uint16_t size, uint8_t ifnum)
+{
+  memcpy(&hdesc->cfg[pos], block, size);
+  hdesc->cfg[pos + CFG_IF_NUMBER_OFFSET] = ifnum;
+  return pos + size;
+}
+
+/**
+  * @brief  Build the configuration descriptor for a personality and set
+  *         idProduct to USBD_PID + personality. Interfaces are numbered as
+  *         given; USBD_COMPOSITE_NO_IF leaves one out.
+  */
+void USBD_Desc_Build(USBD_Desc_HandleTypeDef *hdesc, uint8_t personality, uint8_t mouse_if,
+                     uint8_t custom_if, uint8_t bulk_if, uint8_t channels)
+{
+  uint16_t pos = CFG_HEADER_SIZE;
+  uint8_t num_if = 0;
+  uint8_t ch;
+
+  memcpy(hdesc->cfg, CfgHeader, CFG_HEADER_SIZE);
+  if (mouse_if != USBD_COMPOSITE_NO_IF)
+  {
+    pos = Desc_AppendIf(hdesc, pos, CfgMouseIf, CFG_MOUSE_IF_SIZE, mouse_if);
+    num_if++;
+  }
+  if (custom_if != USBD_COMPOSITE_NO_IF)
+  {
+    pos = Desc_AppendIf(hdesc, pos, CfgCustomIf, CFG_CUSTOM_IF_SIZE, custom_if);
+    num_if++;
+
+    for (ch = 1; ch < channels; ch++)
+    {
+      pos = Desc_AppendIf(hdesc, pos, CfgStripeIf, CFG_STRIPE_IF_SIZE, custom_if + ch);
+      hdesc->cfg[pos - CFG_STRIPE_IF_SIZE + CFG_STRIPE_EP_OFFSET] = USBD_STRIPE_EPIN_ADDR(ch);
+      num_if++;
+    }
+  }
+  if (bulk_if != USBD_COMPOSITE_NO_IF)
+  {
+    pos = Desc_AppendIf(hdesc, pos, CfgBulkIf, CFG_BULK_IF_SIZE, bulk_if);
+    num_if++;
+  }
+
+  hdesc->cfg[2] = LOBYTE(pos);
+  hdesc->cfg[3] = HIBYTE(pos);
+  hdesc->cfg[4] = num_if;
+  hdesc->cfg_size = pos;
+
+  memcpy(hdesc->dev, DeviceDescTemplate, USB_LEN_DEV_DESC);
+  hdesc->dev[10] = LOBYTE(USBD_PID + personality);
+  hdesc->dev[11] = HIBYTE(USBD_PID + personality);
+}
 
 /* --- String Descriptors --- */
 //#define USB_LEN_LANGID_STR_DESC       4
-__ALIGN_BEGIN static uint8_t USBD_LangIDDesc[USB_LEN_LANGID_STR_DESC] __ALIGN_END = {
+__ALIGN_BEGIN static const uint8_t USBD_LangIDDesc[USB_LEN_LANGID_STR_DESC] __ALIGN_END = {
   USB_LEN_LANGID_STR_DESC,
   USB_DESC_TYPE_STRING,
   LOBYTE(USBD_LANGID_STRING),
   HIBYTE(USBD_LANGID_STRING),
 };
 
-/* Maximum string descriptor size */
-#define USBD_MAX_STR_DESC_SIZ         64
-static uint8_t USBD_StrDesc[USBD_MAX_STR_DESC_SIZ];
-
 /* Modified interface string descriptor callback:
    This function now returns different strings based on the requested index.
    (Indices 4 and 5 are used for our two HID interfaces.) */
 
-uint8_t *USBD_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length, uint8_t index)
+uint8_t *USBD_InterfaceStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length, uint8_t index)
 {
+  uint8_t *str = USBD_COMPOSITE_CTX(pdev)->desc.str;
+
   switch(index)
   {
     case 4:
-      USBD_GetString((uint8_t *)USBD_HID_MOUSE_INTERFACE_STRING, USBD_StrDesc, length);
+      USBD_GetString((uint8_t *)USBD_HID_MOUSE_INTERFACE_STRING, str, length);
       break;
     case 5:
-      USBD_GetString((uint8_t *)USBD_CUSTOM_HID_INTERFACE_STRING, USBD_StrDesc, length);
+      USBD_GetString((uint8_t *)USBD_CUSTOM_HID_INTERFACE_STRING, str, length);
       break;
-    default:
-      USBD_GetString((uint8_t *)"ffff", USBD_StrDesc, length);
+    case 6:
+      USBD_GetString((uint8_t *)USBD_BULK_INTERFACE_STRING, str, length);
+      break;
+    case 7:
+      USBD_GetString((uint8_t *)USBD_STRIPE_INTERFACE_STRING, str, length);
       break;
+    default:
+      /* Not one of ours: the core stalls the request */
+      *length = 0U;
+      return NULL;
   }
-  return USBD_StrDesc;
+  return str;
 }
 
 /* Other string descriptor callbacks remain unchanged */
-uint8_t *USBD_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_DeviceDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  *length = sizeof(USBD_DeviceDesc);
-  return USBD_DeviceDesc;
+  *length = USB_LEN_DEV_DESC;
+  return USBD_COMPOSITE_CTX(pdev)->desc.dev;
 }
 
-uint8_t *USBD_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_LangIDStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
   *length = sizeof(USBD_LangIDDesc);
-  return USBD_LangIDDesc;
+  return (uint8_t *)USBD_LangIDDesc;
 }
 
-uint8_t *USBD_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_ManufacturerStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_GetString((uint8_t *)USBD_MANUFACTURER_STRING, USBD_StrDesc, length);
-  return USBD_StrDesc;
+  uint8_t *str = USBD_COMPOSITE_CTX(pdev)->desc.str;
+
+  USBD_GetString((uint8_t *)USBD_MANUFACTURER_STRING, str, length);
+  return str;
 }
 
-uint8_t *USBD_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_ProductStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_GetString((uint8_t *)USBD_PRODUCT_STRING, USBD_StrDesc, length);
-  return USBD_StrDesc;
+  uint8_t *str = USBD_COMPOSITE_CTX(pdev)->desc.str;
+
+  USBD_GetString((uint8_t *)USBD_PRODUCT_STRING, str, length);
+  return str;
 }
 
-uint8_t *USBD_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_SerialStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_GetString((uint8_t *)USBD_SERIALNUMBER_STRING, USBD_StrDesc, length);
-  return USBD_StrDesc;
+  uint8_t *str = USBD_COMPOSITE_CTX(pdev)->desc.str;
+
+  USBD_GetString((uint8_t *)((pdev->id == DEVICE_HS) ? USBD_SERIALNUMBER_STRING_HS : USBD_SERIALNUMBER_STRING),
+                 str, length);
+  return str;
 }
 
-uint8_t *USBD_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+uint8_t *USBD_ConfigStrDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_GetString((uint8_t *)USBD_CONFIGURATION_STRING, USBD_StrDesc, length);
-  return USBD_StrDesc;
+  uint8_t *str = USBD_COMPOSITE_CTX(pdev)->desc.str;
+
+  USBD_GetString((uint8_t *)USBD_CONFIGURATION_STRING, str, length);
+  return str;
 }
 
 /* Group all descriptor callback functions into one structure */
@@ -30,7 +30,7 @@
 #include "usbd_def.h"
 
 /* USER CODE BEGIN INCLUDE */
-
+#include "usbd_stripe.h"
 /* USER CODE END INCLUDE */
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
@@ -66,7 +66,19 @@
   */
 
 /* USER CODE BEGIN EXPORTED_DEFINES */
-
+/* Configuration descriptor blocks, see usbd_desc.c */
+#define CFG_HEADER_SIZE             9
+#define CFG_MOUSE_IF_SIZE           (9+9+7)
+#define CFG_CUSTOM_IF_SIZE          (9+9+7+7)
+#define CFG_STRIPE_IF_SIZE          (9+9+7)
+#define CFG_BULK_IF_SIZE            (9+7+7)
+/* Largest interface set: FULL, or VENDOR_X3 with every extra channel */
+#define CFG_FULL_IFS_SIZE           (CFG_MOUSE_IF_SIZE + CFG_CUSTOM_IF_SIZE + CFG_BULK_IF_SIZE)
+#define CFG_STRIPE_IFS_SIZE         (CFG_CUSTOM_IF_SIZE + (USBD_STRIPE_MAX_CHANNELS - 1) * CFG_STRIPE_IF_SIZE)
+#define COMPOSITE_CONFIG_DESC_SIZE  (CFG_HEADER_SIZE + MAX(CFG_FULL_IFS_SIZE, CFG_STRIPE_IFS_SIZE))
+
+/* Maximum string descriptor size */
+#define USBD_MAX_STR_DESC_SIZ       64
 /* USER CODE END EXPORTED_DEFINES */
 
 /**
@@ -79,7 +91,15 @@
   */
 
 /* USER CODE BEGIN EXPORTED_TYPES */
-
+/* Descriptors of one device instance: built per personality, and the
+   scratch buffer string descriptors are rendered into */
+typedef struct
+{
+  uint8_t  dev[USB_LEN_DEV_DESC] USBD_DMA_ALIGNED;
+  uint8_t  cfg[COMPOSITE_CONFIG_DESC_SIZE] USBD_DMA_ALIGNED;
+  uint16_t cfg_size;
+  uint8_t  str[USBD_MAX_STR_DESC_SIZ] USBD_DMA_ALIGNED;
+} USBD_Desc_HandleTypeDef;
 /* USER CODE END EXPORTED_TYPES */
 
 /**
@@ -108,10 +128,8 @@
 //extern USBD_DescriptorsTypeDef FS_Desc;
 
 /* USER CODE BEGIN EXPORTED_VARIABLES */
-/* Export the descriptors and composite configuration descriptor */
+/* Descriptor callbacks, shared by every instance */
 extern USBD_DescriptorsTypeDef FS_Desc;
-extern uint8_t USBD_Composite_CfgDesc[];
-extern uint16_t USBD_Composite_CfgDescSize;
 /* USER CODE END EXPORTED_VARIABLES */
 
 /**
@@ -124,6 +142,8 @@ extern uint16_t USBD_Composite_CfgDescSize;
   */
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+void USBD_Desc_Build(USBD_Desc_HandleTypeDef *hdesc, uint8_t personality, uint8_t mouse_if,
+                     uint8_t custom_if, uint8_t bulk_if, uint8_t channels);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
@@ -28,7 +28,10 @@
 #include "usbd_composite.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "clock_gov.h"
+#include "usbd_trace.h"
+#include "usbd_bench.h"
+#include "usbd_ll_fs.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -37,17 +40,33 @@
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
+/* Device-initiated resume: requested from an input interrupt, signalled
+   from the main loop, done once the first report after it completes */
+#define LP_WAKE_IDLE          0U
+#define LP_WAKE_REQUESTED     1U
+#define LP_WAKE_SIGNALLING    2U
+#define LP_WAKE_REPORT        3U
 
 /* USER CODE END PV */
 
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
+PCD_HandleTypeDef hpcd_USB_OTG_HS;
 void Error_Handler(void);
 
 /* External functions --------------------------------------------------------*/
 void SystemClock_Config(void);
 
 /* USER CODE BEGIN 0 */
+/* PCD call for the port of `pdev`: the lean driver on OTG_FS when it is
+   built in, the HAL everywhere else */
+#if (USBD_LL_LEAN_FS != 0U)
+#define LL_PCD(pdev, fn)      (((pdev)->id == DEVICE_FS) ? USBD_LLFS_##fn : HAL_PCD_##fn)
+#else
+#define LL_PCD(pdev, fn)      HAL_PCD_##fn
+#endif
 
+/* LL state of the port of `hpcd`, kept in its device instance */
+#define LL_PORT(hpcd)         USBD_PORT((USBD_HandleTypeDef*)(hpcd)->pData)
 /* USER CODE END 0 */
 
 /* USER CODE BEGIN PFP */
@@ -59,7 +78,54 @@ USBD_StatusTypeDef USBD_Get_USB_Status(HAL_StatusTypeDef hal_status);
 /* Private functions ---------------------------------------------------------*/
 
 /* USER CODE BEGIN 1 */
+#if (USBD_USE_OTG_HS != 0U)
+static PCD_HandleTypeDef *const LPPcd[USBD_NUM_PORTS] = { &hpcd_USB_OTG_FS, &hpcd_USB_OTG_HS };
+#else
+static PCD_HandleTypeDef *const LPPcd[USBD_NUM_PORTS] = { &hpcd_USB_OTG_FS };
+#endif
+
+/* LL state of port `i`, NULL until its instance is bound */
+static USBD_Port_HandleTypeDef *LP_Port(uint8_t i)
+{
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)LPPcd[i]->pData;
+
+  if ((pdev == NULL) || (pdev->pUserData == NULL))
+  {
+    return NULL;
+  }
+  return USBD_PORT(pdev);
+}
+
+/* Bus left suspend, either host- or device-initiated */
+static void LP_Resumed(USBD_HandleTypeDef *pdev)
+{
+  USBD_Port_HandleTypeDef *port = USBD_PORT(pdev);
 
+  if (pdev->dev_state != USBD_STATE_SUSPENDED)
+  {
+    return;
+  }
+
+  port->lp.resumes++;
+  port->resume_cycles = DWT->CYCCNT;
+  port->resume_sofs = 0U;
+  port->resume_pending = 1U;
+  USBD_Trace_Record(pdev, USBD_TRACE_EV_POWER, 1U);
+}
+
+static void Conn_SetState(USBD_HandleTypeDef *pdev, uint8_t state)
+{
+  USBD_PORT(pdev)->conn.state = state;
+  USBD_Trace_Record(pdev, USBD_TRACE_EV_CONN, state);
+}
+
+/* Cable plugged, or a bus reset found us detached (VBUS already there at boot) */
+static void Conn_Attached(USBD_HandleTypeDef *pdev)
+{
+  USBD_PORT(pdev)->conn.attaches++;
+  USBD_PORT(pdev)->attach_tick = HAL_GetTick();
+  Conn_SetState(pdev, USBD_CONN_ATTACHED);
+}
 /* USER CODE END 1 */
 
 /*******************************************************************************
@@ -78,9 +144,15 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef* pcdHandle)
 
     __HAL_RCC_GPIOA_CLK_ENABLE();
     /**USB_OTG_FS GPIO Configuration
+    PA9     ------> USB_OTG_FS_VBUS
     PA11     ------> USB_OTG_FS_DM
     PA12     ------> USB_OTG_FS_DP
     */
+    GPIO_InitStruct.Pin = GPIO_PIN_9;
+    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
     GPIO_InitStruct.Pin = GPIO_PIN_11|GPIO_PIN_12;
     GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
     GPIO_InitStruct.Pull = GPIO_NOPULL;
@@ -94,10 +166,67 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef* pcdHandle)
     /* Peripheral interrupt init */
     HAL_NVIC_SetPriority(OTG_FS_IRQn, 0, 0);
     HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+    if(pcdHandle->Init.low_power_enable == 1)
+    {
+      /* Enable EXTI Line 18 for USB wakeup */
+      __HAL_USB_OTG_FS_WAKEUP_EXTI_CLEAR_FLAG();
+      __HAL_USB_OTG_FS_WAKEUP_EXTI_ENABLE_RISING_EDGE();
+      __HAL_USB_OTG_FS_WAKEUP_EXTI_ENABLE_IT();
+      HAL_NVIC_SetPriority(OTG_FS_WKUP_IRQn, 0, 0);
+      HAL_NVIC_EnableIRQ(OTG_FS_WKUP_IRQn);
+    }
   /* USER CODE BEGIN USB_OTG_FS_MspInit 1 */
 
   /* USER CODE END USB_OTG_FS_MspInit 1 */
   }
+  else if(pcdHandle->Instance==USB_OTG_HS)
+  {
+  /* USER CODE BEGIN USB_OTG_HS_MspInit 0 */
+
+  /* USER CODE END USB_OTG_HS_MspInit 0 */
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    /**USB_OTG_HS GPIO Configuration
+    PB13     ------> USB_OTG_HS_VBUS
+    PB14     ------> USB_OTG_HS_DM
+    PB15     ------> USB_OTG_HS_DP
+    */
+    GPIO_InitStruct.Pin = GPIO_PIN_13;
+    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = GPIO_PIN_14|GPIO_PIN_15;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF12_OTG_HS_FS;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    /* Peripheral clock enable */
+    __HAL_RCC_USB_OTG_HS_CLK_ENABLE();
+    /* No external ULPI PHY: its clock must stay off in sleep, or the core
+       does not run while the main loop waits in WFI */
+    __HAL_RCC_USB_OTG_HS_ULPI_CLK_SLEEP_DISABLE();
+
+    /* Peripheral interrupt init. Same priority as OTG_FS so the two ports
+       never preempt each other around the clock governor, which either
+       SOF stream drives and which records on the OTG_FS trace. */
+    HAL_NVIC_SetPriority(OTG_HS_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
+    if(pcdHandle->Init.low_power_enable == 1)
+    {
+      /* Enable EXTI Line 20 for USB wakeup */
+      __HAL_USB_OTG_HS_WAKEUP_EXTI_CLEAR_FLAG();
+      __HAL_USB_OTG_HS_WAKEUP_EXTI_ENABLE_RISING_EDGE();
+      __HAL_USB_OTG_HS_WAKEUP_EXTI_ENABLE_IT();
+      HAL_NVIC_SetPriority(OTG_HS_WKUP_IRQn, 0, 0);
+      HAL_NVIC_EnableIRQ(OTG_HS_WKUP_IRQn);
+    }
+  /* USER CODE BEGIN USB_OTG_HS_MspInit 1 */
+
+  /* USER CODE END USB_OTG_HS_MspInit 1 */
+  }
 }
 
 void HAL_PCD_MspDeInit(PCD_HandleTypeDef* pcdHandle)
@@ -111,18 +240,43 @@ void HAL_PCD_MspDeInit(PCD_HandleTypeDef* pcdHandle)
     __HAL_RCC_USB_OTG_FS_CLK_DISABLE();
 
     /**USB_OTG_FS GPIO Configuration
+    PA9     ------> USB_OTG_FS_VBUS
     PA11     ------> USB_OTG_FS_DM
     PA12     ------> USB_OTG_FS_DP
     */
-    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_11|GPIO_PIN_12);
+    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9|GPIO_PIN_11|GPIO_PIN_12);
 
     /* Peripheral interrupt Deinit*/
     HAL_NVIC_DisableIRQ(OTG_FS_IRQn);
+    HAL_NVIC_DisableIRQ(OTG_FS_WKUP_IRQn);
 
   /* USER CODE BEGIN USB_OTG_FS_MspDeInit 1 */
 
   /* USER CODE END USB_OTG_FS_MspDeInit 1 */
   }
+  else if(pcdHandle->Instance==USB_OTG_HS)
+  {
+  /* USER CODE BEGIN USB_OTG_HS_MspDeInit 0 */
+
+  /* USER CODE END USB_OTG_HS_MspDeInit 0 */
+    /* Peripheral clock disable */
+    __HAL_RCC_USB_OTG_HS_CLK_DISABLE();
+
+    /**USB_OTG_HS GPIO Configuration
+    PB13     ------> USB_OTG_HS_VBUS
+    PB14     ------> USB_OTG_HS_DM
+    PB15     ------> USB_OTG_HS_DP
+    */
+    HAL_GPIO_DeInit(GPIOB, GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15);
+
+    /* Peripheral interrupt Deinit*/
+    HAL_NVIC_DisableIRQ(OTG_HS_IRQn);
+    HAL_NVIC_DisableIRQ(OTG_HS_WKUP_IRQn);
+
+  /* USER CODE BEGIN USB_OTG_HS_MspDeInit 1 */
+
+  /* USER CODE END USB_OTG_HS_MspDeInit 1 */
+  }
 }
 
 /**
@@ -131,12 +285,33 @@ void HAL_PCD_MspDeInit(PCD_HandleTypeDef* pcdHandle)
   * @retval None
   */
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
-static void PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+USBD_RAMFUNC static void PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
 #else
-void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+USBD_RAMFUNC void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_SetupStage((USBD_HandleTypeDef*)hpcd->pData, (uint8_t *)hpcd->Setup);
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  USBD_Conn_StatsTypeDef *conn = &USBD_PORT(pdev)->conn;
+  uint32_t elapsed;
+
+  ClockGov_Activity();
+  USBD_LL_SetupStage(pdev, (uint8_t *)hpcd->Setup);
+
+  /* SET_CONFIGURATION completes in the setup stage; the class has already
+     re-armed its endpoints from Init */
+  if ((pdev->dev_state == USBD_STATE_CONFIGURED) && (conn->state != USBD_CONN_CONFIGURED))
+  {
+    elapsed = HAL_GetTick() - USBD_PORT(pdev)->attach_tick;
+    conn->configured_ms_last = elapsed;
+    conn->configured_ms_max = MAX(conn->configured_ms_max, elapsed);
+    Conn_SetState(pdev, USBD_CONN_CONFIGURED);
+  }
+  else if ((pdev->dev_state != USBD_STATE_CONFIGURED) && (pdev->dev_state != USBD_STATE_SUSPENDED) &&
+           (conn->state == USBD_CONN_CONFIGURED))
+  {
+    /* SET_CONFIGURATION(0) */
+    Conn_SetState(pdev, USBD_CONN_ENUMERATING);
+  }
 }
 
 /**
@@ -146,11 +321,16 @@ void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
   * @retval None
   */
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
-static void PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+USBD_RAMFUNC static void PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #else
-void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+USBD_RAMFUNC void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  ClockGov_Activity();
+  if (epnum != 0U)
+  {
+    USBD_Bench_Bytes((USBD_HandleTypeDef*)hpcd->pData, hpcd->OUT_ep[epnum].xfer_count);
+  }
   USBD_LL_DataOutStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->OUT_ep[epnum].xfer_buff);
 }
 
@@ -161,11 +341,35 @@ void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   * @retval None
   */
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
-static void PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+USBD_RAMFUNC static void PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #else
-void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+USBD_RAMFUNC void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  USBD_Port_HandleTypeDef *port = LL_PORT(hpcd);
+
+  if ((port->resume_pending != 0U) && (epnum != 0U))
+  {
+    port->resume_pending = 0U;
+    port->lp.resume_cycles_last = DWT->CYCCNT - port->resume_cycles;
+    port->lp.resume_cycles_max = MAX(port->lp.resume_cycles_max, port->lp.resume_cycles_last);
+    port->lp.resume_frames_last = port->resume_sofs;
+  }
+  if ((port->wake_state == LP_WAKE_REPORT) && (epnum != 0U))
+  {
+    port->wake_state = LP_WAKE_IDLE;
+    port->lp.wake_cycles_last = DWT->CYCCNT - port->wake_cycles;
+    port->lp.wake_cycles_max = MAX(port->lp.wake_cycles_max, port->lp.wake_cycles_last);
+  }
+  if (epnum != 0U)
+  {
+    /* Device-to-host streams (bulk, stripe, macro playback) are activity
+       too, not only what the host sends */
+    ClockGov_Activity();
+    /* xfer_count is not kept up in DMA mode; an IN transfer always
+       completes in full */
+    USBD_Bench_Bytes((USBD_HandleTypeDef*)hpcd->pData, hpcd->IN_ep[epnum].xfer_len);
+  }
   USBD_LL_DataInStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
 }
 
@@ -175,12 +379,26 @@ void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
   * @retval None
   */
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
-static void PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
+USBD_RAMFUNC static void PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 #else
-void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
+USBD_RAMFUNC void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_SOF((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  USBD_Port_HandleTypeDef *port = USBD_PORT(pdev);
+  USBD_Port_HandleTypeDef *fs = LP_Port(DEVICE_FS);
+
+  if (port->resume_pending != 0U)
+  {
+    port->resume_sofs++;
+  }
+  /* One SOF stream paces the governor's idle count: OTG_FS's, or the
+     other port's while OTG_FS is unplugged */
+  if ((pdev->id == DEVICE_FS) || (fs == NULL) || (fs->conn.state == USBD_CONN_DETACHED))
+  {
+    ClockGov_SOF();
+  }
+  USBD_LL_SOF(pdev);
 }
 
 /**
@@ -194,6 +412,8 @@ static void PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  USBD_Port_HandleTypeDef *port = USBD_PORT(pdev);
   USBD_SpeedTypeDef speed = USBD_SPEED_FULL;
 
   if ( hpcd->Init.speed == PCD_SPEED_HIGH)
@@ -213,6 +433,21 @@ void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 
   /* Reset Device. */
   USBD_LL_Reset((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_UsrLog("port %u: bus reset, speed %u", pdev->id, speed);
+
+  port->conn.resets++;
+  if (port->conn.state == USBD_CONN_DETACHED)
+  {
+    Conn_Attached(pdev);
+  }
+  else if (port->conn.state == USBD_CONN_CONFIGURED)
+  {
+    /* Host re-enumerates: time it from here */
+    port->attach_tick = HAL_GetTick();
+  }
+  Conn_SetState(pdev, USBD_CONN_ENUMERATING);
+  port->resume_pending = 0U;
+  port->wake_state = LP_WAKE_IDLE;
 }
 
 /**
@@ -227,16 +462,22 @@ static void PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  USBD_Port_HandleTypeDef *port = LL_PORT(hpcd);
+
   /* Inform USB library that core enters in suspend Mode. */
   USBD_LL_Suspend((USBD_HandleTypeDef*)hpcd->pData);
   __HAL_PCD_GATE_PHYCLOCK(hpcd);
   /* Enter in STOP mode. */
   /* USER CODE BEGIN 2 */
-  if (hpcd->Init.low_power_enable)
+  /* STOP is entered from the main loop once it sees the suspended state,
+     so no SLEEPONEXIT here: the loop must not run while suspended. */
+  port->lp.suspends++;
+  port->resume_pending = 0U;
+  if (port->wake_state == LP_WAKE_REPORT)
   {
-    /* Set SLEEPDEEP bit and SleepOnExit of Cortex System Control Register. */
-    SCB->SCR |= (uint32_t)((uint32_t)(SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk));
+    port->wake_state = LP_WAKE_IDLE;
   }
+  USBD_Trace_Record((USBD_HandleTypeDef*)hpcd->pData, USBD_TRACE_EV_POWER, 0U);
   /* USER CODE END 2 */
 }
 
@@ -253,7 +494,13 @@ void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
   /* USER CODE BEGIN 3 */
-
+  if (hpcd->Init.low_power_enable)
+  {
+    /* Usually already done by the wakeup EXTI handler */
+    SCB->SCR &= (uint32_t)~((uint32_t)(SCB_SCR_SLEEPDEEP_Msk | SCB_SCR_SLEEPONEXIT_Msk));
+    SystemClock_Restore();
+  }
+  LP_Resumed((USBD_HandleTypeDef*)hpcd->pData);
   /* USER CODE END 3 */
   USBD_LL_Resume((USBD_HandleTypeDef*)hpcd->pData);
 }
@@ -299,7 +546,13 @@ static void PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DevConnected((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+
+  USBD_LL_DevConnected(pdev);
+  if (USBD_PORT(pdev)->conn.state == USBD_CONN_DETACHED)
+  {
+    Conn_Attached(pdev);
+  }
 }
 
 /**
@@ -313,7 +566,16 @@ static void PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DevDisconnected((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  USBD_Port_HandleTypeDef *port = USBD_PORT(pdev);
+
+  /* The core calls the class DeInit, which drops all per-session state */
+  USBD_LL_DevDisconnected(pdev);
+
+  port->conn.detaches++;
+  Conn_SetState(pdev, USBD_CONN_DETACHED);
+  port->resume_pending = 0U;
+  port->wake_state = LP_WAKE_IDLE;
 }
 
 /*******************************************************************************
@@ -334,16 +596,16 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   pdev->pData = &hpcd_USB_OTG_FS;
 
   hpcd_USB_OTG_FS.Instance = USB_OTG_FS;
-  hpcd_USB_OTG_FS.Init.dev_endpoints = 4;
+  hpcd_USB_OTG_FS.Init.dev_endpoints = USBD_FS_DEV_ENDPOINTS;
   hpcd_USB_OTG_FS.Init.speed = PCD_SPEED_FULL;
   hpcd_USB_OTG_FS.Init.dma_enable = DISABLE;
   hpcd_USB_OTG_FS.Init.phy_itface = PCD_PHY_EMBEDDED;
-  hpcd_USB_OTG_FS.Init.Sof_enable = DISABLE;
-  hpcd_USB_OTG_FS.Init.low_power_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.Sof_enable = ENABLE;
+  hpcd_USB_OTG_FS.Init.low_power_enable = ENABLE;
   hpcd_USB_OTG_FS.Init.lpm_enable = DISABLE;
-  hpcd_USB_OTG_FS.Init.vbus_sensing_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.vbus_sensing_enable = ENABLE;
   hpcd_USB_OTG_FS.Init.use_dedicated_ep1 = DISABLE;
-  if (HAL_PCD_Init(&hpcd_USB_OTG_FS) != HAL_OK)
+  if (LL_PCD(pdev, Init)(&hpcd_USB_OTG_FS) != HAL_OK)
   {
     Error_Handler( );
   }
@@ -363,10 +625,72 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   HAL_PCD_RegisterIsoOutIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOOUTIncompleteCallback);
   HAL_PCD_RegisterIsoInIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOINIncompleteCallback);
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+  /* 320 words of FIFO RAM: RX shared, one TX FIFO per IN endpoint in use.
+     The HID endpoints need one small packet each (16 words is the minimum
+     depth); the rest goes to bulk IN 0x83, eight 64-byte packets deep so
+     the TXFE refill keeps up with back-to-back packets in a frame. The
+     lean driver carries the same plan in its endpoint table. */
+#if (USBD_LL_LEAN_FS == 0U)
   HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, 0x80);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x40);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x80);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x20);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x10);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, 0x10);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 3, 0x80);
+#endif
   }
+#if (USBD_USE_OTG_HS != 0U)
+  if (pdev->id == DEVICE_HS) {
+  /* Link the driver to the stack. */
+  hpcd_USB_OTG_HS.pData = pdev;
+  pdev->pData = &hpcd_USB_OTG_HS;
+
+  hpcd_USB_OTG_HS.Instance = USB_OTG_HS;
+  hpcd_USB_OTG_HS.Init.dev_endpoints = USBD_HS_DEV_ENDPOINTS;
+  hpcd_USB_OTG_HS.Init.speed = PCD_SPEED_FULL;
+#if (USBD_HS_DMA != 0U)
+  hpcd_USB_OTG_HS.Init.dma_enable = ENABLE;
+#else
+  hpcd_USB_OTG_HS.Init.dma_enable = DISABLE;
+#endif
+  hpcd_USB_OTG_HS.Init.phy_itface = PCD_PHY_EMBEDDED;
+  hpcd_USB_OTG_HS.Init.Sof_enable = ENABLE;
+  hpcd_USB_OTG_HS.Init.low_power_enable = ENABLE;
+  hpcd_USB_OTG_HS.Init.lpm_enable = DISABLE;
+  hpcd_USB_OTG_HS.Init.vbus_sensing_enable = ENABLE;
+  hpcd_USB_OTG_HS.Init.use_dedicated_ep1 = DISABLE;
+  hpcd_USB_OTG_HS.Init.use_external_vbus = DISABLE;
+  if (HAL_PCD_Init(&hpcd_USB_OTG_HS) != HAL_OK)
+  {
+    Error_Handler( );
+  }
+
+#if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
+  /* Register USB PCD CallBacks */
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_SOF_CB_ID, PCD_SOFCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_SETUPSTAGE_CB_ID, PCD_SetupStageCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_RESET_CB_ID, PCD_ResetCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_SUSPEND_CB_ID, PCD_SuspendCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_RESUME_CB_ID, PCD_ResumeCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_CONNECT_CB_ID, PCD_ConnectCallback);
+  HAL_PCD_RegisterCallback(&hpcd_USB_OTG_HS, HAL_PCD_DISCONNECT_CB_ID, PCD_DisconnectCallback);
+
+  HAL_PCD_RegisterDataOutStageCallback(&hpcd_USB_OTG_HS, PCD_DataOutStageCallback);
+  HAL_PCD_RegisterDataInStageCallback(&hpcd_USB_OTG_HS, PCD_DataInStageCallback);
+  HAL_PCD_RegisterIsoOutIncpltCallback(&hpcd_USB_OTG_HS, PCD_ISOOUTIncompleteCallback);
+  HAL_PCD_RegisterIsoInIncpltCallback(&hpcd_USB_OTG_HS, PCD_ISOINIncompleteCallback);
+#endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+  /* 1024 words of FIFO RAM, so the same layout as OTG_FS with room to
+     spare: a deeper RX FIFO for back-to-back OUT packets, 64 words for
+     each HID endpoint and sixteen bulk packets on 0x83. 960 words used;
+     with DMA the core keeps its DMA address registers in the last words
+     of the FIFO RAM, so the rest stays unallocated. */
+  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_HS, 0x200);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 0, 0x40);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 1, 0x40);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 2, 0x40);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_HS, 3, 0x100);
+  }
+#endif
   return USBD_OK;
 }
 
@@ -380,7 +704,7 @@ USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev)
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_DeInit(pdev->pData);
+  hal_status = LL_PCD(pdev, DeInit)(pdev->pData);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -397,7 +721,7 @@ USBD_StatusTypeDef USBD_LL_Start(USBD_HandleTypeDef *pdev)
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_Start(pdev->pData);
+  hal_status = LL_PCD(pdev, Start)(pdev->pData);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -414,7 +738,7 @@ USBD_StatusTypeDef USBD_LL_Stop(USBD_HandleTypeDef *pdev)
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_Stop(pdev->pData);
+  hal_status = LL_PCD(pdev, Stop)(pdev->pData);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -434,7 +758,7 @@ USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uin
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_Open(pdev->pData, ep_addr, ep_mps, ep_type);
+  hal_status = LL_PCD(pdev, EP_Open)(pdev->pData, ep_addr, ep_mps, ep_type);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -452,7 +776,7 @@ USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_Close(pdev->pData, ep_addr);
+  hal_status = LL_PCD(pdev, EP_Close)(pdev->pData, ep_addr);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -470,7 +794,7 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_Flush(pdev->pData, ep_addr);
+  hal_status = LL_PCD(pdev, EP_Flush)(pdev->pData, ep_addr);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -483,12 +807,12 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   * @param  ep_addr: Endpoint number
   * @retval USBD status
   */
-USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 {
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_SetStall(pdev->pData, ep_addr);
+  hal_status = LL_PCD(pdev, EP_SetStall)(pdev->pData, ep_addr);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -501,12 +825,12 @@ USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   * @param  ep_addr: Endpoint number
   * @retval USBD status
   */
-USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 {
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_ClrStall(pdev->pData, ep_addr);
+  hal_status = LL_PCD(pdev, EP_ClrStall)(pdev->pData, ep_addr);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -523,6 +847,10 @@ uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 {
   PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef*) pdev->pData;
 
+  if ((ep_addr & 0x7FU) >= hpcd->Init.dev_endpoints)
+  {
+    return 0U;
+  }
   if((ep_addr & 0x80) == 0x80)
   {
     return hpcd->IN_ep[ep_addr & 0x7F].is_stall;
@@ -539,12 +867,12 @@ uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
   * @param  dev_addr: Device address
   * @retval USBD status
   */
-USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr)
 {
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_SetAddress(pdev->pData, dev_addr);
+  hal_status = LL_PCD(pdev, SetAddress)(pdev->pData, dev_addr);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -559,12 +887,12 @@ USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_a
   * @param  size: Data size
   * @retval USBD status
   */
-USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
 {
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_Transmit(pdev->pData, ep_addr, pbuf, size);
+  hal_status = LL_PCD(pdev, EP_Transmit)(pdev->pData, ep_addr, pbuf, size);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -579,12 +907,12 @@ USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, u
   * @param  size: Data size
   * @retval USBD status
   */
-USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
+USBD_RAMFUNC USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint32_t size)
 {
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
-  hal_status = HAL_PCD_EP_Receive(pdev->pData, ep_addr, pbuf, size);
+  hal_status = LL_PCD(pdev, EP_Receive)(pdev->pData, ep_addr, pbuf, size);
 
   usb_status =  USBD_Get_USB_Status(hal_status);
 
@@ -597,11 +925,35 @@ USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_a
   * @param  ep_addr: Endpoint number
   * @retval Received Data Size
   */
-uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+USBD_RAMFUNC uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 {
   return HAL_PCD_EP_GetRxCount((PCD_HandleTypeDef*) pdev->pData, ep_addr);
 }
 
+/**
+  * @brief  Returns the frame number of the last SOF received.
+  * @param  pdev: Device handle
+  * @retval Frame number
+  */
+USBD_RAMFUNC uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef*) pdev->pData;
+  uint32_t USBx_BASE = (uint32_t)hpcd->Instance;
+
+  return (USBx_DEVICE->DSTS & USB_OTG_DSTS_FNSOF) >> USB_OTG_DSTS_FNSOF_Pos;
+}
+
+/**
+  * @brief  Whether the port moves FIFO data by DMA, so transfer buffers
+  *         must be word aligned.
+  * @param  pdev: Device handle
+  * @retval 1 with DMA, 0 otherwise
+  */
+uint8_t USBD_LL_IsDMA(USBD_HandleTypeDef *pdev)
+{
+  return (((PCD_HandleTypeDef*) pdev->pData)->Init.dma_enable != 0U) ? 1U : 0U;
+}
+
 /**
   * @brief  Static single allocation.
   * @param  size: Size of allocated memory
@@ -633,6 +985,218 @@ void USBD_LL_Delay(uint32_t Delay)
   HAL_Delay(Delay);
 }
 
+/**
+  * @brief  Ask the host to resume the bus on behalf of an input event.
+  *         Only accepted on ports that are suspended with remote wakeup
+  *         enabled by the host. Safe from interrupts; the signalling itself
+  *         is driven by USBD_LP_Process() from the main loop.
+  * @retval USBD_OK if a wakeup is under way on at least one port
+  */
+uint8_t USBD_LP_RequestWakeup(void)
+{
+  USBD_HandleTypeDef *pdev;
+  USBD_Port_HandleTypeDef *port;
+  uint8_t status = USBD_FAIL;
+  uint8_t i;
+
+  for (i = 0U; i < USBD_NUM_PORTS; i++)
+  {
+    pdev = (USBD_HandleTypeDef*)LPPcd[i]->pData;
+    port = LP_Port(i);
+    if ((port == NULL) || (pdev->dev_state != USBD_STATE_SUSPENDED) || (pdev->dev_remote_wakeup == 0U))
+    {
+      continue;
+    }
+
+    if (port->wake_state == LP_WAKE_IDLE)
+    {
+      port->wake_cycles = DWT->CYCCNT;
+      port->wake_state = LP_WAKE_REQUESTED;
+    }
+    status = USBD_OK;
+  }
+  return status;
+}
+
+/**
+  * @brief  Drive remote wakeup signalling. Resume K-state is held for the
+  *         shortest time the spec allows (>= 1 ms, two tick edges), then the
+  *         device leaves suspend without waiting for the host's resume.
+  */
+void USBD_LP_Process(void)
+{
+  PCD_HandleTypeDef *hpcd;
+  USBD_Port_HandleTypeDef *port;
+  uint8_t i;
+
+  for (i = 0U; i < USBD_NUM_PORTS; i++)
+  {
+    hpcd = LPPcd[i];
+    port = LP_Port(i);
+    if (port == NULL)
+    {
+      continue;
+    }
+
+    switch (port->wake_state)
+    {
+      case LP_WAKE_REQUESTED:
+        __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+        (void)HAL_PCD_ActivateRemoteWakeup(hpcd);
+        port->wake_tick = HAL_GetTick();
+        port->wake_state = LP_WAKE_SIGNALLING;
+        break;
+
+      case LP_WAKE_SIGNALLING:
+        if ((HAL_GetTick() - port->wake_tick) >= 2U)
+        {
+          (void)HAL_PCD_DeActivateRemoteWakeup(hpcd);
+          port->lp.wakeups++;
+          port->wake_state = LP_WAKE_REPORT;
+          LP_Resumed((USBD_HandleTypeDef*)hpcd->pData);
+          USBD_LL_Resume((USBD_HandleTypeDef*)hpcd->pData);
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+/* Remote wakeup requested or being signalled: the main loop must stay awake */
+uint8_t USBD_LP_WakeupPending(void)
+{
+  USBD_Port_HandleTypeDef *port;
+  uint8_t i;
+
+  for (i = 0U; i < USBD_NUM_PORTS; i++)
+  {
+    port = LP_Port(i);
+    if ((port != NULL) &&
+        ((port->wake_state == LP_WAKE_REQUESTED) || (port->wake_state == LP_WAKE_SIGNALLING)))
+    {
+      return 1U;
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Whether the board may enter STOP: at least one port suspended
+  *         and every other one suspended or unplugged. A port that is still
+  *         enumerated keeps the clocks running.
+  * @retval 1 if the bus side is idle
+  */
+uint8_t USBD_LP_Suspended(void)
+{
+  USBD_HandleTypeDef *pdev;
+  USBD_Port_HandleTypeDef *port;
+  uint8_t suspended = 0U;
+  uint8_t i;
+
+  for (i = 0U; i < USBD_NUM_PORTS; i++)
+  {
+    pdev = (USBD_HandleTypeDef*)LPPcd[i]->pData;
+    port = LP_Port(i);
+    if ((port != NULL) && (pdev->dev_state == USBD_STATE_SUSPENDED))
+    {
+      suspended = 1U;
+    }
+    else if ((port != NULL) && (port->conn.state != USBD_CONN_DETACHED))
+    {
+      return 0U;
+    }
+  }
+  return suspended;
+}
+
+/* Events behind `pending`: each source, with the endpoint interrupts
+   counted per endpoint */
+USBD_RAMFUNC static uint32_t IRQ_CountEvents(USB_OTG_GlobalTypeDef *USBx, uint32_t pending)
+{
+  uint32_t USBx_BASE = (uint32_t)USBx;
+  uint32_t bits = pending & ~(USB_OTG_GINTSTS_IEPINT | USB_OTG_GINTSTS_OEPINT);
+  uint32_t events = 0U;
+
+  if ((pending & (USB_OTG_GINTSTS_IEPINT | USB_OTG_GINTSTS_OEPINT)) != 0U)
+  {
+    bits |= USBx_DEVICE->DAINT & USBx_DEVICE->DAINTMSK;
+  }
+  for (; bits != 0U; bits &= bits - 1U)
+  {
+    events++;
+  }
+  return events;
+}
+
+/* An SOF closes the entries-per-frame window */
+USBD_RAMFUNC static void IRQ_Frame(USBD_Irq_StatsTypeDef *irq)
+{
+  irq->entries_frame_last = irq->entries_frame;
+  irq->entries_frame_max = MAX(irq->entries_frame_max, irq->entries_frame);
+  irq->entries_frame = 0U;
+}
+
+/**
+  * @brief  OTG interrupt of one port: drain every enabled source before
+  *         returning.
+  * @param  hpcd: PCD handle of the port
+  * @param  irqn: its NVIC line
+  * @retval None
+  */
+USBD_RAMFUNC void USBD_LL_IRQService(PCD_HandleTypeDef *hpcd, IRQn_Type irqn)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef*)hpcd->pData;
+  USBD_Irq_StatsTypeDef *irq = &USBD_PORT(pdev)->irq;
+  uint32_t t0 = DWT->CYCCNT;
+  uint32_t pending = USBx->GINTSTS & USBx->GINTMSK;
+  uint32_t events = 0U;
+  uint32_t cycles;
+  uint8_t passes = 0U;
+
+  irq->entries++;
+  if (pending == 0U)
+  {
+    irq->empty++;
+  }
+
+  while ((pending != 0U) && (passes < USBD_IRQ_MAX_PASSES))
+  {
+    if ((pending & USB_OTG_GINTSTS_SOF) != 0U)
+    {
+      IRQ_Frame(irq);
+    }
+    events += IRQ_CountEvents(USBx, pending);
+    LL_PCD(pdev, IRQHandler)(hpcd);
+    passes++;
+    pending = USBx->GINTSTS & USBx->GINTMSK;
+  }
+  irq->entries_frame++;
+  irq->passes += passes;
+  irq->events += events;
+  irq->events_max = (uint16_t)MIN(MAX(irq->events_max, events), 0xFFFFU);
+
+  /* The line stayed asserted through the later passes, so the NVIC holds
+     a stale pending bit for events already served; drop it, and keep it
+     only if something new is there */
+  NVIC_ClearPendingIRQ(irqn);
+  if (pending != 0U)
+  {
+    irq->capped++;
+  }
+  if ((USBx->GINTSTS & USBx->GINTMSK) != 0U)
+  {
+    NVIC_SetPendingIRQ(irqn);
+    irq->tail_chained++;
+  }
+
+  cycles = DWT->CYCCNT - t0;
+  irq->cycles_max = MAX(irq->cycles_max, cycles);
+  USBD_Bench_Irq(pdev, cycles);
+}
+
 /**
   * @brief  Returns the USB status depending on the HAL status:
   * @param  hal_status: HAL status
@@ -36,7 +36,7 @@
 #include "stm32f4xx_hal.h"
 
 /* USER CODE BEGIN INCLUDE */
-
+#include "usbd_log.h"
 /* USER CODE END INCLUDE */
 
 /** @addtogroup USBD_OTG_DRIVER
@@ -82,11 +82,87 @@
 ///* #define for FS and HS identification */
 //#define DEVICE_FS 		0
 //#define DEVICE_HS 		1
-#define USBD_MAX_NUM_INTERFACES       2
+#define USBD_MAX_NUM_INTERFACES       3
+/* OTG_FS on the F429 has four bidirectional endpoints, EP0 included */
+#define USBD_FS_DEV_ENDPOINTS         4U
+/* Endpoint state entries per direction in USBD_HandleTypeDef. The
+   composite uses EP0..3 on either port; the core refuses endpoint numbers
+   from the bus beyond the table (USBD_GetEP). */
+#define USBD_MAX_EP_NUM               4U
+#if (USBD_MAX_EP_NUM < USBD_FS_DEV_ENDPOINTS)
+#error "usbd_conf.h: USBD_MAX_EP_NUM does not cover the OTG_FS endpoints"
+#endif
 #define USBD_MAX_NUM_CONFIGURATION    1
 #ifndef DEVICE_FS
 #define DEVICE_FS 0
 #endif
+#ifndef DEVICE_HS
+#define DEVICE_HS 1
+#endif
+
+/* Second composite device on OTG_HS through its embedded full-speed PHY
+   (PB14/PB15). It is an independent instance: own core handle, FIFO plan,
+   interrupt, low-power and class state, and its own event trace; only the
+   clock governor and the log ring are shared by the board. Opt-in: the
+   board as shipped wires only OTG_FS, so build with USBD_USE_OTG_HS=1 only
+   where PB14/PB15 go to a second connector. */
+#ifndef USBD_USE_OTG_HS
+#define USBD_USE_OTG_HS               0U
+#endif
+/* OTG_HS has six bidirectional endpoints, EP0 included; the composite
+   class uses the same EP1..3 on either port */
+#define USBD_HS_DEV_ENDPOINTS         6U
+
+/* OTG_HS internal DMA: the core's AHB master moves FIFO data itself
+   instead of the CPU in the interrupt. Buffers handed to the LL layer on
+   that port must then be word aligned (the DMA address registers drop the
+   low two bits) and outside CCM RAM, which the master cannot reach; OUT
+   data is stored in whole words. */
+#ifndef USBD_HS_DMA
+#define USBD_HS_DMA                   0U
+#endif
+
+/* Transfer buffer members: word aligned, sized in whole words */
+#define USBD_DMA_ALIGNED              __ALIGNED(4)
+#define USBD_DMA_SIZE(n)              (((n) + 3U) & ~3U)
+
+/* OTG_FS through the lean register-level driver in usbd_ll_fs.c instead
+   of the HAL PCD driver: fixed endpoint table, only the interrupt sources
+   this device uses. OTG_HS always runs on the HAL driver. */
+#ifndef USBD_LL_LEAN_FS
+#define USBD_LL_LEAN_FS               0U
+#endif
+
+/* Placement of the interrupt path, see MDK-ARM/HID/HID.sct. USBD_RAMFUNC
+   code runs from SRAM1: no flash wait states, and its timing no longer
+   depends on ART cache hits. USBD_CCMRAM data goes to the 64 KB CCM RAM,
+   which only the CPU can reach, so never a buffer the OTG_HS DMA uses. */
+#if defined(__CC_ARM)
+#define USBD_RAMFUNC                  __attribute__((section(".ramfunc")))
+#define USBD_CCMRAM                   __attribute__((section(".ccmram"), zero_init))
+#else
+#define USBD_RAMFUNC                  __attribute__((section(".ramfunc")))
+#define USBD_CCMRAM                   __attribute__((section(".ccmram")))
+#endif
+
+/* The class driver is fixed at build time: the core calls the composite's
+   data-path handlers directly instead of loading them from the
+   USBD_ClassTypeDef table, and skips the NULL checks. 0 brings back the
+   pointer dispatch, for comparing cycles per dispatch on the bench. */
+#ifndef USBD_STATIC_CLASS
+#define USBD_STATIC_CLASS             1U
+#endif
+#define USBD_STATIC_CLASS_Setup       USBD_Composite_Setup
+#define USBD_STATIC_CLASS_EP0_RxReady USBD_Composite_EP0_RxReady
+#define USBD_STATIC_CLASS_DataIn      USBD_Composite_DataIn
+#define USBD_STATIC_CLASS_DataOut     USBD_Composite_DataOut
+#define USBD_STATIC_CLASS_SOF         USBD_Composite_SOF
+
+#if (USBD_USE_OTG_HS != 0U)
+#define USBD_NUM_PORTS                2U
+#else
+#define USBD_NUM_PORTS                1U
+#endif
 /**
   * @}
   */
@@ -112,31 +188,31 @@
 ///** Alias for delay. */
 //#define USBD_Delay          HAL_Delay
 
-/* DEBUG macros */
-
-//#if (USBD_DEBUG_LEVEL > 0)
-//#define USBD_UsrLog(...)    printf(__VA_ARGS__);\
-//                            printf("\n");
-//#else
-//#define USBD_UsrLog(...)
-//#endif
+/* DEBUG macros: binary records, see usbd_log.h. Nothing is formatted on
+   the target, so they are cheap enough for the interrupt path. */
+#ifndef USBD_DEBUG_LEVEL
+#define USBD_DEBUG_LEVEL              2U
+#endif
+/* Instance whose vendor channel drains the log */
+#define USBD_LOG_PORT                 DEVICE_FS
 
-//#if (USBD_DEBUG_LEVEL > 1)
+#if (USBD_DEBUG_LEVEL > 0U)
+#define USBD_UsrLog(...)              USBD_LOG(USBD_LOG_USR, __VA_ARGS__)
+#else
+#define USBD_UsrLog(...)              do {} while (0)
+#endif
 
-//#define USBD_ErrLog(...)    printf("ERROR: ") ;\
-//                            printf(__VA_ARGS__);\
-//                            printf("\n");
-//#else
-//#define USBD_ErrLog(...)
-//#endif
+#if (USBD_DEBUG_LEVEL > 1U)
+#define USBD_ErrLog(...)              USBD_LOG(USBD_LOG_ERR, __VA_ARGS__)
+#else
+#define USBD_ErrLog(...)              do {} while (0)
+#endif
 
-//#if (USBD_DEBUG_LEVEL > 2)
-//#define USBD_DbgLog(...)    printf("DEBUG : ") ;\
-//                            printf(__VA_ARGS__);\
-//                            printf("\n");
-//#else
-//#define USBD_DbgLog(...)
-//#endif
+#if (USBD_DEBUG_LEVEL > 2U)
+#define USBD_DbgLog(...)              USBD_LOG(USBD_LOG_DBG, __VA_ARGS__)
+#else
+#define USBD_DbgLog(...)              do {} while (0)
+#endif
 
 /**
   * @}
@@ -156,6 +232,88 @@
   * @{
   */
 
+/* Suspend/resume bookkeeping. Resume latency runs from the clocks being
+   back after STOP to the first completed transfer on a data IN endpoint.
+   Wake latency runs from the input that requested remote wakeup to that
+   same transfer. */
+typedef struct
+{
+  uint32_t suspends;
+  uint32_t resumes;
+  uint32_t resume_cycles_last;   /* DWT cycles */
+  uint32_t resume_cycles_max;
+  uint16_t resume_frames_last;   /* SOFs seen in the same window */
+  uint32_t wakeups;              /* device-initiated resumes */
+  uint32_t wake_cycles_last;     /* DWT cycles */
+  uint32_t wake_cycles_max;
+} USBD_LP_StatsTypeDef;
+
+uint8_t USBD_LP_RequestWakeup(void);
+void    USBD_LP_Process(void);
+uint8_t USBD_LP_WakeupPending(void);
+uint8_t USBD_LP_Suspended(void);
+
+/* Connection state, driven from the PCD callbacks */
+#define USBD_CONN_DETACHED            0U     /* no VBUS */
+#define USBD_CONN_ATTACHED            1U     /* VBUS valid, no bus reset yet */
+#define USBD_CONN_ENUMERATING         2U     /* bus reset seen, not configured */
+#define USBD_CONN_CONFIGURED          3U
+
+typedef struct
+{
+  uint8_t  state;
+  uint32_t attaches;
+  uint32_t detaches;
+  uint32_t resets;
+  uint32_t configured_ms_last;   /* attach (or first reset) to SET_CONFIGURATION */
+  uint32_t configured_ms_max;
+} USBD_Conn_StatsTypeDef;
+
+/* OTG interrupt servicing. One exception entry runs the PCD handler again
+   while enabled sources remain (at most USBD_IRQ_MAX_PASSES times, so a
+   stream of TXFE refills cannot starve the other port), so events that
+   come in while it runs do not cost another entry and exit. Events are
+   GINTSTS sources plus one per endpoint flagged in DAINT. */
+#ifndef USBD_IRQ_MAX_PASSES
+#define USBD_IRQ_MAX_PASSES           4U
+#endif
+
+typedef struct
+{
+  uint32_t entries;              /* exception entries */
+  uint32_t passes;               /* PCD handler runs */
+  uint32_t events;
+  uint32_t empty;                /* entries that found nothing pending */
+  uint32_t tail_chained;         /* exits with the line pending again */
+  uint32_t capped;               /* entries left with events after the last pass */
+  uint16_t events_max;           /* per entry */
+  uint16_t entries_frame;        /* entries since the last SOF */
+  uint16_t entries_frame_last;   /* entries in the last complete frame */
+  uint16_t entries_frame_max;
+  uint32_t cycles_max;           /* DWT cycles of the worst entry, handler to exit */
+} USBD_Irq_StatsTypeDef;
+
+/* Everything the LL layer keeps about one port. It lives in the device
+   instance (USBD_PORT(pdev), usbd_composite.h), so ports share no LL
+   bookkeeping and their interrupts touch disjoint memory. */
+typedef struct
+{
+  USBD_Conn_StatsTypeDef conn;
+  USBD_LP_StatsTypeDef   lp;
+  USBD_Irq_StatsTypeDef  irq;
+  /* Set on resume until the first report goes out */
+  __IO uint8_t resume_pending;
+  uint32_t resume_cycles;
+  uint16_t resume_sofs;
+  __IO uint8_t wake_state;
+  uint32_t wake_cycles;
+  uint32_t wake_tick;
+  /* HAL tick at attach, start of the reconnect-to-configured window */
+  uint32_t attach_tick;
+} USBD_Port_HandleTypeDef;
+
+void    USBD_LL_IRQService(PCD_HandleTypeDef *hpcd, IRQn_Type irqn);
+
 /* Exported functions -------------------------------------------------------*/
 //void *USBD_static_malloc(uint32_t size);
 //void USBD_static_free(void *p);
@@ -0,0 +1,664 @@
+/* Target/usbd_ll_fs.c */
+#include "usbd_ll_fs.h"
+#include "usbd_def.h"
+#include "clock_gov.h"
+
+#if (USBD_LL_LEAN_FS != 0U)
+
+#define USBx_BASE           ((uint32_t)USBx)
+
+/* Endpoint table: EP0 and the three data endpoints, TX FIFO depth of each
+   in words. Same FIFO plan as the HAL path in USBD_LL_Init. */
+#define LLFS_RX_FIFO_WORDS  0x80U
+#define LLFS_NUM_EP         USBD_FS_DEV_ENDPOINTS
+#define LLFS_EP_MASK        ((1U << LLFS_NUM_EP) - 1U)
+
+static const uint16_t LLFS_TxFifoWords[LLFS_NUM_EP] = { 0x20U, 0x10U, 0x10U, 0x80U };
+
+/* The only sources this device needs: no ISO, no LPM, no host mode */
+#define LLFS_GINTMSK        (USB_OTG_GINTMSK_USBRST | USB_OTG_GINTMSK_ENUMDNEM | USB_OTG_GINTMSK_IEPINT | \
+                             USB_OTG_GINTMSK_OEPINT | USB_OTG_GINTMSK_RXFLVLM | USB_OTG_GINTMSK_USBSUSPM | \
+                             USB_OTG_GINTMSK_WUIM | USB_OTG_GINTMSK_SOFM | USB_OTG_GINTMSK_SRQIM | \
+                             USB_OTG_GINTMSK_OTGINT)
+
+/* GRXSTSP packet status */
+#define LLFS_STS_DATA_UPDT  2U
+#define LLFS_STS_SETUP_UPDT 6U
+
+/* Lowest set bit of a non-zero mask */
+#define LLFS_LOWEST(bits)   ((uint8_t)__CLZ(__RBIT(bits)))
+
+USBD_RAMFUNC static void LLFS_FlushTxFifo(USB_OTG_GlobalTypeDef *USBx, uint32_t num)
+{
+  USBx->GRSTCTL = USB_OTG_GRSTCTL_TXFFLSH | (num << USB_OTG_GRSTCTL_TXFNUM_Pos);
+  while ((USBx->GRSTCTL & USB_OTG_GRSTCTL_TXFFLSH) != 0U)
+  {
+  }
+}
+
+static void LLFS_FlushRxFifo(USB_OTG_GlobalTypeDef *USBx)
+{
+  USBx->GRSTCTL = USB_OTG_GRSTCTL_RXFFLSH;
+  while ((USBx->GRSTCTL & USB_OTG_GRSTCTL_RXFFLSH) != 0U)
+  {
+  }
+}
+
+/* EP0 OUT ready for up to three back-to-back SETUP packets */
+USBD_RAMFUNC static void LLFS_EP0_OutStart(USB_OTG_GlobalTypeDef *USBx)
+{
+  USBx_OUTEP(0U)->DOEPTSIZ = (3U << USB_OTG_DOEPTSIZ_STUPCNT_Pos) | (1U << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | (3U * 8U);
+}
+
+/* Pop `len` bytes of the packet at the head of the RX FIFO */
+USBD_RAMFUNC static void LLFS_ReadPacket(USB_OTG_GlobalTypeDef *USBx, uint8_t *dest, uint16_t len)
+{
+  uint32_t words = len / 4U;
+  uint32_t rem = len % 4U;
+  uint32_t data;
+
+  for (; words != 0U; words--)
+  {
+    __UNALIGNED_UINT32_WRITE(dest, USBx_DFIFO(0U));
+    dest += 4U;
+  }
+  if (rem != 0U)
+  {
+    data = USBx_DFIFO(0U);
+    for (; rem != 0U; rem--)
+    {
+      *dest++ = (uint8_t)data;
+      data >>= 8;
+    }
+  }
+}
+
+/* Fill the TX FIFO of `epnum` with as many packets as fit */
+USBD_RAMFUNC static void LLFS_WriteEmptyTxFifo(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[epnum];
+  uint32_t len, words;
+
+  while (ep->xfer_count < ep->xfer_len)
+  {
+    len = MIN(ep->xfer_len - ep->xfer_count, ep->maxpacket);
+    words = (len + 3U) / 4U;
+    if ((USBx_INEP(epnum)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) < words)
+    {
+      return;
+    }
+    for (; words != 0U; words--)
+    {
+      USBx_DFIFO(epnum) = __UNALIGNED_UINT32_READ(ep->xfer_buff);
+      ep->xfer_buff += 4U;
+    }
+    /* The last word may run past the packet; keep the buffer on it */
+    ep->xfer_buff -= ((len + 3U) & ~3U) - len;
+    ep->xfer_count += len;
+  }
+  USBx_DEVICE->DIEPEMPMSK &= ~(1UL << epnum);
+}
+
+/**
+  * @brief  Core and device init, soft-disconnected. Interrupts stay off
+  *         until USBD_LLFS_Start.
+  */
+HAL_StatusTypeDef USBD_LLFS_Init(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t offset;
+  uint8_t i;
+
+  HAL_PCD_MspInit(hpcd);
+
+  USBx->GAHBCFG &= ~USB_OTG_GAHBCFG_GINT;
+  USBx->GUSBCFG |= USB_OTG_GUSBCFG_PHYSEL;
+
+  /* Core soft reset */
+  while ((USBx->GRSTCTL & USB_OTG_GRSTCTL_AHBIDL) == 0U)
+  {
+  }
+  USBx->GRSTCTL |= USB_OTG_GRSTCTL_CSRST;
+  while ((USBx->GRSTCTL & USB_OTG_GRSTCTL_CSRST) != 0U)
+  {
+  }
+
+  /* Transceiver on, device mode, VBUS sensing on PA9 */
+  USBx->GCCFG = USB_OTG_GCCFG_PWRDWN | USB_OTG_GCCFG_VBUSBSEN;
+  USBx->GUSBCFG &= ~(USB_OTG_GUSBCFG_FHMOD | USB_OTG_GUSBCFG_FDMOD);
+  USBx->GUSBCFG |= USB_OTG_GUSBCFG_FDMOD;
+  while ((USBx->GINTSTS & USB_OTG_GINTSTS_CMOD) != 0U)
+  {
+  }
+
+  USBx_PCGCCTL = 0U;
+  USBx_DEVICE->DCFG |= USB_OTG_DCFG_DSPD;     /* full speed, embedded PHY */
+  USBx_DEVICE->DCTL |= USB_OTG_DCTL_SDIS;
+
+  /* FIFO plan from the endpoint table */
+  USBx->GRXFSIZ = LLFS_RX_FIFO_WORDS;
+  offset = LLFS_RX_FIFO_WORDS;
+  USBx->DIEPTXF0_HNPTXFSIZ = ((uint32_t)LLFS_TxFifoWords[0] << 16) | offset;
+  offset += LLFS_TxFifoWords[0];
+  for (i = 1U; i < LLFS_NUM_EP; i++)
+  {
+    USBx->DIEPTXF[i - 1U] = ((uint32_t)LLFS_TxFifoWords[i] << 16) | offset;
+    offset += LLFS_TxFifoWords[i];
+  }
+  LLFS_FlushTxFifo(USBx, 0x10U);
+  LLFS_FlushRxFifo(USBx);
+
+  USBx_DEVICE->DIEPMSK = 0U;
+  USBx_DEVICE->DOEPMSK = 0U;
+  USBx_DEVICE->DAINTMSK = 0U;
+  for (i = 0U; i < LLFS_NUM_EP; i++)
+  {
+    USBx_INEP(i)->DIEPCTL = 0U;
+    USBx_INEP(i)->DIEPTSIZ = 0U;
+    USBx_INEP(i)->DIEPINT = 0xFB7FU;
+    USBx_OUTEP(i)->DOEPCTL = 0U;
+    USBx_OUTEP(i)->DOEPTSIZ = 0U;
+    USBx_OUTEP(i)->DOEPINT = 0xFB7FU;
+  }
+
+  USBx->GINTMSK = 0U;
+  USBx->GINTSTS = 0xBFFFFFFFU;
+  USBx->GINTMSK = LLFS_GINTMSK;
+
+  for (i = 0U; i < LLFS_NUM_EP; i++)
+  {
+    hpcd->IN_ep[i].is_in = 1U;
+    hpcd->IN_ep[i].num = i;
+    hpcd->IN_ep[i].tx_fifo_num = i;
+    hpcd->IN_ep[i].xfer_len = 0U;
+    hpcd->OUT_ep[i].is_in = 0U;
+    hpcd->OUT_ep[i].num = i;
+    hpcd->OUT_ep[i].xfer_len = 0U;
+  }
+  hpcd->USB_Address = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_DeInit(PCD_HandleTypeDef *hpcd)
+{
+  (void)USBD_LLFS_Stop(hpcd);
+  HAL_PCD_MspDeInit(hpcd);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_Start(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+
+  USBx->GAHBCFG |= USB_OTG_GAHBCFG_GINT;
+  USBx_DEVICE->DCTL &= ~USB_OTG_DCTL_SDIS;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_Stop(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+
+  USBx->GAHBCFG &= ~USB_OTG_GAHBCFG_GINT;
+  USBx_DEVICE->DCTL |= USB_OTG_DCTL_SDIS;
+  LLFS_FlushTxFifo(USBx, 0x10U);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+  uint32_t ctl = ((uint32_t)ep_mps & USB_OTG_DIEPCTL_MPSIZ) | ((uint32_t)ep_type << USB_OTG_DIEPCTL_EPTYP_Pos) |
+                 USB_OTG_DIEPCTL_SD0PID_SEVNFRM | USB_OTG_DIEPCTL_USBAEP;
+  PCD_EPTypeDef *ep;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    ep = &hpcd->IN_ep[num];
+    USBx_DEVICE->DAINTMSK |= 1UL << num;
+    /* EP0 is always active; its size is set up at enumeration */
+    if ((USBx_INEP(num)->DIEPCTL & USB_OTG_DIEPCTL_USBAEP) == 0U)
+    {
+      USBx_INEP(num)->DIEPCTL |= ctl | ((uint32_t)num << USB_OTG_DIEPCTL_TXFNUM_Pos);
+    }
+  }
+  else
+  {
+    ep = &hpcd->OUT_ep[num];
+    USBx_DEVICE->DAINTMSK |= 1UL << (16U + num);
+    if ((USBx_OUTEP(num)->DOEPCTL & USB_OTG_DOEPCTL_USBAEP) == 0U)
+    {
+      USBx_OUTEP(num)->DOEPCTL |= ctl;
+    }
+  }
+
+  ep->maxpacket = ep_mps;
+  ep->type = ep_type;
+  ep->data_pid_start = 0U;
+  ep->is_stall = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    if ((USBx_INEP(num)->DIEPCTL & USB_OTG_DIEPCTL_EPENA) != 0U)
+    {
+      USBx_INEP(num)->DIEPCTL |= USB_OTG_DIEPCTL_SNAK | USB_OTG_DIEPCTL_EPDIS;
+    }
+    USBx_DEVICE->DIEPEMPMSK &= ~(1UL << num);
+    USBx_DEVICE->DAINTMSK &= ~(1UL << num);
+    USBx_INEP(num)->DIEPCTL &= ~(USB_OTG_DIEPCTL_USBAEP | USB_OTG_DIEPCTL_MPSIZ | USB_OTG_DIEPCTL_TXFNUM |
+                                 USB_OTG_DIEPCTL_SD0PID_SEVNFRM | USB_OTG_DIEPCTL_EPTYP);
+  }
+  else
+  {
+    if ((USBx_OUTEP(num)->DOEPCTL & USB_OTG_DOEPCTL_EPENA) != 0U)
+    {
+      USBx_OUTEP(num)->DOEPCTL |= USB_OTG_DOEPCTL_SNAK | USB_OTG_DOEPCTL_EPDIS;
+    }
+    USBx_DEVICE->DAINTMSK &= ~(1UL << (16U + num));
+    USBx_OUTEP(num)->DOEPCTL &= ~(USB_OTG_DOEPCTL_USBAEP | USB_OTG_DOEPCTL_MPSIZ |
+                                  USB_OTG_DOEPCTL_SD0PID_SEVNFRM | USB_OTG_DOEPCTL_EPTYP);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef USBD_LLFS_EP_Flush(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    LLFS_FlushTxFifo(hpcd->Instance, ep_addr & EP_ADDR_MSK);
+  }
+  else
+  {
+    LLFS_FlushRxFifo(hpcd->Instance);
+  }
+  return HAL_OK;
+}
+
+USBD_RAMFUNC HAL_StatusTypeDef USBD_LLFS_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    if (((USBx_INEP(num)->DIEPCTL & USB_OTG_DIEPCTL_EPENA) == 0U) && (num != 0U))
+    {
+      USBx_INEP(num)->DIEPCTL &= ~USB_OTG_DIEPCTL_EPDIS;
+    }
+    USBx_INEP(num)->DIEPCTL |= USB_OTG_DIEPCTL_STALL;
+    hpcd->IN_ep[num].is_stall = 1U;
+  }
+  else
+  {
+    if (((USBx_OUTEP(num)->DOEPCTL & USB_OTG_DOEPCTL_EPENA) == 0U) && (num != 0U))
+    {
+      USBx_OUTEP(num)->DOEPCTL &= ~USB_OTG_DOEPCTL_EPDIS;
+    }
+    USBx_OUTEP(num)->DOEPCTL |= USB_OTG_DOEPCTL_STALL;
+    hpcd->OUT_ep[num].is_stall = 1U;
+  }
+
+  if (num == 0U)
+  {
+    LLFS_EP0_OutStart(USBx);
+  }
+  return HAL_OK;
+}
+
+USBD_RAMFUNC HAL_StatusTypeDef USBD_LLFS_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+  PCD_EPTypeDef *ep;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  /* Data toggle back to DATA0 on bulk and interrupt endpoints */
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    ep = &hpcd->IN_ep[num];
+    USBx_INEP(num)->DIEPCTL &= ~USB_OTG_DIEPCTL_STALL;
+    if ((ep->type == EP_TYPE_INTR) || (ep->type == EP_TYPE_BULK))
+    {
+      USBx_INEP(num)->DIEPCTL |= USB_OTG_DIEPCTL_SD0PID_SEVNFRM;
+    }
+  }
+  else
+  {
+    ep = &hpcd->OUT_ep[num];
+    USBx_OUTEP(num)->DOEPCTL &= ~USB_OTG_DOEPCTL_STALL;
+    if ((ep->type == EP_TYPE_INTR) || (ep->type == EP_TYPE_BULK))
+    {
+      USBx_OUTEP(num)->DOEPCTL |= USB_OTG_DOEPCTL_SD0PID_SEVNFRM;
+    }
+  }
+  ep->is_stall = 0U;
+  return HAL_OK;
+}
+
+USBD_RAMFUNC HAL_StatusTypeDef USBD_LLFS_SetAddress(PCD_HandleTypeDef *hpcd, uint8_t address)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+
+  hpcd->USB_Address = address;
+  USBx_DEVICE->DCFG &= ~USB_OTG_DCFG_DAD;
+  USBx_DEVICE->DCFG |= ((uint32_t)address << USB_OTG_DCFG_DAD_Pos) & USB_OTG_DCFG_DAD;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Arm an IN transfer. EP0 moves one packet per call; the core
+  *         continues a longer reply from the DataIn callback, as with the
+  *         HAL driver.
+  */
+USBD_RAMFUNC HAL_StatusTypeDef USBD_LLFS_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+  PCD_EPTypeDef *ep = &hpcd->IN_ep[num];
+  uint32_t pktcnt;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  if (num == 0U)
+  {
+    len = MIN(len, ep->maxpacket);
+  }
+  ep->xfer_buff = pBuf;
+  ep->xfer_len = len;
+  ep->xfer_count = 0U;
+
+  pktcnt = (len == 0U) ? 1U : ((len + ep->maxpacket - 1U) / ep->maxpacket);
+  USBx_INEP(num)->DIEPTSIZ = (pktcnt << USB_OTG_DIEPTSIZ_PKTCNT_Pos) | len;
+  USBx_INEP(num)->DIEPCTL |= USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA;
+
+  /* The TXFE interrupt feeds the FIFO */
+  if (len != 0U)
+  {
+    USBx_DEVICE->DIEPEMPMSK |= 1UL << num;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Arm an OUT transfer of up to `len` bytes, in whole packets.
+  */
+USBD_RAMFUNC HAL_StatusTypeDef USBD_LLFS_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t num = ep_addr & EP_ADDR_MSK;
+  PCD_EPTypeDef *ep = &hpcd->OUT_ep[num];
+  uint32_t pktcnt;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    return HAL_ERROR;
+  }
+
+  if (num == 0U)
+  {
+    len = MIN(len, ep->maxpacket);
+  }
+  ep->xfer_buff = pBuf;
+  ep->xfer_len = len;
+  ep->xfer_count = 0U;
+
+  pktcnt = (len == 0U) ? 1U : ((len + ep->maxpacket - 1U) / ep->maxpacket);
+  if (num == 0U)
+  {
+    /* Keep SETUP reception armed alongside the data stage */
+    USBx_OUTEP(0U)->DOEPTSIZ = (3U << USB_OTG_DOEPTSIZ_STUPCNT_Pos) | (1U << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | ep->maxpacket;
+  }
+  else
+  {
+    USBx_OUTEP(num)->DOEPTSIZ = (pktcnt << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | (pktcnt * ep->maxpacket);
+  }
+  USBx_OUTEP(num)->DOEPCTL |= USB_OTG_DOEPCTL_CNAK | USB_OTG_DOEPCTL_EPENA;
+  return HAL_OK;
+}
+
+/* RX FIFO level: one OUT or SETUP packet, straight into its buffer */
+USBD_RAMFUNC static void LLFS_RxLevel(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t sts = USBx->GRXSTSP;
+  uint8_t num = (uint8_t)(sts & USB_OTG_GRXSTSP_EPNUM);
+  uint16_t bcnt = (uint16_t)((sts & USB_OTG_GRXSTSP_BCNT) >> USB_OTG_GRXSTSP_BCNT_Pos);
+  uint32_t pktsts = (sts & USB_OTG_GRXSTSP_PKTSTS) >> USB_OTG_GRXSTSP_PKTSTS_Pos;
+  PCD_EPTypeDef *ep;
+  uint32_t words;
+
+  if (num >= LLFS_NUM_EP)
+  {
+    /* Not ours: drain it */
+    for (words = (bcnt + 3U) / 4U; words != 0U; words--)
+    {
+      (void)USBx_DFIFO(0U);
+    }
+    return;
+  }
+
+  ep = &hpcd->OUT_ep[num];
+  if ((pktsts == LLFS_STS_DATA_UPDT) && (bcnt != 0U))
+  {
+    LLFS_ReadPacket(USBx, ep->xfer_buff, bcnt);
+    ep->xfer_buff += bcnt;
+    ep->xfer_count += bcnt;
+  }
+  else if (pktsts == LLFS_STS_SETUP_UPDT)
+  {
+    LLFS_ReadPacket(USBx, (uint8_t *)hpcd->Setup, 8U);
+    ep->xfer_count += bcnt;
+  }
+}
+
+USBD_RAMFUNC static void LLFS_OutEndpoints(PCD_HandleTypeDef *hpcd, uint32_t bits)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t epint;
+  uint8_t num;
+
+  for (; bits != 0U; bits &= bits - 1U)
+  {
+    num = LLFS_LOWEST(bits);
+    epint = USBx_OUTEP(num)->DOEPINT & USBx_DEVICE->DOEPMSK;
+    USBx_OUTEP(num)->DOEPINT = epint;
+
+    if ((epint & USB_OTG_DOEPINT_XFRC) != 0U)
+    {
+      if ((num == 0U) && (hpcd->OUT_ep[0].xfer_len == 0U))
+      {
+        /* Status stage done */
+        LLFS_EP0_OutStart(USBx);
+      }
+      HAL_PCD_DataOutStageCallback(hpcd, num);
+    }
+    if ((epint & USB_OTG_DOEPINT_STUP) != 0U)
+    {
+      HAL_PCD_SetupStageCallback(hpcd);
+    }
+  }
+}
+
+USBD_RAMFUNC static void LLFS_InEndpoints(PCD_HandleTypeDef *hpcd, uint32_t bits)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t epint;
+  uint8_t num;
+
+  for (; bits != 0U; bits &= bits - 1U)
+  {
+    num = LLFS_LOWEST(bits);
+    epint = USBx_INEP(num)->DIEPINT &
+            (USBx_DEVICE->DIEPMSK | (((USBx_DEVICE->DIEPEMPMSK >> num) & 1U) << 7));
+
+    if ((epint & USB_OTG_DIEPINT_XFRC) != 0U)
+    {
+      USBx_DEVICE->DIEPEMPMSK &= ~(1UL << num);
+      USBx_INEP(num)->DIEPINT = USB_OTG_DIEPINT_XFRC;
+      HAL_PCD_DataInStageCallback(hpcd, num);
+    }
+    if ((epint & USB_OTG_DIEPINT_TXFE) != 0U)
+    {
+      LLFS_WriteEmptyTxFifo(hpcd, num);
+    }
+    /* Timeout and disabled: acknowledge only */
+    USBx_INEP(num)->DIEPINT = epint & ~(USB_OTG_DIEPINT_XFRC | USB_OTG_DIEPINT_TXFE);
+  }
+}
+
+USBD_RAMFUNC static void LLFS_BusReset(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint8_t i;
+
+  USBx_DEVICE->DCTL &= ~USB_OTG_DCTL_RWUSIG;
+  LLFS_FlushTxFifo(USBx, 0x10U);
+
+  for (i = 0U; i < LLFS_NUM_EP; i++)
+  {
+    USBx_INEP(i)->DIEPINT = 0xFB7FU;
+    USBx_INEP(i)->DIEPCTL &= ~USB_OTG_DIEPCTL_STALL;
+    USBx_OUTEP(i)->DOEPINT = 0xFB7FU;
+    USBx_OUTEP(i)->DOEPCTL &= ~USB_OTG_DOEPCTL_STALL;
+    USBx_OUTEP(i)->DOEPCTL |= USB_OTG_DOEPCTL_SNAK;
+  }
+  USBx_DEVICE->DAINTMSK |= 0x10001U;
+  USBx_DEVICE->DOEPMSK = USB_OTG_DOEPMSK_STUPM | USB_OTG_DOEPMSK_XFRCM;
+  USBx_DEVICE->DIEPMSK = USB_OTG_DIEPMSK_XFRCM;
+  USBx_DEVICE->DIEPEMPMSK = 0U;
+
+  USBx_DEVICE->DCFG &= ~USB_OTG_DCFG_DAD;
+  LLFS_EP0_OutStart(USBx);
+}
+
+/* Enumeration done: EP0 at 64 bytes, turnaround time for the current HCLK */
+USBD_RAMFUNC static void LLFS_EnumDone(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+
+  USBx_INEP(0U)->DIEPCTL &= ~USB_OTG_DIEPCTL_MPSIZ;
+  USBx_DEVICE->DCTL |= USB_OTG_DCTL_CGINAK;
+  MODIFY_REG(USBx->GUSBCFG, USB_OTG_GUSBCFG_TRDT, ClockGov_Trdt(HAL_RCC_GetHCLKFreq()) << USB_OTG_GUSBCFG_TRDT_Pos);
+
+  HAL_PCD_ResetCallback(hpcd);
+}
+
+/**
+  * @brief  OTG_FS interrupt: only the sources in LLFS_GINTMSK, only the
+  *         endpoints in the table.
+  */
+USBD_RAMFUNC void USBD_LLFS_IRQHandler(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t gintsts = USBx->GINTSTS & USBx->GINTMSK;
+  uint32_t daint;
+  uint32_t otgint;
+
+  if (gintsts == 0U)
+  {
+    return;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_RXFLVL) != 0U)
+  {
+    USBx->GINTMSK &= ~USB_OTG_GINTMSK_RXFLVLM;
+    LLFS_RxLevel(hpcd);
+    USBx->GINTMSK |= USB_OTG_GINTMSK_RXFLVLM;
+  }
+
+  if ((gintsts & (USB_OTG_GINTSTS_OEPINT | USB_OTG_GINTSTS_IEPINT)) != 0U)
+  {
+    daint = USBx_DEVICE->DAINT & USBx_DEVICE->DAINTMSK;
+    if ((gintsts & USB_OTG_GINTSTS_OEPINT) != 0U)
+    {
+      LLFS_OutEndpoints(hpcd, (daint >> 16) & LLFS_EP_MASK);
+    }
+    if ((gintsts & USB_OTG_GINTSTS_IEPINT) != 0U)
+    {
+      LLFS_InEndpoints(hpcd, daint & LLFS_EP_MASK);
+    }
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_WKUINT) != 0U)
+  {
+    USBx_DEVICE->DCTL &= ~USB_OTG_DCTL_RWUSIG;
+    HAL_PCD_ResumeCallback(hpcd);
+    USBx->GINTSTS = USB_OTG_GINTSTS_WKUINT;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_USBSUSP) != 0U)
+  {
+    if ((USBx_DEVICE->DSTS & USB_OTG_DSTS_SUSPSTS) != 0U)
+    {
+      HAL_PCD_SuspendCallback(hpcd);
+    }
+    USBx->GINTSTS = USB_OTG_GINTSTS_USBSUSP;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_USBRST) != 0U)
+  {
+    LLFS_BusReset(hpcd);
+    USBx->GINTSTS = USB_OTG_GINTSTS_USBRST;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_ENUMDNE) != 0U)
+  {
+    LLFS_EnumDone(hpcd);
+    USBx->GINTSTS = USB_OTG_GINTSTS_ENUMDNE;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_SOF) != 0U)
+  {
+    HAL_PCD_SOFCallback(hpcd);
+    USBx->GINTSTS = USB_OTG_GINTSTS_SOF;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_SRQINT) != 0U)
+  {
+    HAL_PCD_ConnectCallback(hpcd);
+    USBx->GINTSTS = USB_OTG_GINTSTS_SRQINT;
+  }
+
+  if ((gintsts & USB_OTG_GINTSTS_OTGINT) != 0U)
+  {
+    otgint = USBx->GOTGINT;
+    if ((otgint & USB_OTG_GOTGINT_SEDET) != 0U)
+    {
+      HAL_PCD_DisconnectCallback(hpcd);
+    }
+    USBx->GOTGINT = otgint;
+  }
+}
+
+#endif /* USBD_LL_LEAN_FS */
@@ -0,0 +1,46 @@
+/* usbd_ll_fs.h */
+#ifndef __USBD_LL_FS_H
+#define __USBD_LL_FS_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal.h"
+
+/* Lean OTG_FS device driver, used instead of the HAL PCD driver for the
+   OTG_FS port when USBD_LL_LEAN_FS is set in usbd_conf.h.
+
+   Slave mode only, full speed, embedded PHY. It knows the endpoints of
+   this device from a compile-time table (number and TX FIFO depth), opens
+   nothing else and unmasks only the interrupt sources the device uses, so
+   the interrupt walks a handful of bits instead of every endpoint and
+   source the HAL supports.
+
+   Endpoint and setup state stays in the PCD handle with the same meaning
+   as under the HAL, and events go to the same HAL_PCD_*Callback functions
+   in usbd_conf.c, so everything above the LL layer is shared with OTG_HS.
+   The functions mirror their HAL_PCD_* counterparts one for one. There is
+   no locking: as with the rest of the stack, thread-side callers mask
+   interrupts around USB calls. */
+
+HAL_StatusTypeDef USBD_LLFS_Init(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef USBD_LLFS_DeInit(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef USBD_LLFS_Start(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef USBD_LLFS_Stop(PCD_HandleTypeDef *hpcd);
+HAL_StatusTypeDef USBD_LLFS_EP_Open(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint16_t ep_mps, uint8_t ep_type);
+HAL_StatusTypeDef USBD_LLFS_EP_Close(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_LLFS_EP_Flush(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_LLFS_EP_SetStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_LLFS_EP_ClrStall(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+HAL_StatusTypeDef USBD_LLFS_SetAddress(PCD_HandleTypeDef *hpcd, uint8_t address);
+HAL_StatusTypeDef USBD_LLFS_EP_Transmit(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+HAL_StatusTypeDef USBD_LLFS_EP_Receive(PCD_HandleTypeDef *hpcd, uint8_t ep_addr, uint8_t *pBuf, uint32_t len);
+void              USBD_LLFS_IRQHandler(PCD_HandleTypeDef *hpcd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_LL_FS_H */